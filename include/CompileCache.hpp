@@ -0,0 +1,62 @@
+#ifndef _COMPILE_CACHE_HPP_
+#define _COMPILE_CACHE_HPP_
+#include "Module.h"
+#include "Function.h"
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+/*
+ * An on-disk cache of the optimized IR, e.g.
+ *      cminusfc -O2 -cache-dir=.cminus-cache a.cminus
+ * The entries are files named by a hash of what they depend on, which
+ * includes the size and the time of the cminusfc binary, so a rebuilt
+ * compiler never sees the entries of the old one.
+ * A module is cached as a whole in the binary encoding (<hash>.lir), keyed by
+ * the input and the options, so compiling the same input again skips the
+ * front end and the passes.
+ * Otherwise the function passes at the end of the pipeline, after the last
+ * module pass, are cached per function (<hash>.ll): a FunctionPass only looks
+ * at its function, so its result depends on the body it starts from, the
+ * globals and the headers of the functions. After editing one function, the
+ * others still go through the front end and the module passes, which are
+ * cheap, but not through the function passes, which are most of -O2.
+ * An entry is written to a temporary file which is then renamed, so another
+ * cminusfc never reads a partial one, and an entry which can't be read is a
+ * miss.
+ */
+class CompileCache
+{
+public:
+    // dir is created if it doesn't exist
+    CompileCache(const std::string &dir);
+
+    // the module compiled before from the same input and options, nullptr on a miss
+    std::unique_ptr<Module> load_module(const std::string &input, const std::string &options);
+    void store_module(const std::string &input, const std::string &options, Module *m);
+
+    // replace the bodies of the functions of m which the function passes of options have
+    // optimized before, and remember the keys of the others
+    void load_functions(Module *m, const std::string &options);
+    bool is_restored(Function *f) { return restored_.count(f); }
+    // the bodies of the functions which weren't restored, after the function passes
+    void store_functions();
+
+    // split the pipeline after its last module pass
+    static void split_pipeline(const std::string &pipeline, std::string &module_passes, std::string &function_passes);
+
+private:
+    std::string get_path(const std::string &key, const char *extension);
+    // write data to the entry at path
+    void store(const std::string &path, const std::string &data);
+
+    std::string dir_;
+    // the hash of the cminusfc binary
+    std::string compiler_;
+    std::set<Function *> restored_;
+    // the paths of the entries of the functions not restored
+    std::map<Function *, std::string> function_paths_;
+};
+
+#endif
@@ -61,7 +61,8 @@ private:
 // Building IR for Cminus
 class CminusfBuilder: public ASTVisitor {
 public:
-    CminusfBuilder() {
+    // check_bounds: whether every array access is guarded by bounds checks
+    CminusfBuilder(bool check_bounds = false) : check_bounds(check_bounds) {
         // module of current program
         module = std::unique_ptr<Module>(new Module("Cminus code"));
         // IR builder for this module
@@ -99,6 +100,32 @@ public:
                     output_float_type,
                     "outputFloat",
                     module.get());
+        // void inputArray(int[], int n)
+        // it reads n integers from stdin into the array
+        auto TyInt32Ptr = Type::get_int32_ptr_type(module.get());
+        auto TyFloatPtr = Type::get_float_ptr_type(module.get());
+        auto input_array_type = FunctionType::get(TyVoid, {TyInt32Ptr, TyInt32});
+        auto input_array_fun =
+            Function::create(
+                    input_array_type,
+                    "inputArray",
+                    module.get());
+        // void outputArray(int[], int n)
+        // it prints the first n integers of the array to stdout, as n calls of output
+        auto output_array_type = FunctionType::get(TyVoid, {TyInt32Ptr, TyInt32});
+        auto output_array_fun =
+            Function::create(
+                    output_array_type,
+                    "outputArray",
+                    module.get());
+        // void outputFloatArray(float[], int n)
+        // it prints the first n floats of the array to stdout, as n calls of outputFloat
+        auto output_float_array_type = FunctionType::get(TyVoid, {TyFloatPtr, TyInt32});
+        auto output_float_array_fun =
+            Function::create(
+                    output_float_array_type,
+                    "outputFloatArray",
+                    module.get());
         // void neg_index_except(void)
         // report error message and exit
         auto neg_idx_except_type = FunctionType::get(TyVoid, {});
@@ -112,7 +139,22 @@ public:
         scope.push("input", input_fun);
         scope.push("output", output_fun);
         scope.push("outputFloat", output_float_fun);
+        scope.push("inputArray", input_array_fun);
+        scope.push("outputArray", output_array_fun);
+        scope.push("outputFloatArray", output_float_array_fun);
         scope.push("neg_idx_except", neg_idx_except_fun);
+
+        if (check_bounds) {
+            // void idx_out_of_range_except(void)
+            // report error message and exit
+            auto idx_out_of_range_except_type = FunctionType::get(TyVoid, {});
+            auto idx_out_of_range_except_fun =
+                Function::create(
+                        idx_out_of_range_except_type,
+                        "idx_out_of_range_except",
+                        module.get());
+            scope.push("idx_out_of_range_except", idx_out_of_range_except_fun);
+        }
     }
 
     std::unique_ptr<Module> getModule() {
@@ -135,6 +177,10 @@ private:
     virtual void visit(ASTVar &) override final;
     virtual void visit(ASTTerm &) override final;
     virtual void visit(ASTCall &) override final;
+    void create_bounds_check(Value *idx, int size);
+    void create_index_check(Value *is_out, std::string except_func_name);
+    // whether to emit bounds checks for array accesses
+    bool check_bounds;
     // IR builder for this module
     IRBuilder *builder;
     // the scope for variables
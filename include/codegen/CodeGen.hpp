@@ -0,0 +1,135 @@
+#ifndef SYSYC_CODEGEN_HPP
+#define SYSYC_CODEGEN_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "GlobalVariable.h"
+#include "RegAlloc.hpp"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+ * The part of the native backends which does not depend on the target, the
+ * instructions being selected by the backends from LightIR directly:
+ *  - the data of the globals and the constant pool of floats,
+ *  - the blocks reachable from the entry, in their order, with their labels,
+ *  - the registers of the scalar values, given by RegAlloc from the registers
+ *    of the target, hinting the arguments to those they are passed in,
+ *  - the frame below the frame pointer: the callee saved registers, the
+ *    slots of the spilled values and of the vectors, and then the storage of
+ *    the allocas, so the slots are the closest ones to the frame pointer,
+ *  - the elimination of phis by parallel moves at the end of the predecessor,
+ *    or in a block of their own on an edge of a conditional branch; a vector
+ *    phi has a shadow slot, which the predecessors write, and which is copied
+ *    into the slot of the phi at the start of its block,
+ *  - the compares only used by the branch right after them, which the
+ *    target may branch on directly.
+ * An operand is a string in the syntax of the target, and a location is the
+ * operand naming a register or a slot, whatever the width it is used with.
+ */
+class CodeGen
+{
+public:
+    // the registers are given in the order of preference of RegAlloc, frame_reserved is the size of
+    // what the prologue saves right below the frame pointer, and stack_args_offset the offset from
+    // the frame pointer of the first argument passed on the stack
+    CodeGen(Module *m, const std::vector<std::string> &int_regs, const std::vector<std::string> &float_regs,
+            const std::set<std::string> &callee_saved, int frame_reserved, int stack_args_offset)
+        : m_(m), int_regs_(int_regs), float_regs_(float_regs), callee_saved_(callee_saved),
+          frame_reserved_(frame_reserved), stack_args_offset_(stack_args_offset) {}
+    virtual ~CodeGen(){};
+    // the assembly of the whole module
+    std::string generate();
+
+protected:
+    // a move of scalar ty, src is an address to take if is_address
+    struct Move
+    {
+        Type *ty;
+        std::string src;
+        std::string dst;
+        bool is_address;
+    };
+
+    // the registers passing arguments of types, empty for those passed on the stack
+    virtual std::vector<std::string> get_arg_regs(const std::vector<Type *> &types) = 0;
+    // whether the compare instr may be left to the branch using it
+    virtual bool can_fuse(Instruction *instr) { return instr->is_cmp() || instr->is_fcmp(); }
+    // set up the frame of frame_size bytes, save the callee saved registers and move the arguments
+    virtual void generate_prologue(Function *func, int frame_size) = 0;
+    virtual void generate_instr(Instruction *instr) = 0;
+    virtual void emit_jump(const std::string &label) = 0;
+    // the operand of a scalar: an immediate, a constant of the pool, a register or a slot
+    virtual std::string get_operand(Value *val) = 0;
+    // the operand of the address of a global or an alloca
+    virtual std::string get_address_operand(Value *val) = 0;
+    virtual std::string get_frame_operand(int offset) = 0;
+    virtual std::string get_location(const std::string &op) { return op; }
+    // the scratch register holding a value of ty while a cycle of moves is broken
+    virtual std::string get_cycle_scratch(Type *ty) = 0;
+    virtual void emit_move(const Move &move) = 0;
+    virtual void copy_slot(int src_off, int dst_off, int size) = 0;
+    virtual void zero_slot(int offset, int size) = 0;
+
+    // the only target of the branch br, nullptr if it is taken on a condition
+    BasicBlock *get_br_target(Instruction *br);
+    // set the values of the phis of to on the edge from from
+    void generate_edge_moves(BasicBlock *from, BasicBlock *to);
+    // the label a branch of from to to jumps to, a block of the edge if there are phis to set
+    std::string get_edge_label(BasicBlock *from, BasicBlock *to);
+    Move get_move(Value *val, const std::string &dst);
+    // emit the moves as if all their sources were read before any destination is written
+    void emit_parallel_moves(std::vector<Move> moves);
+    // copy the vector val into the slot at offset, e.g. the shadow of a phi
+    void copy_vector(Value *val, int offset);
+    bool has_location(Value *val) { return regs_.count(val) || offsets_.count(val); }
+    std::string get_slot(Value *val) { return get_frame_operand(offsets_.at(val)); }
+    std::string get_label(BasicBlock *bb) { return labels_.at(bb); }
+    std::string get_float_constant(float val);
+    // the size of a value of ty in memory, pointers take 8 bytes
+    static int get_type_size(Type *ty);
+    // the size of a value of ty in a slot, i1 takes 4 bytes like i32
+    static int get_slot_size(Type *ty);
+    void emit(const std::string &line) { asm_ += "    " + line + "\n"; }
+
+    Module *m_;
+    std::string asm_;
+    // { value : its register }
+    std::map<Value *, std::string> regs_;
+    // { value : the offset of its slot from the frame pointer }, for allocas the offset of their storage
+    std::map<Value *, int> offsets_;
+    std::map<PhiInst *, int> shadows_;
+    // { callee saved register : the offset of the slot it is saved in }
+    std::map<std::string, int> saved_regs_;
+    // the block emitted after the current one, to which no jump is needed
+    BasicBlock *next_bb_;
+    // the compares left to the branch using them
+    std::set<Instruction *> fused_;
+
+private:
+    void generate_global(GlobalVariable *global);
+    void generate_constant(Constant *init, Type *ty);
+    void generate_function(Function *func);
+    // assign the locations of the values and the storage of allocas, return the frame size
+    int allocate_frame(Function *func, RegAlloc &reg_alloc);
+
+    std::vector<std::string> int_regs_;
+    std::vector<std::string> float_regs_;
+    std::set<std::string> callee_saved_;
+    int frame_reserved_;
+    int stack_args_offset_;
+    std::map<BasicBlock *, std::string> labels_;
+    // the blocks of the function reachable from its entry, in their order
+    std::vector<BasicBlock *> bbs_;
+    // the edges with a block of their own, which are emitted after the function
+    std::vector<std::pair<BasicBlock *, BasicBlock *>> edges_;
+    // { the bits of a float : its label in the constant pool }
+    std::map<unsigned, std::string> float_constants_;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef SYSYC_INTERPRETER_HPP
+#define SYSYC_INTERPRETER_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "GlobalVariable.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+ * Execution of a module by interpreting its LightIR, e.g. to check the
+ * results of the passes without a toolchain.
+ * Each function is decoded once into ops on the slots of its frame: the
+ * constants, then the arguments, then the values of the instructions, a
+ * vector taking a slot per lane, and then the temporaries of the moves of
+ * phis. The types are resolved when decoding, so an op does not look at the
+ * type of its operands, e.g. a load of i32 and one of a pointer differ.
+ * The phis are set by moves at the end of the predecessor, or in a stub of
+ * their own on an edge of a conditional branch, the branches jump to the
+ * index of their target op, and the ops are dispatched by computed gotos
+ * when the compiler supports them.
+ * The globals live in a buffer of the interpreter, the allocas take their
+ * storage from a stack of their own, which is also reached directly by the
+ * loads, stores and geps of an alloca, and the functions of libcminus_io
+ * linked into cminusfc are called (see cminus_io.h). A call doesn't recurse
+ * in C++, the frame of the caller is pushed and the same loop goes on with
+ * the callee, so a deep recursion ends in a "stack overflow" error instead
+ * of a crash.
+ * An error at run time, e.g. a division by zero, is thrown as a string.
+ */
+class Interpreter
+{
+public:
+    Interpreter(Module *m) : m_(m) {}
+    ~Interpreter(){};
+    // run main, return its result, or 0 if it returns void
+    int run();
+
+private:
+    union Slot
+    {
+        int i;
+        float f;
+        char *p;
+    };
+
+    // the dispatch table of the interpreter lists them in this order
+    enum Opcode
+    {
+        MOV,
+        MOVN,
+        // int binary operators
+        ADD,
+        SUB,
+        MUL,
+        SDIV,
+        SREM,
+        SHL,
+        ASHR,
+        AND,
+        OR,
+        XOR,
+        // float binary operators
+        FADD,
+        FSUB,
+        FMUL,
+        FDIV,
+        // the binary operator c on n lanes
+        VBINARY,
+        // compares of ints, of pointers, and the unordered ones of floats
+        EQ,
+        NE,
+        GT,
+        GE,
+        LT,
+        LE,
+        PEQ,
+        PNE,
+        PGT,
+        PGE,
+        PLT,
+        PLE,
+        FEQ,
+        FNE,
+        FGT,
+        FGE,
+        FLT,
+        FLE,
+        FPTOSI,
+        SITOFP,
+        // loads from the address a and stores of a to the address b, of 1, 4 or 8 bytes, or of n lanes
+        LOAD8,
+        LOAD32,
+        LOAD64,
+        LOADN,
+        STORE8,
+        STORE32,
+        STORE64,
+        STOREN,
+        // the same of the storage of an alloca, at the offset a of the frame, or b for the stores
+        LOAD32_FRAME,
+        LOAD64_FRAME,
+        STORE32_FRAME,
+        STORE64_FRAME,
+        // the storage of an alloca at the offset a of the frame
+        ALLOCA,
+        // the address a plus the offset b, and the address dst plus the index a scaled by b
+        GEP,
+        GEP_INDEX,
+        // the storage of an alloca at the offset a of the frame plus the offset b
+        GEP_FRAME,
+        // the vector a with the lane b replaced by c, and the lane b of the vector a
+        INSERT,
+        EXTRACT,
+        // the call site a
+        CALL,
+        BR,
+        // branch to b if a, to c otherwise
+        CBR,
+        RET,
+        RET_VOID
+    };
+
+    struct Op
+    {
+        Opcode code;
+        int dst;
+        int a;
+        int b;
+        int c;
+        // the lanes of a vector op
+        int n;
+    };
+
+    // the functions of libcminus_io, called by a negative callee
+    enum Builtin
+    {
+        INPUT = -1,
+        OUTPUT = -2,
+        OUTPUT_FLOAT = -3,
+        NEG_IDX_EXCEPT = -4,
+        IDX_OUT_OF_RANGE_EXCEPT = -5,
+        INPUT_ARRAY = -6,
+        OUTPUT_ARRAY = -7,
+        OUTPUT_FLOAT_ARRAY = -8
+    };
+
+    struct CallSite
+    {
+        // the index of the callee in codes_, or a Builtin
+        int callee;
+        // the slot of the result, -1 for void
+        int dst;
+        std::vector<int> args;
+    };
+
+    // a decoded function
+    struct Code
+    {
+        std::vector<Op> ops;
+        // the initial values of the first slots
+        std::vector<Slot> constants;
+        int num_slots;
+        // the size of the storage of the allocas
+        int frame_size;
+    };
+
+    // what a call saves of the caller, until the callee returns to it
+    struct Frame
+    {
+        const Op *ops;
+        const Op *ip;
+        Slot *fp;
+        char *frame;
+        int slot_top;
+        int memory_top;
+        // the slot of the result, -1 for void
+        int dst;
+    };
+
+    // decode func into codes_[index]
+    void decode(Function *func, int index);
+    // the first slot of val, which is made a constant of code if it is one
+    int get_slot(Code &code, Value *val);
+    // append the moves setting the phis of to on the edge from from
+    void decode_edge_moves(Code &code, BasicBlock *from, BasicBlock *to);
+    void init_global(char *data, Constant *init, Type *ty);
+    // execute codes_[index] on the frame fp, whose arguments are set, with the functions it calls
+    Slot execute(int index, Slot *fp);
+    Slot call_builtin(const CallSite &site, Slot *fp);
+    // the size of a value of ty in memory, pointers take 8 bytes
+    static int get_type_size(Type *ty);
+
+    Module *m_;
+    std::vector<Code> codes_;
+    std::map<Function *, int> indices_;
+    std::vector<CallSite> call_sites_;
+    // { value : its first slot in the function being decoded }
+    std::map<Value *, int> slots_;
+    // { block or stub : the index of its first op }, in the function being decoded
+    std::vector<int> labels_;
+    // the temporaries of the moves of phis of the function being decoded
+    int temps_;
+    // the memory of the globals
+    std::vector<char> globals_;
+    std::map<GlobalVariable *, int> global_offsets_;
+    std::unique_ptr<Slot[]> slot_stack_;
+    int slot_top_;
+    std::unique_ptr<char[]> memory_stack_;
+    int memory_top_;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SYSYC_JIT_HPP
+#define SYSYC_JIT_HPP
+
+#include "Module.h"
+#include <string>
+
+/*
+ * Execution of a module in the process of the compiler, with the ORC JIT of
+ * the LLVM the project is built with.
+ * The module is printed as LLVM IR and parsed into LLVM again, then compiled
+ * to native code in memory, which calls the functions of libcminus_io
+ * linked into cminusfc (see cminus_io.h), so neither clang nor a linker is
+ * run.
+ * An error of LLVM, e.g. an IR it does not accept, is thrown as a string.
+ */
+class JIT
+{
+public:
+    JIT(Module *m) : m_(m) {}
+    ~JIT(){};
+    // run main, return its result, or 0 if it returns void
+    int run();
+
+private:
+    Module *m_;
+};
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef SYSYC_REGALLOC_HPP
+#define SYSYC_REGALLOC_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+ * Linear scan register allocation of the scalar values of a function.
+ * The instructions are numbered in the order of the blocks given, and the
+ * liveness of the SSA values is solved on the blocks: a phi defines its value
+ * at the start of its block, and uses each incoming value at the end of the
+ * corresponding predecessor, where the phi is eliminated by a move.
+ * The live interval of a value spans all the positions where it is live.
+ * The intervals are visited by their start, and each takes a free register
+ * of its class (int and pointer, or float); when there is none, the interval
+ * among it and the active ones which ends last is spilled, i.e. it lives in a
+ * stack slot, and the spilled intervals which do not overlap share a slot.
+ * An interval containing a call only takes a callee saved register.
+ * Moves are coalesced by preferring the register of the phi or the incoming
+ * values of a value, or the register hinted by the target, e.g. the one an
+ * argument is passed in, if it is free.
+ * The values used nowhere get neither a register nor a slot.
+ */
+class RegAlloc
+{
+public:
+    // the registers are given in the order of preference, each one is either in int_regs or in float_regs
+    RegAlloc(const std::vector<std::string> &int_regs, const std::vector<std::string> &float_regs,
+             const std::set<std::string> &callee_saved)
+        : int_regs_(int_regs), float_regs_(float_regs), callee_saved_(callee_saved) {}
+    ~RegAlloc(){};
+    // allocate the values of func, whose blocks are emitted in the order of bbs
+    void run(Function *func, const std::vector<BasicBlock *> &bbs);
+    // prefer reg for val, which is only taken if it is free and allowed
+    void set_hint(Value *val, const std::string &reg) { hints_[val] = reg; }
+
+    // whether val is a value the allocator takes care of: an int, pointer or float argument or instruction
+    static bool is_allocated(Value *val);
+    // the register of val, empty if val is spilled or dead
+    std::string get_reg(Value *val);
+    // the stack slot of val, -1 if val is in a register or dead
+    int get_slot(Value *val);
+    int get_num_slots() { return num_slots_; }
+    // the callee saved registers assigned to some value, to be saved by the function
+    const std::set<std::string> &get_used_callee_saved() { return used_callee_saved_; }
+
+private:
+    struct Interval
+    {
+        Value *val;
+        int start;
+        int end;
+        bool used;
+        bool is_float;
+        bool crosses_call;
+        std::string reg;
+    };
+
+    void number_instrs(const std::vector<BasicBlock *> &bbs);
+    void compute_liveness(const std::vector<BasicBlock *> &bbs);
+    void build_intervals(Function *func, const std::vector<BasicBlock *> &bbs);
+    void scan();
+    void assign_slots();
+    // extend the interval of val to pos, a use makes the value live
+    void extend(Value *val, int pos, bool is_use);
+    // the register val prefers, empty if none is free and allowed
+    std::string get_hint(Interval &interval, std::set<std::string> &free_regs);
+    bool is_allowed(Interval &interval, const std::string &reg)
+    {
+        return !interval.crosses_call || callee_saved_.count(reg);
+    }
+
+    std::vector<std::string> int_regs_;
+    std::vector<std::string> float_regs_;
+    std::set<std::string> callee_saved_;
+    std::map<Value *, std::string> hints_;
+    // the values connected by moves, i.e. a phi and its incoming values, a copy and its source
+    std::map<Value *, std::vector<Value *>> related_;
+
+    std::map<Instruction *, int> positions_;
+    std::map<BasicBlock *, std::pair<int, int>> bb_ranges_;
+    std::vector<int> call_positions_;
+    std::map<BasicBlock *, std::set<Value *>> live_in_;
+    std::map<BasicBlock *, std::set<Value *>> live_out_;
+    std::map<Value *, Interval> intervals_;
+    // the values in the order their intervals were created, which keeps the allocation deterministic
+    std::vector<Value *> order_;
+    std::vector<Interval *> spilled_;
+
+    std::map<Value *, std::string> regs_;
+    std::map<Value *, int> slots_;
+    int num_slots_;
+    std::set<std::string> used_callee_saved_;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef SYSYC_RISCVCODEGEN_HPP
+#define SYSYC_RISCVCODEGEN_HPP
+
+#include "CodeGen.hpp"
+
+/*
+ * Code generation of RV64GC assembly (GNU syntax, LP64D ABI) from LightIR.
+ *  - a0 - a7, t3 - t5 and s1 - s11 hold the ints and pointers, fa0 - fa7,
+ *    ft2 - ft11 and fs0 - fs11 the floats, and a spilled value is used from
+ *    its slot below s0; t0 - t2, t6, ft0 and ft1 are left as scratch registers,
+ *    t6 only for the addresses of slots past the 12 bit offsets,
+ *  - an i32 is kept sign extended to 64 bits, as the *w instructions leave it,
+ *    and an i1 is kept as 0 or 1,
+ *  - the storage of an alloca is part of the frame, whose address is s0 plus
+ *    its offset, and float constants come from a constant pool,
+ *  - a compare only used by the branch following it is done by the branch,
+ *    an unordered float compare being the negation of an ordered one,
+ *  - vectors live in memory, and are computed lane by lane.
+ */
+class RiscVCodeGen : public CodeGen
+{
+public:
+    RiscVCodeGen(Module *m);
+    ~RiscVCodeGen(){};
+
+private:
+    std::vector<std::string> get_arg_regs(const std::vector<Type *> &types) override;
+    void generate_prologue(Function *func, int frame_size) override;
+    void generate_instr(Instruction *instr) override;
+    void emit_jump(const std::string &label) override { emit("j " + label); }
+    std::string get_operand(Value *val) override;
+    std::string get_address_operand(Value *val) override;
+    std::string get_frame_operand(int offset) override { return std::to_string(offset) + "(s0)"; }
+    std::string get_cycle_scratch(Type *ty) override { return ty->is_float_type() ? "ft1" : "t1"; }
+    void emit_move(const Move &move) override;
+    void copy_slot(int src_off, int dst_off, int size) override { copy_memory("s0", src_off, "s0", dst_off, size); }
+    void zero_slot(int offset, int size) override { zero_memory("s0", offset, size); }
+
+    void generate_binary(Instruction *instr);
+    void generate_vector_binary(Instruction *instr);
+    void generate_cmp(Instruction *instr);
+    void generate_fcmp(Instruction *instr);
+    void generate_call(Instruction *instr);
+    void generate_gep(Instruction *instr);
+    void generate_load(Instruction *instr);
+    void generate_store(Instruction *instr);
+    void generate_insert_element(Instruction *instr);
+    void generate_extract_element(Instruction *instr);
+    void generate_br(Instruction *instr);
+    void generate_ret(Instruction *instr);
+    // compute the ordered float compare whose negation is the fcmp instr into rd
+    void emit_ordered_fcmp(Instruction *instr, const std::string &rd);
+
+    // the register holding val, which is loaded into scratch if needed
+    std::string load_operand(Value *val, const std::string &scratch);
+    // the operand of lane of the vector val
+    std::string get_lane_operand(Value *val, int lane);
+    // the memory operand of the address ptr, which is loaded into t0 if needed
+    std::string get_memory_operand(Value *ptr);
+    // the lane of the vector at offset in the frame indexed by idx, whose address is computed into t2
+    std::string get_indexed_lane(int offset, Value *idx);
+    // compute the binary instruction id of the registers rs1 and rs2 into rd
+    void emit_binary(Instruction::OpID id, const std::string &rd, const std::string &rs1, const std::string &rs2);
+    // the load or store op of reg, the address of which is moved into t6 if its offset takes more than 12 bits
+    void emit_memory(const std::string &op, const std::string &reg, const std::string &mem);
+    // set rd to base plus offset
+    void emit_add_offset(const std::string &rd, const std::string &base, long long offset);
+    // move a scalar of ty, through t0 from memory to memory
+    void emit_move(Type *ty, const std::string &src, const std::string &dst);
+    // copy size bytes from src_off(src) to dst_off(dst), with t2
+    void copy_memory(const std::string &src, int src_off, const std::string &dst, int dst_off, int size);
+    void zero_memory(const std::string &dst, int dst_off, int size);
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SYSYC_X86CODEGEN_HPP
+#define SYSYC_X86CODEGEN_HPP
+
+#include "CodeGen.hpp"
+
+/*
+ * Code generation of x86-64 assembly (AT&T syntax, System V ABI) from LightIR.
+ *  - %rbx, %rsi, %rdi and %r8 - %r15 but %r11 hold the ints and pointers,
+ *    %xmm2 - %xmm14 the floats, and a spilled value is used from its slot below
+ *    %rbp; %rax, %rcx, %rdx, %r11, %xmm0, %xmm1 and %xmm15 are left as scratch
+ *    registers, e.g. for idivl, shifts, and the moves from memory to memory,
+ *  - the storage of an alloca is part of the frame, so its address is leaq'd,
+ *  - i1 is kept as a 32 bit 0 or 1, float constants come from a constant pool,
+ *  - a compare only used by the branch following it sets the flags for it,
+ *  - vectors live in memory, and are computed by 16 bytes with SSE2 where the
+ *    operation exists for the whole vector, and lane by lane otherwise.
+ * The functions declared but not defined, e.g. those of libcminus_io, are
+ * called through the PLT, so the output links as a PIE as well.
+ */
+class X86CodeGen : public CodeGen
+{
+public:
+    X86CodeGen(Module *m);
+    ~X86CodeGen(){};
+
+private:
+    std::vector<std::string> get_arg_regs(const std::vector<Type *> &types) override;
+    bool can_fuse(Instruction *instr) override;
+    void generate_prologue(Function *func, int frame_size) override;
+    void generate_instr(Instruction *instr) override;
+    void emit_jump(const std::string &label) override { emit("jmp " + label); }
+    std::string get_operand(Value *val) override;
+    std::string get_address_operand(Value *val) override;
+    std::string get_frame_operand(int offset) override { return std::to_string(offset) + "(%rbp)"; }
+    std::string get_location(const std::string &op) override;
+    std::string get_cycle_scratch(Type *ty) override;
+    void emit_move(const Move &move) override;
+    void copy_slot(int src_off, int dst_off, int size) override { copy_memory("rbp", src_off, "rbp", dst_off, size); }
+    void zero_slot(int offset, int size) override { zero_memory("rbp", offset, size); }
+
+    void generate_binary(Instruction *instr);
+    void generate_vector_binary(Instruction *instr);
+    void generate_cmp(Instruction *instr);
+    void generate_fcmp(Instruction *instr);
+    void generate_call(Instruction *instr);
+    void generate_gep(Instruction *instr);
+    void generate_load(Instruction *instr);
+    void generate_store(Instruction *instr);
+    void generate_insert_element(Instruction *instr);
+    void generate_extract_element(Instruction *instr);
+    void generate_br(Instruction *instr);
+    void generate_ret(Instruction *instr);
+    // compare the operands of the cmp or fcmp instr, return the condition code of its result
+    std::string emit_compare(Instruction *instr);
+
+    // the operand of lane of the vector val
+    std::string get_lane_operand(Value *val, int lane);
+    // the memory operand pointed to by ptr, which is loaded into %rax if needed
+    std::string get_memory_operand(Value *ptr);
+    // compute the scalar int binary instruction id of the operands lhs and rhs into dst
+    void emit_int_binary(Instruction::OpID id, std::string lhs, std::string rhs, const std::string &dst);
+    // move a scalar of ty, through %r11 from memory to memory
+    void emit_move(Type *ty, const std::string &src, const std::string &dst);
+    void load_pointer(Value *val, const std::string &reg);
+    // copy size bytes from src_off(%src) to dst_off(%dst), with %xmm0 and %rcx
+    void copy_memory(const std::string &src, int src_off, const std::string &dst, int dst_off, int size);
+    void zero_memory(const std::string &dst, int dst_off, int size);
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SYSYC_CMINUS_IO_H
+#define SYSYC_CMINUS_IO_H
+
+/*
+ * The functions of libcminus_io (src/io/io.c), which is also linked into
+ * cminusfc: --run binds the calls of the module to them and --interpret
+ * calls them, so the programs read and write exactly as when they are linked
+ * with the library.
+ */
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+int input();
+void output(int a);
+void outputFloat(float a);
+void inputArray(int a[], int n);
+void outputArray(int a[], int n);
+void outputFloatArray(float a[], int n);
+void neg_idx_except();
+void idx_out_of_range_except();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
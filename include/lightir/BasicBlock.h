@@ -37,6 +37,8 @@ public:
 
     void remove_pre_basic_block(BasicBlock *bb) { pre_bbs_.remove(bb); }
     void remove_succ_basic_block(BasicBlock *bb) { succ_bbs_.remove(bb); }
+    // make the terminator branch to new_succ instead of succ
+    void redirect_succ_basic_block(BasicBlock *succ, BasicBlock *new_succ);
 
     /****************api about cfg****************/
 
@@ -50,6 +52,10 @@ public:
     
     void add_instruction(Instruction *instr);
     void add_instr_begin(Instruction *instr);
+    // insert instr right before pos, which must be in this bb
+    void add_instr_before(Instruction *instr, Instruction *pos);
+    // move instr, which its factory has just added at the end of this bb, right before the terminator
+    Instruction *insert_before_terminator(Instruction *instr);
 
     void delete_instr(Instruction *instr);
 
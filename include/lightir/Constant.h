@@ -14,7 +14,7 @@ private:
     // int value;
 public:
     Constant(Type *ty, const std::string &name = "", unsigned num_ops = 0)
-        : User(ty, name, num_ops) {}
+        : User(ty, name, num_ops) { set_shared_use_list(); } // constants may be used by several functions
     ~Constant() = default;
 };
 
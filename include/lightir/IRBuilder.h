@@ -19,6 +19,13 @@ public:
     BinaryInst *create_isub( Value *lhs, Value *rhs){ return BinaryInst::create_sub( lhs, rhs, this->BB_, m_);}
     BinaryInst *create_imul( Value *lhs, Value *rhs){ return BinaryInst::create_mul( lhs, rhs, this->BB_, m_);}
     BinaryInst *create_isdiv( Value *lhs, Value *rhs){ return BinaryInst::create_sdiv( lhs, rhs, this->BB_, m_);}
+    BinaryInst *create_isrem( Value *lhs, Value *rhs){ return BinaryInst::create_srem( lhs, rhs, this->BB_, m_);}
+
+    BinaryInst *create_shl( Value *lhs, Value *rhs){ return BinaryInst::create_shl( lhs, rhs, this->BB_, m_);}
+    BinaryInst *create_ashr( Value *lhs, Value *rhs){ return BinaryInst::create_ashr( lhs, rhs, this->BB_, m_);}
+    BinaryInst *create_and( Value *lhs, Value *rhs){ return BinaryInst::create_and( lhs, rhs, this->BB_, m_);}
+    BinaryInst *create_or( Value *lhs, Value *rhs){ return BinaryInst::create_or( lhs, rhs, this->BB_, m_);}
+    BinaryInst *create_xor( Value *lhs, Value *rhs){ return BinaryInst::create_xor( lhs, rhs, this->BB_, m_);}
     
     CmpInst *create_icmp_eq( Value *lhs, Value *rhs){ return CmpInst::create_cmp(CmpInst::EQ, lhs, rhs, this->BB_, m_); }
     CmpInst *create_icmp_ne( Value *lhs, Value *rhs){ return CmpInst::create_cmp(CmpInst::NE, lhs, rhs, this->BB_, m_); }
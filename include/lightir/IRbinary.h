@@ -0,0 +1,34 @@
+#ifndef SYSYC_IRBINARY_H
+#define SYSYC_IRBINARY_H
+
+#include "Module.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+/*
+ * A compact binary encoding of a module, to cache or pass it between runs of
+ * the compiler without running the front end again.
+ * The file starts with the magic "LIRB" and the version, then a table of the
+ * types, each used once, then the constants, the globals and the functions
+ * declared, and then the bodies of the functions.
+ * The numbers are unsigned LEB128 varints (zigzag for the signed ones), the
+ * floats are their 4 bytes, and a value is the index in a dense numbering:
+ * the constants, the globals and the functions of the module, then the
+ * arguments, the blocks and the non-void instructions of the function.
+ * Each function lists the types of its instructions first, so an operand
+ * defined later, e.g. by a phi, is read as a placeholder of the right type.
+ * The names of the instructions and the arguments are not kept, they are
+ * numbered again when printed.
+ * A truncated or malformed input is thrown as a string, though the operands
+ * of an instruction are only checked by the asserts of its constructor.
+ */
+
+// the binary encoding of m
+std::string write_binary(Module *m);
+// the module encoded in data, which is only read while reading
+std::unique_ptr<Module> read_binary(const char *data, size_t size);
+// the module encoded in the file path, which is mapped into memory
+std::unique_ptr<Module> read_binary_file(const std::string &path);
+
+#endif // SYSYC_IRBINARY_H
@@ -0,0 +1,37 @@
+#ifndef SYSYC_IRPARSER_H
+#define SYSYC_IRPARSER_H
+
+#include "Module.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * A parser of the subset of LLVM IR printed by LightIR, e.g. the .ll files of
+ * cminusfc -emit-llvm, to run the passes on them without the front end.
+ * The text is read in place, without a separate lexer or copies of its
+ * names. The globals and the headers of the functions are read first, so a
+ * call may come before its callee, and an operand used before it is defined,
+ * e.g. by a phi, is a placeholder of the type given by its use until then.
+ * The blocks keep their names unless they were numbered by the printer, the
+ * instructions and the arguments are numbered again when printed, and the
+ * "; preds = " comment of a block, if any, restores the order of its
+ * predecessors. The "[ undef, %bb ]" operands of a phi, which the printer
+ * adds for the predecessors it has no value from, are dropped.
+ * An error, e.g. a syntax error or an undefined value, is thrown as a string
+ * with its line.
+ * The bodies of single functions can also be read into the functions of an
+ * existing module, whose globals and functions they refer to by name.
+ */
+
+// the module printed in data
+std::unique_ptr<Module> parse_ir(const char *data, size_t size);
+// the module printed in the file path, which is mapped into memory
+std::unique_ptr<Module> parse_ir_file(const std::string &path);
+// the bodies of functions of m printed by Function::print replace the ones they
+// have, except for the malformed texts, whose functions are returned
+std::vector<Function *> parse_function_bodies(Module *m, const std::vector<std::pair<Function *, std::string>> &texts);
+
+#endif // SYSYC_IRPARSER_H
@@ -21,6 +21,14 @@ public:
         sub,
         mul,
         sdiv,
+        srem,
+        // Bitwise binary operators
+        // (and/or/xor are reserved words in C++, hence the trailing underscore)
+        shl,
+        ashr,
+        and_,
+        or_,
+        xor_,
         // float binary operators
         fadd,
         fsub,
@@ -38,7 +46,11 @@ public:
         getelementptr,
         zext, // zero extend
         fptosi,
-        sitofp
+        sitofp,
+        bitcast,
+        // Vector operators
+        insertelement,
+        extractelement
         // float binary operators Logical operators
 
     };
@@ -50,6 +62,9 @@ public:
     inline const BasicBlock *get_parent() const { return parent_; }
     inline BasicBlock *get_parent() { return parent_; }
     void set_parent(BasicBlock *parent) { this->parent_ = parent; }
+    // copy this instruction with the same operands, auto insert to bb
+    // the cfg edges of a copied br are not added, since its targets are usually remapped
+    virtual Instruction *copy_inst(BasicBlock *bb) = 0;
     // Return the function this instruction belongs to.
     Function *get_function();
     Module *get_module();
@@ -64,6 +79,12 @@ public:
             case sub: return "sub"; break;
             case mul: return "mul"; break;
             case sdiv: return "sdiv"; break;
+            case srem: return "srem"; break;
+            case shl: return "shl"; break;
+            case ashr: return "ashr"; break;
+            case and_: return "and"; break;
+            case or_: return "or"; break;
+            case xor_: return "xor"; break;
             case fadd: return "fadd"; break;
             case fsub: return "fsub"; break;
             case fmul: return "fmul"; break;
@@ -79,6 +100,9 @@ public:
             case zext: return "zext"; break;
             case fptosi: return "fptosi"; break;
             case sitofp: return "sitofp"; break;
+            case bitcast: return "bitcast"; break;
+            case insertelement: return "insertelement"; break;
+            case extractelement: return "extractelement"; break;
 
         default: return ""; break;
         }
@@ -99,7 +123,14 @@ public:
     bool is_sub() { return op_id_ == sub; }
     bool is_mul() { return op_id_ == mul; }
     bool is_div() { return op_id_ == sdiv; }
-    bool is_int_instr() { return is_add() || is_sub() || is_mul() || is_div(); }
+    bool is_rem() { return op_id_ == srem; }
+    bool is_shl() { return op_id_ == shl; }
+    bool is_ashr() { return op_id_ == ashr; }
+    bool is_and() { return op_id_ == and_; }
+    bool is_or() { return op_id_ == or_; }
+    bool is_xor() { return op_id_ == xor_; }
+    bool is_bitwise_instr() { return is_shl() || is_ashr() || is_and() || is_or() || is_xor(); }
+    bool is_int_instr() { return is_add() || is_sub() || is_mul() || is_div() || is_rem() || is_bitwise_instr(); }
     bool is_fp_instr() { return is_fadd() || is_fsub() || is_fmul() || is_fdiv(); }
 
 
@@ -116,12 +147,14 @@ public:
     bool is_call() { return op_id_ == call; }
     bool is_gep() { return op_id_ == getelementptr; }
     bool is_zext() { return op_id_ == zext; }
+    bool is_bitcast() { return op_id_ == bitcast; }
+    bool is_insert_element() { return op_id_ == insertelement; }
+    bool is_extract_element() { return op_id_ == extractelement; }
 
 
     bool isBinary()
     {
-        return (is_add() || is_sub() || is_mul() || is_div() ||
-                is_fadd() || is_fsub() || is_fmul() || is_fdiv()) &&
+        return (is_int_instr() || is_fp_instr()) &&
                (get_num_operand() == 2);
     }
 
@@ -152,6 +185,24 @@ public:
     // create Div instruction, auto insert to bb
     static BinaryInst *create_sdiv(Value *v1, Value *v2, BasicBlock *bb, Module *m);
 
+    // create Rem instruction, auto insert to bb
+    static BinaryInst *create_srem(Value *v1, Value *v2, BasicBlock *bb, Module *m);
+
+    // create shl instruction, auto insert to bb
+    static BinaryInst *create_shl(Value *v1, Value *v2, BasicBlock *bb, Module *m);
+
+    // create ashr instruction, auto insert to bb
+    static BinaryInst *create_ashr(Value *v1, Value *v2, BasicBlock *bb, Module *m);
+
+    // create and instruction, auto insert to bb
+    static BinaryInst *create_and(Value *v1, Value *v2, BasicBlock *bb, Module *m);
+
+    // create or instruction, auto insert to bb
+    static BinaryInst *create_or(Value *v1, Value *v2, BasicBlock *bb, Module *m);
+
+    // create xor instruction, auto insert to bb
+    static BinaryInst *create_xor(Value *v1, Value *v2, BasicBlock *bb, Module *m);
+
     // create fadd instruction, auto insert to bb
     static BinaryInst *create_fadd(Value *v1, Value *v2, BasicBlock *bb, Module *m);
 
@@ -164,6 +215,10 @@ public:
     // create fDiv instruction, auto insert to bb
     static BinaryInst *create_fdiv(Value *v1, Value *v2, BasicBlock *bb, Module *m);
 
+    // create instruction id of the type of v1, e.g. an operation on vectors, auto insert to bb
+    static BinaryInst *create(OpID id, Value *v1, Value *v2, BasicBlock *bb);
+
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 private:
@@ -193,6 +248,7 @@ public:
 
     CmpOp get_cmp_op() { return cmp_op_; }
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 private:
@@ -224,6 +280,7 @@ public:
 
     CmpOp get_cmp_op() { return cmp_op_; }
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 private:
@@ -241,6 +298,7 @@ public:
     static CallInst *create(Function *func, std::vector<Value *> args, BasicBlock *bb);
     FunctionType *get_function_type() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 };
 
@@ -258,6 +316,7 @@ public:
 
     bool is_cond_br() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 };
 
@@ -272,6 +331,7 @@ public:
     static ReturnInst *create_void_ret(BasicBlock *bb);
     bool is_void_ret() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 };
 
@@ -285,6 +345,7 @@ public:
     static GetElementPtrInst *create_gep(Value *ptr, std::vector<Value *> idxs, BasicBlock *bb);
     Type *get_element_type() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 private:
@@ -302,6 +363,7 @@ public:
     Value *get_rval() { return this->get_operand(0); }
     Value *get_lval() { return this->get_operand(1); }
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 };
 
@@ -317,6 +379,7 @@ public:
 
     Type *get_load_type() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 };
@@ -331,6 +394,7 @@ public:
 
     Type *get_alloca_type() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 private:
@@ -347,6 +411,7 @@ public:
 
     Type *get_dest_type() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 private:
@@ -363,6 +428,7 @@ public:
 
     Type *get_dest_type() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 private:
@@ -379,18 +445,63 @@ public:
 
     Type *get_dest_type() const;
 
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
+    virtual std::string print() override;
+
+private:
+    Type *dest_ty_;
+};
+
+class BitCastInst : public Instruction
+{
+private:
+    BitCastInst(OpID op, Value *val, Type *ty, BasicBlock *bb);
+
+public:
+    // a pointer cast, e.g. from i32* to <4 x i32>*
+    static BitCastInst *create_bitcast(Value *val, Type *ty, BasicBlock *bb);
+
+    Type *get_dest_type() const;
+
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 
 private:
     Type *dest_ty_;
 };
 
+class InsertElementInst : public Instruction
+{
+private:
+    InsertElementInst(Value *vec, Value *val, Value *idx, BasicBlock *bb);
+
+public:
+    // the vector vec with element idx replaced by val
+    static InsertElementInst *create_insert_element(Value *vec, Value *val, Value *idx, BasicBlock *bb);
+
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
+    virtual std::string print() override;
+};
+
+class ExtractElementInst : public Instruction
+{
+private:
+    ExtractElementInst(Value *vec, Value *idx, BasicBlock *bb);
+
+public:
+    // element idx of the vector vec
+    static ExtractElementInst *create_extract_element(Value *vec, Value *idx, BasicBlock *bb);
+
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
+    virtual std::string print() override;
+};
+
 class PhiInst : public Instruction
 {
 private:
     PhiInst(OpID op, std::vector<Value *> vals, std::vector<BasicBlock *> val_bbs, Type *ty, BasicBlock *bb);
     PhiInst(Type *ty, OpID op, unsigned num_ops, BasicBlock *bb)
-        : Instruction(ty, op, num_ops, bb) {}
+        : Instruction(ty, op, num_ops, bb), l_val_(nullptr) {}
     Value *l_val_;
 
 public:
@@ -402,6 +513,7 @@ public:
         this->add_operand(val);
         this->add_operand(pre_bb);
     }
+    virtual Instruction *copy_inst(BasicBlock *bb) override;
     virtual std::string print() override;
 };
 
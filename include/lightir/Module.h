@@ -4,6 +4,7 @@
 #include <string>
 #include <list>
 #include <map>
+#include <mutex>
 
 #include "Type.h"
 #include "GlobalVariable.h"
@@ -17,6 +18,8 @@ class Module
 public:
     explicit Module(std::string name);
     ~Module();
+
+    std::string get_name() { return module_name_; }
     
     Type *get_void_type();
     Type *get_label_type();
@@ -28,6 +31,7 @@ public:
 
     PointerType *get_pointer_type(Type *contained);
     ArrayType *get_array_type(Type *contained, unsigned num_elements);
+    VectorType *get_vector_type(Type *contained, unsigned num_elements);
 
     void add_function(Function *f);
     std::list<Function* > get_functions();
@@ -54,6 +58,9 @@ private:
     
     std::map<Type *, PointerType *> pointer_map_;
     std::map<std::pair<Type *,int >, ArrayType *> array_map_; 
+    std::map<std::pair<Type *,int >, VectorType *> vector_map_;
+    // the type maps are filled lazily, even by function passes running in parallel
+    std::mutex type_map_mutex_;
 };
 
 #endif // SYSYC_MODULE_H
\ No newline at end of file
@@ -10,6 +10,7 @@ class FunctionType;
 class ArrayType;
 class PointerType;
 class FloatType;
+class VectorType;
 
 class Type
 {
@@ -21,7 +22,8 @@ public:
         FunctionTyID,     // Functions
         ArrayTyID,        // Arrays
         PointerTyID,      // Pointer
-        FloatTyID         // float
+        FloatTyID,        // float
+        VectorTyID        // Vector, e.g. <4 x i32>
     };
 
     explicit Type(TypeID tid, Module *m);
@@ -43,6 +45,8 @@ public:
 
     bool is_float_type() const { return get_type_id() == FloatTyID; }
 
+    bool is_vector_type() const { return get_type_id() == VectorTyID; }
+
     static bool is_eq_type(Type *ty1, Type *ty2);
 
     static Type *get_void_type(Module *m);
@@ -63,10 +67,14 @@ public:
 
     static ArrayType *get_array_type(Type *contained, unsigned num_elements);
 
+    static VectorType *get_vector_type(Type *contained, unsigned num_elements);
+
     Type *get_pointer_element_type();
 
     Type *get_array_element_type();
 
+    Type *get_vector_element_type();
+
     int get_size();
     
     Module *get_module();
@@ -144,4 +152,21 @@ public:
 private:
 };
 
+// a vector of i32 or float, whose operations work on each element
+class VectorType : public Type {
+public:
+    VectorType(Type *contained, unsigned num_elements);
+
+    static bool is_valid_element_type(Type *ty);
+
+    static VectorType *get(Type *contained, unsigned num_elements);
+
+    Type *get_element_type() const { return contained_; }
+    unsigned get_num_of_elements() const { return num_elements_; }
+
+private:
+    Type *contained_;   // The element type of the vector.
+    unsigned num_elements_;  // Number of elements in the vector.
+};
+
 #endif // SYSYC_TYPE_H
\ No newline at end of file
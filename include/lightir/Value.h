@@ -39,9 +39,15 @@ public:
 
     void replace_all_use_with(Value *new_val);
     void remove_use(Value *val);
+    void remove_use(Value *val, unsigned arg_no);
 
     virtual std::string print() = 0;
+protected:
+    // the use list is shared by all the functions of a module (e.g. functions, global variables, constants),
+    // it's locked when updated, since function passes may run on different functions in parallel
+    void set_shared_use_list() { shared_use_list_ = true; }
 private:
+    bool shared_use_list_ = false;
     Type *type_;
     std::list<Use> use_list_;   // who use this value
     std::string name_;    // should we put name field here ?
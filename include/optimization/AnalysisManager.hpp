@@ -0,0 +1,50 @@
+#ifndef SYSYC_ANALYSISMANAGER_HPP
+#define SYSYC_ANALYSISMANAGER_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "Dominators.h"
+#include "LoopSearch.hpp"
+#include <map>
+#include <mutex>
+
+/*
+ * Lazily computes and caches the analyses of each function.
+ * A result is computed the first time a pass asks for it, and is reused by
+ * the following passes until PassManager invalidates it, i.e. until a pass
+ * which doesn't preserve it (see Pass::get_preserved_analyses) has run on the
+ * function. Function passes running in parallel may ask for the results of
+ * different functions at the same time.
+ */
+class AnalysisManager
+{
+public:
+    explicit AnalysisManager(Module *m) : m_(m) {}
+    ~AnalysisManager();
+
+    Dominators *get_dominators(Function *f);
+    LoopSearch *get_loop_search(Function *f);
+
+    // drop the results of f which are not preserved
+    void invalidate(Function *f, unsigned preserved);
+    // drop the results of all the functions which are not preserved
+    void invalidate_all(unsigned preserved);
+
+private:
+    struct Results
+    {
+        Dominators *dominators = nullptr;
+        LoopSearch *loop_search = nullptr;
+    };
+
+    // the results of different functions are only touched by the threads running on them,
+    // so the lock only guards the map
+    Results &get_results(Function *f);
+    void invalidate(Results &results, unsigned preserved);
+
+    Module *m_;
+    std::mutex mutex_;
+    std::map<Function *, Results> results_;
+};
+
+#endif
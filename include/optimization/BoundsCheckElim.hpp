@@ -0,0 +1,62 @@
+#ifndef SYSYC_BOUNDSCHECKELIM_HPP
+#define SYSYC_BOUNDSCHECKELIM_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "Dominators.h"
+#include "PassManager.hpp"
+#include <map>
+#include <climits>
+
+/*
+ * Array bounds check elimination.
+ * A bounds check (emitted by "cminusfc -check-bounds") is a conditional
+ * branch to an exception block, which calls neg_idx_except or
+ * idx_out_of_range_except. The range of the checked index is computed from
+ *  - its definition (constants, arithmetic by constants, induction phis),
+ *  - the conditions of the branches dominating the check, e.g. i < n.
+ * A check that can never fail is replaced by a branch to the block where
+ * the access continues, and its exception block is removed.
+ * This pass should run after Mem2Reg.
+ */
+class BoundsCheckElim : public FunctionPass
+{
+public:
+    BoundsCheckElim(Module *m) : FunctionPass(m) {}
+    ~BoundsCheckElim(){};
+    void run_on_function(Function *func) override;
+
+private:
+    // the range [lo, hi] of an i32 value
+    struct Range
+    {
+        long long lo;
+        long long hi;
+        Range(long long lo = INT_MIN, long long hi = INT_MAX) : lo(lo), hi(hi) {}
+        bool is_full() const { return lo <= INT_MIN && hi >= INT_MAX; }
+    };
+
+    bool is_except_block(BasicBlock *bb);
+    // whether the condition can never be true at the end of bb
+    bool is_always_false(Value *cond, BasicBlock *bb);
+    void remove_check(BranchInst *br);
+
+    // the range of val at the end of bb
+    Range get_range(Value *val, BasicBlock *bb, int depth);
+    // the range of val implied by its definition only
+    Range get_def_range(Value *val, BasicBlock *bb, int depth);
+    Range get_phi_range(PhiInst *phi, int depth);
+    // refine the range of val by the conditions of the branches dominating bb
+    Range refine_by_conditions(Value *val, Range range, BasicBlock *bb, int depth);
+    // refine the range of val, given that "cmp" evaluates to taken
+    Range refine_by_cmp(Value *val, Range range, CmpInst *cmp, bool taken, BasicBlock *bb, int depth);
+
+    Dominators *dominators_ = nullptr;
+    // ranges assumed for the phis being computed, to break cycles
+    std::map<PhiInst *, Range> assumed_;
+};
+
+#endif
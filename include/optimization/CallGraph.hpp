@@ -0,0 +1,56 @@
+#ifndef SYSYC_CALLGRAPH_HPP
+#define SYSYC_CALLGRAPH_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "Instruction.h"
+#include "PassManager.hpp"
+#include <map>
+#include <set>
+#include <vector>
+
+/*
+ * Call graph of the module.
+ * Functions are grouped into strongly connected components, so that direct
+ * and mutual recursion can be detected, and a bottom-up order (callees before
+ * callers) is provided for interprocedural passes.
+ */
+class CallGraph : public Pass
+{
+public:
+    explicit CallGraph(Module *m) : Pass(m) {}
+    ~CallGraph(){};
+    void run() override;
+    unsigned get_preserved_analyses() override { return PRESERVE_CFG; }
+
+    /****************api about CallGraph****************/
+
+    std::set<Function *> &get_callees(Function *f) { return callees_[f]; }
+    std::set<Function *> &get_callers(Function *f) { return callers_[f]; }
+    // all the call instructions in f
+    std::vector<CallInst *> &get_call_sites(Function *f) { return call_sites_[f]; }
+    // whether f may call itself, directly or through other functions
+    bool is_recursive(Function *f) { return recursive_.find(f) != recursive_.end(); }
+    // defined functions, callees come before callers except in recursion
+    std::vector<Function *> &get_bottom_up_order() { return bottom_up_order_; }
+
+    /****************api about CallGraph****************/
+
+private:
+    void strong_connect(Function *f);
+
+    std::map<Function *, std::set<Function *>> callees_;
+    std::map<Function *, std::set<Function *>> callers_;
+    std::map<Function *, std::vector<CallInst *>> call_sites_;
+    std::set<Function *> recursive_;
+    std::vector<Function *> bottom_up_order_;
+
+    // states of Tarjan's algorithm
+    int index_count_;
+    std::map<Function *, int> index_;
+    std::map<Function *, int> low_link_;
+    std::vector<Function *> stack_;
+    std::set<Function *> on_stack_;
+};
+
+#endif
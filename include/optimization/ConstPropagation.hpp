@@ -21,14 +21,13 @@
  *                      if either m(y) or m(z) is NAC, then f(m(x))(x) = NAC
  *                      else, f(m(x))(x) = UNDEF
  */
-class ConstPropagation : public Pass {
+class ConstPropagation : public FunctionPass {
 public:
-    ConstPropagation(Module *m) : Pass(m) {}
+    ConstPropagation(Module *m) : FunctionPass(m) {}
     ~ConstPropagation() {};
     // Do constant propagation in a function, since this is an intra-procedural analysis
     // @param func: the function to be analyzed
-    void process_func(Function *func);
-    void run() override;
+    void run_on_function(Function *func) override;
 private:
 };
 
@@ -7,11 +7,12 @@
 #include <set>
 #include <map>
 
-class Dominators : public Pass{
+class Dominators : public FunctionPass{
 public:
-    explicit Dominators(Module *m) : Pass(m){}
+    explicit Dominators(Module *m) : FunctionPass(m){}
     ~Dominators(){};
-    void run() override;
+    void run_on_function(Function *f) override;
+    unsigned get_preserved_analyses() override { return PRESERVE_CFG; }
     void create_doms(Function *f);
     void create_reverse_post_order(Function *f);
     void create_idom(Function *f);
@@ -0,0 +1,54 @@
+#ifndef SYSYC_GLOBALPROMOTION_HPP
+#define SYSYC_GLOBALPROMOTION_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "GlobalVariable.h"
+#include "CallGraph.hpp"
+#include "PassManager.hpp"
+#include <map>
+#include <memory>
+#include <set>
+
+/*
+ * Promotion of global scalars to local variables.
+ * The globals which a function (or any function it calls) may store to or
+ * load from are summarized as its mod/ref sets. In a function that accesses
+ * a global g, g is copied into a new alloca at the entry, and all the
+ * accesses use the alloca instead. The alloca is synchronized with g only
+ *  - before a call whose callee may access g, if the function stores to g,
+ *  - after a call whose callee may store to g,
+ *  - before a return, if the function stores to g.
+ * Mem2Reg should run after this pass to promote the allocas to registers.
+ */
+class GlobalPromotion : public Pass
+{
+public:
+    GlobalPromotion(Module *m) : Pass(m) {}
+    ~GlobalPromotion(){};
+    void run() override;
+    unsigned get_preserved_analyses() override { return PRESERVE_CFG; }
+
+    /****************api about mod/ref summaries****************/
+
+    // the globals which f may store to, directly or through calls
+    std::set<GlobalVariable *> &get_mod(Function *f) { return mod_[f]; }
+    // the globals which f may load from, directly or through calls
+    std::set<GlobalVariable *> &get_ref(Function *f) { return ref_[f]; }
+
+    /****************api about mod/ref summaries****************/
+
+private:
+    void compute_mod_ref();
+    void promote(Function *func, GlobalVariable *global);
+    // insert a copy of the value in src to dest before pos
+    void insert_copy(Value *src, Value *dest, Instruction *pos);
+
+    std::unique_ptr<CallGraph> call_graph_;
+    std::map<Function *, std::set<GlobalVariable *>> mod_;
+    std::map<Function *, std::set<GlobalVariable *>> ref_;
+};
+
+#endif
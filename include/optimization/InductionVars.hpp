@@ -0,0 +1,84 @@
+#ifndef SYSYC_INDUCTIONVARS_HPP
+#define SYSYC_INDUCTIONVARS_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "LoopSearch.hpp"
+#include <map>
+
+/*
+ * Induction variables of a loop, a lite scalar evolution.
+ * A basic induction variable is a phi of the loop header
+ *      %iv = phi i32 [ %init, %entry ], [ %next, %latch ]
+ *      %next = add i32 %iv, step
+ * where %entry is the only predecessor of the header outside the loop, %latch
+ * is the only latch, and step is a constant.
+ * An affine induction variable is a value of scale * %iv + offset, where
+ * scale is a constant and offset is a loop invariant value plus a constant,
+ * e.g. %iv * 10 + %j + 1.
+ * The loop invariants defined in the loop are integer operations whose
+ * operands are loop invariants; they can be hoisted to %entry.
+ * The bound of a loop is found from the branch of a header which leaves the
+ * loop by comparing a basic induction variable with a loop invariant.
+ */
+class InductionVars
+{
+public:
+    struct BasicIV
+    {
+        PhiInst *phi;
+        Value *init;
+        int step;
+    };
+    // scale * phi + offset_val + offset, offset_val is nullptr if there is no such term
+    struct AffineIV
+    {
+        PhiInst *phi;
+        int scale;
+        Value *offset_val;
+        int offset;
+    };
+    // the loop goes on while "iv op bound" holds
+    struct LoopBound
+    {
+        CmpInst *cond;
+        BasicIV *iv;
+        CmpInst::CmpOp op;
+        Value *bound;
+        // the successors of the header in and out of the loop
+        BasicBlock *body;
+        BasicBlock *exit;
+    };
+
+    InductionVars(Loop *loop);
+
+    // the only predecessor of the header outside the loop, or nullptr
+    BasicBlock *get_entry() { return entry_; }
+    // the basic induction variable of phi, or nullptr
+    BasicIV *get_basic_iv(PhiInst *phi);
+    // whether val is an affine induction variable, which is written to iv
+    bool get_affine_iv(Value *val, AffineIV &iv);
+    bool is_invariant(Value *val);
+    // make an invariant value available at the end of the entry, moving its definition there if needed
+    void hoist(Value *val);
+    // the bound of the loop from the branch of the header, which is hoisted; false if there is no such bound
+    bool get_loop_bound(LoopBound &bound);
+    // the index of an element pointer, getelementptr [N x T], [N x T]* %a, i32 0, i32 idx
+    // or getelementptr T, T* %a, i32 idx, nullptr for the other geps
+    static Value *get_gep_index(Instruction *gep);
+
+private:
+    bool get_affine_iv(Value *val, AffineIV &iv, int depth);
+    // add an invariant term to the offset of iv, false if it can't be represented
+    bool add_offset(AffineIV &iv, Value *val);
+    bool is_invariant(Value *val, int depth);
+
+    Loop *loop_;
+    BasicBlock *entry_ = nullptr;
+    std::map<PhiInst *, BasicIV> basic_ivs_;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SYSYC_INLINER_HPP
+#define SYSYC_INLINER_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "PassManager.hpp"
+#include "CallGraph.hpp"
+#include "LoopSearch.hpp"
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+ * Bottom-up function inliner.
+ * Functions are visited in the bottom-up order of the call graph, so the calls
+ * in a callee have already been inlined when the callee itself is considered.
+ * A call is inlined if the callee is not recursive and its size minus a bonus
+ * for constant arguments is under a threshold, which is higher for calls in
+ * loops. The callee's blocks are cloned into the caller with arguments mapped
+ * to the call operands, and its returns branch to the rest of the call's block.
+ */
+class Inliner : public Pass
+{
+public:
+    Inliner(Module *m) : Pass(m) {}
+    ~Inliner(){};
+    void run() override;
+
+private:
+    bool should_inline(CallInst *call, Function *callee);
+    void inline_call(CallInst *call, Function *callee);
+    // move the instructions after instr into a new bb, which takes over the successors
+    BasicBlock *split_block_after(Instruction *instr);
+    int get_func_size(Function *f);
+
+    std::unique_ptr<CallGraph> call_graph_;
+    std::unordered_set<CallInst *> calls_in_loop_;
+    std::unordered_map<Function *, int> func_size_;
+};
+
+#endif
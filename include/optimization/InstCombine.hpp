@@ -0,0 +1,61 @@
+#ifndef SYSYC_INSTCOMBINE_HPP
+#define SYSYC_INSTCOMBINE_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "PassManager.hpp"
+#include <vector>
+#include <unordered_set>
+
+/*
+ * Peephole instruction combiner.
+ * Every instruction of a function is put into a worklist. An instruction
+ * popped from the worklist is either deleted (no use and no side effect),
+ * or replaced by a simpler value, e.g.
+ *      x + 0, x * 1                    =>  x
+ *      x * 2^k                         =>  x shl k
+ *      x sdiv 2^k                      =>  (x + ((x ashr 31) and 2^k-1)) ashr k
+ *      x - (x sdiv y) * y              =>  x srem y
+ *      icmp ne (zext i1 c to i32), 0   =>  c
+ *      fptosi (sitofp x)               =>  x, if x is exact in float
+ * The users of a replaced value are pushed back into the worklist,
+ * so the pass runs until a fixed point is reached.
+ */
+class InstCombine : public FunctionPass
+{
+public:
+    InstCombine(Module *m) : FunctionPass(m) {}
+    ~InstCombine(){};
+    void run_on_function(Function *func) override;
+    unsigned get_preserved_analyses() override { return PRESERVE_CFG; }
+
+private:
+    // return the value which replaces instr, or nullptr if instr can't be simplified
+    Value *combine(Instruction *instr);
+    Value *combine_int_binary(BinaryInst *instr);
+    Value *combine_fp_binary(BinaryInst *instr);
+    Value *combine_cmp(CmpInst *instr);
+    Value *combine_fcmp(FCmpInst *instr);
+    Value *combine_cast(Instruction *instr);
+    Value *combine_phi(PhiInst *instr);
+
+    // create a new instruction right before pos_
+    BinaryInst *insert_binary(Instruction::OpID op, Value *lhs, Value *rhs);
+    Instruction *insert_before_pos(Instruction *instr);
+
+    void add_to_worklist(Value *val);
+    void add_users_to_worklist(Value *val);
+    void erase(Instruction *instr);
+    bool is_trivially_dead(Instruction *instr);
+
+    // the instruction being combined, new instructions are inserted before it
+    Instruction *pos_;
+    std::vector<Instruction *> worklist_;
+    std::unordered_set<Instruction *> in_worklist_;
+    std::unordered_set<Instruction *> erased_;
+};
+
+#endif
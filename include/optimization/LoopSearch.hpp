@@ -9,69 +9,112 @@
 #include "BasicBlock.h"
 #include <memory>
 #include <vector>
-struct CFGNode;
-using CFGNodePtr = CFGNode*;
-using CFGNodePtrSet = std::unordered_set<CFGNode*>;
+
 using BBset_t = std::unordered_set<BasicBlock *>;
 
+// a loop of the loop nest forest found by LoopSearch
+class Loop{
+public:
+    // the entry block of the loop, i.e. the loop base
+    BasicBlock *get_header() { return header_; }
+    // the loop directly containing this loop, nullptr for an outermost loop
+    Loop *get_parent() { return parent_; }
+    // 1 for an outermost loop
+    int get_depth() { return depth_; }
+    const std::vector<Loop *> &get_sub_loops() { return sub_loops_; }
+    // the blocks of the loop including those of its sub loops, the header comes first
+    const std::vector<BasicBlock *> &get_blocks() { return blocks_; }
+    const BBset_t &get_block_set() { return block_set_; }
+    bool contains(BasicBlock *bb) { return block_set_.find(bb) != block_set_.end(); }
+
+    // the only predecessor of the header outside the loop, if the header is its only successor
+    BasicBlock *get_preheader();
+    // the predecessors of the header inside the loop
+    std::vector<BasicBlock *> get_latches();
+    // the only latch, nullptr if there are several
+    BasicBlock *get_latch();
+    // the blocks outside the loop which are branched to from the loop
+    std::vector<BasicBlock *> get_exit_blocks();
+    // the blocks in the loop which branch out of the loop
+    std::vector<BasicBlock *> get_exiting_blocks();
+
+private:
+    friend class LoopSearch;
 
+    BasicBlock *header_ = nullptr;
+    Loop *parent_ = nullptr;
+    int depth_ = 0;
+    std::vector<Loop *> sub_loops_;
+    std::vector<BasicBlock *> blocks_;
+    BBset_t block_set_;
+};
 
-class LoopSearch : public Pass{
+/*
+ * Loop nest forest.
+ * A loop is a strongly connected component of the cfg; its base (header) is
+ * the block entered from outside. The inner loops are the strongly connected
+ * components left after the header is removed. Tarjan's algorithm runs
+ * iteratively over dense block indices, so that functions with a huge
+ * number of blocks don't overflow the stack.
+ */
+class LoopSearch : public FunctionPass{
 public:
-    explicit LoopSearch(Module* m, bool dump=false) : Pass(m), dump(dump){}
-    ~LoopSearch() = default;
-    void build_cfg(Function *func,std::unordered_set<CFGNode *> &result);
-    void run() override;
-    bool strongly_connected_components(
-        CFGNodePtrSet &nodes,
-        std::unordered_set<CFGNodePtrSet *> &result
-    );
-    void dump_graph(CFGNodePtrSet& nodes,std::string title);
-    void traverse(
-        CFGNodePtr n, 
-        std::unordered_set<CFGNodePtrSet *> &result);
-    CFGNodePtr find_loop_base(
-        CFGNodePtrSet *set,
-        CFGNodePtrSet &reserved);
+    explicit LoopSearch(Module* m, bool dump=false) : FunctionPass(m), dump(dump){}
+    ~LoopSearch(){
+        for(auto loop : loops_)
+            delete loop;
+    }
+    void run_on_function(Function *func) override;
+    unsigned get_preserved_analyses() override { return PRESERVE_CFG; }
 
     // 利用iterator来遍历所有的loop
-    auto begin(){ return loop_set.begin();}
-    auto end(){ return loop_set.end(); }
-
-    BasicBlock* get_loop_base(BBset_t *loop) { return loop2base[loop]; }
-    
-    // 得到bb所在最低层次的loop 
-    BBset_t *get_inner_loop(BasicBlock* bb){
-        if(bb2base.find(bb) == bb2base.end())
-            return nullptr;
-        return base2loop[bb2base[bb]];
+    auto begin(){ return loops_.begin();}
+    auto end(){ return loops_.end(); }
+
+    BasicBlock* get_loop_base(Loop *loop) { return loop->get_header(); }
+
+    // 得到bb所在最低层次的loop
+    Loop *get_inner_loop(BasicBlock* bb){
+        auto iter = bb2loop_.find(bb);
+        return iter == bb2loop_.end() ? nullptr : iter->second;
     }
 
     // 得到输入loop的外一层的循环，如果没有则返回空
-    BBset_t *get_parent_loop(BBset_t *loop);
-    
-    // 得到函数 f 里的所有循环
-    std::unordered_set<BBset_t *> get_loops_in_func(Function *f);
-    
+    Loop *get_parent_loop(Loop *loop) { return loop->get_parent(); }
+
+    // the number of loops containing bb, 0 if bb is not in a loop
+    int get_loop_depth(BasicBlock *bb){
+        auto loop = get_inner_loop(bb);
+        return loop ? loop->get_depth() : 0;
+    }
+
+    // 得到函数 f 里的所有循环, outer loops come before their sub loops
+    const std::vector<Loop *> &get_loops_in_func(Function *f) { return func2loop_[f]; }
 
-    
 private:
-    int index_count;
-    bool dump;
-    std::vector<CFGNodePtr> stack;
-    // loops found
-    std::unordered_set<BBset_t *> loop_set;
-    // loops found in a function
-    std::unordered_map<Function *, std::unordered_set<BBset_t *>> func2loop;
-    // { entry bb of loop : loop }
-    std::unordered_map<BasicBlock *, BBset_t *> base2loop;
-    // { loop : entry bb of loop }
-    std::unordered_map<BBset_t *, BasicBlock *> loop2base;
-    // { bb :  entry bb of loop} 默认最低层次的loop
-    std::unordered_map<BasicBlock *, BasicBlock *> bb2base;
-};
+    // find the strongly connected components of the nodes, which are marked with mark,
+    // each component is returned as the list of its nodes
+    void find_sccs(const std::vector<int> &nodes, int mark, std::vector<std::vector<int>> &sccs);
+    void dump_graph(Function *func);
 
+    bool dump;
 
+    /* the cfg of the function being searched, the blocks are numbered by their order */
+    std::vector<BasicBlock *> bbs_;
+    std::vector<std::vector<int>> succs_;
+    std::vector<std::vector<int>> preds_;
+    // the nodes of the region being searched have the mark of the region
+    std::vector<int> region_mark_;
+    // the states of Tarjan's algorithm
+    std::vector<int> index_;
+    std::vector<int> lowlink_;
+    std::vector<bool> on_stack_;
 
+    // all the loops found
+    std::vector<Loop *> loops_;
+    std::unordered_map<Function *, std::vector<Loop *>> func2loop_;
+    // { bb : the innermost loop containing bb }
+    std::unordered_map<BasicBlock *, Loop *> bb2loop_;
+};
 
 #endif
@@ -0,0 +1,73 @@
+#ifndef SYSYC_LOOPUNROLL_HPP
+#define SYSYC_LOOPUNROLL_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "LoopSearch.hpp"
+#include "InductionVars.hpp"
+#include "PassManager.hpp"
+#include <map>
+
+/*
+ * Unrolling of the innermost loops.
+ * A loop is unrolled if its header is the only block leaving the loop, and
+ * the header branches out by comparing a basic induction variable with a
+ * loop invariant bound:
+ *      header: %iv = phi ...; %c = icmp slt %iv, %n; br %c, %body, %exit
+ *  - if the initial value and the bound are constants and the loop runs only a
+ *    few times, the body is cloned once per iteration and the loop is removed,
+ *  - otherwise, the loop is preceded by an unrolled loop running factor
+ *    iterations at a time, as long as the last of them is still in range:
+ *      header.u: %c.u = icmp slt %iv.u, %n - (factor - 1) * step
+ *    The original loop is kept as the remainder loop, which runs the last
+ *    iterations starting from the values left by the unrolled loop.
+ * The block clones are appended to the function, and the phis of the header
+ * are rewired with the values of the last clone.
+ * This pass should run after Mem2Reg and InstCombine, and be followed by
+ * InstCombine, which folds the compares and offsets of the clones.
+ */
+class LoopUnroll : public FunctionPass
+{
+public:
+    LoopUnroll(Module *m) : FunctionPass(m) {}
+    ~LoopUnroll(){};
+    void run_on_function(Function *func) override;
+    unsigned get_preserved_analyses() override { return PRESERVE_NONE; }
+
+    // the number of iterations run at a time by a partially unrolled loop, 1 disables it
+    static void set_unroll_factor(int factor) { unroll_factor_ = factor; }
+    static int get_unroll_factor() { return unroll_factor_; }
+
+private:
+    // a loop the pass can unroll, which goes on while "iv op bound" holds
+    struct LoopShape
+    {
+        Loop *loop;
+        BasicBlock *entry;
+        BasicBlock *latch;
+        BasicBlock *body;
+        BasicBlock *exit;
+        CmpInst *cond;
+        InductionVars::BasicIV iv;
+        CmpInst::CmpOp op;
+        Value *bound;
+        int size;
+    };
+
+    bool analyze_loop(Loop *loop, InductionVars &ivs, LoopShape &shape);
+    // the number of iterations if it is a small constant, -1 otherwise
+    int get_trip_count(LoopShape &shape);
+    void fully_unroll(LoopShape &shape, int trip_count);
+    void partially_unroll(LoopShape &shape, int factor);
+    // clone the blocks of one iteration, in which the header phis are val_map[phi];
+    // val_map is left with the values of the phis at the next iteration,
+    // the clone of the latch is returned in latch without a terminator
+    BasicBlock *clone_iteration(LoopShape &shape, std::map<Value *, Value *> &val_map, BasicBlock *&latch);
+
+    static int unroll_factor_;
+};
+
+#endif
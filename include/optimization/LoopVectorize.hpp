@@ -0,0 +1,85 @@
+#ifndef SYSYC_LOOPVECTORIZE_HPP
+#define SYSYC_LOOPVECTORIZE_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "LoopSearch.hpp"
+#include "InductionVars.hpp"
+#include "PassManager.hpp"
+#include <map>
+#include <set>
+
+/*
+ * Vectorization of the innermost counted loops, e.g.
+ *      while (i < n) { a[i] = b[i] + c[i]; i = i + 1; }
+ * The loop must be a header computing "iv < bound" (or <=) and a single body,
+ * where iv steps by 1 and every instruction either computes an index
+ * "iv + offset", accesses an element at such an index, or is an operation on
+ * elements of the same type (i32 or float); the other phis of the header must
+ * be i32 sums "%s = phi [%init], [%s + x]".
+ * The vector loop runs lanes iterations at a time with <lanes x T> loads,
+ * stores and operations, the loop invariants are broadcast to vectors, and the
+ * sums are kept in vectors whose lanes are added up when the loop exits:
+ *      pre:      the checks, which go to the scalar loop if they fail
+ *      header.v: %c.v = icmp slt %iv.v, %n - (lanes - 1); br %c.v, %body.v, %exit.v
+ *      exit.v:   the lanes of the sums are added up
+ * The original loop is kept as the scalar epilogue, which runs the remaining
+ * iterations from the values left by the vector loop.
+ * The accesses to the same array at a constant distance less than lanes apart
+ * are not vectorized; those which may alias are checked at run time, where the
+ * first elements accessed by each pair must be at least lanes apart.
+ * This pass should run after Mem2Reg and InstCombine, and before StrengthReduction.
+ */
+class LoopVectorize : public FunctionPass
+{
+public:
+    LoopVectorize(Module *m) : FunctionPass(m) {}
+    ~LoopVectorize(){};
+    void run_on_function(Function *func) override;
+    unsigned get_preserved_analyses() override { return PRESERVE_NONE; }
+
+private:
+    // a load or a store of the element at gep, whose index is the affine induction variable index
+    struct Access
+    {
+        Instruction *instr;
+        GetElementPtrInst *gep;
+        InductionVars::AffineIV index;
+    };
+    struct VectorLoop
+    {
+        Loop *loop;
+        BasicBlock *entry;
+        BasicBlock *body;
+        InductionVars::LoopBound bound;
+        Type *element_ty;
+        int lanes;
+        std::vector<PhiInst *> sums;
+        // the index computations and the increment of iv, which are kept scalar
+        std::set<Instruction *> scalars;
+        std::vector<Access> accesses;
+        // the pairs of accesses which are checked at run time
+        std::vector<std::pair<int, int>> runtime_checks;
+    };
+
+    bool analyze_loop(Loop *loop, InductionVars &ivs, VectorLoop &vl);
+    // mark the computation of an index in the body as scalar
+    void mark_scalar(Value *val, VectorLoop &vl);
+    // whether val can be an operand of a vector operation of the loop
+    bool is_vector_operand(Value *val, VectorLoop &vl);
+    bool check_dependences(VectorLoop &vl);
+    void vectorize(VectorLoop &vl);
+
+    // the element of access at the first iteration, computed in pre
+    Value *get_first_element(VectorLoop &vl, Access &access, BasicBlock *pre);
+    // the vector of val in the vector loop, a loop invariant is broadcast in pre
+    Value *get_vector(Value *val, VectorLoop &vl, BasicBlock *pre);
+
+    // the vectors of the values of the loop body
+    std::map<Value *, Value *> vector_map_;
+};
+
+#endif
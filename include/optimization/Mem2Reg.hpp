@@ -8,20 +8,26 @@
 #include "Instruction.h"
 #include "PassManager.hpp"
 #include "Dominators.h"
+#include <map>
+#include <vector>
 
-class Mem2Reg : public Pass
+class Mem2Reg : public FunctionPass
 {
 private:
-    Function * func_;
-    Dominators *dominators_;
+    Dominators *dominators_ = nullptr;
 
 public:
-    Mem2Reg(Module *m) : Pass(m){}
+    Mem2Reg(Module *m) : FunctionPass(m){}
     ~Mem2Reg(){};
-    void run() override;
-    void generate_phi();
-    void re_name(BasicBlock *bb);
-    void remove_alloca();
+    void run_on_function(Function *func) override;
+    unsigned get_preserved_analyses() override { return PRESERVE_CFG; }
+    void generate_phi(Function *func);
+    void re_name(Function *func);
+    void enter_block(BasicBlock *bb, std::map<Value *, std::vector<Value *>> &var_val_stack);
+    void exit_block(BasicBlock *bb, std::map<Value *, std::vector<Value *>> &var_val_stack);
+    Value *get_latest_val(Value *l_val, std::map<Value *, std::vector<Value *>> &var_val_stack);
+    void clear_phi_lval(Function *func);
+    void remove_alloca(Function *func);
 };
 
 #endif
\ No newline at end of file
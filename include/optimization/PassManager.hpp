@@ -4,42 +4,139 @@
 
 
 #include "Module.h"
+#include "Function.h"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
 #include <vector>
 #include <memory>
+#include <thread>
 // using PassPtr = ;
 // using PassPtrList=;
+class AnalysisManager;
+
+// the analyses cached by AnalysisManager which a pass keeps valid
+enum PreservedAnalyses{
+    PRESERVE_NONE = 0,
+    PRESERVE_DOMINATORS = 1 << 0,
+    PRESERVE_LOOPS = 1 << 1,
+    // a pass which doesn't change the cfg preserves all of them
+    PRESERVE_CFG = PRESERVE_DOMINATORS | PRESERVE_LOOPS,
+};
+
 class Pass{
 public:
     Pass(Module* m) : m_(m){
     }
+    virtual ~Pass(){}
 
     virtual void run()=0;
+    // the cached analyses are dropped after the pass runs, unless they are preserved
+    virtual unsigned get_preserved_analyses(){ return PRESERVE_NONE; }
+    void set_analysis_manager(AnalysisManager* am){ am_ = am; }
+    // the counters of the pass, e.g. the number of phis inserted
+    std::map<std::string, long long>& get_stats(){ return stats_; }
 
 protected:
-    
+    void add_stat(const std::string& name, long long n=1){ stats_[name] += n; }
+
     Module* m_;
+    // set by the PassManager which runs the pass
+    AnalysisManager* am_ = nullptr;
+    std::map<std::string, long long> stats_;
 };
 
+/*
+ * A pass which works on each function independently.
+ * run_on_function() may only change the given function, and must not read
+ * the use lists of functions and global variables, so that PassManager can
+ * run it on different functions at the same time. Each worker thread gets
+ * its own instance of the pass, so the members are never shared by threads.
+ */
+class FunctionPass : public Pass{
+public:
+    FunctionPass(Module* m) : Pass(m){
+    }
+
+    // run on each function with a body, one after another
+    void run() override{
+        for(auto f : m_->get_functions()){
+            if(!f->is_declaration()){
+                run_on_function(f);
+            }
+        }
+    }
+    virtual void run_on_function(Function* f)=0;
+};
+
+/*
+ * Consecutive function passes are run as a group: each function goes through
+ * all the passes of the group, and the functions are scheduled on a
+ * work-stealing thread pool. A module pass is a barrier between groups.
+ */
 class PassManager{
     public:
-        PassManager(Module* m) : m_(m){}
-        template<typename PassType> void add_pass(bool print_ir=false){
-            passes_.push_back(std::pair<Pass*,bool>(new PassType(m_),print_ir));
-        }
-        void run(){
-            for(auto pass : passes_){
-                pass.first->run();
-                if(pass.second){
-                    std::cout<<m_->print();
-                }
-            }
+        // function passes run on num_threads threads, all the cores by default
+        PassManager(Module* m, int num_threads=std::thread::hardware_concurrency());
+        ~PassManager();
+        // the name is used in the timing and statistics reports
+        template<typename PassType> void add_pass(bool print_ir=false, const std::string& name=""){
+            auto m = m_;
+            auto am = analysis_manager_.get();
+            PassInfo info;
+            info.print_ir = print_ir;
+            info.name = name.empty() ? "pass" + std::to_string(passes_.size()) : name;
+            info.create = [m, am]() -> Pass* {
+                auto pass = new PassType(m);
+                pass->set_analysis_manager(am);
+                return pass;
+            };
+            info.instances.push_back(info.create());
+            passes_.push_back(info);
         }
+        void set_num_threads(int num_threads){ num_threads_ = std::max(num_threads, 1); }
+        // measure the wall and cpu time of each pass on each function
+        void set_time_passes(bool time_passes){ time_passes_ = time_passes; }
+        // the function passes only run on the functions accepted by filter, e.g. to skip the
+        // ones whose optimized body is already known; the module passes still see every function
+        void set_function_filter(std::function<bool(Function*)> filter){ function_filter_ = filter; }
+        void run();
+        void print_timing(std::ostream& out);
+        // the counters of all the passes, summed over the passes of the same name
+        void print_stats(std::ostream& out);
 
 
     private:
-        std::vector<std::pair<Pass*,bool>> passes_;
+        struct PassTiming{
+            double wall = 0;
+            double cpu = 0;
+        };
+        struct PassInfo{
+            bool print_ir;
+            std::string name;
+            std::function<Pass*()> create;
+            // one instance for each worker thread, the first one is used by module passes
+            std::vector<Pass*> instances;
+            // the time spent on each function, a module pass is timed as a whole under nullptr
+            std::map<Function*, PassTiming> timings;
+        };
+        void run_function_passes(int first, int last);
+        // run pass i on f, or on the module if f is null, with the instance of the worker
+        void run_pass(int i, int worker_id, Function* f);
+
+        std::vector<PassInfo> passes_;
         Module* m_;
+        int num_threads_;
+        std::unique_ptr<ThreadPool> thread_pool_;
+        std::unique_ptr<AnalysisManager> analysis_manager_;
+        bool time_passes_ = false;
+        std::mutex timing_mutex_;
+        std::function<bool(Function*)> function_filter_;
 
 };
 
-#endif
\ No newline at end of file
+#endif
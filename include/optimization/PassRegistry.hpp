@@ -0,0 +1,27 @@
+#ifndef SYSYC_PASSREGISTRY_HPP
+#define SYSYC_PASSREGISTRY_HPP
+
+#include "PassManager.hpp"
+#include <string>
+#include <vector>
+
+/*
+ * The passes which can be named in a textual pipeline, e.g.
+ *      -passes=inline,mem2reg,instcombine
+ * and the pipelines of the optimization levels -O0, -O1 and -O2.
+ */
+class PassRegistry
+{
+public:
+    // add the pass called name to pm, false if there is no such pass
+    static bool add_pass(PassManager &pm, const std::string &name, bool print_ir = false);
+    // add the passes of a comma separated pipeline, false if any name is unknown
+    static bool add_pipeline(PassManager &pm, const std::string &pipeline);
+    static std::vector<std::string> get_pass_names();
+    // whether the pass called name is a FunctionPass, false if there is no such pass
+    static bool is_function_pass(const std::string &name);
+    // the pipeline of -O<opt_level>, empty for an unknown level
+    static std::string get_default_pipeline(int opt_level);
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SYSYC_SROA_HPP
+#define SYSYC_SROA_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "PassManager.hpp"
+#include <map>
+
+/*
+ * Scalar replacement of aggregates.
+ * A small local array whose elements are only accessed as
+ *      %p = getelementptr [N x T], [N x T]* %a, i32 0, i32 c
+ * with a constant c in [0, N), and whose element pointers are only loaded
+ * from or stored to, is split into one alloca of T per accessed element.
+ * The new allocas are promoted to registers by Mem2Reg, so this pass should
+ * run before Mem2Reg (after InstCombine, which folds constant indices).
+ */
+class SROA : public FunctionPass
+{
+public:
+    SROA(Module *m) : FunctionPass(m) {}
+    ~SROA(){};
+    void run_on_function(Function *func) override;
+    unsigned get_preserved_analyses() override { return PRESERVE_CFG; }
+
+private:
+    // whether every use of alloca is an element access with a constant index
+    bool is_splittable(AllocaInst *alloca);
+    void split(AllocaInst *alloca);
+};
+
+#endif
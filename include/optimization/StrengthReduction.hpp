@@ -0,0 +1,48 @@
+#ifndef SYSYC_STRENGTHREDUCTION_HPP
+#define SYSYC_STRENGTHREDUCTION_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "LoopSearch.hpp"
+#include "InductionVars.hpp"
+#include "PassManager.hpp"
+#include <map>
+#include <tuple>
+#include <vector>
+
+/*
+ * Strength reduction of induction variables.
+ * In a loop with a basic induction variable %iv stepped by step,
+ *  - an element pointer "getelementptr %a, 0, idx" whose index is the affine
+ *    induction variable scale * %iv + offset is replaced with a pointer phi,
+ *    which starts at the element of the first iteration and is advanced by
+ *    scale * step elements on the back edge,
+ *  - a multiplication (or shift) by a constant which is an affine induction
+ *    variable is replaced with a phi advanced by an add on the back edge.
+ * The initial values are computed at the end of the only predecessor of the
+ * loop header outside the loop. Inner loops are reduced first, so that the
+ * initial values computed for them can be reduced in the outer loops.
+ * This pass should run after Mem2Reg and InstCombine.
+ */
+class StrengthReduction : public FunctionPass
+{
+public:
+    StrengthReduction(Module *m) : FunctionPass(m) {}
+    ~StrengthReduction(){};
+    void run_on_function(Function *func) override;
+    unsigned get_preserved_analyses() override { return PRESERVE_CFG; }
+
+private:
+    void reduce_loop(Loop *loop, LoopSearch *loop_search);
+    // the value of iv at the first iteration, computed at the end of the loop entry
+    Value *get_init_value(InductionVars &ivs, InductionVars::AffineIV &iv);
+    // create a phi in the header which starts at init, and is advanced by stride on the back edge,
+    // a pointer is advanced by stride elements
+    PhiInst *create_phi(Loop *loop, BasicBlock *entry, Value *init, int stride);
+    void remove_dead_instrs(Loop *loop, InductionVars &ivs, std::vector<PhiInst *> &new_phis);
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SYSYC_TAILRECURSIONELIM_HPP
+#define SYSYC_TAILRECURSIONELIM_HPP
+
+#include "Module.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "PassManager.hpp"
+#include <vector>
+
+/*
+ * Tail recursion elimination.
+ * A self call is a tail call if it is followed by the return of its value,
+ * or by a void return (possibly through a branch to a block with only
+ * "ret void"). Such calls are turned into a branch back to the old entry
+ * block, which becomes a loop header with one phi per argument. Allocas are
+ * moved to a new entry block, so that they are not re-executed in the loop.
+ */
+class TailRecursionElim : public FunctionPass
+{
+public:
+    TailRecursionElim(Module *m) : FunctionPass(m) {}
+    ~TailRecursionElim(){};
+    void run_on_function(Function *func) override;
+
+private:
+    bool is_tail_call(CallInst *call);
+    // whether the call passes a pointer into the stack frame of its caller
+    bool passes_local_memory(CallInst *call);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef SYSYC_THREADPOOL_HPP
+#define SYSYC_THREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * A work-stealing thread pool.
+ * Each worker owns a task deque. It takes tasks from the back of its own
+ * deque, and steals from the front of the others' when its deque is empty.
+ * The thread calling run_tasks() works as worker 0, so a pool of n workers
+ * starts n - 1 threads.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(int num_workers);
+    ~ThreadPool();
+
+    int get_num_workers() { return num_workers_; }
+    // run all the tasks and wait for them to finish,
+    // a task is called with the id of the worker running it, in [0, num_workers)
+    void run_tasks(const std::vector<std::function<void(int)>> &tasks);
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<const std::function<void(int)> *> tasks;
+    };
+
+    void worker_loop(int worker_id);
+    // run tasks until there is no task left in any queue
+    void work(int worker_id);
+    const std::function<void(int)> *pop_task(int worker_id);
+
+    int num_workers_;
+    std::vector<std::unique_ptr<TaskQueue>> queues_;
+    std::vector<std::thread> threads_;
+
+    // the workers sleep until a new batch of tasks comes
+    std::mutex batch_mutex_;
+    std::condition_variable batch_start_;
+    std::condition_variable batch_done_;
+    unsigned batch_id_ = 0;
+    int busy_workers_ = 0;
+    bool stopping_ = false;
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "CompileCache.hpp"
+#include "PassRegistry.hpp"
+#include "IRbinary.h"
+#include "IRparser.h"
+#include "GlobalVariable.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// the 64-bit FNV-1a hash of the parts, each preceded by its size so that they can't run together
+static std::string hash(const std::vector<std::string> &parts)
+{
+    unsigned long long h = 14695981039346656037ull;
+    auto add = [&h](const char *data, size_t size) {
+        for (size_t i = 0; i < size; i++)
+        {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 1099511628211ull;
+        }
+    };
+    for (auto &part : parts)
+    {
+        auto size = part.size();
+        add(reinterpret_cast<const char *>(&size), sizeof(size));
+        add(part.data(), part.size());
+    }
+    char key[17];
+    std::snprintf(key, sizeof(key), "%016llx", h);
+    return key;
+}
+
+static bool read_file(const std::string &path, std::string &data)
+{
+    std::ifstream input_stream(path, std::ios::in | std::ios::binary);
+    if (!input_stream)
+        return false;
+    std::stringstream ss;
+    ss << input_stream.rdbuf();
+    data = ss.str();
+    return true;
+}
+
+CompileCache::CompileCache(const std::string &dir) : dir_(dir)
+{
+    mkdir(dir_.c_str(), 0755);
+    struct stat st;
+    if (stat("/proc/self/exe", &st) == 0)
+        compiler_ = std::to_string(st.st_size) + "." + std::to_string(st.st_mtime);
+}
+
+std::string CompileCache::get_path(const std::string &key, const char *extension)
+{
+    return dir_ + "/" + key + extension;
+}
+
+void CompileCache::store(const std::string &path, const std::string &data)
+{
+    auto tmp_path = path + ".tmp" + std::to_string(getpid());
+    std::ofstream output_stream(tmp_path, std::ios::out | std::ios::binary);
+    output_stream.write(data.data(), data.size());
+    output_stream.close();
+    if (!output_stream || std::rename(tmp_path.c_str(), path.c_str()) != 0)
+        std::remove(tmp_path.c_str());
+}
+
+std::unique_ptr<Module> CompileCache::load_module(const std::string &input, const std::string &options)
+{
+    auto path = get_path(hash({"module", compiler_, options, input}), ".lir");
+    if (access(path.c_str(), R_OK) != 0)
+        return nullptr;
+    try
+    {
+        return read_binary_file(path);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void CompileCache::store_module(const std::string &input, const std::string &options, Module *m)
+{
+    std::string binary;
+    try
+    {
+        binary = write_binary(m);
+    }
+    catch (...)
+    {
+        // e.g. an operand left dangling by a pass, the module is compiled again next time
+        return;
+    }
+    store(get_path(hash({"module", compiler_, options, input}), ".lir"), binary);
+}
+
+void CompileCache::load_functions(Module *m, const std::string &options)
+{
+    // step 1: what the function passes may look at besides the function, the globals and the headers
+    std::string context;
+    for (auto global : m->get_global_variable())
+    {
+        context += global->print();
+        context += "\n";
+    }
+    for (auto f : m->get_functions())
+    {
+        context += f->get_return_type()->print() + " @" + f->get_name() + "(";
+        for (unsigned i = 0; i < f->get_num_of_args(); i++)
+        {
+            context += f->get_function_type()->get_param_type(i)->print() + ",";
+        }
+        context += ")\n";
+    }
+    context = hash({context});
+
+    // step 2: restore the functions which have an entry, the malformed ones are written again
+    std::vector<std::pair<Function *, std::string>> bodies;
+    std::map<Function *, std::string> paths;
+    for (auto f : m->get_functions())
+    {
+        if (f->is_declaration())
+            continue;
+        auto path = get_path(hash({"function", compiler_, options, context, f->print()}), ".ll");
+        std::string body;
+        if (read_file(path, body))
+        {
+            bodies.emplace_back(f, std::move(body));
+            restored_.insert(f);
+            paths[f] = path;
+        }
+        else
+            function_paths_[f] = path;
+    }
+    for (auto f : parse_function_bodies(m, bodies))
+    {
+        restored_.erase(f);
+        function_paths_[f] = paths[f];
+    }
+}
+
+void CompileCache::store_functions()
+{
+    for (auto &entry : function_paths_)
+    {
+        store(entry.second, entry.first->print());
+    }
+    function_paths_.clear();
+}
+
+void CompileCache::split_pipeline(const std::string &pipeline, std::string &module_passes, std::string &function_passes)
+{
+    std::vector<std::string> names;
+    std::stringstream ss(pipeline);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        if (!name.empty())
+            names.push_back(name);
+    }
+    auto first = names.size();
+    while (first > 0 && PassRegistry::is_function_pass(names[first - 1]))
+        first--;
+    module_passes.clear();
+    function_passes.clear();
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        auto &passes = i < first ? module_passes : function_passes;
+        passes += (passes.empty() ? "" : ",") + names[i];
+    }
+}
@@ -170,12 +170,8 @@ void CminusfBuilder::visit(ASTFunDeclaration &node) {
     cur_func = func;
 
     // create a new basic block for this function and insert it into builder
+    // (the entry block has no predecessor, functions are not connected in cfg)
     auto new_bb = BasicBlock::create(module.get(), node.id, cur_func);
-    auto cur_bb = builder->get_insert_block();
-    if (cur_bb) {
-        cur_bb->add_succ_basic_block(new_bb);
-    }
-    new_bb->add_pre_basic_block(cur_bb);
     builder->set_insert_point(new_bb);
 
     // get the arguments of this function
@@ -184,6 +180,9 @@ void CminusfBuilder::visit(ASTFunDeclaration &node) {
         args.push_back(*arg_itr);
     }
 
+    // the parameters are in the scope of function body
+    scope.enter();
+
     // continue visiting the parameters
     arg_index = 0;
     for (auto param : node.params) {
@@ -195,7 +194,7 @@ void CminusfBuilder::visit(ASTFunDeclaration &node) {
     node.compound_stmt->accept(*this);
 
     // add ret instruction if the function doesn't have a return statement
-    cur_bb = builder->get_insert_block();
+    auto cur_bb = builder->get_insert_block();
     if (!cur_bb->get_terminator()) {
         // check the return type of this function
         // 1. return void
@@ -214,6 +213,7 @@ void CminusfBuilder::visit(ASTFunDeclaration &node) {
 
     /// ----------- exit from the function -----------
 
+    scope.exit();
     // restore cur_func
     cur_func = old_func;
 }
@@ -270,6 +270,10 @@ void CminusfBuilder::visit(ASTCompoundStmt &node) {
     }
 
     for (auto stmt : node.statement_list) {
+        // the statements after a return are unreachable, they would follow the ret in its block
+        if (builder->get_insert_block()->get_terminator()) {
+            break;
+        }
         stmt->accept(*this);
     }
     scope.exit();
@@ -292,8 +296,6 @@ void CminusfBuilder::visit(ASTExpressionStmt &node) {
 /// @param node     a node of ASTExpressionStmt
 void CminusfBuilder::visit(ASTSelectionStmt &node) {
 
-    // get the current basic block
-    auto cur_bb = builder->get_insert_block();
     // create corresponding basic blocks: for true branch, false branch and next block
     auto true_bb = BasicBlock::create(module.get(), "", cur_func);
     auto false_bb = BasicBlock::create(module.get(), "", cur_func);
@@ -314,24 +316,15 @@ void CminusfBuilder::visit(ASTSelectionStmt &node) {
     
     // generate the branch instruction and connect basic blocks
     // 1. there exists else statement
+    // (create_cond_br and create_br also connect basic blocks)
     if (node.else_statement) {
         builder->create_cond_br(cmp_result, true_bb, false_bb);
-        // connect basic blocks
-        cur_bb->add_succ_basic_block(true_bb);
-        true_bb->add_pre_basic_block(cur_bb);
-        cur_bb->add_succ_basic_block(false_bb);
-        false_bb->add_pre_basic_block(cur_bb);
     }
     // 2. there does not exist else statement
     else {
         builder->create_cond_br(cmp_result, true_bb, next_bb);
         // remove false_bb since it is not used
         false_bb->erase_from_parent();
-        // connect basic blocks
-        cur_bb->add_succ_basic_block(true_bb);
-        true_bb->add_pre_basic_block(cur_bb);
-        cur_bb->add_succ_basic_block(next_bb);
-        next_bb->add_pre_basic_block(cur_bb);
     }
     
     // continue visiting true branch
@@ -340,8 +333,6 @@ void CminusfBuilder::visit(ASTSelectionStmt &node) {
     // connect basic blocks
     auto cur_nested_bb = builder->get_insert_block();
     if (!cur_nested_bb->get_terminator()) {
-        cur_nested_bb->add_succ_basic_block(next_bb);
-        next_bb->add_pre_basic_block(cur_nested_bb);
         builder->create_br(next_bb);
     }
 
@@ -352,8 +343,6 @@ void CminusfBuilder::visit(ASTSelectionStmt &node) {
         // connect basic blocks
         cur_nested_bb = builder->get_insert_block();
         if (!cur_nested_bb->get_terminator()) {
-            cur_nested_bb->add_succ_basic_block(next_bb);
-            next_bb->add_pre_basic_block(cur_nested_bb);
             builder->create_br(next_bb);
         }
     }
@@ -366,16 +355,12 @@ void CminusfBuilder::visit(ASTSelectionStmt &node) {
 /// @param node     a node of ASTIterationStmt
 void CminusfBuilder::visit(ASTIterationStmt &node) {
     
-    // get the current basic block
-    auto cur_bb = builder->get_insert_block();
     // create corresponding basic blocks: for comparion, true branch and next block
     auto cmp_bb = BasicBlock::create(module.get(), "", cur_func);
     auto true_bb = BasicBlock::create(module.get(), "", cur_func);
     auto next_bb = BasicBlock::create(module.get(), "", cur_func);
 
     // get the result of expression in cur_val in cmp_bb
-    cur_bb->add_succ_basic_block(cmp_bb);
-    cmp_bb->add_pre_basic_block(cur_bb);
     builder->create_br(cmp_bb);
     builder->set_insert_point(cmp_bb);
     node.expression->accept(*this);
@@ -392,10 +377,6 @@ void CminusfBuilder::visit(ASTIterationStmt &node) {
 
     // generate the branch instruction and connect basic blocks
     builder->create_cond_br(cmp_result, true_bb, next_bb);
-    cmp_bb->add_succ_basic_block(true_bb);
-    true_bb->add_pre_basic_block(cmp_bb);
-    cmp_bb->add_succ_basic_block(next_bb);
-    next_bb->add_pre_basic_block(cmp_bb);
 
     // continue visiting statements in iteration
     builder->set_insert_point(true_bb);
@@ -404,8 +385,6 @@ void CminusfBuilder::visit(ASTIterationStmt &node) {
     auto cur_nested_bb = builder->get_insert_block();
     if (!cur_nested_bb->get_terminator()) {
         builder->create_br(cmp_bb);
-        cur_nested_bb->add_succ_basic_block(cmp_bb);
-        cmp_bb->add_pre_basic_block(cur_nested_bb);
     }
 
     // focus on next_bb for next instructions
@@ -496,6 +475,17 @@ void CminusfBuilder::visit(ASTVar &node) {
             expr_val = builder->create_fptosi(expr_val, INT_32_TYPE);
         }
 
+        // guard the access if bounds checks are required,
+        // the size of an array parameter is unknown, so only negative index is checked
+        if (check_bounds) {
+            if (is_array) {
+                auto array_type = static_cast<ArrayType *>(value->get_type()->get_pointer_element_type());
+                create_bounds_check(expr_val, array_type->get_num_of_elements());
+            } else {
+                create_bounds_check(expr_val, -1);
+            }
+        }
+
         // get the element
         if (is_int || is_float) {
             cur_val = builder->create_gep(value, {ConstantInt::get(0, module.get()), expr_val});
@@ -514,6 +504,50 @@ void CminusfBuilder::visit(ASTVar &node) {
     }
 }
 
+/// Emit bounds checks for an array index.
+/// The access continues in a new basic block if the index is in range. 
+/// @param idx      the index, an i32 value
+/// @param size     the number of elements of the array, -1 if it is unknown
+void CminusfBuilder::create_bounds_check(Value *idx, int size) {
+
+    // 1. the index can't be negative
+    auto is_neg = builder->create_icmp_lt(idx, ConstantInt::get(0, module.get()));
+    create_index_check(is_neg, "neg_idx_except");
+
+    // 2. the index can't exceed the upper bound
+    if (size >= 0) {
+        auto is_over = builder->create_icmp_ge(idx, ConstantInt::get(size, module.get()));
+        create_index_check(is_over, "idx_out_of_range_except");
+    }
+}
+
+/// Branch to an exception block if the index is out of range. 
+/// The exception block calls the exception function and returns from current function, 
+/// the insert point is set to the block where the access continues. 
+/// @param is_out               an i1 value, true iff the index is out of range
+/// @param except_func_name     the name of the builtin exception function
+void CminusfBuilder::create_index_check(Value *is_out, std::string except_func_name) {
+
+    auto except_bb = BasicBlock::create(module.get(), "", cur_func);
+    auto cont_bb = BasicBlock::create(module.get(), "", cur_func);
+    builder->create_cond_br(is_out, except_bb, cont_bb);
+
+    // call the exception function, it never returns actually
+    builder->set_insert_point(except_bb);
+    auto except_func = scope.find(except_func_name);
+    assert(except_func != nullptr && "the exception function should be declared");
+    builder->create_call(except_func, {});
+    if (cur_func->get_return_type()->is_void_type()) {
+        builder->create_void_ret();
+    } else if (cur_func->get_return_type()->is_float_type()) {
+        builder->create_ret(ConstantFP::get(0.0, module.get()));
+    } else {
+        builder->create_ret(ConstantInt::get(0, module.get()));
+    }
+
+    builder->set_insert_point(cont_bb);
+}
+
 /// Visit a node of ASTAssignExpression. 
 /// We need to get the expression result and address. 
 /// Then we can do type transformation and store the value
@@ -739,6 +773,8 @@ void CminusfBuilder::visit(ASTCall &node) {
 
     // the list of actual arguments
     std::vector<Value*> actual_args;
+    // the number of elements of the array passed, -1 if it is unknown
+    int array_size = -1;
     // the iterator of formal argument type 
     auto formal_arg_type_itr = func->get_function_type()->param_begin();
 
@@ -758,6 +794,10 @@ void CminusfBuilder::visit(ASTCall &node) {
             }
             // 2. array -> pointer
             else {
+                auto element_type = cur_val->get_type()->get_pointer_element_type();
+                if (element_type->is_array_type()) {
+                    array_size = static_cast<ArrayType *>(element_type)->get_num_of_elements();
+                }
                 cur_val = builder->create_gep(cur_val, {ConstantInt::get(0, module.get()),
                                                         ConstantInt::get(0, module.get())});
             }
@@ -766,6 +806,13 @@ void CminusfBuilder::visit(ASTCall &node) {
         formal_arg_type_itr++;
     }
 
+    // the array builtins access the first n elements, n can't exceed the size of the array
+    if (check_bounds && array_size >= 0 &&
+        (node.id == "inputArray" || node.id == "outputArray" || node.id == "outputFloatArray")) {
+        auto is_over = builder->create_icmp_gt(actual_args[1], ConstantInt::get(array_size, module.get()));
+        create_index_check(is_over, "idx_out_of_range_except");
+    }
+
     // generate a call instruction
     cur_val = builder->create_call(func, actual_args);
 }
@@ -1,19 +1,50 @@
 #include "cminusf_builder.hpp"
+#include "PassManager.hpp"
+#include "PassRegistry.hpp"
+#include "LoopUnroll.hpp"
+#include "X86CodeGen.hpp"
+#include "RiscVCodeGen.hpp"
+#include "JIT.hpp"
+#include "Interpreter.hpp"
+#include "IRbinary.h"
+#include "IRparser.h"
+#include "CompileCache.hpp"
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
 #include <memory>
+#include <sstream>
 
 using namespace std::literals::string_literals;
 
 void print_help(std::string exe_name) {
     std::cout << "Usage: " << exe_name <<
-        " [ -h | --help ] [ -o <target-file> ] [ -emit-llvm ] <input-file>" << std::endl;
+        " [ -h | --help ] [ -o <target-file> ] [ -emit-llvm | -emit-lir | -S ] [ -native | --run | --interpret ]"
+        " [ -target=x86-64 | -target=riscv64 ] [ -check-bounds ] [ -O0 | -O1 | -O2 ] [ -passes=<pass>,... ] [ -unroll-factor=<n> ] [ -cache-dir=<dir> ] [ -time-passes ] [ -stats ] <input-file>" << std::endl;
+    std::cout << "Passes:";
+    for (auto &name : PassRegistry::get_pass_names()) {
+        std::cout << " " << name;
+    }
+    std::cout << std::endl;
 }
 
 int main(int argc, char **argv) {
     std::string target_path;
     std::string input_path;
     bool emit = false;
+    bool emit_binary = false;
+    bool emit_asm = false;
+    bool native = false;
+    bool run = false;
+    bool interpret = false;
+    std::string target = "x86-64";
+    bool check_bounds = false;
+    int opt_level = 0;
+    std::string pipeline;
+    bool has_pipeline = false;
+    bool time_passes = false;
+    bool stats = false;
+    std::string cache_dir;
     for (int i = 1;i < argc;++i) {
         if (argv[i] == "-h"s || argv[i] == "--help"s) {
             print_help(argv[0]);
@@ -28,6 +59,46 @@ int main(int argc, char **argv) {
             }
         } else if (argv[i] == "-emit-llvm"s) {
             emit = true;
+        } else if (argv[i] == "-emit-lir"s) {
+            // the module is written in the binary encoding, which can be given back as the input
+            emit_binary = true;
+        } else if (argv[i] == "-S"s) {
+            emit_asm = true;
+        } else if (argv[i] == "-native"s) {
+            // the executable is built from the x86-64 assembly instead of by clang
+            native = true;
+        } else if (argv[i] == "--run"s) {
+            run = true;
+        } else if (argv[i] == "--interpret"s) {
+            run = interpret = true;
+        } else if (argv[i] == "-target=x86-64"s || argv[i] == "-target=riscv64"s) {
+            target = std::string(argv[i]).substr("-target="s.size());
+        } else if (argv[i] == "-check-bounds"s) {
+            check_bounds = true;
+        } else if (argv[i] == "-O0"s || argv[i] == "-O1"s || argv[i] == "-O2"s) {
+            opt_level = argv[i][2] - '0';
+        } else if (std::string(argv[i]).rfind("-passes=", 0) == 0) {
+            // an explicit pipeline replaces the one of the optimization level
+            pipeline = std::string(argv[i]).substr("-passes="s.size());
+            has_pipeline = true;
+        } else if (std::string(argv[i]).rfind("-unroll-factor=", 0) == 0) {
+            auto factor = std::atoi(argv[i] + "-unroll-factor="s.size());
+            if (factor < 1) {
+                print_help(argv[0]);
+                return 0;
+            }
+            LoopUnroll::set_unroll_factor(factor);
+        } else if (std::string(argv[i]).rfind("-cache-dir=", 0) == 0) {
+            // the optimized IR is cached in the directory, see CompileCache.hpp
+            cache_dir = std::string(argv[i]).substr("-cache-dir="s.size());
+            if (cache_dir.empty()) {
+                print_help(argv[0]);
+                return 0;
+            }
+        } else if (argv[i] == "-time-passes"s) {
+            time_passes = true;
+        } else if (argv[i] == "-stats"s) {
+            stats = true;
         } else {
             if (input_path.empty()) {
                 input_path = argv[i];
@@ -41,6 +112,10 @@ int main(int argc, char **argv) {
         print_help(argv[0]);
         return 0;
     }
+    if (native && target != "x86-64") {
+        std::cerr << argv[0] << ": only the x86-64 assembly is linked natively, use -S for " << target << std::endl;
+        return -1;
+    }
 
     if (target_path.empty()) {
         auto pos = input_path.rfind('.');
@@ -48,7 +123,8 @@ int main(int argc, char **argv) {
             std::cerr << argv[0] << ": input file " << input_path << " has unknown filetype!" << std::endl;
             return -1;
         } else {
-            if (input_path.substr(pos) != ".cminus") {
+            auto extension = input_path.substr(pos);
+            if (extension != ".cminus" && extension != ".lir" && extension != ".ll") {
                 std::cerr << argv[0] << ": input file " << input_path << " has unknown filetype!" << std::endl;
                 return -1;
             }
@@ -59,35 +135,137 @@ int main(int argc, char **argv) {
             }
         }
     }
+    auto has_extension = [&input_path](const std::string &extension) {
+        return input_path.size() > extension.size() &&
+               input_path.compare(input_path.size() - extension.size(), extension.size(), extension) == 0;
+    };
+    if (has_extension(".ll") && (emit || (!emit_binary && !emit_asm && !native && !run)) && target_path + ".ll" == input_path) {
+        std::cerr << argv[0] << ": the output would overwrite " << input_path << ", use -o" << std::endl;
+        return -1;
+    }
     try
     {    
-    auto s = parse(input_path.c_str());
-    auto a = AST(s);
-    CminusfBuilder builder;
-    a.run_visitor(builder);
-    auto m = builder.getModule();
-    auto IR = m->print();
+    if (!has_pipeline) {
+        pipeline = PassRegistry::get_default_pipeline(opt_level);
+    }
+    std::unique_ptr<Module> m;
+    std::unique_ptr<CompileCache> cache;
+    std::string input, options;
+    if (!cache_dir.empty()) {
+        // the module is compiled again only if the input or an option changing the IR differs
+        std::ifstream input_stream(input_path, std::ios::in | std::ios::binary);
+        std::stringstream ss;
+        ss << input_stream.rdbuf();
+        input = ss.str();
+        options = pipeline + " " + std::to_string(check_bounds) + " " + std::to_string(LoopUnroll::get_unroll_factor());
+        cache.reset(new CompileCache(cache_dir));
+        m = cache->load_module(input, options);
+    }
+
+    if (!m) {
+        if (has_extension(".lir")) {
+            // a module written by -emit-lir, the front end is skipped
+            m = read_binary_file(input_path);
+        } else if (has_extension(".ll")) {
+            // the IR printed by -emit-llvm, e.g. to run other passes on it
+            m = parse_ir_file(input_path);
+        } else {
+            auto s = parse(input_path.c_str());
+            auto a = AST(s);
+            CminusfBuilder builder(check_bounds);
+            a.run_visitor(builder);
+            m = builder.getModule();
+        }
 
-    std::ofstream output_stream;
-    auto output_file = target_path+".ll";
-    output_stream.open(output_file, std::ios::out);
-    output_stream << "; ModuleID = 'cminus'\n";
-    output_stream << "source_filename = \""+ input_path +"\"\n\n";
-    output_stream << IR;
-    output_stream.close();
+        // with the cache, the function passes at the end run separately, on the functions not cached
+        std::string module_passes = pipeline, function_passes;
+        if (cache) {
+            CompileCache::split_pipeline(pipeline, module_passes, function_passes);
+        }
+        PassManager pm(m.get()), function_pm(m.get());
+        pm.set_time_passes(time_passes);
+        function_pm.set_time_passes(time_passes);
+        if (!PassRegistry::add_pipeline(pm, module_passes) || !PassRegistry::add_pipeline(function_pm, function_passes)) {
+            std::cerr << argv[0] << ": unknown pass in pipeline " << pipeline << std::endl;
+            print_help(argv[0]);
+            return -1;
+        }
+        pm.run();
+        if (!function_passes.empty()) {
+            auto cache_ptr = cache.get();
+            cache->load_functions(m.get(), function_passes + " " + std::to_string(LoopUnroll::get_unroll_factor()));
+            function_pm.set_function_filter([cache_ptr](Function *f) { return !cache_ptr->is_restored(f); });
+            function_pm.run();
+            cache->store_functions();
+        }
+        if (cache) {
+            cache->store_module(input, options, m.get());
+        }
+        if (time_passes) {
+            pm.print_timing(std::cerr);
+            if (!function_passes.empty()) {
+                function_pm.print_timing(std::cerr);
+            }
+        }
+        if (stats) {
+            pm.print_stats(std::cerr);
+            if (!function_passes.empty()) {
+                function_pm.print_stats(std::cerr);
+            }
+        }
+    }
+    if (run) {
+        // nothing is written, the module is compiled and run in this process, or interpreted
+        return interpret ? Interpreter(m.get()).run() : JIT(m.get()).run();
+    }
+
+    if (emit_binary) {
+        auto binary = write_binary(m.get());
+        std::ofstream output_stream(target_path + ".lir", std::ios::out | std::ios::binary);
+        output_stream.write(binary.data(), binary.size());
+    }
+    if (emit || (!emit_binary && !emit_asm && !native)) {
+        auto IR = m->print();
+
+        std::ofstream output_stream;
+        auto output_file = target_path+".ll";
+        output_stream.open(output_file, std::ios::out);
+        output_stream << "; ModuleID = 'cminus'\n";
+        output_stream << "source_filename = \""+ input_path +"\"\n\n";
+        output_stream << IR;
+        output_stream.close();
+    }
+    if (emit_asm || native) {
+        std::unique_ptr<CodeGen> codegen;
+        if (target == "riscv64") {
+            codegen.reset(new RiscVCodeGen(m.get()));
+        } else {
+            codegen.reset(new X86CodeGen(m.get()));
+        }
+        std::ofstream output_stream;
+        output_stream.open(target_path + ".s", std::ios::out);
+        output_stream << "    .file \"" + input_path + "\"\n";
+        output_stream << codegen->generate();
+        output_stream.close();
+    }
     }
     catch(const char* e)
     {
+        // nothing is linked after an error, e.g. of the input or of the program run by --interpret
         std::cerr << e << std::endl;
+        return -1;
     }
     catch(const std::string e)
     {
         std::cerr << e << std::endl;
+        return -1;
     }
-    if (!emit) {
-        auto command_string = "clang -w "s + target_path + ".ll -o " + target_path + " -L/usr/local/lib/ -lcminus_io";
+    if (!emit && !emit_binary && !emit_asm && !run) {
+        // only the assembler and the linker are needed for the native assembly
+        auto source_path = target_path + (native ? ".s" : ".ll");
+        auto command_string = (native ? "cc -w "s : "clang -w "s) + source_path + " -o " + target_path + " -L/usr/local/lib/ -lcminus_io";
         std::system(command_string.c_str());
-        command_string = "rm "s + target_path + ".ll";
+        command_string = "rm "s + source_path;
         std::system(command_string.c_str());
     }
 
@@ -0,0 +1,398 @@
+#include "CodeGen.hpp"
+#include <algorithm>
+#include <cstring>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+#define CONST_ZERO(val) dynamic_cast<ConstantZero *>(val)
+
+int CodeGen::get_type_size(Type *ty)
+{
+    if (ty->is_pointer_type())
+        return 8;
+    if (ty->is_array_type())
+        return static_cast<ArrayType *>(ty)->get_num_of_elements() *
+               get_type_size(static_cast<ArrayType *>(ty)->get_element_type());
+    return ty->get_size();
+}
+
+int CodeGen::get_slot_size(Type *ty)
+{
+    if (ty->is_vector_type())
+        return ty->get_size();
+    if (ty->is_pointer_type())
+        return 8;
+    return 4;
+}
+
+std::string CodeGen::generate()
+{
+    asm_.clear();
+    float_constants_.clear();
+    for (auto global : m_->get_global_variable())
+    {
+        generate_global(global);
+    }
+    asm_ += "    .text\n";
+    for (auto func : m_->get_functions())
+    {
+        if (!func->is_declaration())
+            generate_function(func);
+    }
+    if (!float_constants_.empty())
+    {
+        asm_ += "    .section .rodata\n";
+        emit(".p2align 2");
+        for (auto &constant : float_constants_)
+        {
+            asm_ += constant.second + ":\n";
+            emit(".long " + std::to_string(constant.first));
+        }
+    }
+    asm_ += "    .section .note.GNU-stack,\"\",@progbits\n";
+    return asm_;
+}
+
+void CodeGen::generate_global(GlobalVariable *global)
+{
+    auto ty = global->get_type()->get_pointer_element_type();
+    auto size = get_type_size(ty);
+    auto init = global->get_init();
+    bool is_zero = init == nullptr || CONST_ZERO(init);
+    asm_ += is_zero ? "    .bss\n" : "    .data\n";
+    emit(".globl " + global->get_name());
+    emit(ty->is_array_type() ? ".p2align 4" : ".p2align 2");
+    emit(".type " + global->get_name() + ", @object");
+    emit(".size " + global->get_name() + ", " + std::to_string(size));
+    asm_ += global->get_name() + ":\n";
+    if (is_zero)
+        emit(".zero " + std::to_string(size));
+    else
+        generate_constant(init, ty);
+}
+
+void CodeGen::generate_constant(Constant *init, Type *ty)
+{
+    if (CONST_ZERO(init))
+    {
+        emit(".zero " + std::to_string(get_type_size(ty)));
+    }
+    else if (CONST_INT(init))
+    {
+        auto directive = ty->get_size() == 1 ? ".byte " : ".long ";
+        emit(directive + std::to_string(CONST_INT(init)->get_value()));
+    }
+    else if (dynamic_cast<ConstantFP *>(init))
+    {
+        auto val = static_cast<ConstantFP *>(init)->get_value();
+        unsigned bits;
+        std::memcpy(&bits, &val, sizeof(bits));
+        emit(".long " + std::to_string(bits));
+    }
+    else if (dynamic_cast<ConstantArray *>(init))
+    {
+        auto array = static_cast<ConstantArray *>(init);
+        auto element_ty = static_cast<ArrayType *>(ty)->get_element_type();
+        for (unsigned i = 0; i < array->get_size_of_array(); i++)
+        {
+            generate_constant(array->get_element_value(i), element_ty);
+        }
+    }
+}
+
+int CodeGen::allocate_frame(Function *func, RegAlloc &reg_alloc)
+{
+    int frame_size = frame_reserved_;
+    // the offset of bytes more below the frame pointer, aligned to align
+    auto allocate = [&frame_size](int bytes, int align) {
+        frame_size = (frame_size + bytes + align - 1) / align * align;
+        return -frame_size;
+    };
+
+    // step 1: the callee saved registers taken by values, and the slots of the spilled values
+    for (auto &reg : reg_alloc.get_used_callee_saved())
+    {
+        saved_regs_[reg] = allocate(8, 8);
+    }
+    std::vector<int> slots;
+    for (int i = 0; i < reg_alloc.get_num_slots(); i++)
+    {
+        slots.push_back(allocate(8, 8));
+    }
+    auto assign = [&](Value *val) {
+        auto reg = reg_alloc.get_reg(val);
+        if (!reg.empty())
+            regs_[val] = reg;
+        else if (reg_alloc.get_slot(val) >= 0)
+            offsets_[val] = slots[reg_alloc.get_slot(val)];
+    };
+    // a spilled argument passed on the stack stays where the caller has put it
+    std::vector<Type *> types;
+    for (auto arg : func->get_args())
+    {
+        types.push_back(arg->get_type());
+    }
+    auto arg_regs = get_arg_regs(types);
+    int num_stack = 0;
+    auto arg_iter = func->get_args().begin();
+    for (unsigned i = 0; i < arg_regs.size(); i++, ++arg_iter)
+    {
+        assign(*arg_iter);
+        if (!arg_regs[i].empty())
+            continue;
+        if (offsets_.count(*arg_iter))
+            offsets_[*arg_iter] = stack_args_offset_ + 8 * num_stack;
+        num_stack++;
+    }
+
+    // step 2: the vectors, and the storage of allocas
+    for (auto bb : bbs_)
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (RegAlloc::is_allocated(instr))
+            {
+                assign(instr);
+            }
+            else if (instr->get_type()->is_vector_type())
+            {
+                auto size = get_slot_size(instr->get_type());
+                offsets_[instr] = allocate(size, 16);
+                if (instr->is_phi())
+                    shadows_[static_cast<PhiInst *>(instr)] = allocate(size, 16);
+            }
+        }
+    }
+    for (auto bb : bbs_)
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (instr->is_alloca())
+            {
+                auto size = get_type_size(static_cast<AllocaInst *>(instr)->get_alloca_type());
+                offsets_[instr] = allocate(size, size >= 16 ? 16 : 8);
+            }
+        }
+    }
+    return (frame_size + 15) / 16 * 16;
+}
+
+void CodeGen::generate_function(Function *func)
+{
+    regs_.clear();
+    offsets_.clear();
+    shadows_.clear();
+    saved_regs_.clear();
+    labels_.clear();
+    bbs_.clear();
+    fused_.clear();
+    edges_.clear();
+    // the unreachable blocks are not emitted, their instructions may use values removed by the passes
+    std::set<BasicBlock *> reachable = {func->get_entry_block()};
+    std::vector<BasicBlock *> worklist = {func->get_entry_block()};
+    while (!worklist.empty())
+    {
+        auto bb = worklist.back();
+        worklist.pop_back();
+        for (auto succ : bb->get_succ_basic_blocks())
+        {
+            if (reachable.insert(succ).second)
+                worklist.push_back(succ);
+        }
+    }
+    for (auto bb : func->get_basic_blocks())
+    {
+        if (!reachable.count(bb))
+            continue;
+        labels_[bb] = ".L" + func->get_name() + "_" + std::to_string(bbs_.size());
+        bbs_.push_back(bb);
+    }
+
+    // step 1: allocate the registers, hinting the arguments of calls and of the function
+    // to the registers they are passed in, which saves their moves
+    RegAlloc reg_alloc(int_regs_, float_regs_, callee_saved_);
+    auto hint_args = [&](const std::vector<Value *> &args) {
+        std::vector<Type *> types;
+        for (auto arg : args)
+        {
+            types.push_back(arg->get_type());
+        }
+        auto arg_regs = get_arg_regs(types);
+        for (unsigned i = 0; i < args.size(); i++)
+        {
+            if (!arg_regs[i].empty())
+                reg_alloc.set_hint(args[i], arg_regs[i]);
+        }
+    };
+    for (auto bb : bbs_)
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (instr->is_call())
+                hint_args(std::vector<Value *>(std::next(instr->get_operands().begin()),
+                                               instr->get_operands().end()));
+        }
+    }
+    hint_args(std::vector<Value *>(func->get_args().begin(), func->get_args().end()));
+    reg_alloc.run(func, bbs_);
+    auto frame_size = allocate_frame(func, reg_alloc);
+
+    // step 2: the compares right before the branch which is their only use
+    for (auto bb : bbs_)
+    {
+        auto br = bb->get_terminator();
+        if (br == nullptr || !br->is_br() || bb->get_instructions().size() < 2)
+            continue;
+        auto cmp = *std::prev(bb->get_instructions().end(), 2);
+        if (can_fuse(cmp) && cmp->get_use_list().size() == 1 && cmp->get_use_list().front().val_ == br)
+            fused_.insert(cmp);
+    }
+
+    // step 3: the blocks, and then those of the edges
+    auto name = func->get_name();
+    emit(".globl " + name);
+    emit(".p2align 4");
+    emit(".type " + name + ", @function");
+    asm_ += name + ":\n";
+    generate_prologue(func, frame_size);
+    for (auto iter = bbs_.begin(); iter != bbs_.end(); ++iter)
+    {
+        auto bb = *iter;
+        next_bb_ = std::next(iter) == bbs_.end() ? nullptr : *std::next(iter);
+        asm_ += get_label(bb) + ":\n";
+        for (auto instr : bb->get_instructions())
+        {
+            if (!instr->is_phi())
+                break;
+            auto phi = static_cast<PhiInst *>(instr);
+            if (shadows_.count(phi))
+                copy_slot(shadows_[phi], offsets_[phi], get_slot_size(phi->get_type()));
+        }
+        for (auto instr : bb->get_instructions())
+        {
+            generate_instr(instr);
+        }
+    }
+    next_bb_ = nullptr;
+    for (auto &edge : edges_)
+    {
+        asm_ += get_edge_label(edge.first, edge.second) + ":\n";
+        generate_edge_moves(edge.first, edge.second);
+        emit_jump(get_label(edge.second));
+    }
+    emit(".size " + name + ", .-" + name);
+}
+
+BasicBlock *CodeGen::get_br_target(Instruction *br)
+{
+    if (!static_cast<BranchInst *>(br)->is_cond_br())
+        return static_cast<BasicBlock *>(br->get_operand(0));
+    auto cond = br->get_operand(0);
+    auto if_true = static_cast<BasicBlock *>(br->get_operand(1));
+    auto if_false = static_cast<BasicBlock *>(br->get_operand(2));
+    if (if_true == if_false)
+        return if_true;
+    if (CONST_INT(cond) || CONST_ZERO(cond))
+        return CONST_INT(cond) && CONST_INT(cond)->get_value() != 0 ? if_true : if_false;
+    return nullptr;
+}
+
+void CodeGen::generate_edge_moves(BasicBlock *from, BasicBlock *to)
+{
+    std::vector<Move> moves;
+    for (auto instr : to->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(instr);
+        // a phi without a value from from is undefined there, and a phi used nowhere has no location
+        for (unsigned i = 0; i + 1 < phi->get_num_operand(); i += 2)
+        {
+            if (phi->get_operand(i + 1) != from)
+                continue;
+            if (shadows_.count(phi))
+                copy_vector(phi->get_operand(i), shadows_[phi]);
+            else if (has_location(phi))
+                moves.push_back(get_move(phi->get_operand(i), get_operand(phi)));
+            break;
+        }
+    }
+    emit_parallel_moves(moves);
+}
+
+std::string CodeGen::get_edge_label(BasicBlock *from, BasicBlock *to)
+{
+    if (to->get_instructions().empty() || !to->get_instructions().front()->is_phi())
+        return get_label(to);
+    std::pair<BasicBlock *, BasicBlock *> edge = {from, to};
+    if (std::find(edges_.begin(), edges_.end(), edge) == edges_.end())
+        edges_.push_back(edge);
+    auto idx = std::find(bbs_.begin(), bbs_.end(), to) - bbs_.begin();
+    return get_label(from) + "_" + std::to_string(idx);
+}
+
+CodeGen::Move CodeGen::get_move(Value *val, const std::string &dst)
+{
+    if (dynamic_cast<GlobalVariable *>(val) || dynamic_cast<AllocaInst *>(val))
+        return {val->get_type(), get_address_operand(val), dst, true};
+    return {val->get_type(), get_operand(val), dst, false};
+}
+
+void CodeGen::emit_parallel_moves(std::vector<Move> moves)
+{
+    auto reads = [this](const Move &move, const std::string &location) {
+        return !move.is_address && get_location(move.src) == location;
+    };
+    moves.erase(std::remove_if(moves.begin(), moves.end(),
+                               [&](const Move &move) { return reads(move, get_location(move.dst)); }),
+                moves.end());
+    while (!moves.empty())
+    {
+        // step 1: a move whose destination is read by no other move is done first
+        auto iter = std::find_if(moves.begin(), moves.end(), [&](const Move &move) {
+            return std::none_of(moves.begin(), moves.end(),
+                                [&](const Move &other) { return reads(other, get_location(move.dst)); });
+        });
+        if (iter != moves.end())
+        {
+            emit_move(*iter);
+            moves.erase(iter);
+            continue;
+        }
+
+        // step 2: the moves left form cycles, one of which is broken by reading
+        // the destination of a move from a scratch register instead
+        auto location = get_location(moves.front().dst);
+        bool saved = false;
+        for (auto &move : moves)
+        {
+            if (!reads(move, location))
+                continue;
+            auto scratch = get_cycle_scratch(move.ty);
+            if (!saved)
+                emit_move({move.ty, move.src, scratch, false});
+            saved = true;
+            move.src = scratch;
+        }
+    }
+}
+
+void CodeGen::copy_vector(Value *val, int offset)
+{
+    auto size = val->get_type()->get_size();
+    if (CONST_ZERO(val))
+        zero_slot(offset, size);
+    else
+        copy_slot(offsets_[val], offset, size);
+}
+
+std::string CodeGen::get_float_constant(float val)
+{
+    unsigned bits;
+    std::memcpy(&bits, &val, sizeof(bits));
+    auto iter = float_constants_.find(bits);
+    if (iter != float_constants_.end())
+        return iter->second;
+    auto label = ".LCPI" + std::to_string(float_constants_.size());
+    float_constants_[bits] = label;
+    return label;
+}
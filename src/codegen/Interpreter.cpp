@@ -0,0 +1,891 @@
+#include "Interpreter.hpp"
+#include "cminus_io.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <set>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+#define CONST_ZERO(val) dynamic_cast<ConstantZero *>(val)
+#define CONST_FP(val) dynamic_cast<ConstantFP *>(val)
+
+// the slots and the bytes of the stacks of the frames
+const int SLOT_STACK_SIZE = 1 << 22;
+const int MEMORY_STACK_SIZE = 1 << 26;
+
+static int get_lanes(Type *ty) { return ty->is_vector_type() ? ty->get_size() / 4 : 1; }
+
+static bool is_constant(Value *val)
+{
+    return CONST_INT(val) || CONST_ZERO(val) || CONST_FP(val) || dynamic_cast<GlobalVariable *>(val);
+}
+
+int Interpreter::get_type_size(Type *ty)
+{
+    if (ty->is_pointer_type())
+        return 8;
+    if (ty->is_array_type())
+        return static_cast<ArrayType *>(ty)->get_num_of_elements() *
+               get_type_size(static_cast<ArrayType *>(ty)->get_element_type());
+    return ty->get_size();
+}
+
+int Interpreter::run()
+{
+    // step 1: the globals, whose addresses are constants of the functions
+    global_offsets_.clear();
+    int size = 0;
+    for (auto global : m_->get_global_variable())
+    {
+        auto ty = global->get_type()->get_pointer_element_type();
+        int align = ty->is_array_type() ? 16 : 8;
+        size = (size + align - 1) / align * align;
+        global_offsets_[global] = size;
+        size += get_type_size(ty);
+    }
+    globals_.assign(size, 0);
+    for (auto global : m_->get_global_variable())
+    {
+        auto init = global->get_init();
+        if (init && !CONST_ZERO(init))
+            init_global(globals_.data() + global_offsets_[global], init, global->get_type()->get_pointer_element_type());
+    }
+
+    // step 2: decode the functions
+    codes_.clear();
+    indices_.clear();
+    call_sites_.clear();
+    Function *main = nullptr;
+    for (auto func : m_->get_functions())
+    {
+        if (func->is_declaration())
+            continue;
+        indices_[func] = indices_.size();
+        if (func->get_name() == "main")
+            main = func;
+    }
+    if (!main)
+        throw std::string("no main function");
+    codes_.resize(indices_.size());
+    for (auto &index : indices_)
+    {
+        decode(index.first, index.second);
+    }
+
+    // step 3: run main
+    slot_stack_.reset(new Slot[SLOT_STACK_SIZE]);
+    memory_stack_.reset(new char[MEMORY_STACK_SIZE]);
+    slot_top_ = 0;
+    memory_top_ = 0;
+    // the output of libcminus_io is written at exit, an exception of it ends the process
+    auto result = execute(indices_[main], slot_stack_.get());
+    return main->get_return_type()->is_void_type() ? 0 : result.i;
+}
+
+void Interpreter::init_global(char *data, Constant *init, Type *ty)
+{
+    if (CONST_INT(init))
+    {
+        int val = CONST_INT(init)->get_value();
+        std::memcpy(data, &val, ty->get_size());
+    }
+    else if (CONST_FP(init))
+    {
+        float val = CONST_FP(init)->get_value();
+        std::memcpy(data, &val, sizeof(val));
+    }
+    else if (dynamic_cast<ConstantArray *>(init))
+    {
+        auto array = static_cast<ConstantArray *>(init);
+        auto element_ty = static_cast<ArrayType *>(ty)->get_element_type();
+        for (unsigned i = 0; i < array->get_size_of_array(); i++)
+        {
+            init_global(data + i * get_type_size(element_ty), array->get_element_value(i), element_ty);
+        }
+    }
+}
+
+int Interpreter::get_slot(Code &code, Value *val)
+{
+    auto iter = slots_.find(val);
+    if (iter != slots_.end())
+        return iter->second;
+    if (!is_constant(val))
+        throw std::string("use of " + val->get_name() + " without a definition");
+    // the constants take the first slots, see decode
+    int slot = code.constants.size();
+    slots_[val] = slot;
+    for (int lane = 0; lane < get_lanes(val->get_type()); lane++)
+    {
+        Slot constant;
+        constant.p = nullptr;
+        if (CONST_INT(val))
+            constant.i = CONST_INT(val)->get_value();
+        else if (CONST_FP(val))
+            constant.f = CONST_FP(val)->get_value();
+        else if (dynamic_cast<GlobalVariable *>(val))
+            constant.p = globals_.data() + global_offsets_.at(static_cast<GlobalVariable *>(val));
+        code.constants.push_back(constant);
+    }
+    return slot;
+}
+
+void Interpreter::decode(Function *func, int index)
+{
+    auto &code = codes_[index];
+    slots_.clear();
+    labels_.clear();
+    temps_ = 0;
+
+    // step 1: the blocks reachable from the entry, the others may use values removed by the passes
+    std::set<BasicBlock *> reachable = {func->get_entry_block()};
+    std::vector<BasicBlock *> worklist = {func->get_entry_block()};
+    while (!worklist.empty())
+    {
+        auto bb = worklist.back();
+        worklist.pop_back();
+        for (auto succ : bb->get_succ_basic_blocks())
+        {
+            if (reachable.insert(succ).second)
+                worklist.push_back(succ);
+        }
+    }
+    std::vector<BasicBlock *> bbs;
+    std::map<BasicBlock *, int> bb_labels;
+    for (auto bb : func->get_basic_blocks())
+    {
+        if (!reachable.count(bb))
+            continue;
+        bb_labels[bb] = bbs.size();
+        bbs.push_back(bb);
+    }
+
+    // step 2: the slots, first the constants, then the arguments, and then the values of the instructions
+    for (auto bb : bbs)
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            for (unsigned i = 0; i < instr->get_num_operand(); i++)
+            {
+                auto op = instr->get_operand(i);
+                bool is_incoming = instr->is_phi() && i % 2 == 0;
+                if (is_constant(op) && (!is_incoming || reachable.count(
+                                                             static_cast<BasicBlock *>(instr->get_operand(i + 1)))))
+                    get_slot(code, op);
+            }
+        }
+    }
+    int num_slots = code.constants.size();
+    for (auto arg : func->get_args())
+    {
+        slots_[arg] = num_slots++;
+    }
+    // the storage of each alloca is aligned to 16 bytes, like an array of the native backends
+    std::map<Value *, int> frame_offsets;
+    code.frame_size = 0;
+    for (auto bb : bbs)
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (!instr->is_void())
+            {
+                slots_[instr] = num_slots;
+                num_slots += get_lanes(instr->get_type());
+            }
+            if (instr->is_alloca())
+            {
+                frame_offsets[instr] = code.frame_size;
+                code.frame_size += (get_type_size(static_cast<AllocaInst *>(instr)->get_alloca_type()) + 15) / 16 * 16;
+            }
+        }
+    }
+    // the temporaries follow the values
+    code.num_slots = num_slots;
+
+    // step 3: the ops of the blocks, then the stubs of the edges setting phis, the loads, stores and
+    // geps of an alloca use its offset in the frame
+    std::vector<std::pair<BasicBlock *, BasicBlock *>> stubs;
+    auto get_target = [&](BasicBlock *from, BasicBlock *to) {
+        if (to->get_instructions().empty() || !to->get_instructions().front()->is_phi())
+            return bb_labels[to];
+        stubs.push_back({from, to});
+        return static_cast<int>(bbs.size() + stubs.size() - 1);
+    };
+    auto &ops = code.ops;
+    for (unsigned n = 0; n < bbs.size(); n++)
+    {
+        auto bb = bbs[n];
+        labels_.push_back(ops.size());
+        for (auto instr : bb->get_instructions())
+        {
+            Op op = {MOV, instr->is_void() ? -1 : slots_[instr], -1, -1, -1, get_lanes(instr->get_type())};
+            auto ty = instr->get_type();
+            auto id = instr->get_instr_type();
+            switch (id)
+            {
+            case Instruction::ret:
+                if (static_cast<ReturnInst *>(instr)->is_void_ret())
+                    ops.push_back({RET_VOID, -1, -1, -1, -1, 1});
+                else
+                    ops.push_back({RET, -1, get_slot(code, instr->get_operand(0)), -1, -1, 1});
+                break;
+            case Instruction::br:
+                if (static_cast<BranchInst *>(instr)->is_cond_br())
+                {
+                    auto if_true = static_cast<BasicBlock *>(instr->get_operand(1));
+                    auto if_false = static_cast<BasicBlock *>(instr->get_operand(2));
+                    ops.push_back({CBR, -1, get_slot(code, instr->get_operand(0)), get_target(bb, if_true),
+                                   get_target(bb, if_false), 1});
+                }
+                else
+                {
+                    auto target = static_cast<BasicBlock *>(instr->get_operand(0));
+                    decode_edge_moves(code, bb, target);
+                    if (bb_labels[target] != static_cast<int>(n + 1))
+                        ops.push_back({BR, -1, bb_labels[target], -1, -1, 1});
+                }
+                break;
+            case Instruction::add:
+            case Instruction::sub:
+            case Instruction::mul:
+            case Instruction::sdiv:
+            case Instruction::srem:
+            case Instruction::shl:
+            case Instruction::ashr:
+            case Instruction::and_:
+            case Instruction::or_:
+            case Instruction::xor_:
+            case Instruction::fadd:
+            case Instruction::fsub:
+            case Instruction::fmul:
+            case Instruction::fdiv:
+                // the opcodes are in the order of the OpIDs
+                op.code = ty->is_vector_type() ? VBINARY : static_cast<Opcode>(ADD + (id - Instruction::add));
+                op.a = get_slot(code, instr->get_operand(0));
+                op.b = get_slot(code, instr->get_operand(1));
+                op.c = id;
+                ops.push_back(op);
+                break;
+            case Instruction::alloca:
+                op.code = ALLOCA;
+                op.a = frame_offsets[instr];
+                ops.push_back(op);
+                break;
+            case Instruction::load:
+            {
+                op.code = ty->is_vector_type() ? LOADN
+                          : ty->is_pointer_type() ? LOAD64
+                          : ty->get_size() == 1   ? LOAD8
+                                                  : LOAD32;
+                auto ptr = instr->get_operand(0);
+                if (frame_offsets.count(ptr) && (op.code == LOAD32 || op.code == LOAD64))
+                {
+                    op.code = op.code == LOAD32 ? LOAD32_FRAME : LOAD64_FRAME;
+                    op.a = frame_offsets[ptr];
+                }
+                else
+                {
+                    op.a = get_slot(code, ptr);
+                }
+                ops.push_back(op);
+                break;
+            }
+            case Instruction::store:
+            {
+                auto val_ty = static_cast<StoreInst *>(instr)->get_rval()->get_type();
+                op.code = val_ty->is_vector_type() ? STOREN
+                          : val_ty->is_pointer_type() ? STORE64
+                          : val_ty->get_size() == 1   ? STORE8
+                                                      : STORE32;
+                auto ptr = static_cast<StoreInst *>(instr)->get_lval();
+                op.a = get_slot(code, static_cast<StoreInst *>(instr)->get_rval());
+                op.n = get_lanes(val_ty);
+                if (frame_offsets.count(ptr) && (op.code == STORE32 || op.code == STORE64))
+                {
+                    op.code = op.code == STORE32 ? STORE32_FRAME : STORE64_FRAME;
+                    op.b = frame_offsets[ptr];
+                }
+                else
+                {
+                    op.b = get_slot(code, ptr);
+                }
+                ops.push_back(op);
+                break;
+            }
+            case Instruction::cmp:
+            case Instruction::fcmp:
+            {
+                // the opcodes of each kind of compare are in the order of CmpOp
+                auto lhs_ty = instr->get_operand(0)->get_type();
+                auto first = instr->is_fcmp() ? FEQ : lhs_ty->is_pointer_type() ? PEQ : EQ;
+                auto cmp_op = instr->is_fcmp() ? static_cast<int>(static_cast<FCmpInst *>(instr)->get_cmp_op())
+                                               : static_cast<int>(static_cast<CmpInst *>(instr)->get_cmp_op());
+                op.code = static_cast<Opcode>(first + cmp_op);
+                op.a = get_slot(code, instr->get_operand(0));
+                op.b = get_slot(code, instr->get_operand(1));
+                ops.push_back(op);
+                break;
+            }
+            case Instruction::phi:
+                // set on the edges to the block
+                break;
+            case Instruction::call:
+            {
+                auto callee = static_cast<Function *>(instr->get_operand(0));
+                CallSite site;
+                site.dst = op.dst;
+                if (!callee->is_declaration())
+                {
+                    site.callee = indices_.at(callee);
+                }
+                else
+                {
+                    static const std::map<std::string, Builtin> BUILTINS = {
+                        {"input", INPUT},
+                        {"output", OUTPUT},
+                        {"outputFloat", OUTPUT_FLOAT},
+                        {"inputArray", INPUT_ARRAY},
+                        {"outputArray", OUTPUT_ARRAY},
+                        {"outputFloatArray", OUTPUT_FLOAT_ARRAY},
+                        {"neg_idx_except", NEG_IDX_EXCEPT},
+                        {"idx_out_of_range_except", IDX_OUT_OF_RANGE_EXCEPT}};
+                    auto iter = BUILTINS.find(callee->get_name());
+                    if (iter == BUILTINS.end())
+                        throw std::string("call of undefined function " + callee->get_name());
+                    site.callee = iter->second;
+                }
+                for (unsigned i = 1; i < instr->get_num_operand(); i++)
+                {
+                    site.args.push_back(get_slot(code, instr->get_operand(i)));
+                }
+                op.code = CALL;
+                op.a = call_sites_.size();
+                call_sites_.push_back(site);
+                ops.push_back(op);
+                break;
+            }
+            case Instruction::getelementptr:
+            {
+                // step 1: the first index steps over the pointed type, the next ones over the elements of the arrays
+                auto ptr = instr->get_operand(0);
+                auto element_ty = ptr->get_type()->get_pointer_element_type();
+                int offset = 0;
+                std::vector<Op> indices;
+                for (unsigned i = 1; i < instr->get_num_operand(); i++)
+                {
+                    if (i > 1)
+                        element_ty = element_ty->get_array_element_type();
+                    auto idx = instr->get_operand(i);
+                    if (CONST_INT(idx) || CONST_ZERO(idx))
+                        offset += CONST_INT(idx) ? CONST_INT(idx)->get_value() * get_type_size(element_ty) : 0;
+                    else
+                        indices.push_back({GEP_INDEX, op.dst, get_slot(code, idx), get_type_size(element_ty), -1, 1});
+                }
+                // step 2: the constant offset, then the indices
+                op.code = frame_offsets.count(ptr) ? GEP_FRAME : GEP;
+                op.a = frame_offsets.count(ptr) ? frame_offsets[ptr] : get_slot(code, ptr);
+                op.b = offset;
+                ops.push_back(op);
+                ops.insert(ops.end(), indices.begin(), indices.end());
+                break;
+            }
+            case Instruction::zext:
+            case Instruction::bitcast:
+                op.a = get_slot(code, instr->get_operand(0));
+                ops.push_back(op);
+                break;
+            case Instruction::fptosi:
+            case Instruction::sitofp:
+                // the builder converts a value of the right type as well
+                op.a = get_slot(code, instr->get_operand(0));
+                if (instr->get_operand(0)->get_type()->is_float_type() != ty->is_float_type())
+                    op.code = id == Instruction::fptosi ? FPTOSI : SITOFP;
+                ops.push_back(op);
+                break;
+            case Instruction::insertelement:
+                op.code = INSERT;
+                op.a = get_slot(code, instr->get_operand(0));
+                op.c = get_slot(code, instr->get_operand(1));
+                op.b = get_slot(code, instr->get_operand(2));
+                ops.push_back(op);
+                break;
+            case Instruction::extractelement:
+                op.code = EXTRACT;
+                op.a = get_slot(code, instr->get_operand(0));
+                op.b = get_slot(code, instr->get_operand(1));
+                op.n = get_lanes(instr->get_operand(0)->get_type());
+                ops.push_back(op);
+                break;
+            default:
+                throw std::string("cannot interpret " + instr->get_instr_op_name());
+            }
+        }
+    }
+    for (auto &stub : stubs)
+    {
+        labels_.push_back(ops.size());
+        decode_edge_moves(code, stub.first, stub.second);
+        ops.push_back({BR, -1, bb_labels[stub.second], -1, -1, 1});
+    }
+
+    // step 4: the branches jump to the index of the first op of their target
+    for (auto &op : ops)
+    {
+        if (op.code == BR)
+        {
+            op.a = labels_[op.a];
+        }
+        else if (op.code == CBR)
+        {
+            op.b = labels_[op.b];
+            op.c = labels_[op.c];
+        }
+    }
+    code.num_slots += temps_;
+}
+
+void Interpreter::decode_edge_moves(Code &code, BasicBlock *from, BasicBlock *to)
+{
+    // the moves are parallel, so they go through the temporaries if a phi is read by another one
+    std::vector<Op> moves;
+    std::set<int> dsts;
+    for (auto instr : to->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        for (unsigned i = 0; i < instr->get_num_operand(); i += 2)
+        {
+            if (instr->get_operand(i + 1) == from)
+            {
+                int lanes = get_lanes(instr->get_type());
+                moves.push_back({lanes > 1 ? MOVN : MOV, slots_[instr], get_slot(code, instr->get_operand(i)), -1, -1,
+                                 lanes});
+                dsts.insert(slots_[instr]);
+                break;
+            }
+        }
+    }
+    bool is_parallel = false;
+    for (auto &move : moves)
+    {
+        is_parallel |= dsts.count(move.a) && move.a != move.dst;
+    }
+    if (!is_parallel)
+    {
+        for (auto &move : moves)
+        {
+            if (move.a != move.dst)
+                code.ops.push_back(move);
+        }
+        return;
+    }
+    int temp = code.num_slots;
+    for (auto &move : moves)
+    {
+        code.ops.push_back({move.code, temp, move.a, -1, -1, move.n});
+        temp += move.n;
+    }
+    temps_ = std::max(temps_, temp - code.num_slots);
+    temp = code.num_slots;
+    for (auto &move : moves)
+    {
+        code.ops.push_back({move.code, move.dst, temp, -1, -1, move.n});
+        temp += move.n;
+    }
+}
+
+static int divide(int lhs, int rhs, bool is_rem)
+{
+    // both trap on x86-64
+    if (rhs == 0)
+        throw std::string("division by zero");
+    if (lhs == INT_MIN && rhs == -1)
+        throw std::string("overflow of a division");
+    return is_rem ? lhs % rhs : lhs / rhs;
+}
+
+static int float_to_int(float val)
+{
+    // out of range, cvttss2si gives the minimum
+    if (std::isnan(val) || val >= 2147483648.0f || val < -2147483648.0f)
+        return INT_MIN;
+    return static_cast<int>(val);
+}
+
+// a lane of a vector binary instruction id, ints wrap around
+template <typename Slot>
+static Slot compute_binary(int id, Slot lhs, Slot rhs)
+{
+    Slot result;
+    result.p = nullptr;
+    auto a = static_cast<unsigned>(lhs.i), b = static_cast<unsigned>(rhs.i);
+    switch (id)
+    {
+    case Instruction::add: result.i = a + b; break;
+    case Instruction::sub: result.i = a - b; break;
+    case Instruction::mul: result.i = a * b; break;
+    case Instruction::sdiv: result.i = divide(lhs.i, rhs.i, false); break;
+    case Instruction::srem: result.i = divide(lhs.i, rhs.i, true); break;
+    case Instruction::shl: result.i = a << (b & 31); break;
+    case Instruction::ashr: result.i = lhs.i >> (b & 31); break;
+    case Instruction::and_: result.i = a & b; break;
+    case Instruction::or_: result.i = a | b; break;
+    case Instruction::xor_: result.i = a ^ b; break;
+    case Instruction::fadd: result.f = lhs.f + rhs.f; break;
+    case Instruction::fsub: result.f = lhs.f - rhs.f; break;
+    case Instruction::fmul: result.f = lhs.f * rhs.f; break;
+    case Instruction::fdiv: result.f = lhs.f / rhs.f; break;
+    }
+    return result;
+}
+
+Interpreter::Slot Interpreter::call_builtin(const CallSite &site, Slot *fp)
+{
+    Slot result;
+    result.p = nullptr;
+    switch (site.callee)
+    {
+    case INPUT:
+        result.i = input();
+        break;
+    case OUTPUT:
+        output(fp[site.args[0]].i);
+        break;
+    case OUTPUT_FLOAT:
+        outputFloat(fp[site.args[0]].f);
+        break;
+    case INPUT_ARRAY:
+        inputArray(reinterpret_cast<int *>(fp[site.args[0]].p), fp[site.args[1]].i);
+        break;
+    case OUTPUT_ARRAY:
+        outputArray(reinterpret_cast<int *>(fp[site.args[0]].p), fp[site.args[1]].i);
+        break;
+    case OUTPUT_FLOAT_ARRAY:
+        outputFloatArray(reinterpret_cast<float *>(fp[site.args[0]].p), fp[site.args[1]].i);
+        break;
+    case NEG_IDX_EXCEPT:
+        neg_idx_except();
+        break;
+    case IDX_OUT_OF_RANGE_EXCEPT:
+        idx_out_of_range_except();
+        break;
+    }
+    return result;
+}
+
+Interpreter::Slot Interpreter::execute(int index, Slot *fp)
+{
+    // step 1: the frame of index, whose arguments are set by the caller
+    // the frames of the callers are kept in call_stack, so a deep recursion doesn't grow the C++ stack
+    std::vector<Frame> call_stack;
+    auto saved_slot_top = slot_top_;
+    auto saved_memory_top = memory_top_;
+    const Op *ops;
+    const Op *ip;
+    char *frame;
+#define ENTER(index)                                                 \
+    {                                                                \
+        auto &code = codes_[index];                                  \
+        std::copy(code.constants.begin(), code.constants.end(), fp); \
+        slot_top_ = fp - slot_stack_.get() + code.num_slots;         \
+        frame = memory_stack_.get() + memory_top_;                   \
+        memory_top_ += code.frame_size;                              \
+        if (memory_top_ > MEMORY_STACK_SIZE)                         \
+            throw std::string("stack overflow");                     \
+        ops = code.ops.data();                                       \
+        ip = ops;                                                    \
+    }
+    ENTER(index)
+
+    // step 2: the dispatch loop
+    const Op *op;
+    Slot result;
+    result.p = nullptr;
+#if defined(__GNUC__)
+    // in the order of Opcode
+    static const void *LABELS[] = {
+        &&L_MOV, &&L_MOVN, &&L_ADD, &&L_SUB, &&L_MUL, &&L_SDIV, &&L_SREM, &&L_SHL, &&L_ASHR, &&L_AND, &&L_OR,
+        &&L_XOR, &&L_FADD, &&L_FSUB, &&L_FMUL, &&L_FDIV, &&L_VBINARY, &&L_EQ, &&L_NE, &&L_GT, &&L_GE, &&L_LT,
+        &&L_LE, &&L_PEQ, &&L_PNE, &&L_PGT, &&L_PGE, &&L_PLT, &&L_PLE, &&L_FEQ, &&L_FNE, &&L_FGT, &&L_FGE,
+        &&L_FLT, &&L_FLE, &&L_FPTOSI, &&L_SITOFP, &&L_LOAD8, &&L_LOAD32, &&L_LOAD64, &&L_LOADN, &&L_STORE8,
+        &&L_STORE32, &&L_STORE64, &&L_STOREN, &&L_LOAD32_FRAME, &&L_LOAD64_FRAME, &&L_STORE32_FRAME,
+        &&L_STORE64_FRAME, &&L_ALLOCA, &&L_GEP, &&L_GEP_INDEX, &&L_GEP_FRAME, &&L_INSERT, &&L_EXTRACT,
+        &&L_CALL, &&L_BR, &&L_CBR, &&L_RET, &&L_RET_VOID};
+#define TARGET(name) \
+    case name:       \
+    L_##name:
+#define NEXT()                  \
+    do                          \
+    {                           \
+        op = ip++;              \
+        goto *LABELS[op->code]; \
+    } while (0)
+#else
+#define TARGET(name) case name:
+#define NEXT() continue
+#endif
+#define INT_BINARY(name, expr)                       \
+    TARGET(name)                                     \
+    {                                                \
+        auto a = static_cast<unsigned>(fp[op->a].i); \
+        auto b = static_cast<unsigned>(fp[op->b].i); \
+        fp[op->dst].i = (expr);                      \
+        NEXT();                                      \
+    }
+#define FLOAT_BINARY(name, oper)                      \
+    TARGET(name)                                      \
+    {                                                 \
+        fp[op->dst].f = fp[op->a].f oper fp[op->b].f; \
+        NEXT();                                       \
+    }
+#define COMPARE(name, field, expr) \
+    TARGET(name)                   \
+    {                              \
+        auto a = fp[op->a].field;  \
+        auto b = fp[op->b].field;  \
+        fp[op->dst].i = (expr);    \
+        NEXT();                    \
+    }
+// the caller continues with the result, the loop ends when the frame of index returns
+#define RETURN()                                        \
+    {                                                   \
+        if (call_stack.empty())                         \
+            goto done;                                  \
+        auto &caller = call_stack.back();               \
+        ops = caller.ops;                               \
+        ip = caller.ip;                                 \
+        fp = caller.fp;                                 \
+        frame = caller.frame;                           \
+        slot_top_ = caller.slot_top;                    \
+        memory_top_ = caller.memory_top;                \
+        if (caller.dst >= 0)                            \
+            fp[caller.dst] = result;                    \
+        call_stack.pop_back();                          \
+        NEXT();                                         \
+    }
+    for (;;)
+    {
+        op = ip++;
+        switch (op->code)
+        {
+        TARGET(MOV)
+        {
+            fp[op->dst] = fp[op->a];
+            NEXT();
+        }
+        TARGET(MOVN)
+        {
+            std::copy(fp + op->a, fp + op->a + op->n, fp + op->dst);
+            NEXT();
+        }
+        INT_BINARY(ADD, a + b)
+        INT_BINARY(SUB, a - b)
+        INT_BINARY(MUL, a * b)
+        INT_BINARY(SDIV, divide(static_cast<int>(a), static_cast<int>(b), false))
+        INT_BINARY(SREM, divide(static_cast<int>(a), static_cast<int>(b), true))
+        INT_BINARY(SHL, a << (b & 31))
+        INT_BINARY(ASHR, static_cast<int>(a) >> (b & 31))
+        INT_BINARY(AND, a & b)
+        INT_BINARY(OR, a | b)
+        INT_BINARY(XOR, a ^ b)
+        FLOAT_BINARY(FADD, +)
+        FLOAT_BINARY(FSUB, -)
+        FLOAT_BINARY(FMUL, *)
+        FLOAT_BINARY(FDIV, /)
+        TARGET(VBINARY)
+        {
+            for (int lane = 0; lane < op->n; lane++)
+            {
+                fp[op->dst + lane] = compute_binary(op->c, fp[op->a + lane], fp[op->b + lane]);
+            }
+            NEXT();
+        }
+        COMPARE(EQ, i, a == b)
+        COMPARE(NE, i, a != b)
+        COMPARE(GT, i, a > b)
+        COMPARE(GE, i, a >= b)
+        COMPARE(LT, i, a < b)
+        COMPARE(LE, i, a <= b)
+        COMPARE(PEQ, p, a == b)
+        COMPARE(PNE, p, a != b)
+        COMPARE(PGT, p, a > b)
+        COMPARE(PGE, p, a >= b)
+        COMPARE(PLT, p, a < b)
+        COMPARE(PLE, p, a <= b)
+        // an unordered compare is true if an operand is NaN
+        COMPARE(FEQ, f, !(a < b || a > b))
+        COMPARE(FNE, f, !(a == b))
+        COMPARE(FGT, f, !(a <= b))
+        COMPARE(FGE, f, !(a < b))
+        COMPARE(FLT, f, !(a >= b))
+        COMPARE(FLE, f, !(a > b))
+        TARGET(FPTOSI)
+        {
+            fp[op->dst].i = float_to_int(fp[op->a].f);
+            NEXT();
+        }
+        TARGET(SITOFP)
+        {
+            fp[op->dst].f = static_cast<float>(fp[op->a].i);
+            NEXT();
+        }
+        TARGET(LOAD8)
+        {
+            fp[op->dst].i = static_cast<unsigned char>(*fp[op->a].p);
+            NEXT();
+        }
+        TARGET(LOAD32)
+        {
+            std::memcpy(&fp[op->dst].i, fp[op->a].p, 4);
+            NEXT();
+        }
+        TARGET(LOAD64)
+        {
+            std::memcpy(&fp[op->dst].p, fp[op->a].p, 8);
+            NEXT();
+        }
+        TARGET(LOADN)
+        {
+            for (int lane = 0; lane < op->n; lane++)
+            {
+                std::memcpy(&fp[op->dst + lane].i, fp[op->a].p + 4 * lane, 4);
+            }
+            NEXT();
+        }
+        TARGET(STORE8)
+        {
+            *fp[op->b].p = static_cast<char>(fp[op->a].i);
+            NEXT();
+        }
+        TARGET(STORE32)
+        {
+            std::memcpy(fp[op->b].p, &fp[op->a].i, 4);
+            NEXT();
+        }
+        TARGET(STORE64)
+        {
+            std::memcpy(fp[op->b].p, &fp[op->a].p, 8);
+            NEXT();
+        }
+        TARGET(STOREN)
+        {
+            for (int lane = 0; lane < op->n; lane++)
+            {
+                std::memcpy(fp[op->b].p + 4 * lane, &fp[op->a + lane].i, 4);
+            }
+            NEXT();
+        }
+        TARGET(LOAD32_FRAME)
+        {
+            std::memcpy(&fp[op->dst].i, frame + op->a, 4);
+            NEXT();
+        }
+        TARGET(LOAD64_FRAME)
+        {
+            std::memcpy(&fp[op->dst].p, frame + op->a, 8);
+            NEXT();
+        }
+        TARGET(STORE32_FRAME)
+        {
+            std::memcpy(frame + op->b, &fp[op->a].i, 4);
+            NEXT();
+        }
+        TARGET(STORE64_FRAME)
+        {
+            std::memcpy(frame + op->b, &fp[op->a].p, 8);
+            NEXT();
+        }
+        TARGET(ALLOCA)
+        {
+            fp[op->dst].p = frame + op->a;
+            NEXT();
+        }
+        TARGET(GEP)
+        {
+            fp[op->dst].p = fp[op->a].p + op->b;
+            NEXT();
+        }
+        TARGET(GEP_INDEX)
+        {
+            fp[op->dst].p += static_cast<long>(fp[op->a].i) * op->b;
+            NEXT();
+        }
+        TARGET(GEP_FRAME)
+        {
+            fp[op->dst].p = frame + op->a + op->b;
+            NEXT();
+        }
+        TARGET(INSERT)
+        {
+            // a lane out of the vector is poison, it is left alone
+            std::copy(fp + op->a, fp + op->a + op->n, fp + op->dst);
+            auto lane = static_cast<unsigned>(fp[op->b].i);
+            if (lane < static_cast<unsigned>(op->n))
+                fp[op->dst + lane] = fp[op->c];
+            NEXT();
+        }
+        TARGET(EXTRACT)
+        {
+            auto lane = static_cast<unsigned>(fp[op->b].i);
+            fp[op->dst] = fp[op->a + (lane < static_cast<unsigned>(op->n) ? lane : 0)];
+            NEXT();
+        }
+        TARGET(CALL)
+        {
+            auto &site = call_sites_[op->a];
+            if (site.callee < 0)
+            {
+                auto value = call_builtin(site, fp);
+                if (site.dst >= 0)
+                    fp[site.dst] = value;
+                NEXT();
+            }
+            auto &callee = codes_[site.callee];
+            auto callee_fp = slot_stack_.get() + slot_top_;
+            if (slot_top_ + callee.num_slots > SLOT_STACK_SIZE)
+                throw std::string("stack overflow");
+            for (unsigned i = 0; i < site.args.size(); i++)
+            {
+                callee_fp[callee.constants.size() + i] = fp[site.args[i]];
+            }
+            call_stack.push_back({ops, ip, fp, frame, slot_top_, memory_top_, site.dst});
+            fp = callee_fp;
+            ENTER(site.callee)
+            NEXT();
+        }
+        TARGET(BR)
+        {
+            ip = ops + op->a;
+            NEXT();
+        }
+        TARGET(CBR)
+        {
+            ip = ops + (fp[op->a].i ? op->b : op->c);
+            NEXT();
+        }
+        TARGET(RET)
+        {
+            result = fp[op->a];
+            RETURN()
+        }
+        TARGET(RET_VOID)
+        {
+            RETURN()
+        }
+        }
+    }
+#undef TARGET
+#undef NEXT
+#undef ENTER
+#undef RETURN
+#undef INT_BINARY
+#undef FLOAT_BINARY
+#undef COMPARE
+
+    // step 3: pop the frame of index
+done:
+    slot_top_ = saved_slot_top;
+    memory_top_ = saved_memory_top;
+    return result;
+}
@@ -0,0 +1,76 @@
+#include "JIT.hpp"
+#include "cminus_io.h"
+#include "Function.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+
+template <typename T>
+static T check(llvm::Expected<T> value)
+{
+    if (!value)
+        throw llvm::toString(value.takeError());
+    return std::move(*value);
+}
+
+static void check(llvm::Error err)
+{
+    if (err)
+        throw llvm::toString(std::move(err));
+}
+
+int JIT::run()
+{
+    // step 1: parse the printed module into LLVM
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto ir = m_->print();
+    llvm::SMDiagnostic diag;
+    auto module = llvm::parseIR(llvm::MemoryBufferRef(ir, "cminus"), diag, *context);
+    if (!module)
+    {
+        std::string message;
+        llvm::raw_string_ostream stream(message);
+        diag.print("cminusfc", stream);
+        throw stream.str();
+    }
+
+    // step 2: bind libcminus_io, which is linked into cminusfc, and leave the other symbols, e.g. memset, to libc
+    auto jit = check(llvm::orc::LLJITBuilder().create());
+    auto &dylib = jit->getMainJITDylib();
+    const std::pair<const char *, void *> IO_FUNCTIONS[] = {
+        {"input", reinterpret_cast<void *>(input)},
+        {"output", reinterpret_cast<void *>(output)},
+        {"outputFloat", reinterpret_cast<void *>(outputFloat)},
+        {"inputArray", reinterpret_cast<void *>(inputArray)},
+        {"outputArray", reinterpret_cast<void *>(outputArray)},
+        {"outputFloatArray", reinterpret_cast<void *>(outputFloatArray)},
+        {"neg_idx_except", reinterpret_cast<void *>(neg_idx_except)},
+        {"idx_out_of_range_except", reinterpret_cast<void *>(idx_out_of_range_except)}};
+    llvm::orc::SymbolMap symbols;
+    for (auto &function : IO_FUNCTIONS)
+    {
+        symbols[jit->mangleAndIntern(function.first)] =
+            llvm::JITEvaluatedSymbol(llvm::pointerToJITTargetAddress(function.second),
+                                     llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    }
+    check(dylib.define(llvm::orc::absoluteSymbols(symbols)));
+    dylib.addGenerator(check(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        jit->getDataLayout().getGlobalPrefix())));
+
+    // step 3: compile the module and run main, the output of libcminus_io is written at exit
+    check(jit->addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context))));
+    auto address = check(jit->lookup("main")).getAddress();
+    for (auto func : m_->get_functions())
+    {
+        if (func->get_name() == "main" && func->get_return_type()->is_void_type())
+        {
+            reinterpret_cast<void (*)()>(address)();
+            return 0;
+        }
+    }
+    return reinterpret_cast<int (*)()>(address)();
+}
@@ -0,0 +1,346 @@
+#include "RegAlloc.hpp"
+#include <algorithm>
+#include <list>
+
+bool RegAlloc::is_allocated(Value *val)
+{
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (instr && (instr->is_void() || instr->is_alloca()))
+        return false;
+    if (!instr && !dynamic_cast<Argument *>(val))
+        return false;
+    auto ty = val->get_type();
+    return ty->is_integer_type() || ty->is_pointer_type() || ty->is_float_type();
+}
+
+std::string RegAlloc::get_reg(Value *val)
+{
+    auto iter = regs_.find(val);
+    return iter == regs_.end() ? "" : iter->second;
+}
+
+int RegAlloc::get_slot(Value *val)
+{
+    auto iter = slots_.find(val);
+    return iter == slots_.end() ? -1 : iter->second;
+}
+
+void RegAlloc::run(Function *func, const std::vector<BasicBlock *> &bbs)
+{
+    positions_.clear();
+    bb_ranges_.clear();
+    call_positions_.clear();
+    live_in_.clear();
+    live_out_.clear();
+    intervals_.clear();
+    order_.clear();
+    spilled_.clear();
+    related_.clear();
+    regs_.clear();
+    slots_.clear();
+    num_slots_ = 0;
+    used_callee_saved_.clear();
+
+    number_instrs(bbs);
+    compute_liveness(bbs);
+    build_intervals(func, bbs);
+    scan();
+    assign_slots();
+}
+
+void RegAlloc::number_instrs(const std::vector<BasicBlock *> &bbs)
+{
+    // the arguments are defined at 0, the phis at the start of their block,
+    // and the moves eliminating the phis of the successors come at the end of a block
+    int pos = 0;
+    for (auto bb : bbs)
+    {
+        int start = pos += 2;
+        for (auto instr : bb->get_instructions())
+        {
+            if (instr->is_phi())
+            {
+                positions_[instr] = start;
+                continue;
+            }
+            positions_[instr] = pos += 2;
+            if (instr->is_call())
+                call_positions_.push_back(pos);
+        }
+        bb_ranges_[bb] = {start, pos += 2};
+    }
+}
+
+void RegAlloc::compute_liveness(const std::vector<BasicBlock *> &bbs)
+{
+    // step 1: the values used before being defined in each block, and those defined there
+    std::map<BasicBlock *, std::set<Value *>> uses, defs;
+    for (auto bb : bbs)
+    {
+        auto &use = uses[bb];
+        auto &def = defs[bb];
+        for (auto instr : bb->get_instructions())
+        {
+            if (!instr->is_phi())
+            {
+                for (auto op : instr->get_operands())
+                {
+                    if (is_allocated(op) && !def.count(op))
+                        use.insert(op);
+                }
+            }
+            if (is_allocated(instr))
+                def.insert(instr);
+        }
+    }
+
+    // step 2: solve live_in = use + (live_out - def) backwards until nothing changes,
+    // where live_out has the incoming values of the phis of the successors
+    std::set<BasicBlock *> emitted(bbs.begin(), bbs.end());
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto iter = bbs.rbegin(); iter != bbs.rend(); ++iter)
+        {
+            auto bb = *iter;
+            std::set<Value *> out;
+            for (auto succ : bb->get_succ_basic_blocks())
+            {
+                if (!emitted.count(succ))
+                    continue;
+                out.insert(live_in_[succ].begin(), live_in_[succ].end());
+                for (auto instr : succ->get_instructions())
+                {
+                    if (!instr->is_phi())
+                        break;
+                    for (unsigned i = 0; i + 1 < instr->get_num_operand(); i += 2)
+                    {
+                        if (instr->get_operand(i + 1) == bb && is_allocated(instr->get_operand(i)))
+                            out.insert(instr->get_operand(i));
+                    }
+                }
+            }
+            auto in = uses[bb];
+            for (auto val : out)
+            {
+                if (!defs[bb].count(val))
+                    in.insert(val);
+            }
+            if (in != live_in_[bb] || out != live_out_[bb])
+            {
+                live_in_[bb] = std::move(in);
+                live_out_[bb] = std::move(out);
+                changed = true;
+            }
+        }
+    }
+}
+
+void RegAlloc::extend(Value *val, int pos, bool is_use)
+{
+    auto iter = intervals_.find(val);
+    if (iter == intervals_.end())
+    {
+        bool is_float = val->get_type()->is_float_type();
+        intervals_[val] = {val, pos, pos, is_use, is_float, false, ""};
+        order_.push_back(val);
+        return;
+    }
+    iter->second.start = std::min(iter->second.start, pos);
+    iter->second.end = std::max(iter->second.end, pos);
+    iter->second.used |= is_use;
+}
+
+void RegAlloc::build_intervals(Function *func, const std::vector<BasicBlock *> &bbs)
+{
+    for (auto arg : func->get_args())
+    {
+        if (is_allocated(arg))
+            extend(arg, 0, false);
+    }
+    for (auto bb : bbs)
+    {
+        auto range = bb_ranges_[bb];
+        for (auto val : live_in_[bb])
+        {
+            extend(val, range.first, true);
+        }
+        for (auto val : live_out_[bb])
+        {
+            extend(val, range.second, true);
+        }
+        for (auto instr : bb->get_instructions())
+        {
+            auto pos = positions_[instr];
+            if (is_allocated(instr))
+                extend(instr, pos, false);
+            if (instr->is_phi())
+            {
+                // the incoming values are live at the end of the predecessors
+                for (unsigned i = 0; i + 1 < instr->get_num_operand(); i += 2)
+                {
+                    if (!is_allocated(instr->get_operand(i)))
+                        continue;
+                    related_[instr].push_back(instr->get_operand(i));
+                    related_[instr->get_operand(i)].push_back(instr);
+                }
+                continue;
+            }
+            for (auto op : instr->get_operands())
+            {
+                if (is_allocated(op))
+                    extend(op, pos, true);
+            }
+            if ((instr->is_zext() || instr->get_instr_type() == Instruction::bitcast) &&
+                is_allocated(instr->get_operand(0)))
+            {
+                related_[instr].push_back(instr->get_operand(0));
+                related_[instr->get_operand(0)].push_back(instr);
+            }
+        }
+    }
+    for (auto &entry : intervals_)
+    {
+        auto &interval = entry.second;
+        for (auto pos : call_positions_)
+        {
+            if (interval.start < pos && pos < interval.end)
+                interval.crosses_call = true;
+        }
+    }
+}
+
+std::string RegAlloc::get_hint(Interval &interval, std::set<std::string> &free_regs)
+{
+    auto usable = [&](const std::string &reg) {
+        return !reg.empty() && free_regs.count(reg) && is_allowed(interval, reg);
+    };
+    auto iter = hints_.find(interval.val);
+    if (iter != hints_.end() && usable(iter->second))
+        return iter->second;
+    for (auto val : related_[interval.val])
+    {
+        auto related = intervals_.find(val);
+        if (related != intervals_.end() && usable(related->second.reg))
+            return related->second.reg;
+    }
+    return "";
+}
+
+void RegAlloc::scan()
+{
+    // the intervals by their start, the values used nowhere are left out
+    std::vector<Interval *> intervals;
+    for (auto val : order_)
+    {
+        if (intervals_[val].used)
+            intervals.push_back(&intervals_[val]);
+    }
+    std::stable_sort(intervals.begin(), intervals.end(), [](Interval *lhs, Interval *rhs) {
+        return lhs->start < rhs->start;
+    });
+
+    std::set<std::string> free_ints(int_regs_.begin(), int_regs_.end());
+    std::set<std::string> free_floats(float_regs_.begin(), float_regs_.end());
+    std::list<Interval *> active;
+    for (auto interval : intervals)
+    {
+        // step 1: free the registers of the intervals which have ended,
+        // an interval ending where another starts is only read by the instruction defining the other
+        for (auto iter = active.begin(); iter != active.end();)
+        {
+            if ((*iter)->end <= interval->start)
+            {
+                ((*iter)->is_float ? free_floats : free_ints).insert((*iter)->reg);
+                iter = active.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+
+        // step 2: take the hinted register, or the first free one in the order of preference
+        auto &free_regs = interval->is_float ? free_floats : free_ints;
+        auto &regs = interval->is_float ? float_regs_ : int_regs_;
+        auto reg = get_hint(*interval, free_regs);
+        for (auto iter = regs.begin(); reg.empty() && iter != regs.end(); ++iter)
+        {
+            if (free_regs.count(*iter) && is_allowed(*interval, *iter))
+                reg = *iter;
+        }
+        if (!reg.empty())
+        {
+            interval->reg = reg;
+            free_regs.erase(reg);
+            active.push_back(interval);
+            continue;
+        }
+
+        // step 3: spill the interval ending last, among those whose register this one may take
+        Interval *victim = nullptr;
+        for (auto other : active)
+        {
+            if (other->is_float == interval->is_float && is_allowed(*interval, other->reg) &&
+                (!victim || other->end > victim->end))
+                victim = other;
+        }
+        if (victim && victim->end > interval->end)
+        {
+            interval->reg = victim->reg;
+            victim->reg.clear();
+            active.remove(victim);
+            active.push_back(interval);
+            spilled_.push_back(victim);
+        }
+        else
+        {
+            spilled_.push_back(interval);
+        }
+    }
+
+    for (auto interval : intervals)
+    {
+        if (interval->reg.empty())
+            continue;
+        regs_[interval->val] = interval->reg;
+        if (callee_saved_.count(interval->reg))
+            used_callee_saved_.insert(interval->reg);
+    }
+}
+
+void RegAlloc::assign_slots()
+{
+    // a slot is reused once the interval holding it has ended before the next one starts
+    std::stable_sort(spilled_.begin(), spilled_.end(), [](Interval *lhs, Interval *rhs) {
+        return lhs->start < rhs->start;
+    });
+    std::vector<int> free_slots;
+    std::list<Interval *> active;
+    for (auto interval : spilled_)
+    {
+        for (auto iter = active.begin(); iter != active.end();)
+        {
+            if ((*iter)->end < interval->start)
+            {
+                free_slots.push_back(slots_[(*iter)->val]);
+                iter = active.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+        if (free_slots.empty())
+        {
+            slots_[interval->val] = num_slots_++;
+        }
+        else
+        {
+            slots_[interval->val] = free_slots.back();
+            free_slots.pop_back();
+        }
+        active.push_back(interval);
+    }
+}
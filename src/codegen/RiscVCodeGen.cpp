@@ -0,0 +1,756 @@
+#include "RiscVCodeGen.hpp"
+#include <cassert>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+#define CONST_ZERO(val) dynamic_cast<ConstantZero *>(val)
+
+// the registers passing the first arguments of the LP64D calling convention
+const int NUM_INT_ARG_REGS = 8;
+const int NUM_FLOAT_ARG_REGS = 8;
+// the registers given to RegAlloc, the caller saved ones first, and the argument registers last among them
+const std::vector<std::string> INT_REGS = {"t3", "t4", "t5", "a7", "a6", "a5", "a4", "a3", "a2", "a1", "a0",
+                                           "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"};
+const std::vector<std::string> FLOAT_REGS = {
+    "ft2", "ft3", "ft4", "ft5", "ft6", "ft7", "ft8", "ft9", "ft10", "ft11", "fa7", "fa6", "fa5", "fa4", "fa3", "fa2",
+    "fa1", "fa0", "fs0", "fs1", "fs2", "fs3", "fs4", "fs5", "fs6", "fs7", "fs8", "fs9", "fs10", "fs11"};
+const std::set<std::string> CALLEE_SAVED = {"s1",  "s2",  "s3",  "s4",  "s5",  "s6",  "s7", "s8",
+                                            "s9",  "s10", "s11", "fs0", "fs1", "fs2", "fs3", "fs4",
+                                            "fs5", "fs6", "fs7", "fs8", "fs9", "fs10", "fs11"};
+// the immediates of I-type instructions are 12 bit signed
+const int IMM_MIN = -2048;
+const int IMM_MAX = 2047;
+
+static bool fits_imm(long long val) { return val >= IMM_MIN && val <= IMM_MAX; }
+
+static bool is_mem(const std::string &op) { return op.find('(') != std::string::npos; }
+
+static bool is_label(const std::string &op) { return op[0] == '.'; }
+
+static bool is_imm(const std::string &op) { return !is_mem(op) && (op[0] == '-' || (op[0] >= '0' && op[0] <= '9')); }
+
+static bool is_reg(const std::string &op) { return !is_mem(op) && !is_label(op) && !is_imm(op); }
+
+static bool is_float_reg(const std::string &reg) { return reg[0] == 'f'; }
+
+static std::string get_load_op(Type *ty, const std::string &reg)
+{
+    if (is_float_reg(reg))
+        return ty->is_pointer_type() ? "fld" : "flw";
+    return ty->is_pointer_type() ? "ld" : "lw";
+}
+
+static std::string get_store_op(Type *ty, const std::string &reg)
+{
+    if (is_float_reg(reg))
+        return ty->is_pointer_type() ? "fsd" : "fsw";
+    return ty->is_pointer_type() ? "sd" : "sw";
+}
+
+// the branch taken when the one of op is not
+static std::string get_inverse_branch(const std::string &op)
+{
+    static const std::map<std::string, std::string> INVERSES = {
+        {"beq", "bne"}, {"bne", "beq"}, {"bgt", "ble"}, {"ble", "bgt"},
+        {"bge", "blt"}, {"blt", "bge"}, {"beqz", "bnez"}, {"bnez", "beqz"}};
+    return INVERSES.at(op);
+}
+
+RiscVCodeGen::RiscVCodeGen(Module *m)
+    // ra and the old s0 are saved right below s0, which is the stack pointer of the caller
+    : CodeGen(m, INT_REGS, FLOAT_REGS, CALLEE_SAVED, 16, 0)
+{
+}
+
+std::vector<std::string> RiscVCodeGen::get_arg_regs(const std::vector<Type *> &types)
+{
+    // a float is passed in an int register once the float ones are taken
+    std::vector<std::string> regs;
+    int num_ints = 0, num_floats = 0;
+    for (auto ty : types)
+    {
+        if (ty->is_float_type() && num_floats < NUM_FLOAT_ARG_REGS)
+            regs.push_back("fa" + std::to_string(num_floats++));
+        else
+            regs.push_back(num_ints < NUM_INT_ARG_REGS ? "a" + std::to_string(num_ints++) : "");
+    }
+    return regs;
+}
+
+void RiscVCodeGen::generate_prologue(Function *func, int frame_size)
+{
+    emit("addi sp, sp, -16");
+    emit("sd ra, 8(sp)");
+    emit("sd s0, 0(sp)");
+    emit("addi s0, sp, 16");
+    if (frame_size > 16)
+        emit_add_offset("sp", "sp", 16 - frame_size);
+    for (auto &saved : saved_regs_)
+    {
+        emit_memory(is_float_reg(saved.first) ? "fsd" : "sd", saved.first, get_frame_operand(saved.second));
+    }
+    // the arguments are moved from where they are passed to their locations
+    std::vector<Type *> types;
+    for (auto arg : func->get_args())
+    {
+        types.push_back(arg->get_type());
+    }
+    auto arg_regs = get_arg_regs(types);
+    std::vector<Move> moves;
+    int num_stack = 0;
+    auto arg_iter = func->get_args().begin();
+    for (unsigned i = 0; i < arg_regs.size(); i++, ++arg_iter)
+    {
+        auto src = arg_regs[i].empty() ? get_frame_operand(8 * num_stack++) : arg_regs[i];
+        if (has_location(*arg_iter))
+            moves.push_back({types[i], src, get_operand(*arg_iter), false});
+    }
+    emit_parallel_moves(moves);
+}
+
+void RiscVCodeGen::generate_instr(Instruction *instr)
+{
+    switch (instr->get_instr_type())
+    {
+    case Instruction::ret:
+        generate_ret(instr);
+        break;
+    case Instruction::br:
+        generate_br(instr);
+        break;
+    case Instruction::add:
+    case Instruction::sub:
+    case Instruction::mul:
+    case Instruction::sdiv:
+    case Instruction::srem:
+    case Instruction::shl:
+    case Instruction::ashr:
+    case Instruction::and_:
+    case Instruction::or_:
+    case Instruction::xor_:
+    case Instruction::fadd:
+    case Instruction::fsub:
+    case Instruction::fmul:
+    case Instruction::fdiv:
+        if (instr->get_type()->is_vector_type())
+            generate_vector_binary(instr);
+        else
+            generate_binary(instr);
+        break;
+    case Instruction::alloca:
+    case Instruction::phi:
+        // the storage of allocas is in the frame, and the phis are set on the edges to their block
+        break;
+    case Instruction::load:
+        generate_load(instr);
+        break;
+    case Instruction::store:
+        generate_store(instr);
+        break;
+    case Instruction::cmp:
+        if (!fused_.count(instr))
+            generate_cmp(instr);
+        break;
+    case Instruction::fcmp:
+        if (!fused_.count(instr))
+            generate_fcmp(instr);
+        break;
+    case Instruction::call:
+        generate_call(instr);
+        break;
+    case Instruction::getelementptr:
+        generate_gep(instr);
+        break;
+    case Instruction::zext:
+        // an i1 is already 0 or 1
+        emit_move(instr->get_type(), get_operand(instr->get_operand(0)), get_operand(instr));
+        break;
+    case Instruction::fptosi:
+    {
+        if (!instr->get_operand(0)->get_type()->is_float_type())
+        {
+            // the builder converts a value of the right type as well
+            emit_move(instr->get_type(), get_operand(instr->get_operand(0)), get_operand(instr));
+            break;
+        }
+        auto src = load_operand(instr->get_operand(0), "ft0");
+        auto dst = get_operand(instr);
+        auto rd = is_reg(dst) ? dst : "t0";
+        emit("fcvt.w.s " + rd + ", " + src + ", rtz");
+        emit_move(instr->get_type(), rd, dst);
+        break;
+    }
+    case Instruction::sitofp:
+    {
+        auto src = load_operand(instr->get_operand(0), "t0");
+        auto dst = get_operand(instr);
+        auto rd = is_reg(dst) ? dst : "ft0";
+        emit("fcvt.s.w " + rd + ", " + src);
+        emit_move(instr->get_type(), rd, dst);
+        break;
+    }
+    case Instruction::bitcast:
+        emit_move(get_move(instr->get_operand(0), get_operand(instr)));
+        break;
+    case Instruction::insertelement:
+        generate_insert_element(instr);
+        break;
+    case Instruction::extractelement:
+        generate_extract_element(instr);
+        break;
+    default:
+        assert(false && "unknown instruction");
+    }
+}
+
+void RiscVCodeGen::generate_binary(Instruction *instr)
+{
+    auto dst = get_operand(instr);
+    if (instr->is_fp_instr())
+    {
+        auto rs1 = load_operand(instr->get_operand(0), "ft0");
+        auto rs2 = load_operand(instr->get_operand(1), "ft1");
+        auto rd = is_reg(dst) ? dst : "ft0";
+        emit_binary(instr->get_instr_type(), rd, rs1, rs2);
+        emit_move(instr->get_type(), rd, dst);
+        return;
+    }
+    auto rs1 = load_operand(instr->get_operand(0), "t1");
+    auto rd = is_reg(dst) ? dst : "t0";
+    // an operation with a constant of 12 bits takes it as its immediate
+    auto rhs = CONST_INT(instr->get_operand(1));
+    std::string op;
+    long long imm = rhs ? rhs->get_value() : 0;
+    switch (instr->get_instr_type())
+    {
+    case Instruction::add: op = "addiw"; break;
+    case Instruction::sub: op = "addiw"; imm = -imm; break;
+    case Instruction::and_: op = "andi"; break;
+    case Instruction::or_: op = "ori"; break;
+    case Instruction::xor_: op = "xori"; break;
+    case Instruction::shl: op = "slliw"; imm &= 31; break;
+    case Instruction::ashr: op = "sraiw"; imm &= 31; break;
+    default: break;
+    }
+    if (rhs && !op.empty() && fits_imm(imm))
+        emit(op + " " + rd + ", " + rs1 + ", " + std::to_string(imm));
+    else
+        emit_binary(instr->get_instr_type(), rd, rs1, load_operand(instr->get_operand(1), "t2"));
+    emit_move(instr->get_type(), rd, dst);
+}
+
+void RiscVCodeGen::emit_binary(Instruction::OpID id, const std::string &rd, const std::string &rs1,
+                               const std::string &rs2)
+{
+    std::string op;
+    switch (id)
+    {
+    case Instruction::add: op = "addw"; break;
+    case Instruction::sub: op = "subw"; break;
+    case Instruction::mul: op = "mulw"; break;
+    case Instruction::sdiv: op = "divw"; break;
+    case Instruction::srem: op = "remw"; break;
+    case Instruction::shl: op = "sllw"; break;
+    case Instruction::ashr: op = "sraw"; break;
+    case Instruction::and_: op = "and"; break;
+    case Instruction::or_: op = "or"; break;
+    case Instruction::xor_: op = "xor"; break;
+    case Instruction::fadd: op = "fadd.s"; break;
+    case Instruction::fsub: op = "fsub.s"; break;
+    case Instruction::fmul: op = "fmul.s"; break;
+    case Instruction::fdiv: op = "fdiv.s"; break;
+    default: assert(false && "not a binary instruction");
+    }
+    emit(op + " " + rd + ", " + rs1 + ", " + rs2);
+}
+
+void RiscVCodeGen::generate_vector_binary(Instruction *instr)
+{
+    // there are no vector registers in RV64GC
+    auto vector_ty = static_cast<VectorType *>(instr->get_type());
+    auto element_ty = vector_ty->get_element_type();
+    bool is_float = element_ty->is_float_type();
+    for (unsigned lane = 0; lane < vector_ty->get_num_of_elements(); lane++)
+    {
+        auto rs1 = is_float ? "ft0" : "t1";
+        auto rs2 = is_float ? "ft1" : "t2";
+        auto rd = is_float ? "ft0" : "t0";
+        emit_move(element_ty, get_lane_operand(instr->get_operand(0), lane), rs1);
+        emit_move(element_ty, get_lane_operand(instr->get_operand(1), lane), rs2);
+        emit_binary(instr->get_instr_type(), rd, rs1, rs2);
+        emit_move(element_ty, rd, get_lane_operand(instr, lane));
+    }
+}
+
+void RiscVCodeGen::generate_cmp(Instruction *instr)
+{
+    auto rs1 = load_operand(instr->get_operand(0), "t1");
+    auto rs2 = load_operand(instr->get_operand(1), "t2");
+    auto dst = get_operand(instr);
+    auto rd = is_reg(dst) ? dst : "t0";
+    switch (static_cast<CmpInst *>(instr)->get_cmp_op())
+    {
+    case CmpInst::EQ:
+        emit("xor " + rd + ", " + rs1 + ", " + rs2);
+        emit("seqz " + rd + ", " + rd);
+        break;
+    case CmpInst::NE:
+        emit("xor " + rd + ", " + rs1 + ", " + rs2);
+        emit("snez " + rd + ", " + rd);
+        break;
+    case CmpInst::GT:
+        emit("slt " + rd + ", " + rs2 + ", " + rs1);
+        break;
+    case CmpInst::GE:
+        emit("slt " + rd + ", " + rs1 + ", " + rs2);
+        emit("xori " + rd + ", " + rd + ", 1");
+        break;
+    case CmpInst::LT:
+        emit("slt " + rd + ", " + rs1 + ", " + rs2);
+        break;
+    case CmpInst::LE:
+        emit("slt " + rd + ", " + rs2 + ", " + rs1);
+        emit("xori " + rd + ", " + rd + ", 1");
+        break;
+    }
+    emit_move(instr->get_type(), rd, dst);
+}
+
+void RiscVCodeGen::emit_ordered_fcmp(Instruction *instr, const std::string &rd)
+{
+    // feq, flt and fle are false if an operand is NaN, when the unordered compares are true
+    auto rs1 = load_operand(instr->get_operand(0), "ft0");
+    auto rs2 = load_operand(instr->get_operand(1), "ft1");
+    switch (static_cast<FCmpInst *>(instr)->get_cmp_op())
+    {
+    case FCmpInst::EQ:
+        emit("flt.s t1, " + rs1 + ", " + rs2);
+        emit("flt.s " + rd + ", " + rs2 + ", " + rs1);
+        emit("or " + rd + ", " + rd + ", t1");
+        break;
+    case FCmpInst::NE:
+        emit("feq.s " + rd + ", " + rs1 + ", " + rs2);
+        break;
+    case FCmpInst::GT:
+        emit("fle.s " + rd + ", " + rs1 + ", " + rs2);
+        break;
+    case FCmpInst::GE:
+        emit("flt.s " + rd + ", " + rs1 + ", " + rs2);
+        break;
+    case FCmpInst::LT:
+        emit("fle.s " + rd + ", " + rs2 + ", " + rs1);
+        break;
+    case FCmpInst::LE:
+        emit("flt.s " + rd + ", " + rs2 + ", " + rs1);
+        break;
+    }
+}
+
+void RiscVCodeGen::generate_fcmp(Instruction *instr)
+{
+    auto dst = get_operand(instr);
+    auto rd = is_reg(dst) ? dst : "t0";
+    emit_ordered_fcmp(instr, rd);
+    emit("xori " + rd + ", " + rd + ", 1");
+    emit_move(instr->get_type(), rd, dst);
+}
+
+void RiscVCodeGen::generate_call(Instruction *instr)
+{
+    auto func = static_cast<Function *>(instr->get_operand(0));
+
+    // step 1: the arguments past the registers are passed on the stack, which stays aligned to 16 bytes
+    std::vector<Type *> types;
+    for (unsigned i = 1; i < instr->get_num_operand(); i++)
+    {
+        types.push_back(instr->get_operand(i)->get_type());
+    }
+    auto arg_regs = get_arg_regs(types);
+    std::vector<Move> moves;
+    std::vector<Value *> stack_args;
+    for (unsigned i = 0; i < arg_regs.size(); i++)
+    {
+        if (arg_regs[i].empty())
+            stack_args.push_back(instr->get_operand(i + 1));
+        else
+            moves.push_back(get_move(instr->get_operand(i + 1), arg_regs[i]));
+    }
+    int stack_size = (stack_args.size() * 8 + 15) / 16 * 16;
+    if (stack_size > 0)
+        emit_add_offset("sp", "sp", -stack_size);
+    for (unsigned i = 0; i < stack_args.size(); i++)
+    {
+        emit_move(get_move(stack_args[i], std::to_string(8 * i) + "(sp)"));
+    }
+
+    // step 2: the arguments in registers, no value is live in a caller saved register across the call
+    emit_parallel_moves(moves);
+    emit("call " + func->get_name());
+    if (stack_size > 0)
+        emit_add_offset("sp", "sp", stack_size);
+
+    // step 3: the result
+    auto ty = instr->get_type();
+    if (!ty->is_void_type())
+        emit_move(ty, ty->is_float_type() ? "fa0" : "a0", get_operand(instr));
+}
+
+void RiscVCodeGen::generate_gep(Instruction *instr)
+{
+    // step 1: the first index steps over the pointed type, the next ones over the elements of the arrays
+    auto ptr = instr->get_operand(0);
+    auto base = load_operand(ptr, "t0");
+    auto ty = ptr->get_type()->get_pointer_element_type();
+    long long offset = 0;
+    for (unsigned i = 1; i < instr->get_num_operand(); i++)
+    {
+        if (i > 1)
+            ty = ty->get_array_element_type();
+        long long size = get_type_size(ty);
+        auto idx = instr->get_operand(i);
+        if (CONST_INT(idx) || CONST_ZERO(idx))
+        {
+            offset += CONST_INT(idx) ? CONST_INT(idx)->get_value() * size : 0;
+            continue;
+        }
+        auto reg = load_operand(idx, "t1");
+        int shift = 0;
+        while ((1LL << shift) < size)
+            shift++;
+        if ((1LL << shift) != size)
+        {
+            emit("li t2, " + std::to_string(size));
+            emit("mul t1, " + reg + ", t2");
+            reg = "t1";
+        }
+        else if (shift > 0)
+        {
+            emit("slli t1, " + reg + ", " + std::to_string(shift));
+            reg = "t1";
+        }
+        emit("add t0, " + base + ", " + reg);
+        base = "t0";
+    }
+
+    // step 2: the constant offset
+    auto dst = get_operand(instr);
+    auto rd = is_reg(dst) ? dst : "t0";
+    emit_add_offset(rd, base, offset);
+    emit_move(instr->get_type(), rd, dst);
+}
+
+void RiscVCodeGen::generate_load(Instruction *instr)
+{
+    auto ty = instr->get_type();
+    if (ty->is_vector_type())
+    {
+        copy_memory(load_operand(instr->get_operand(0), "t0"), 0, "s0", offsets_[instr], ty->get_size());
+        return;
+    }
+    auto src = get_memory_operand(instr->get_operand(0));
+    auto dst = get_operand(instr);
+    if (ty->get_size() == 1 && !ty->is_pointer_type())
+    {
+        // an i1 takes a byte in memory
+        auto rd = is_reg(dst) ? dst : "t0";
+        emit_memory("lbu", rd, src);
+        emit_move(ty, rd, dst);
+    }
+    else
+    {
+        emit_move(ty, src, dst);
+    }
+}
+
+void RiscVCodeGen::generate_store(Instruction *instr)
+{
+    auto val = static_cast<StoreInst *>(instr)->get_rval();
+    auto ptr = static_cast<StoreInst *>(instr)->get_lval();
+    auto ty = val->get_type();
+    if (ty->is_vector_type())
+    {
+        auto base = load_operand(ptr, "t0");
+        if (CONST_ZERO(val))
+            zero_memory(base, 0, ty->get_size());
+        else
+            copy_memory("s0", offsets_[val], base, 0, ty->get_size());
+        return;
+    }
+    auto reg = load_operand(val, ty->is_float_type() ? "ft0" : "t1");
+    auto dst = get_memory_operand(ptr);
+    if (ty->get_size() == 1 && !ty->is_pointer_type())
+        emit_memory("sb", reg, dst);
+    else
+        emit_memory(get_store_op(ty, reg), reg, dst);
+}
+
+void RiscVCodeGen::generate_insert_element(Instruction *instr)
+{
+    auto val = instr->get_operand(1);
+    auto idx = instr->get_operand(2);
+    auto offset = offsets_[instr];
+    copy_vector(instr->get_operand(0), offset);
+    auto reg = load_operand(val, val->get_type()->is_float_type() ? "ft0" : "t1");
+    auto lane = CONST_INT(idx) ? get_lane_operand(instr, CONST_INT(idx)->get_value()) : get_indexed_lane(offset, idx);
+    emit_memory(get_store_op(val->get_type(), reg), reg, lane);
+}
+
+void RiscVCodeGen::generate_extract_element(Instruction *instr)
+{
+    auto vec = instr->get_operand(0);
+    auto idx = instr->get_operand(1);
+    std::string lane;
+    if (CONST_ZERO(vec) || CONST_INT(idx))
+        lane = get_lane_operand(vec, CONST_INT(idx) ? CONST_INT(idx)->get_value() : 0);
+    else
+        lane = get_indexed_lane(offsets_[vec], idx);
+    emit_move(instr->get_type(), lane, get_operand(instr));
+}
+
+std::string RiscVCodeGen::get_indexed_lane(int offset, Value *idx)
+{
+    // the elements are i32 or float, which take 4 bytes
+    emit("slli t2, " + load_operand(idx, "t2") + ", 2");
+    emit("add t2, t2, s0");
+    return std::to_string(offset) + "(t2)";
+}
+
+void RiscVCodeGen::generate_br(Instruction *instr)
+{
+    auto bb = instr->get_parent();
+    auto target = get_br_target(instr);
+    if (target)
+    {
+        generate_edge_moves(bb, target);
+        if (target != next_bb_)
+            emit_jump(get_label(target));
+        return;
+    }
+
+    // the phis of a target are set on a block of the edge, so the other target does not see the moves
+    auto cond = instr->get_operand(0);
+    auto if_true = static_cast<BasicBlock *>(instr->get_operand(1));
+    auto if_false = static_cast<BasicBlock *>(instr->get_operand(2));
+    std::string op = "bnez", operands;
+    auto cmp = static_cast<Instruction *>(cond);
+    if (fused_.count(cmp) && cmp->is_cmp())
+    {
+        // indexed by CmpInst::CmpOp
+        static const char *BRANCHES[] = {"beq", "bne", "bgt", "bge", "blt", "ble"};
+        op = BRANCHES[static_cast<CmpInst *>(cmp)->get_cmp_op()];
+        operands = load_operand(cmp->get_operand(0), "t1") + ", " + load_operand(cmp->get_operand(1), "t2");
+    }
+    else if (fused_.count(cmp))
+    {
+        emit_ordered_fcmp(cmp, "t0");
+        op = "beqz";
+        operands = "t0";
+    }
+    else
+    {
+        operands = load_operand(cond, "t0");
+    }
+    auto true_label = get_edge_label(bb, if_true);
+    auto false_label = get_edge_label(bb, if_false);
+    if (if_false == next_bb_ && false_label == get_label(if_false))
+    {
+        emit(op + " " + operands + ", " + true_label);
+    }
+    else if (if_true == next_bb_ && true_label == get_label(if_true))
+    {
+        emit(get_inverse_branch(op) + " " + operands + ", " + false_label);
+    }
+    else
+    {
+        emit(op + " " + operands + ", " + true_label);
+        emit_jump(false_label);
+    }
+}
+
+void RiscVCodeGen::generate_ret(Instruction *instr)
+{
+    if (!static_cast<ReturnInst *>(instr)->is_void_ret())
+    {
+        auto val = instr->get_operand(0);
+        emit_move(get_move(val, val->get_type()->is_float_type() ? "fa0" : "a0"));
+    }
+    for (auto &saved : saved_regs_)
+    {
+        emit_memory(is_float_reg(saved.first) ? "fld" : "ld", saved.first, get_frame_operand(saved.second));
+    }
+    emit("addi sp, s0, -16");
+    emit("ld ra, 8(sp)");
+    emit("ld s0, 0(sp)");
+    emit("addi sp, sp, 16");
+    emit("ret");
+}
+
+std::string RiscVCodeGen::get_operand(Value *val)
+{
+    auto ty = val->get_type();
+    if (CONST_INT(val))
+        return std::to_string(CONST_INT(val)->get_value());
+    if (dynamic_cast<ConstantFP *>(val))
+        return get_float_constant(static_cast<ConstantFP *>(val)->get_value());
+    if (CONST_ZERO(val))
+        return ty->is_float_type() ? get_float_constant(0) : "0";
+    auto iter = regs_.find(val);
+    if (iter != regs_.end())
+        return iter->second;
+    if (offsets_.count(val))
+        return get_slot(val);
+    // a value used nowhere is computed into a scratch register
+    return ty->is_float_type() ? "ft0" : "t0";
+}
+
+std::string RiscVCodeGen::get_address_operand(Value *val)
+{
+    if (dynamic_cast<GlobalVariable *>(val))
+        return val->get_name();
+    return get_slot(val);
+}
+
+std::string RiscVCodeGen::load_operand(Value *val, const std::string &scratch)
+{
+    if (dynamic_cast<GlobalVariable *>(val) || dynamic_cast<AllocaInst *>(val))
+    {
+        emit_move(get_move(val, scratch));
+        return scratch;
+    }
+    auto op = get_operand(val);
+    if (op == "0")
+        return "zero";
+    if (is_reg(op))
+        return op;
+    emit_move(val->get_type(), op, scratch);
+    return scratch;
+}
+
+std::string RiscVCodeGen::get_lane_operand(Value *val, int lane)
+{
+    if (CONST_ZERO(val))
+        return val->get_type()->get_vector_element_type()->is_float_type() ? get_float_constant(0) : "0";
+    return get_frame_operand(offsets_.at(val) + 4 * lane);
+}
+
+std::string RiscVCodeGen::get_memory_operand(Value *ptr)
+{
+    if (dynamic_cast<AllocaInst *>(ptr))
+        return get_slot(ptr);
+    return "0(" + load_operand(ptr, "t0") + ")";
+}
+
+void RiscVCodeGen::emit_memory(const std::string &op, const std::string &reg, const std::string &mem)
+{
+    auto pos = mem.find('(');
+    auto offset = std::stoll(mem.substr(0, pos));
+    if (fits_imm(offset))
+    {
+        emit(op + " " + reg + ", " + mem);
+        return;
+    }
+    emit("li t6, " + std::to_string(offset));
+    emit("add t6, t6, " + mem.substr(pos + 1, mem.size() - pos - 2));
+    emit(op + " " + reg + ", 0(t6)");
+}
+
+void RiscVCodeGen::emit_add_offset(const std::string &rd, const std::string &base, long long offset)
+{
+    if (fits_imm(offset))
+    {
+        if (offset != 0)
+            emit("addi " + rd + ", " + base + ", " + std::to_string(offset));
+        else if (rd != base)
+            emit("mv " + rd + ", " + base);
+        return;
+    }
+    // rd may be base
+    emit("li t6, " + std::to_string(offset));
+    emit("add " + rd + ", " + base + ", t6");
+}
+
+void RiscVCodeGen::emit_move(Type *ty, const std::string &src, const std::string &dst)
+{
+    if (src == dst)
+        return;
+    if (is_mem(dst))
+    {
+        // the bits of a float are moved like an int
+        auto reg = src == "0" ? "zero" : src;
+        if (!is_reg(reg))
+        {
+            emit_move(ty, src, "t0");
+            reg = "t0";
+        }
+        emit_memory(get_store_op(ty, reg), reg, dst);
+    }
+    else if (is_mem(src))
+    {
+        emit_memory(get_load_op(ty, dst), dst, src);
+    }
+    else if (is_imm(src))
+    {
+        emit("li " + dst + ", " + src);
+    }
+    else if (is_label(src))
+    {
+        emit("lla t0, " + src);
+        emit_memory(get_load_op(ty, dst), dst, "0(t0)");
+    }
+    else if (is_float_reg(src) && is_float_reg(dst))
+    {
+        emit("fmv.s " + dst + ", " + src);
+    }
+    else if (is_float_reg(src) || is_float_reg(dst))
+    {
+        // a float passed in an int register
+        emit(is_float_reg(src) ? "fmv.x.w " + dst + ", " + src : "fmv.w.x " + dst + ", " + src);
+    }
+    else
+    {
+        emit("mv " + dst + ", " + src);
+    }
+}
+
+void RiscVCodeGen::emit_move(const Move &move)
+{
+    if (!move.is_address)
+    {
+        emit_move(move.ty, move.src, move.dst);
+        return;
+    }
+    auto reg = is_mem(move.dst) ? "t0" : move.dst;
+    if (is_mem(move.src))
+        emit_add_offset(reg, "s0", std::stoll(move.src.substr(0, move.src.find('('))));
+    else
+        emit("lla " + reg + ", " + move.src);
+    if (is_mem(move.dst))
+        emit_memory("sd", reg, move.dst);
+}
+
+void RiscVCodeGen::copy_memory(const std::string &src, int src_off, const std::string &dst, int dst_off, int size)
+{
+    int done = 0;
+    for (; done + 8 <= size; done += 8)
+    {
+        emit_memory("ld", "t2", std::to_string(src_off + done) + "(" + src + ")");
+        emit_memory("sd", "t2", std::to_string(dst_off + done) + "(" + dst + ")");
+    }
+    for (; done + 4 <= size; done += 4)
+    {
+        emit_memory("lw", "t2", std::to_string(src_off + done) + "(" + src + ")");
+        emit_memory("sw", "t2", std::to_string(dst_off + done) + "(" + dst + ")");
+    }
+}
+
+void RiscVCodeGen::zero_memory(const std::string &dst, int dst_off, int size)
+{
+    int done = 0;
+    for (; done + 8 <= size; done += 8)
+    {
+        emit_memory("sd", "zero", std::to_string(dst_off + done) + "(" + dst + ")");
+    }
+    for (; done + 4 <= size; done += 4)
+    {
+        emit_memory("sw", "zero", std::to_string(dst_off + done) + "(" + dst + ")");
+    }
+}
@@ -0,0 +1,839 @@
+#include "X86CodeGen.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+#define CONST_ZERO(val) dynamic_cast<ConstantZero *>(val)
+
+// the registers passing the first arguments of the System V calling convention
+const char *INT_ARG_REGS[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+const int NUM_INT_ARG_REGS = 6;
+const int NUM_FLOAT_ARG_REGS = 8;
+// the registers given to RegAlloc, the caller saved ones first, so that a leaf function saves none
+const std::vector<std::string> INT_REGS = {"rsi", "rdi", "r8", "r9", "r10", "rbx", "r12", "r13", "r14", "r15"};
+const std::vector<std::string> FLOAT_REGS = {"xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "xmm8",
+                                             "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14"};
+const std::set<std::string> CALLEE_SAVED = {"rbx", "r12", "r13", "r14", "r15"};
+// the lanes of a 16 byte SSE register
+const int SSE_LANES = 4;
+
+static std::string get_reg32(const std::string &reg)
+{
+    // %r8 - %r15 are suffixed with d, the others are prefixed with e instead of r
+    if (reg[1] >= '0' && reg[1] <= '9')
+        return reg + "d";
+    return "e" + reg.substr(1);
+}
+
+static std::string get_address(int offset, const std::string &base)
+{
+    return std::to_string(offset) + "(%" + base + ")";
+}
+
+static bool is_reg(const std::string &op) { return op[0] == '%'; }
+
+static bool is_mem(const std::string &op) { return op.find('(') != std::string::npos; }
+
+// the condition code holding when cc does not
+static std::string get_inverse_cc(const std::string &cc)
+{
+    static const std::map<std::string, std::string> INVERSES = {
+        {"e", "ne"}, {"ne", "e"}, {"g", "le"}, {"le", "g"}, {"ge", "l"},
+        {"l", "ge"}, {"b", "ae"}, {"ae", "b"}, {"be", "a"}, {"a", "be"}};
+    return INVERSES.at(cc);
+}
+
+X86CodeGen::X86CodeGen(Module *m)
+    // %rbp and the return address are above the frame, the arguments pushed by the caller above them
+    : CodeGen(m, INT_REGS, FLOAT_REGS, CALLEE_SAVED, 0, 16)
+{
+}
+
+std::vector<std::string> X86CodeGen::get_arg_regs(const std::vector<Type *> &types)
+{
+    std::vector<std::string> regs;
+    int num_ints = 0, num_floats = 0;
+    for (auto ty : types)
+    {
+        if (ty->is_float_type())
+            regs.push_back(num_floats < NUM_FLOAT_ARG_REGS ? "xmm" + std::to_string(num_floats++) : "");
+        else
+            regs.push_back(num_ints < NUM_INT_ARG_REGS ? INT_ARG_REGS[num_ints++] : "");
+    }
+    return regs;
+}
+
+bool X86CodeGen::can_fuse(Instruction *instr)
+{
+    // an unordered != takes two flags, ZF and PF
+    if (instr->is_fcmp())
+        return static_cast<FCmpInst *>(instr)->get_cmp_op() != FCmpInst::NE;
+    return instr->is_cmp();
+}
+
+void X86CodeGen::generate_prologue(Function *func, int frame_size)
+{
+    emit("pushq %rbp");
+    emit("movq %rsp, %rbp");
+    if (frame_size > 0)
+        emit("subq $" + std::to_string(frame_size) + ", %rsp");
+    for (auto &saved : saved_regs_)
+    {
+        emit("movq %" + saved.first + ", " + get_frame_operand(saved.second));
+    }
+    // the arguments are moved from where they are passed to their locations
+    std::vector<Type *> types;
+    for (auto arg : func->get_args())
+    {
+        types.push_back(arg->get_type());
+    }
+    auto arg_regs = get_arg_regs(types);
+    std::vector<Move> moves;
+    int num_stack = 0;
+    auto arg_iter = func->get_args().begin();
+    for (unsigned i = 0; i < arg_regs.size(); i++, ++arg_iter)
+    {
+        auto ty = types[i];
+        std::string src;
+        if (arg_regs[i].empty())
+            src = get_frame_operand(16 + 8 * num_stack++);
+        else
+            src = "%" + (ty->is_float_type() || ty->is_pointer_type() ? arg_regs[i] : get_reg32(arg_regs[i]));
+        if (has_location(*arg_iter))
+            moves.push_back({ty, src, get_operand(*arg_iter), false});
+    }
+    emit_parallel_moves(moves);
+}
+
+void X86CodeGen::generate_instr(Instruction *instr)
+{
+    switch (instr->get_instr_type())
+    {
+    case Instruction::ret:
+        generate_ret(instr);
+        break;
+    case Instruction::br:
+        generate_br(instr);
+        break;
+    case Instruction::add:
+    case Instruction::sub:
+    case Instruction::mul:
+    case Instruction::sdiv:
+    case Instruction::srem:
+    case Instruction::shl:
+    case Instruction::ashr:
+    case Instruction::and_:
+    case Instruction::or_:
+    case Instruction::xor_:
+    case Instruction::fadd:
+    case Instruction::fsub:
+    case Instruction::fmul:
+    case Instruction::fdiv:
+        if (instr->get_type()->is_vector_type())
+            generate_vector_binary(instr);
+        else
+            generate_binary(instr);
+        break;
+    case Instruction::alloca:
+    case Instruction::phi:
+        // the storage of allocas is in the frame, and the phis are set on the edges to their block
+        break;
+    case Instruction::load:
+        generate_load(instr);
+        break;
+    case Instruction::store:
+        generate_store(instr);
+        break;
+    case Instruction::cmp:
+        if (!fused_.count(instr))
+            generate_cmp(instr);
+        break;
+    case Instruction::fcmp:
+        if (!fused_.count(instr))
+            generate_fcmp(instr);
+        break;
+    case Instruction::call:
+        generate_call(instr);
+        break;
+    case Instruction::getelementptr:
+        generate_gep(instr);
+        break;
+    case Instruction::zext:
+        // an i1 is already 0 or 1 in 32 bits
+        emit_move(instr->get_type(), get_operand(instr->get_operand(0)), get_operand(instr));
+        break;
+    case Instruction::fptosi:
+    {
+        auto dst = get_operand(instr);
+        if (!instr->get_operand(0)->get_type()->is_float_type())
+        {
+            // the builder converts a value of the right type as well
+            emit_move(instr->get_type(), get_operand(instr->get_operand(0)), dst);
+            break;
+        }
+        auto work = is_reg(dst) ? dst : "%eax";
+        emit("cvttss2si " + get_operand(instr->get_operand(0)) + ", " + work);
+        emit_move(instr->get_type(), work, dst);
+        break;
+    }
+    case Instruction::sitofp:
+    {
+        auto src = get_operand(instr->get_operand(0));
+        auto dst = get_operand(instr);
+        if (src[0] == '$')
+        {
+            emit("movl " + src + ", %eax");
+            src = "%eax";
+        }
+        auto work = is_reg(dst) ? dst : "%xmm0";
+        emit("cvtsi2ssl " + src + ", " + work);
+        emit_move(instr->get_type(), work, dst);
+        break;
+    }
+    case Instruction::bitcast:
+        emit_move(get_move(instr->get_operand(0), get_operand(instr)));
+        break;
+    case Instruction::insertelement:
+        generate_insert_element(instr);
+        break;
+    case Instruction::extractelement:
+        generate_extract_element(instr);
+        break;
+    default:
+        assert(false && "unknown instruction");
+    }
+}
+
+void X86CodeGen::generate_binary(Instruction *instr)
+{
+    auto lhs = get_operand(instr->get_operand(0));
+    auto rhs = get_operand(instr->get_operand(1));
+    auto dst = get_operand(instr);
+    if (!instr->is_fp_instr())
+    {
+        emit_int_binary(instr->get_instr_type(), lhs, rhs, dst);
+        return;
+    }
+    // fadd, fsub, fmul, fdiv are addss, subss, mulss, divss, computed in dst unless it is rhs
+    auto op = instr->get_instr_op_name().substr(1) + "ss ";
+    bool is_commutative = instr->get_instr_type() == Instruction::fadd || instr->get_instr_type() == Instruction::fmul;
+    if (rhs == dst && lhs != dst && is_commutative)
+        std::swap(lhs, rhs);
+    if (is_reg(dst) && (rhs != dst || lhs == dst))
+    {
+        emit_move(instr->get_type(), lhs, dst);
+        emit(op + rhs + ", " + dst);
+    }
+    else
+    {
+        emit_move(instr->get_type(), lhs, "%xmm0");
+        emit(op + rhs + ", %xmm0");
+        emit_move(instr->get_type(), "%xmm0", dst);
+    }
+}
+
+void X86CodeGen::emit_int_binary(Instruction::OpID id, std::string lhs, std::string rhs, const std::string &dst)
+{
+    auto ty = m_->get_int32_type();
+    switch (id)
+    {
+    case Instruction::sdiv:
+    case Instruction::srem:
+        // the quotient is left in %eax and the remainder in %edx
+        emit_move(ty, lhs, "%eax");
+        emit("cltd");
+        if (rhs[0] == '$')
+        {
+            emit("movl " + rhs + ", %ecx");
+            rhs = "%ecx";
+        }
+        emit("idivl " + rhs);
+        emit_move(ty, id == Instruction::sdiv ? "%eax" : "%edx", dst);
+        return;
+    case Instruction::shl:
+    case Instruction::ashr:
+    {
+        // a variable shift count must be in %cl
+        std::string op = id == Instruction::shl ? "sall " : "sarl ";
+        if (rhs[0] != '$')
+        {
+            emit_move(ty, rhs, "%ecx");
+            rhs = "%cl";
+        }
+        auto work = is_reg(dst) ? dst : "%eax";
+        emit_move(ty, lhs, work);
+        emit(op + rhs + ", " + work);
+        emit_move(ty, work, dst);
+        return;
+    }
+    default:
+        break;
+    }
+    std::string op;
+    switch (id)
+    {
+    case Instruction::add: op = "addl "; break;
+    case Instruction::sub: op = "subl "; break;
+    case Instruction::mul: op = "imull "; break;
+    case Instruction::and_: op = "andl "; break;
+    case Instruction::or_: op = "orl "; break;
+    case Instruction::xor_: op = "xorl "; break;
+    default: assert(false && "not an int binary instruction");
+    }
+    // computed in dst unless it is rhs, which a commutative operation swaps with lhs
+    if (rhs == dst && lhs != dst && id != Instruction::sub)
+        std::swap(lhs, rhs);
+    auto work = is_reg(dst) && (rhs != dst || lhs == dst) ? dst : "%eax";
+    emit_move(ty, lhs, work);
+    emit(op + rhs + ", " + work);
+    emit_move(ty, work, dst);
+}
+
+void X86CodeGen::generate_vector_binary(Instruction *instr)
+{
+    auto vector_ty = static_cast<VectorType *>(instr->get_type());
+    int lanes = vector_ty->get_num_of_elements();
+    auto lhs = instr->get_operand(0);
+    auto rhs = instr->get_operand(1);
+
+    // step 1: the operations of SSE2 on 4 lanes at a time,
+    // there are no multiplications (before SSE4.1), divisions or variable shifts of int vectors
+    std::string op;
+    switch (instr->get_instr_type())
+    {
+    case Instruction::add: op = "paddd"; break;
+    case Instruction::sub: op = "psubd"; break;
+    case Instruction::and_: op = "pand"; break;
+    case Instruction::or_: op = "por"; break;
+    case Instruction::xor_: op = "pxor"; break;
+    case Instruction::fadd: op = "addps"; break;
+    case Instruction::fsub: op = "subps"; break;
+    case Instruction::fmul: op = "mulps"; break;
+    case Instruction::fdiv: op = "divps"; break;
+    default: break;
+    }
+    int lane = 0;
+    if (!op.empty())
+    {
+        for (; lane + SSE_LANES <= lanes; lane += SSE_LANES)
+        {
+            if (CONST_ZERO(lhs))
+                emit("pxor %xmm0, %xmm0");
+            else
+                emit("movdqu " + get_lane_operand(lhs, lane) + ", %xmm0");
+            if (CONST_ZERO(rhs))
+                emit("pxor %xmm1, %xmm1");
+            else
+                emit("movdqu " + get_lane_operand(rhs, lane) + ", %xmm1");
+            emit(op + " %xmm1, %xmm0");
+            emit("movdqu %xmm0, " + get_lane_operand(instr, lane));
+        }
+    }
+
+    // step 2: the other lanes one at a time
+    for (; lane < lanes; lane++)
+    {
+        auto lhs_lane = get_lane_operand(lhs, lane);
+        auto rhs_lane = get_lane_operand(rhs, lane);
+        if (instr->is_fp_instr())
+        {
+            emit("movss " + lhs_lane + ", %xmm0");
+            emit(instr->get_instr_op_name().substr(1) + "ss " + rhs_lane + ", %xmm0");
+            emit("movss %xmm0, " + get_lane_operand(instr, lane));
+        }
+        else
+        {
+            emit_int_binary(instr->get_instr_type(), lhs_lane, rhs_lane, get_lane_operand(instr, lane));
+        }
+    }
+}
+
+std::string X86CodeGen::emit_compare(Instruction *instr)
+{
+    auto lhs = get_operand(instr->get_operand(0));
+    auto rhs = get_operand(instr->get_operand(1));
+    if (instr->is_cmp())
+    {
+        // indexed by CmpInst::CmpOp
+        static const char *CCS[] = {"e", "ne", "g", "ge", "l", "le"};
+        // the runtime checks of the vectorizer compare pointers, which may be addresses to leaq
+        bool is_pointer = instr->get_operand(0)->get_type()->is_pointer_type();
+        auto lhs_move = get_move(instr->get_operand(0), is_pointer ? "%rax" : "%eax");
+        auto rhs_move = get_move(instr->get_operand(1), "%rcx");
+        if (rhs_move.is_address)
+        {
+            emit_move(rhs_move);
+            rhs = rhs_move.dst;
+        }
+        if (lhs_move.is_address || lhs[0] == '$' || (is_mem(lhs) && is_mem(rhs)))
+        {
+            emit_move(lhs_move);
+            lhs = lhs_move.dst;
+        }
+        emit((is_pointer ? "cmpq " : "cmpl ") + rhs + ", " + lhs);
+        return CCS[static_cast<CmpInst *>(instr)->get_cmp_op()];
+    }
+    // the compares are unordered, i.e. true if an operand is NaN, as ucomiss sets ZF, PF and CF then;
+    // > and >= are < and <= with the operands swapped
+    auto op = static_cast<FCmpInst *>(instr)->get_cmp_op();
+    if (op == FCmpInst::GT || op == FCmpInst::GE)
+        std::swap(lhs, rhs);
+    if (!is_reg(lhs))
+    {
+        emit_move(instr->get_operand(0)->get_type(), lhs, "%xmm0");
+        lhs = "%xmm0";
+    }
+    emit("ucomiss " + rhs + ", " + lhs);
+    switch (op)
+    {
+    case FCmpInst::EQ:
+        return "e";
+    case FCmpInst::NE:
+        return "ne";
+    case FCmpInst::GT:
+    case FCmpInst::LT:
+        return "b";
+    default:
+        return "be";
+    }
+}
+
+void X86CodeGen::generate_cmp(Instruction *instr)
+{
+    auto cc = emit_compare(instr);
+    auto dst = get_operand(instr);
+    emit("set" + cc + " %al");
+    auto work = is_reg(dst) ? dst : "%eax";
+    emit("movzbl %al, " + work);
+    emit_move(instr->get_type(), work, dst);
+}
+
+void X86CodeGen::generate_fcmp(Instruction *instr)
+{
+    auto cc = emit_compare(instr);
+    auto dst = get_operand(instr);
+    emit("set" + cc + " %al");
+    if (static_cast<FCmpInst *>(instr)->get_cmp_op() == FCmpInst::NE)
+    {
+        emit("setp %cl");
+        emit("orb %cl, %al");
+    }
+    auto work = is_reg(dst) ? dst : "%eax";
+    emit("movzbl %al, " + work);
+    emit_move(instr->get_type(), work, dst);
+}
+
+void X86CodeGen::generate_call(Instruction *instr)
+{
+    auto func = static_cast<Function *>(instr->get_operand(0));
+
+    // step 1: the arguments past the registers are passed on the stack, which stays aligned to 16 bytes
+    std::vector<Type *> types;
+    for (unsigned i = 1; i < instr->get_num_operand(); i++)
+    {
+        types.push_back(instr->get_operand(i)->get_type());
+    }
+    auto arg_regs = get_arg_regs(types);
+    std::vector<Move> moves;
+    std::vector<Value *> stack_args;
+    for (unsigned i = 0; i < arg_regs.size(); i++)
+    {
+        auto arg = instr->get_operand(i + 1);
+        auto ty = types[i];
+        if (arg_regs[i].empty())
+            stack_args.push_back(arg);
+        else
+            moves.push_back(get_move(
+                arg, "%" + (ty->is_float_type() || ty->is_pointer_type() ? arg_regs[i] : get_reg32(arg_regs[i]))));
+    }
+    int stack_size = (stack_args.size() * 8 + 15) / 16 * 16;
+    if (stack_size > 0)
+        emit("subq $" + std::to_string(stack_size) + ", %rsp");
+    for (unsigned i = 0; i < stack_args.size(); i++)
+    {
+        emit_move(get_move(stack_args[i], get_address(8 * i, "rsp")));
+    }
+
+    // step 2: the arguments in registers, no value is live in a caller saved register across the call
+    emit_parallel_moves(moves);
+    emit("call " + func->get_name() + (func->is_declaration() ? "@PLT" : ""));
+    if (stack_size > 0)
+        emit("addq $" + std::to_string(stack_size) + ", %rsp");
+
+    // step 3: the result
+    auto ty = instr->get_type();
+    if (ty->is_float_type())
+        emit_move(ty, "%xmm0", get_operand(instr));
+    else if (ty->is_pointer_type())
+        emit_move(ty, "%rax", get_operand(instr));
+    else if (!ty->is_void_type())
+        emit_move(ty, "%eax", get_operand(instr));
+}
+
+void X86CodeGen::generate_gep(Instruction *instr)
+{
+    // step 1: the base, which is used from its register if it has one
+    auto ptr = instr->get_operand(0);
+    std::string base;
+    if (regs_.count(ptr))
+    {
+        base = "%" + regs_[ptr];
+    }
+    else
+    {
+        load_pointer(ptr, "rax");
+        base = "%rax";
+    }
+
+    // step 2: the first index steps over the pointed type, the next ones over the elements of the arrays
+    auto ty = ptr->get_type()->get_pointer_element_type();
+    long long offset = 0;
+    for (unsigned i = 1; i < instr->get_num_operand(); i++)
+    {
+        if (i > 1)
+            ty = ty->get_array_element_type();
+        long long size = get_type_size(ty);
+        auto idx = instr->get_operand(i);
+        if (CONST_INT(idx) || CONST_ZERO(idx))
+        {
+            offset += CONST_INT(idx) ? CONST_INT(idx)->get_value() * size : 0;
+            continue;
+        }
+        emit("movslq " + get_operand(idx) + ", %rcx");
+        if (size == 1 || size == 2 || size == 4 || size == 8)
+        {
+            emit("leaq (" + base + ",%rcx," + std::to_string(size) + "), %rax");
+        }
+        else
+        {
+            emit("imulq $" + std::to_string(size) + ", %rcx");
+            emit("leaq (" + base + ",%rcx), %rax");
+        }
+        base = "%rax";
+    }
+
+    // step 3: the constant offset
+    auto dst = get_operand(instr);
+    if (offset != 0)
+    {
+        auto work = is_reg(dst) ? dst : "%rax";
+        emit("leaq " + std::to_string(offset) + "(" + base + "), " + work);
+        base = work;
+    }
+    emit_move(instr->get_type(), base, dst);
+}
+
+void X86CodeGen::generate_load(Instruction *instr)
+{
+    auto ty = instr->get_type();
+    if (ty->is_vector_type())
+    {
+        load_pointer(instr->get_operand(0), "rax");
+        copy_memory("rax", 0, "rbp", offsets_[instr], ty->get_size());
+        return;
+    }
+    auto src = get_memory_operand(instr->get_operand(0));
+    auto dst = get_operand(instr);
+    if (ty->get_size() == 1 && !ty->is_pointer_type())
+    {
+        // an i1 takes a byte in memory
+        auto work = is_reg(dst) ? dst : "%eax";
+        emit("movzbl " + src + ", " + work);
+        emit_move(ty, work, dst);
+    }
+    else
+    {
+        emit_move(ty, src, dst);
+    }
+}
+
+void X86CodeGen::generate_store(Instruction *instr)
+{
+    auto val = static_cast<StoreInst *>(instr)->get_rval();
+    auto ty = val->get_type();
+    if (ty->is_vector_type())
+    {
+        load_pointer(static_cast<StoreInst *>(instr)->get_lval(), "rax");
+        if (CONST_ZERO(val))
+            zero_memory("rax", 0, ty->get_size());
+        else
+            copy_memory("rbp", offsets_[val], "rax", 0, ty->get_size());
+        return;
+    }
+    auto dst = get_memory_operand(static_cast<StoreInst *>(instr)->get_lval());
+    if (ty->get_size() == 1 && !ty->is_pointer_type())
+    {
+        emit_move(ty, get_operand(val), "%ecx");
+        emit("movb %cl, " + dst);
+    }
+    else
+    {
+        emit_move(get_move(val, dst));
+    }
+}
+
+void X86CodeGen::generate_insert_element(Instruction *instr)
+{
+    auto vec = instr->get_operand(0);
+    auto val = instr->get_operand(1);
+    auto idx = instr->get_operand(2);
+    auto offset = offsets_[instr];
+    copy_vector(vec, offset);
+    // the elements are i32 or float, which take 4 bytes
+    std::string lane;
+    if (CONST_INT(idx))
+    {
+        lane = get_lane_operand(instr, CONST_INT(idx)->get_value());
+    }
+    else
+    {
+        emit("movslq " + get_operand(idx) + ", %rcx");
+        lane = std::to_string(offset) + "(%rbp,%rcx,4)";
+    }
+    emit_move(val->get_type(), get_operand(val), lane);
+}
+
+void X86CodeGen::generate_extract_element(Instruction *instr)
+{
+    auto vec = instr->get_operand(0);
+    auto idx = instr->get_operand(1);
+    std::string lane;
+    if (CONST_ZERO(vec) || CONST_INT(idx))
+    {
+        lane = get_lane_operand(vec, CONST_INT(idx) ? CONST_INT(idx)->get_value() : 0);
+    }
+    else
+    {
+        emit("movslq " + get_operand(idx) + ", %rcx");
+        lane = std::to_string(offsets_[vec]) + "(%rbp,%rcx,4)";
+    }
+    emit_move(instr->get_type(), lane, get_operand(instr));
+}
+
+void X86CodeGen::generate_br(Instruction *instr)
+{
+    auto bb = instr->get_parent();
+    auto target = get_br_target(instr);
+    if (target)
+    {
+        generate_edge_moves(bb, target);
+        if (target != next_bb_)
+            emit("jmp " + get_label(target));
+        return;
+    }
+
+    // the phis of a target are set on a block of the edge, so the other target does not see the moves
+    auto cond = instr->get_operand(0);
+    auto if_true = static_cast<BasicBlock *>(instr->get_operand(1));
+    auto if_false = static_cast<BasicBlock *>(instr->get_operand(2));
+    std::string cc = "ne";
+    if (fused_.count(static_cast<Instruction *>(cond)))
+    {
+        cc = emit_compare(static_cast<Instruction *>(cond));
+    }
+    else
+    {
+        auto op = get_operand(cond);
+        emit(is_reg(op) ? "testl " + op + ", " + op : "cmpl $0, " + op);
+    }
+    auto true_label = get_edge_label(bb, if_true);
+    auto false_label = get_edge_label(bb, if_false);
+    if (if_false == next_bb_ && false_label == get_label(if_false))
+    {
+        emit("j" + cc + " " + true_label);
+    }
+    else if (if_true == next_bb_ && true_label == get_label(if_true))
+    {
+        emit("j" + get_inverse_cc(cc) + " " + false_label);
+    }
+    else
+    {
+        emit("j" + cc + " " + true_label);
+        emit("jmp " + false_label);
+    }
+}
+
+void X86CodeGen::generate_ret(Instruction *instr)
+{
+    if (!static_cast<ReturnInst *>(instr)->is_void_ret())
+    {
+        auto val = instr->get_operand(0);
+        auto ty = val->get_type();
+        if (ty->is_float_type())
+            emit_move(ty, get_operand(val), "%xmm0");
+        else if (ty->is_pointer_type())
+            load_pointer(val, "rax");
+        else
+            emit_move(ty, get_operand(val), "%eax");
+    }
+    for (auto &saved : saved_regs_)
+    {
+        emit("movq " + get_frame_operand(saved.second) + ", %" + saved.first);
+    }
+    emit("leave");
+    emit("ret");
+}
+
+std::string X86CodeGen::get_operand(Value *val)
+{
+    auto ty = val->get_type();
+    if (CONST_INT(val))
+        return "$" + std::to_string(CONST_INT(val)->get_value());
+    if (dynamic_cast<ConstantFP *>(val))
+        return get_float_constant(static_cast<ConstantFP *>(val)->get_value()) + "(%rip)";
+    if (CONST_ZERO(val))
+        return ty->is_float_type() ? get_float_constant(0) + "(%rip)" : "$0";
+    auto iter = regs_.find(val);
+    if (iter != regs_.end())
+        return "%" + (ty->is_float_type() || ty->is_pointer_type() ? iter->second : get_reg32(iter->second));
+    if (offsets_.count(val))
+        return get_slot(val);
+    // a value used nowhere is computed into a scratch register
+    return ty->is_float_type() ? "%xmm0" : ty->is_pointer_type() ? "%rax" : "%eax";
+}
+
+std::string X86CodeGen::get_address_operand(Value *val)
+{
+    if (dynamic_cast<GlobalVariable *>(val))
+        return val->get_name() + "(%rip)";
+    return get_slot(val);
+}
+
+std::string X86CodeGen::get_location(const std::string &op)
+{
+    // the 64 bit register for a 32 bit one
+    if (op.size() > 2 && op[0] == '%' && op[1] == 'e')
+        return "%r" + op.substr(2);
+    if (op.size() > 3 && op[0] == '%' && op[1] == 'r' && op.back() == 'd')
+        return op.substr(0, op.size() - 1);
+    return op;
+}
+
+std::string X86CodeGen::get_cycle_scratch(Type *ty)
+{
+    if (ty->is_float_type())
+        return "%xmm15";
+    return ty->is_pointer_type() ? "%rax" : "%eax";
+}
+
+std::string X86CodeGen::get_lane_operand(Value *val, int lane)
+{
+    if (CONST_ZERO(val))
+        return val->get_type()->get_vector_element_type()->is_float_type() ? get_float_constant(0) + "(%rip)"
+                                                                           : "$0";
+    return get_address(offsets_.at(val) + 4 * lane, "rbp");
+}
+
+std::string X86CodeGen::get_memory_operand(Value *ptr)
+{
+    if (dynamic_cast<GlobalVariable *>(ptr))
+        return ptr->get_name() + "(%rip)";
+    if (dynamic_cast<AllocaInst *>(ptr))
+        return get_slot(ptr);
+    if (regs_.count(ptr))
+        return "(%" + regs_[ptr] + ")";
+    load_pointer(ptr, "rax");
+    return "(%rax)";
+}
+
+void X86CodeGen::emit_move(Type *ty, const std::string &src, const std::string &dst)
+{
+    if (src == dst)
+        return;
+    if (ty->is_float_type())
+    {
+        if (is_reg(src) && is_reg(dst))
+        {
+            emit("movaps " + src + ", " + dst);
+        }
+        else if (is_reg(src) || is_reg(dst))
+        {
+            emit("movss " + src + ", " + dst);
+        }
+        else
+        {
+            // the bits of a float are moved like an int
+            emit("movl " + src + ", %r11d");
+            emit("movl %r11d, " + dst);
+        }
+        return;
+    }
+    std::string suffix = ty->is_pointer_type() ? "q " : "l ";
+    if (is_mem(src) && is_mem(dst))
+    {
+        auto scratch = ty->is_pointer_type() ? "%r11" : "%r11d";
+        emit("mov" + suffix + src + ", " + scratch);
+        emit("mov" + suffix + scratch + ", " + dst);
+    }
+    else
+    {
+        emit("mov" + suffix + src + ", " + dst);
+    }
+}
+
+void X86CodeGen::emit_move(const Move &move)
+{
+    if (!move.is_address)
+    {
+        emit_move(move.ty, move.src, move.dst);
+    }
+    else if (is_reg(move.dst))
+    {
+        emit("leaq " + move.src + ", " + move.dst);
+    }
+    else
+    {
+        emit("leaq " + move.src + ", %r11");
+        emit("movq %r11, " + move.dst);
+    }
+}
+
+void X86CodeGen::load_pointer(Value *val, const std::string &reg)
+{
+    if (dynamic_cast<GlobalVariable *>(val))
+        emit("leaq " + val->get_name() + "(%rip), %" + reg);
+    else if (dynamic_cast<AllocaInst *>(val))
+        emit("leaq " + get_slot(val) + ", %" + reg);
+    else if (CONST_ZERO(val))
+        emit("xorl %" + get_reg32(reg) + ", %" + get_reg32(reg));
+    else
+        emit_move(val->get_type(), get_operand(val), "%" + reg);
+}
+
+void X86CodeGen::copy_memory(const std::string &src, int src_off, const std::string &dst, int dst_off, int size)
+{
+    int done = 0;
+    for (; done + 16 <= size; done += 16)
+    {
+        emit("movdqu " + get_address(src_off + done, src) + ", %xmm0");
+        emit("movdqu %xmm0, " + get_address(dst_off + done, dst));
+    }
+    for (; done + 8 <= size; done += 8)
+    {
+        emit("movq " + get_address(src_off + done, src) + ", %rcx");
+        emit("movq %rcx, " + get_address(dst_off + done, dst));
+    }
+    for (; done + 4 <= size; done += 4)
+    {
+        emit("movl " + get_address(src_off + done, src) + ", %ecx");
+        emit("movl %ecx, " + get_address(dst_off + done, dst));
+    }
+}
+
+void X86CodeGen::zero_memory(const std::string &dst, int dst_off, int size)
+{
+    int done = 0;
+    if (size >= 16)
+        emit("pxor %xmm0, %xmm0");
+    for (; done + 16 <= size; done += 16)
+    {
+        emit("movdqu %xmm0, " + get_address(dst_off + done, dst));
+    }
+    for (; done + 4 <= size; done += 4)
+    {
+        emit("movl $0, " + get_address(dst_off + done, dst));
+    }
+}
@@ -1,21 +1,214 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * The input and the output go through buffers of the runtime instead of
+ * scanf and printf: the input is read in large blocks and the integers are
+ * parsed by hand, and the numbers are formatted by hand into the output
+ * buffer, which is written when it's full, before reading more input, at
+ * exit and before an exception ends the program. The bytes written are
+ * those printf would write.
+ * The input buffer ends with a NUL, which stops the scans at its end, and
+ * only a number running into the end is read again after a refill, so a
+ * number followed by a newline on a terminal doesn't wait for more input.
+ * The first output finds no room in its buffer and takes the slow path,
+ * which also registers the flush at exit.
+ * The array functions, e.g. inputArray(a, n), do the work of n calls of
+ * input() or output() in one loop.
+ */
+
+#define IO_BUFFER_SIZE (1 << 16)
+// the longest number written by one call, "-340282346638528859811704183484516925440.000000\n"
+#define IO_MAX_NUMBER 64
+
+static char input_buffer[IO_BUFFER_SIZE + 1];
+static size_t input_pos = 0;
+static size_t input_len = 0;
+static int input_eof = 0;
+
+static char output_buffer[IO_BUFFER_SIZE];
+static size_t output_len = 0;
+// a number is written without a check while output_len is below the limit, which is 0
+// until the flush at exit is registered
+static size_t output_limit = 0;
+
+static void flush_output() {
+    size_t written = 0;
+    while (written < output_len) {
+        ssize_t n = write(1, output_buffer + written, output_len - written);
+        if (n <= 0)
+            break;
+        written += n;
+    }
+    output_len = 0;
+}
+
+// make room for a number, the slow path of the output
+static void reserve_output() {
+    if (output_limit == 0) {
+        atexit(flush_output);
+        output_limit = IO_BUFFER_SIZE - IO_MAX_NUMBER;
+    }
+    if (output_len >= output_limit)
+        flush_output();
+}
+
+// read more input after the bytes from input_pos, which are moved to the start
+static void fill_input() {
+    // the output asked for the input is written first, e.g. on a terminal
+    flush_output();
+    input_len -= input_pos;
+    memmove(input_buffer, input_buffer + input_pos, input_len);
+    input_pos = 0;
+    ssize_t n = read(0, input_buffer + input_len, IO_BUFFER_SIZE - input_len);
+    if (n > 0)
+        input_len += n;
+    else
+        input_eof = 1;
+    input_buffer[input_len] = '\0';
+}
+
+static inline int is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// like scanf("%d"), the spaces are skipped and 0 is returned if there is no number
+static inline int read_int() {
+    while (1) {
+        const char *p = input_buffer + input_pos;
+        while (is_space(*p))
+            p++;
+        const char *start = p;
+        int negative = *p == '-';
+        if (*p == '-' || *p == '+')
+            p++;
+        unsigned a = 0;
+        while (*p >= '0' && *p <= '9')
+            a = a * 10 + (*p++ - '0');
+        if (p < input_buffer + input_len || input_eof) {
+            input_pos = p - input_buffer;
+            return negative ? -a : a;
+        }
+        // the number may go on after the end of the buffer
+        input_pos = start - input_buffer;
+        fill_input();
+    }
+}
+
+// the two digits of each number below 100
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline void write_unsigned(unsigned long long a) {
+    char digits[20];
+    int n = 20;
+    while (a >= 100) {
+        n -= 2;
+        memcpy(digits + n, DIGIT_PAIRS + a % 100 * 2, 2);
+        a /= 100;
+    }
+    if (a >= 10) {
+        n -= 2;
+        memcpy(digits + n, DIGIT_PAIRS + a * 2, 2);
+    } else {
+        digits[--n] = '0' + a;
+    }
+    memcpy(output_buffer + output_len, digits + n, 20 - n);
+    output_len += 20 - n;
+}
+
+static inline void write_int(int a) {
+    if (output_len >= output_limit)
+        reserve_output();
+    if (a < 0)
+        output_buffer[output_len++] = '-';
+    write_unsigned(a < 0 ? -(unsigned long long)a : (unsigned long long)a);
+    output_buffer[output_len++] = '\n';
+}
+
+static inline void write_float(float a) {
+    if (output_len >= output_limit)
+        reserve_output();
+    unsigned bits;
+    memcpy(&bits, &a, sizeof(bits));
+    int exponent = (bits >> 23) & 0xff;
+    // step 1: inf, nan and the values of 2^40 or more are left to printf
+    if (exponent >= 127 + 40) {
+        output_len += snprintf(output_buffer + output_len, IO_MAX_NUMBER, "%f\n", a);
+        return;
+    }
+
+    // step 2: a = mantissa * 2^shift, and a * 10^6 is rounded to the nearest integer, ties to even
+    unsigned long long mantissa = exponent ? (bits & 0x7fffff) | 0x800000 : bits & 0x7fffff;
+    int shift = (exponent ? exponent : 1) - 127 - 23;
+    unsigned long long scaled = mantissa * 1000000;
+    if (shift >= 0) {
+        scaled <<= shift;
+    } else if (-shift >= 64) {
+        // less than half of 10^-6
+        scaled = 0;
+    } else {
+        unsigned long long rest = scaled & ((1ull << -shift) - 1);
+        unsigned long long half = 1ull << (-shift - 1);
+        scaled >>= -shift;
+        if (rest > half || (rest == half && (scaled & 1)))
+            scaled++;
+    }
+
+    // step 3: the sign is printed for -0 as well, then 6 decimals
+    if (bits >> 31)
+        output_buffer[output_len++] = '-';
+    write_unsigned(scaled / 1000000);
+    output_buffer[output_len++] = '.';
+    unsigned fraction = scaled % 1000000;
+    for (int i = 5; i >= 0; i--) {
+        output_buffer[output_len + i] = '0' + fraction % 10;
+        fraction /= 10;
+    }
+    output_len += 6;
+    output_buffer[output_len++] = '\n';
+}
+
 int input() {
-    int a;
-    scanf("%d", &a);
-    return a;
+    return read_int();
 }
 
 void output(int a) {
-    printf("%d\n", a);
+    write_int(a);
 }
 
 void outputFloat(float a) {
-    printf("%f\n", a);
+    write_float(a);
+}
+
+void inputArray(int a[], int n) {
+    for (int i = 0; i < n; i++)
+        a[i] = read_int();
+}
+
+void outputArray(int a[], int n) {
+    for (int i = 0; i < n; i++)
+        write_int(a[i]);
+}
+
+void outputFloatArray(float a[], int n) {
+    for (int i = 0; i < n; i++)
+        write_float(a[i]);
 }
 
 void neg_idx_except() {
+    flush_output();
     printf("negative index exception\n");
     exit(0);
 }
 
+
+void idx_out_of_range_except() {
+    flush_output();
+    printf("index out of range exception\n");
+    exit(0);
+}
@@ -3,6 +3,7 @@
 #include "Function.h"
 #include "IRprinter.h"
 #include <cassert>
+#include <algorithm>
 
 BasicBlock::BasicBlock(Module *m, const std::string &name = "",
                       Function *parent = nullptr)
@@ -27,6 +28,38 @@ void BasicBlock::add_instr_begin(Instruction *instr)
     instr_list_.push_front(instr);
 }
 
+void BasicBlock::add_instr_before(Instruction *instr, Instruction *pos)
+{
+    auto iter = std::find(instr_list_.begin(), instr_list_.end(), pos);
+    assert(iter != instr_list_.end() && "pos is not in this bb");
+    instr_list_.insert(iter, instr);
+    instr->set_parent(this);
+}
+
+Instruction *BasicBlock::insert_before_terminator(Instruction *instr)
+{
+    assert(instr_list_.back() == instr && "instr is not the last instruction of this bb");
+    instr_list_.pop_back();
+    add_instr_before(instr, get_terminator());
+    return instr;
+}
+
+void BasicBlock::redirect_succ_basic_block(BasicBlock *succ, BasicBlock *new_succ)
+{
+    remove_succ_basic_block(succ);
+    succ->remove_pre_basic_block(this);
+    auto terminator = get_terminator();
+    for (int i = 0; i < terminator->get_num_operand(); i++)
+    {
+        if (terminator->get_operand(i) == succ)
+        {
+            terminator->set_operand(i, new_succ);
+            add_succ_basic_block(new_succ);
+            new_succ->add_pre_basic_block(this);
+        }
+    }
+}
+
 void BasicBlock::delete_instr( Instruction *instr )
 {
     instr_list_.remove(instr);
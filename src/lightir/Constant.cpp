@@ -47,15 +47,18 @@ ConstantArray *ConstantArray::get(ArrayType *ty, const std::vector<Constant*> &v
 
 std::string ConstantArray::print()
 {
+    // the type of the array is printed by the user, e.g. a global, and each element with its type
     std::string const_ir;
-    const_ir += this->get_type()->print();
-    const_ir += " ";
     const_ir += "[";
     for ( int i = 0 ; i < this->get_size_of_array() ; i++ )
     {
+        if ( i )
+            const_ir += ", ";
+        const_ir += get_element_value(i)->get_type()->print();
+        const_ir += " ";
         const_ir += get_element_value(i)->print();
-        const_ir += ", ";
     }
+    const_ir += "]";
     return const_ir;
 }
 
@@ -6,6 +6,7 @@ Function::Function(FunctionType *ty, const std::string &name, Module *parent)
     : Value(ty, name), parent_(parent), seq_cnt_(0)
 {
     // num_args_ = ty->getNumParams();
+    set_shared_use_list();
     parent->add_function(this);
     build_args();
 }
@@ -7,6 +7,7 @@
 GlobalVariable::GlobalVariable( std::string name, Module *m, Type* ty, bool is_const, Constant* init)
     : User(ty, name, init != nullptr), is_const_(is_const), init_val_(init) 
 {
+    set_shared_use_list();
     m->add_global_variable(this);
     if (init) {
         this->set_operand(0, init);
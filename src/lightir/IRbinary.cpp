@@ -0,0 +1,830 @@
+#include "IRbinary.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "GlobalVariable.h"
+#include <cstring>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+const char MAGIC[4] = {'L', 'I', 'R', 'B'};
+const unsigned VERSION = 1;
+
+enum ConstantKind
+{
+    INT_CONSTANT,
+    FLOAT_CONSTANT,
+    ZERO_CONSTANT,
+    ARRAY_CONSTANT
+};
+
+// the number of operands of each OpID, -1 if it is written before them
+const int NUM_OPERANDS[] = {
+    -1, -1,             // ret, br
+    2, 2, 2, 2, 2,      // add, sub, mul, sdiv, srem
+    2, 2, 2, 2, 2,      // shl, ashr, and, or, xor
+    2, 2, 2, 2,         // fadd, fsub, fmul, fdiv
+    0, 1, 2,            // alloca, load, store
+    2, 2, -1, -1, -1,   // cmp, fcmp, phi, call, getelementptr
+    1, 1, 1, 1,         // zext, fptosi, sitofp, bitcast
+    3, 2                // insertelement, extractelement
+};
+const unsigned NUM_OPS = sizeof(NUM_OPERANDS) / sizeof(NUM_OPERANDS[0]);
+
+class Writer
+{
+public:
+    std::string write(Module *m);
+
+private:
+    // the id of ty, which is added to the types with the types it contains
+    unsigned add_type(Type *ty);
+    // the id of c, which is added to the constants with its elements
+    unsigned add_constant(Constant *c);
+    void write_function(Function *func);
+
+    static void put(std::string &out, unsigned val);
+    static void put_signed(std::string &out, int val);
+    static void put_string(std::string &out, const std::string &str);
+
+    // the encodings of the types and of the constants, in the order of their ids
+    std::string types_;
+    std::string constants_;
+    std::string body_;
+    unsigned num_types_ = 0;
+    unsigned num_constants_ = 0;
+    unsigned num_module_values_ = 0;
+    std::map<Type *, unsigned> type_ids_;
+    std::map<std::tuple<ConstantKind, Type *, unsigned>, unsigned> constant_ids_;
+    std::map<Constant *, unsigned> array_ids_;
+    // { value : id } for the values of the module, and for those of the function being written
+    std::unordered_map<Value *, unsigned> ids_;
+    std::unordered_map<Value *, unsigned> local_ids_;
+};
+
+class Reader
+{
+public:
+    Reader(const char *data, size_t size) : pos_(data), end_(data + size) {}
+    std::unique_ptr<Module> read();
+
+private:
+    void read_type();
+    void read_constant();
+    void read_function(Function *func);
+    Type *get_type();
+    // the operand with the next id, a placeholder if it is an instruction not read yet
+    Value *get_value();
+    BasicBlock *get_block();
+
+    unsigned char get_byte();
+    unsigned get();
+    int get_signed();
+    std::string get_string();
+
+    const char *pos_;
+    const char *end_;
+    Module *m_;
+    std::vector<Type *> types_;
+    // the values of the module, then those of the function being read
+    std::vector<Value *> values_;
+    unsigned num_module_values_;
+    // the first id of an instruction of the function being read, and the types of its instructions
+    unsigned first_instr_;
+    std::vector<Type *> instr_types_;
+    std::vector<Argument *> placeholders_;
+};
+
+void Writer::put(std::string &out, unsigned val)
+{
+    while (val >= 0x80)
+    {
+        out += static_cast<char>(val | 0x80);
+        val >>= 7;
+    }
+    out += static_cast<char>(val);
+}
+
+void Writer::put_signed(std::string &out, int val)
+{
+    put(out, (static_cast<unsigned>(val) << 1) ^ static_cast<unsigned>(val >> 31));
+}
+
+void Writer::put_string(std::string &out, const std::string &str)
+{
+    put(out, str.size());
+    out += str;
+}
+
+unsigned Writer::add_type(Type *ty)
+{
+    auto it = type_ids_.find(ty);
+    if (it != type_ids_.end())
+        return it->second;
+    std::string entry(1, static_cast<char>(ty->get_type_id()));
+    switch (ty->get_type_id())
+    {
+    case Type::IntegerTyID:
+        put(entry, static_cast<IntegerType *>(ty)->get_num_bits());
+        break;
+    case Type::FunctionTyID:
+    {
+        auto func_ty = static_cast<FunctionType *>(ty);
+        put(entry, add_type(func_ty->get_return_type()));
+        put(entry, func_ty->get_num_of_args());
+        for (unsigned i = 0; i < func_ty->get_num_of_args(); i++)
+            put(entry, add_type(func_ty->get_param_type(i)));
+        break;
+    }
+    case Type::ArrayTyID:
+        put(entry, add_type(static_cast<ArrayType *>(ty)->get_element_type()));
+        put(entry, static_cast<ArrayType *>(ty)->get_num_of_elements());
+        break;
+    case Type::PointerTyID:
+        put(entry, add_type(static_cast<PointerType *>(ty)->get_element_type()));
+        break;
+    case Type::VectorTyID:
+        put(entry, add_type(static_cast<VectorType *>(ty)->get_element_type()));
+        put(entry, static_cast<VectorType *>(ty)->get_num_of_elements());
+        break;
+    default:
+        break;
+    }
+    // the contained types take the ids before this one
+    types_ += entry;
+    return type_ids_[ty] = num_types_++;
+}
+
+unsigned Writer::add_constant(Constant *c)
+{
+    std::string entry;
+    auto ty = c->get_type();
+    if (auto const_array = dynamic_cast<ConstantArray *>(c))
+    {
+        auto it = array_ids_.find(c);
+        if (it != array_ids_.end())
+            return it->second;
+        std::vector<unsigned> elements;
+        for (unsigned i = 0; i < const_array->get_size_of_array(); i++)
+            elements.push_back(add_constant(const_array->get_element_value(i)));
+        entry += static_cast<char>(ARRAY_CONSTANT);
+        put(entry, add_type(ty));
+        put(entry, elements.size());
+        for (auto element : elements)
+            put(entry, element);
+        constants_ += entry;
+        return array_ids_[c] = num_constants_++;
+    }
+    std::tuple<ConstantKind, Type *, unsigned> key;
+    if (auto const_int = dynamic_cast<ConstantInt *>(c))
+        key = std::make_tuple(INT_CONSTANT, ty, static_cast<unsigned>(const_int->get_value()));
+    else if (auto const_fp = dynamic_cast<ConstantFP *>(c))
+    {
+        auto val = const_fp->get_value();
+        unsigned bits;
+        std::memcpy(&bits, &val, sizeof(bits));
+        key = std::make_tuple(FLOAT_CONSTANT, ty, bits);
+    }
+    else if (dynamic_cast<ConstantZero *>(c))
+        key = std::make_tuple(ZERO_CONSTANT, ty, 0u);
+    else
+        throw "cannot encode constant " + c->print();
+    auto it = constant_ids_.find(key);
+    if (it != constant_ids_.end())
+        return it->second;
+    entry += static_cast<char>(std::get<0>(key));
+    put(entry, add_type(ty));
+    if (std::get<0>(key) == INT_CONSTANT)
+        put_signed(entry, static_cast<int>(std::get<2>(key)));
+    else if (std::get<0>(key) == FLOAT_CONSTANT)
+    {
+        // little endian, as on the targets of the compiler
+        for (int i = 0; i < 4; i++)
+            entry += static_cast<char>(std::get<2>(key) >> (8 * i));
+    }
+    constants_ += entry;
+    return constant_ids_[key] = num_constants_++;
+}
+
+std::string Writer::write(Module *m)
+{
+    // step 1: number the constants, then the globals and the functions, collecting the types
+    std::vector<unsigned> inits;
+    for (auto global : m->get_global_variable())
+    {
+        add_type(global->get_type()->get_pointer_element_type());
+        inits.push_back(global->get_init() ? add_constant(global->get_init()) + 1 : 0);
+    }
+    for (auto func : m->get_functions())
+    {
+        add_type(func->get_function_type());
+        for (auto bb : func->get_basic_blocks())
+        {
+            for (auto instr : bb->get_instructions())
+            {
+                add_type(instr->get_type());
+                for (auto op : instr->get_operands())
+                {
+                    if (auto c = dynamic_cast<Constant *>(op))
+                        ids_[c] = add_constant(c);
+                }
+            }
+        }
+    }
+    unsigned id = num_constants_;
+    for (auto global : m->get_global_variable())
+        ids_[global] = id++;
+    for (auto func : m->get_functions())
+        ids_[func] = id++;
+    num_module_values_ = id;
+
+    // step 2: the bodies, which may still add types
+    for (auto func : m->get_functions())
+        write_function(func);
+
+    // step 3: the header and the tables, then the bodies
+    std::string out(MAGIC, sizeof(MAGIC));
+    put(out, VERSION);
+    put_string(out, m->get_name());
+    put(out, num_types_);
+    out += types_;
+    put(out, num_constants_);
+    out += constants_;
+    put(out, m->get_global_variable().size());
+    auto init = inits.begin();
+    for (auto global : m->get_global_variable())
+    {
+        put_string(out, global->get_name());
+        put(out, type_ids_[global->get_type()->get_pointer_element_type()]);
+        out += static_cast<char>(global->is_const());
+        put(out, *init++);
+    }
+    put(out, m->get_functions().size());
+    for (auto func : m->get_functions())
+    {
+        put_string(out, func->get_name());
+        put(out, type_ids_[func->get_function_type()]);
+    }
+    out += body_;
+    return out;
+}
+
+void Writer::write_function(Function *func)
+{
+    // step 1: number the arguments, the blocks and the non-void instructions
+    local_ids_.clear();
+    unsigned id = num_module_values_;
+    for (auto arg : func->get_args())
+        local_ids_[arg] = id++;
+    for (auto bb : func->get_basic_blocks())
+        local_ids_[bb] = id++;
+    std::vector<unsigned> instr_types;
+    for (auto bb : func->get_basic_blocks())
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (!instr->is_void())
+            {
+                local_ids_[instr] = id++;
+                instr_types.push_back(type_ids_[instr->get_type()]);
+            }
+        }
+    }
+
+    // step 2: the blocks, then the types of the instructions, so a forward reference can be typed
+    put(body_, func->get_num_basic_blocks());
+    if (func->is_declaration())
+        return;
+    for (auto bb : func->get_basic_blocks())
+        put_string(body_, bb->get_name());
+    put(body_, instr_types.size());
+    for (auto ty : instr_types)
+        put(body_, ty);
+
+    // step 3: the instructions, as the OpID, the predicate or the number of operands, and the operands
+    for (auto bb : func->get_basic_blocks())
+    {
+        put(body_, bb->get_num_of_instr());
+        for (auto instr : bb->get_instructions())
+        {
+            auto op_id = instr->get_instr_type();
+            body_ += static_cast<char>(op_id);
+            if (instr->is_cmp())
+                body_ += static_cast<char>(static_cast<CmpInst *>(instr)->get_cmp_op());
+            else if (instr->is_fcmp())
+                body_ += static_cast<char>(static_cast<FCmpInst *>(instr)->get_cmp_op());
+            else if (NUM_OPERANDS[op_id] < 0)
+                put(body_, instr->get_num_operand());
+            for (auto op : instr->get_operands())
+            {
+                auto it = local_ids_.find(op);
+                if (it == local_ids_.end() && !ids_.count(op))
+                    throw "cannot encode an operand of a " + instr->get_instr_op_name() + " in " + func->get_name() +
+                          ", which is not in the module";
+                put(body_, it != local_ids_.end() ? it->second : ids_[op]);
+            }
+        }
+    }
+
+    // step 4: the edges of the cfg as they are, since the passes do not keep them in the order of the branches
+    for (auto bb : func->get_basic_blocks())
+    {
+        for (auto edges : {&bb->get_pre_basic_blocks(), &bb->get_succ_basic_blocks()})
+        {
+            put(body_, edges->size());
+            for (auto edge : *edges)
+            {
+                if (!local_ids_.count(edge))
+                    throw "cannot encode an edge of " + bb->get_name() + " to a removed block";
+                put(body_, local_ids_[edge]);
+            }
+        }
+    }
+}
+
+unsigned char Reader::get_byte()
+{
+    if (pos_ == end_)
+        throw std::string("truncated LightIR binary");
+    return static_cast<unsigned char>(*pos_++);
+}
+
+unsigned Reader::get()
+{
+    unsigned val = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        auto byte = get_byte();
+        val |= static_cast<unsigned>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return val;
+    }
+    throw std::string("malformed varint in LightIR binary");
+}
+
+int Reader::get_signed()
+{
+    auto val = get();
+    return static_cast<int>((val >> 1) ^ (0u - (val & 1)));
+}
+
+std::string Reader::get_string()
+{
+    auto size = get();
+    if (size > static_cast<size_t>(end_ - pos_))
+        throw std::string("truncated LightIR binary");
+    std::string str(pos_, size);
+    pos_ += size;
+    return str;
+}
+
+Type *Reader::get_type()
+{
+    auto id = get();
+    if (id >= types_.size())
+        throw "bad type id " + std::to_string(id) + " in LightIR binary";
+    return types_[id];
+}
+
+Value *Reader::get_value()
+{
+    auto id = get();
+    if (id < values_.size() && values_[id])
+        return values_[id];
+    if (id < first_instr_ || id - first_instr_ >= instr_types_.size())
+        throw "bad value id " + std::to_string(id) + " in LightIR binary";
+    auto &placeholder = placeholders_[id - first_instr_];
+    if (!placeholder)
+        placeholder = new Argument(instr_types_[id - first_instr_]);
+    return placeholder;
+}
+
+BasicBlock *Reader::get_block()
+{
+    auto bb = dynamic_cast<BasicBlock *>(get_value());
+    if (!bb)
+        throw std::string("branch to a value which is not a block in LightIR binary");
+    return bb;
+}
+
+void Reader::read_type()
+{
+    Type *ty = nullptr;
+    switch (get_byte())
+    {
+    case Type::VoidTyID:
+        ty = m_->get_void_type();
+        break;
+    case Type::LabelTyID:
+        ty = m_->get_label_type();
+        break;
+    case Type::IntegerTyID:
+    {
+        auto num_bits = get();
+        if (num_bits != 1 && num_bits != 32)
+            throw "bad integer type i" + std::to_string(num_bits) + " in LightIR binary";
+        ty = num_bits == 1 ? m_->get_int1_type() : m_->get_int32_type();
+        break;
+    }
+    case Type::FunctionTyID:
+    {
+        auto result = get_type();
+        if (!FunctionType::is_valid_return_type(result))
+            throw std::string("bad return type in LightIR binary");
+        std::vector<Type *> params(get());
+        for (auto &param : params)
+        {
+            param = get_type();
+            if (!FunctionType::is_valid_argument_type(param))
+                throw std::string("bad argument type in LightIR binary");
+        }
+        ty = FunctionType::get(result, params);
+        break;
+    }
+    case Type::ArrayTyID:
+    {
+        auto contained = get_type();
+        if (!ArrayType::is_valid_element_type(contained))
+            throw std::string("bad array type in LightIR binary");
+        ty = m_->get_array_type(contained, get());
+        break;
+    }
+    case Type::PointerTyID:
+        ty = m_->get_pointer_type(get_type());
+        break;
+    case Type::FloatTyID:
+        ty = m_->get_float_type();
+        break;
+    case Type::VectorTyID:
+    {
+        auto contained = get_type();
+        if (!VectorType::is_valid_element_type(contained))
+            throw std::string("bad vector type in LightIR binary");
+        ty = m_->get_vector_type(contained, get());
+        break;
+    }
+    default:
+        throw std::string("bad type in LightIR binary");
+    }
+    types_.push_back(ty);
+}
+
+void Reader::read_constant()
+{
+    auto kind = get_byte();
+    auto ty = get_type();
+    Constant *c = nullptr;
+    switch (kind)
+    {
+    case INT_CONSTANT:
+    {
+        auto val = get_signed();
+        if (ty == m_->get_int1_type())
+            c = ConstantInt::get(val != 0, m_);
+        else
+            c = ConstantInt::get(val, m_);
+        break;
+    }
+    case FLOAT_CONSTANT:
+    {
+        unsigned bits = 0;
+        for (int i = 0; i < 4; i++)
+            bits |= static_cast<unsigned>(get_byte()) << (8 * i);
+        float val;
+        std::memcpy(&val, &bits, sizeof(val));
+        c = ConstantFP::get(val, m_);
+        break;
+    }
+    case ZERO_CONSTANT:
+        c = ConstantZero::get(ty, m_);
+        break;
+    case ARRAY_CONSTANT:
+    {
+        if (!ty->is_array_type())
+            throw std::string("bad constant array in LightIR binary");
+        std::vector<Constant *> elements(get());
+        for (auto &element : elements)
+        {
+            element = dynamic_cast<Constant *>(get_value());
+            if (!element)
+                throw std::string("bad constant array in LightIR binary");
+        }
+        c = ConstantArray::get(static_cast<ArrayType *>(ty), elements);
+        break;
+    }
+    default:
+        throw std::string("bad constant in LightIR binary");
+    }
+    values_.push_back(c);
+}
+
+void Reader::read_function(Function *func)
+{
+    // step 1: the blocks, and the arguments and the blocks take their ids
+    std::vector<BasicBlock *> bbs(get());
+    if (bbs.empty())
+        return;
+    values_.resize(num_module_values_);
+    for (auto arg : func->get_args())
+        values_.push_back(arg);
+    for (auto &bb : bbs)
+    {
+        bb = BasicBlock::create(m_, "", func);
+        bb->set_name(get_string());
+        values_.push_back(bb);
+    }
+    first_instr_ = values_.size();
+    instr_types_.resize(get());
+    for (auto &ty : instr_types_)
+        ty = get_type();
+    values_.resize(first_instr_ + instr_types_.size(), nullptr);
+    placeholders_.assign(instr_types_.size(), nullptr);
+
+    // step 2: the instructions, replacing the placeholders of those read before their uses
+    auto next = first_instr_;
+    for (auto bb : bbs)
+    {
+        auto num_instrs = get();
+        for (unsigned i = 0; i < num_instrs; i++)
+        {
+            auto op_id = get_byte();
+            if (op_id >= NUM_OPS)
+                throw "bad instruction " + std::to_string(op_id) + " in LightIR binary";
+            auto op = static_cast<Instruction::OpID>(op_id);
+            unsigned pred = 0;
+            if (op == Instruction::cmp || op == Instruction::fcmp)
+            {
+                pred = get_byte();
+                if (pred > CmpInst::LE)
+                    throw std::string("bad predicate in LightIR binary");
+            }
+            unsigned num_ops = NUM_OPERANDS[op] < 0 ? get() : NUM_OPERANDS[op];
+            // the type of a non-void instruction is the next one of the function
+            auto ty = next < values_.size() ? instr_types_[next - first_instr_] : nullptr;
+            Instruction *instr = nullptr;
+            switch (op)
+            {
+            case Instruction::ret:
+                if (num_ops > 1)
+                    throw std::string("bad ret in LightIR binary");
+                instr = num_ops ? ReturnInst::create_ret(get_value(), bb) : ReturnInst::create_void_ret(bb);
+                break;
+            case Instruction::br:
+                if (num_ops == 1)
+                    instr = BranchInst::create_br(get_block(), bb);
+                else if (num_ops == 3)
+                {
+                    auto cond = get_value();
+                    auto if_true = get_block();
+                    instr = BranchInst::create_cond_br(cond, if_true, get_block(), bb);
+                }
+                else
+                    throw std::string("bad br in LightIR binary");
+                break;
+            case Instruction::alloca:
+                if (!ty || !ty->is_pointer_type())
+                    throw std::string("bad alloca in LightIR binary");
+                instr = AllocaInst::create_alloca(ty->get_pointer_element_type(), bb);
+                break;
+            case Instruction::load:
+            {
+                auto ptr = get_value();
+                if (!ty || ptr->get_type() != m_->get_pointer_type(ty))
+                    throw std::string("bad load in LightIR binary");
+                instr = LoadInst::create_load(ty, ptr, bb);
+                break;
+            }
+            case Instruction::store:
+            {
+                auto val = get_value();
+                instr = StoreInst::create_store(val, get_value(), bb);
+                break;
+            }
+            case Instruction::cmp:
+            {
+                auto lhs = get_value();
+                instr = CmpInst::create_cmp(static_cast<CmpInst::CmpOp>(pred), lhs, get_value(), bb, m_);
+                break;
+            }
+            case Instruction::fcmp:
+            {
+                auto lhs = get_value();
+                instr = FCmpInst::create_fcmp(static_cast<FCmpInst::CmpOp>(pred), lhs, get_value(), bb, m_);
+                break;
+            }
+            case Instruction::phi:
+            {
+                if (!ty || num_ops % 2)
+                    throw std::string("bad phi in LightIR binary");
+                auto phi = PhiInst::create_phi(ty, bb);
+                bb->add_instruction(phi);
+                for (unsigned j = 0; j < num_ops; j += 2)
+                {
+                    auto val = get_value();
+                    phi->add_phi_pair_operand(val, get_block());
+                }
+                instr = phi;
+                break;
+            }
+            case Instruction::call:
+            {
+                auto callee = num_ops ? dynamic_cast<Function *>(get_value()) : nullptr;
+                if (!callee || callee->get_num_of_args() != num_ops - 1)
+                    throw std::string("bad call in LightIR binary");
+                std::vector<Value *> args(num_ops - 1);
+                for (auto &arg : args)
+                    arg = get_value();
+                instr = CallInst::create(callee, args, bb);
+                break;
+            }
+            case Instruction::getelementptr:
+            {
+                if (num_ops == 0)
+                    throw std::string("bad getelementptr in LightIR binary");
+                auto ptr = get_value();
+                std::vector<Value *> idxs(num_ops - 1);
+                for (auto &idx : idxs)
+                    idx = get_value();
+                instr = GetElementPtrInst::create_gep(ptr, idxs, bb);
+                break;
+            }
+            case Instruction::zext:
+            case Instruction::fptosi:
+            case Instruction::sitofp:
+            case Instruction::bitcast:
+            {
+                auto val = get_value();
+                if (!ty)
+                    throw std::string("bad cast in LightIR binary");
+                if (op == Instruction::zext)
+                    instr = ZextInst::create_zext(val, ty, bb);
+                else if (op == Instruction::fptosi)
+                    instr = FpToSiInst::create_fptosi(val, ty, bb);
+                else if (op == Instruction::sitofp)
+                    instr = SiToFpInst::create_sitofp(val, ty, bb);
+                else
+                    instr = BitCastInst::create_bitcast(val, ty, bb);
+                break;
+            }
+            case Instruction::insertelement:
+            {
+                auto vec = get_value();
+                auto val = get_value();
+                instr = InsertElementInst::create_insert_element(vec, val, get_value(), bb);
+                break;
+            }
+            case Instruction::extractelement:
+            {
+                auto vec = get_value();
+                instr = ExtractElementInst::create_extract_element(vec, get_value(), bb);
+                break;
+            }
+            default:
+            {
+                // the binary operators
+                auto lhs = get_value();
+                instr = BinaryInst::create(op, lhs, get_value(), bb);
+                break;
+            }
+            }
+            if (instr->is_void())
+                continue;
+            if (next == values_.size() || instr->get_type() != ty)
+                throw std::string("mismatched instruction type in LightIR binary");
+            auto &placeholder = placeholders_[next - first_instr_];
+            if (placeholder)
+            {
+                // like the removed instructions, the placeholder is not freed
+                placeholder->replace_all_use_with(instr);
+                placeholder = nullptr;
+            }
+            values_[next++] = instr;
+        }
+    }
+    if (next != values_.size())
+        throw std::string("missing instructions in LightIR binary");
+
+    // step 3: the edges of the cfg, which replace those added by the branches
+    for (auto bb : bbs)
+    {
+        for (auto edges : {&bb->get_pre_basic_blocks(), &bb->get_succ_basic_blocks()})
+        {
+            edges->clear();
+            auto num_edges = get();
+            for (unsigned i = 0; i < num_edges; i++)
+                edges->push_back(get_block());
+        }
+    }
+}
+
+std::unique_ptr<Module> Reader::read()
+{
+    // step 1: the header
+    if (end_ - pos_ < static_cast<long>(sizeof(MAGIC)) || std::memcmp(pos_, MAGIC, sizeof(MAGIC)))
+        throw std::string("not a LightIR binary");
+    pos_ += sizeof(MAGIC);
+    auto version = get();
+    if (version != VERSION)
+        throw "unsupported LightIR binary version " + std::to_string(version);
+    std::unique_ptr<Module> module(new Module(get_string()));
+    m_ = module.get();
+
+    // step 2: the types and the constants, each refers only to those before it
+    auto num_types = get();
+    for (unsigned i = 0; i < num_types; i++)
+        read_type();
+    first_instr_ = 0;
+    auto num_constants = get();
+    for (unsigned i = 0; i < num_constants; i++)
+        read_constant();
+
+    // step 3: the globals and the functions, then the bodies
+    auto num_globals = get();
+    for (unsigned i = 0; i < num_globals; i++)
+    {
+        auto name = get_string();
+        auto ty = get_type();
+        auto is_const = get_byte() != 0;
+        auto init = get();
+        Constant *init_val = nullptr;
+        if (init)
+        {
+            if (init > num_constants)
+                throw std::string("bad initializer in LightIR binary");
+            init_val = static_cast<Constant *>(values_[init - 1]);
+        }
+        values_.push_back(GlobalVariable::create(name, m_, ty, is_const, init_val));
+    }
+    auto num_functions = get();
+    std::vector<Function *> functions;
+    for (unsigned i = 0; i < num_functions; i++)
+    {
+        auto name = get_string();
+        auto ty = get_type();
+        if (!ty->is_function_type())
+            throw std::string("bad function type in LightIR binary");
+        functions.push_back(Function::create(static_cast<FunctionType *>(ty), name, m_));
+        values_.push_back(functions.back());
+    }
+    num_module_values_ = values_.size();
+    for (auto func : functions)
+        read_function(func);
+    if (pos_ != end_)
+        throw std::string("trailing data in LightIR binary");
+    return module;
+}
+
+} // namespace
+
+std::string write_binary(Module *m)
+{
+    return Writer().write(m);
+}
+
+std::unique_ptr<Module> read_binary(const char *data, size_t size)
+{
+    return Reader(data, size).read();
+}
+
+std::unique_ptr<Module> read_binary_file(const std::string &path)
+{
+    auto fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        throw "cannot open " + path;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return read_binary(nullptr, 0);
+    }
+    auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        throw "cannot map " + path;
+    std::unique_ptr<Module> module;
+    try
+    {
+        module = read_binary(static_cast<const char *>(data), st.st_size);
+    }
+    catch (...)
+    {
+        munmap(data, st.st_size);
+        throw;
+    }
+    munmap(data, st.st_size);
+    return module;
+}
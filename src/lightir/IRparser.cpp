@@ -0,0 +1,984 @@
+#include "IRparser.h"
+#include "Function.h"
+#include "BasicBlock.h"
+#include "Instruction.h"
+#include "Constant.h"
+#include "GlobalVariable.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+
+// the OpIDs of the names printed by Module::get_instr_op_name
+const std::unordered_map<std::string_view, Instruction::OpID> OPCODES = {
+    {"ret", Instruction::ret},
+    {"br", Instruction::br},
+    {"add", Instruction::add},
+    {"sub", Instruction::sub},
+    {"mul", Instruction::mul},
+    {"sdiv", Instruction::sdiv},
+    {"srem", Instruction::srem},
+    {"shl", Instruction::shl},
+    {"ashr", Instruction::ashr},
+    {"and", Instruction::and_},
+    {"or", Instruction::or_},
+    {"xor", Instruction::xor_},
+    {"fadd", Instruction::fadd},
+    {"fsub", Instruction::fsub},
+    {"fmul", Instruction::fmul},
+    {"fdiv", Instruction::fdiv},
+    {"alloca", Instruction::alloca},
+    {"load", Instruction::load},
+    {"store", Instruction::store},
+    {"icmp", Instruction::cmp},
+    {"fcmp", Instruction::fcmp},
+    {"phi", Instruction::phi},
+    {"call", Instruction::call},
+    {"getelementptr", Instruction::getelementptr},
+    {"zext", Instruction::zext},
+    {"fptosi", Instruction::fptosi},
+    {"sitofp", Instruction::sitofp},
+    {"bitcast", Instruction::bitcast},
+    {"insertelement", Instruction::insertelement},
+    {"extractelement", Instruction::extractelement}};
+
+// the predicates in the order of CmpOp, see print_cmp_type and print_fcmp_type
+const char *const CMP_PREDICATES[] = {"eq", "ne", "sgt", "sge", "slt", "sle"};
+const char *const FCMP_PREDICATES[] = {"ueq", "une", "ugt", "uge", "ult", "ule"};
+
+class Parser
+{
+public:
+    Parser(const char *data, size_t size) : begin_(data), pos_(data), end_(data + size) {}
+    std::unique_ptr<Module> parse();
+    // the bodies are read into the functions of m, and may use its globals and functions
+    void use_module(Module *m);
+    // the body of func in data, after use_module
+    void parse_function(Function *func, const char *data, size_t size);
+
+private:
+    // a function defined in the text, the names of its arguments and the start of its body
+    struct Body
+    {
+        Function *func;
+        std::vector<std::string_view> arg_names;
+        const char *pos;
+    };
+
+    void parse_global();
+    // the function of the header, which is created unless the header should be that of func
+    Function *parse_function_header(std::vector<std::string_view> &arg_names, Function *func = nullptr);
+    void parse_body(const Body &body);
+    void parse_instruction(BasicBlock *bb);
+    Type *parse_type();
+    // the operand of type ty, nullptr for undef
+    Value *parse_value(Type *ty);
+    // the operand after its type, which a binary operator or a compare prints only if it differs from ty
+    Value *parse_typed_value(Type *ty = nullptr);
+    Constant *parse_constant(Type *ty);
+    BasicBlock *parse_block();
+    BasicBlock *get_block(std::string_view name);
+    BasicBlock *define_block(std::string_view name);
+    void define_value(std::string_view name, Value *val);
+    void parse_preds(BasicBlock *bb);
+    void skip_align();
+
+    void skip_space();
+    // whether an operand follows, rather than its type
+    bool at_value();
+    bool consume(char c);
+    void expect(char c);
+    bool consume_keyword(const char *keyword);
+    void expect_keyword(const char *keyword);
+    std::string_view parse_name();
+    long long parse_int();
+    [[noreturn]] void error(const std::string &message);
+
+    const char *begin_;
+    const char *pos_;
+    const char *end_;
+    Module *m_;
+    std::unordered_map<std::string_view, Value *> globals_;
+    // the names of the globals of an existing module, which globals_ refers to
+    std::deque<std::string> global_names_;
+    // the function being parsed, its values, blocks and placeholders
+    Function *func_;
+    std::unordered_map<std::string_view, Value *> locals_;
+    std::unordered_map<std::string_view, BasicBlock *> blocks_;
+    std::unordered_map<std::string_view, Argument *> placeholders_;
+    // the blocks in the order of their labels, and the predecessors of their comments
+    std::vector<BasicBlock *> block_order_;
+    std::unordered_set<BasicBlock *> defined_blocks_;
+    std::vector<std::pair<BasicBlock *, std::vector<std::string_view>>> preds_;
+};
+
+bool is_name_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           c == '_' || c == '.' || c == '$' || c == '-';
+}
+
+void Parser::error(const std::string &message)
+{
+    auto line = std::count(begin_, pos_, '\n') + 1;
+    throw "line " + std::to_string(line) + ": " + message;
+}
+
+void Parser::skip_space()
+{
+    while (pos_ < end_)
+    {
+        if (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\n' || *pos_ == '\r')
+            pos_++;
+        else if (*pos_ == ';')
+        {
+            auto newline = static_cast<const char *>(std::memchr(pos_, '\n', end_ - pos_));
+            pos_ = newline ? newline : end_;
+        }
+        else
+            break;
+    }
+}
+
+bool Parser::at_value()
+{
+    skip_space();
+    if (pos_ == end_)
+        return false;
+    auto c = *pos_;
+    if (c == '%' || c == '@' || c == '-' || (c >= '0' && c <= '9'))
+        return true;
+    auto pos = pos_;
+    bool is_keyword = consume_keyword("true") || consume_keyword("false") || consume_keyword("zeroinitializer") ||
+                      consume_keyword("undef");
+    pos_ = pos;
+    return is_keyword;
+}
+
+bool Parser::consume(char c)
+{
+    skip_space();
+    if (pos_ < end_ && *pos_ == c)
+    {
+        pos_++;
+        return true;
+    }
+    return false;
+}
+
+void Parser::expect(char c)
+{
+    if (!consume(c))
+        error(std::string("expected '") + c + "'");
+}
+
+bool Parser::consume_keyword(const char *keyword)
+{
+    skip_space();
+    auto length = std::strlen(keyword);
+    if (static_cast<size_t>(end_ - pos_) < length || std::memcmp(pos_, keyword, length) ||
+        (pos_ + length < end_ && is_name_char(pos_[length])))
+        return false;
+    pos_ += length;
+    return true;
+}
+
+void Parser::expect_keyword(const char *keyword)
+{
+    if (!consume_keyword(keyword))
+        error(std::string("expected '") + keyword + "'");
+}
+
+std::string_view Parser::parse_name()
+{
+    skip_space();
+    auto start = pos_;
+    while (pos_ < end_ && is_name_char(*pos_))
+        pos_++;
+    if (pos_ == start)
+        error("expected a name");
+    return std::string_view(start, pos_ - start);
+}
+
+long long Parser::parse_int()
+{
+    skip_space();
+    bool negative = pos_ < end_ && *pos_ == '-';
+    if (negative)
+        pos_++;
+    if (pos_ == end_ || *pos_ < '0' || *pos_ > '9')
+        error("expected an integer");
+    long long val = 0;
+    while (pos_ < end_ && *pos_ >= '0' && *pos_ <= '9')
+    {
+        val = val * 10 + (*pos_++ - '0');
+        if (val > (1ll << 32))
+            error("integer out of range");
+    }
+    return negative ? -val : val;
+}
+
+Type *Parser::parse_type()
+{
+    Type *ty = nullptr;
+    if (consume('['))
+    {
+        auto num_elements = parse_int();
+        expect_keyword("x");
+        auto contained = parse_type();
+        expect(']');
+        if (num_elements < 0 || !ArrayType::is_valid_element_type(contained))
+            error("bad array type");
+        ty = m_->get_array_type(contained, num_elements);
+    }
+    else if (consume('<'))
+    {
+        auto num_elements = parse_int();
+        expect_keyword("x");
+        auto contained = parse_type();
+        expect('>');
+        if (num_elements <= 0 || !VectorType::is_valid_element_type(contained))
+            error("bad vector type");
+        ty = m_->get_vector_type(contained, num_elements);
+    }
+    else if (consume_keyword("i32"))
+        ty = m_->get_int32_type();
+    else if (consume_keyword("i1"))
+        ty = m_->get_int1_type();
+    else if (consume_keyword("float"))
+        ty = m_->get_float_type();
+    else if (consume_keyword("void"))
+        ty = m_->get_void_type();
+    else if (consume_keyword("label"))
+        ty = m_->get_label_type();
+    else
+        error("expected a type");
+    while (pos_ < end_ && *pos_ == '*')
+    {
+        pos_++;
+        ty = m_->get_pointer_type(ty);
+    }
+    return ty;
+}
+
+Constant *Parser::parse_constant(Type *ty)
+{
+    skip_space();
+    if (consume_keyword("zeroinitializer"))
+        return ConstantZero::get(ty, m_);
+    if (ty == m_->get_int1_type())
+    {
+        if (consume_keyword("true"))
+            return ConstantInt::get(true, m_);
+        if (consume_keyword("false"))
+            return ConstantInt::get(false, m_);
+        return ConstantInt::get(parse_int() != 0, m_);
+    }
+    if (ty == m_->get_int32_type())
+    {
+        auto val = parse_int();
+        if (val < -(1ll << 31) || val >= (1ll << 32))
+            error("integer out of range");
+        return ConstantInt::get(static_cast<int>(val), m_);
+    }
+    if (ty == m_->get_float_type())
+    {
+        // the printer writes the bits of the double, as LLVM does
+        auto start = pos_;
+        while (pos_ < end_ && (is_name_char(*pos_) || *pos_ == '+'))
+            pos_++;
+        std::string literal(start, pos_);
+        char *literal_end = nullptr;
+        double val = 0;
+        if (literal.size() == 18 && literal[0] == '0' && literal[1] == 'x')
+        {
+            auto bits = std::strtoull(literal.c_str() + 2, &literal_end, 16);
+            std::memcpy(&val, &bits, sizeof(val));
+        }
+        else
+            val = std::strtod(literal.c_str(), &literal_end);
+        if (literal.empty() || literal_end != literal.c_str() + literal.size())
+        {
+            pos_ = start;
+            error("expected a float");
+        }
+        return ConstantFP::get(static_cast<float>(val), m_);
+    }
+    if (ty->is_array_type() && consume('['))
+    {
+        std::vector<Constant *> elements;
+        do
+        {
+            if (parse_type() != ty->get_array_element_type())
+                error("mismatched type of an array element");
+            elements.push_back(parse_constant(ty->get_array_element_type()));
+        } while (consume(','));
+        expect(']');
+        if (elements.size() != static_cast<ArrayType *>(ty)->get_num_of_elements())
+            error("wrong number of array elements");
+        return ConstantArray::get(static_cast<ArrayType *>(ty), elements);
+    }
+    error("expected a constant of type " + ty->print());
+}
+
+Value *Parser::parse_value(Type *ty)
+{
+    skip_space();
+    Value *val = nullptr;
+    if (consume('%'))
+    {
+        auto name = parse_name();
+        auto it = locals_.find(name);
+        if (it == locals_.end())
+        {
+            // a forward reference, replaced by the value when it is defined
+            auto placeholder = new Argument(ty);
+            placeholders_[name] = placeholder;
+            locals_[name] = placeholder;
+            return placeholder;
+        }
+        val = it->second;
+    }
+    else if (consume('@'))
+    {
+        auto name = parse_name();
+        auto it = globals_.find(name);
+        if (it == globals_.end())
+            error("undefined global @" + std::string(name));
+        val = it->second;
+    }
+    else if (consume_keyword("undef"))
+        return nullptr;
+    else
+        return parse_constant(ty);
+    if (val->get_type() != ty)
+        error("mismatched type of operand, expected " + ty->print());
+    return val;
+}
+
+Value *Parser::parse_typed_value(Type *ty)
+{
+    if (!ty || !at_value())
+        ty = parse_type();
+    auto val = parse_value(ty);
+    if (!val)
+        error("undef is only supported in a phi");
+    return val;
+}
+
+BasicBlock *Parser::get_block(std::string_view name)
+{
+    auto it = blocks_.find(name);
+    if (it != blocks_.end())
+        return it->second;
+    // a block used before its label, which is put in its place when the label is read
+    auto bb = BasicBlock::create(m_, "", func_);
+    blocks_[name] = bb;
+    return bb;
+}
+
+BasicBlock *Parser::parse_block()
+{
+    expect('%');
+    return get_block(parse_name());
+}
+
+BasicBlock *Parser::define_block(std::string_view name)
+{
+    auto bb = get_block(name);
+    if (!defined_blocks_.insert(bb).second)
+        error("redefinition of label " + std::string(name));
+    // a name numbered by the printer is numbered again, so it cannot collide with a new block
+    bool numbered = name.size() > 5 && name.substr(0, 5) == "label" &&
+                    std::all_of(name.begin() + 5, name.end(), [](char c) { return c >= '0' && c <= '9'; });
+    if (!numbered)
+        bb->set_name(std::string(name));
+    block_order_.push_back(bb);
+    return bb;
+}
+
+void Parser::define_value(std::string_view name, Value *val)
+{
+    auto it = placeholders_.find(name);
+    if (it != placeholders_.end())
+    {
+        if (it->second->get_type() != val->get_type())
+            error("%" + std::string(name) + " is used as " + it->second->get_type()->print() +
+                  " but defined as " + val->get_type()->print());
+        // like the removed instructions, the placeholder is not freed
+        it->second->replace_all_use_with(val);
+        placeholders_.erase(it);
+    }
+    else if (locals_.count(name))
+        error("redefinition of %" + std::string(name));
+    locals_[name] = val;
+}
+
+void Parser::parse_preds(BasicBlock *bb)
+{
+    // the comment printed after the label, on its line
+    const char PREDS[] = "; preds = ";
+    auto length = sizeof(PREDS) - 1;
+    while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\t'))
+        pos_++;
+    if (static_cast<size_t>(end_ - pos_) < length || std::memcmp(pos_, PREDS, length))
+        return;
+    pos_ += length;
+    std::vector<std::string_view> names;
+    while (pos_ < end_ && *pos_ == '%')
+    {
+        auto start = ++pos_;
+        while (pos_ < end_ && is_name_char(*pos_))
+            pos_++;
+        names.emplace_back(start, pos_ - start);
+        if (end_ - pos_ >= 2 && pos_[0] == ',' && pos_[1] == ' ')
+            pos_ += 2;
+    }
+    preds_.emplace_back(bb, std::move(names));
+}
+
+void Parser::skip_align()
+{
+    auto pos = pos_;
+    if (consume(',') && consume_keyword("align"))
+        parse_int();
+    else
+        pos_ = pos;
+}
+
+void Parser::parse_instruction(BasicBlock *bb)
+{
+    std::string_view result;
+    if (consume('%'))
+    {
+        result = parse_name();
+        expect('=');
+    }
+    auto op_name = parse_name();
+    auto op = OPCODES.find(op_name);
+    if (op == OPCODES.end())
+        error("unknown instruction " + std::string(op_name));
+    Instruction *instr = nullptr;
+    switch (op->second)
+    {
+    case Instruction::ret:
+        if (consume_keyword("void"))
+            instr = ReturnInst::create_void_ret(bb);
+        else
+            instr = ReturnInst::create_ret(parse_typed_value(), bb);
+        break;
+    case Instruction::br:
+        if (consume_keyword("label"))
+            instr = BranchInst::create_br(parse_block(), bb);
+        else
+        {
+            auto cond = parse_typed_value();
+            if (cond->get_type() != m_->get_int1_type())
+                error("the condition of br is not i1");
+            expect(',');
+            expect_keyword("label");
+            auto if_true = parse_block();
+            expect(',');
+            expect_keyword("label");
+            instr = BranchInst::create_cond_br(cond, if_true, parse_block(), bb);
+        }
+        break;
+    case Instruction::alloca:
+        instr = AllocaInst::create_alloca(parse_type(), bb);
+        skip_align();
+        break;
+    case Instruction::load:
+    {
+        auto ty = parse_type();
+        expect(',');
+        auto ptr = parse_typed_value();
+        if (ptr->get_type() != m_->get_pointer_type(ty))
+            error("the pointer of load is not " + ty->print() + "*");
+        instr = LoadInst::create_load(ty, ptr, bb);
+        skip_align();
+        break;
+    }
+    case Instruction::store:
+    {
+        auto val = parse_typed_value();
+        expect(',');
+        auto ptr = parse_typed_value();
+        if (ptr->get_type() != m_->get_pointer_type(val->get_type()))
+            error("the pointer of store is not " + val->get_type()->print() + "*");
+        instr = StoreInst::create_store(val, ptr, bb);
+        skip_align();
+        break;
+    }
+    case Instruction::cmp:
+    case Instruction::fcmp:
+    {
+        auto predicates = op->second == Instruction::cmp ? CMP_PREDICATES : FCMP_PREDICATES;
+        auto pred = parse_name();
+        int cmp_op = 0;
+        while (cmp_op <= CmpInst::LE && pred != predicates[cmp_op])
+            cmp_op++;
+        if (cmp_op > CmpInst::LE)
+            error("unknown predicate " + std::string(pred));
+        auto ty = parse_type();
+        auto lhs = parse_value(ty);
+        expect(',');
+        auto rhs = parse_typed_value(ty);
+        if (!lhs || lhs->get_type() != rhs->get_type())
+            error("mismatched operands of " + std::string(op_name));
+        if (op->second == Instruction::cmp)
+            instr = CmpInst::create_cmp(static_cast<CmpInst::CmpOp>(cmp_op), lhs, rhs, bb, m_);
+        else
+            instr = FCmpInst::create_fcmp(static_cast<FCmpInst::CmpOp>(cmp_op), lhs, rhs, bb, m_);
+        break;
+    }
+    case Instruction::phi:
+    {
+        auto phi = PhiInst::create_phi(parse_type(), bb);
+        bb->add_instruction(phi);
+        do
+        {
+            expect('[');
+            auto val = parse_value(phi->get_type());
+            expect(',');
+            auto pre_bb = parse_block();
+            expect(']');
+            if (val)
+                phi->add_phi_pair_operand(val, pre_bb);
+        } while (consume(','));
+        instr = phi;
+        break;
+    }
+    case Instruction::call:
+    {
+        auto ty = parse_type();
+        expect('@');
+        auto name = parse_name();
+        auto it = globals_.find(name);
+        auto callee = it == globals_.end() ? nullptr : dynamic_cast<Function *>(it->second);
+        if (!callee || callee->get_return_type() != ty)
+            error("bad callee @" + std::string(name));
+        expect('(');
+        std::vector<Value *> args;
+        if (!consume(')'))
+        {
+            do
+            {
+                args.push_back(parse_typed_value());
+            } while (consume(','));
+            expect(')');
+        }
+        if (args.size() != callee->get_num_of_args())
+            error("wrong number of arguments to @" + std::string(name));
+        for (unsigned i = 0; i < args.size(); i++)
+        {
+            if (args[i]->get_type() != callee->get_function_type()->get_param_type(i))
+                error("mismatched argument to @" + std::string(name));
+        }
+        instr = CallInst::create(callee, args, bb);
+        break;
+    }
+    case Instruction::getelementptr:
+    {
+        parse_type();
+        expect(',');
+        auto ptr = parse_typed_value();
+        if (!ptr->get_type()->is_pointer_type())
+            error("the pointer of getelementptr is not a pointer");
+        std::vector<Value *> idxs;
+        while (consume(','))
+            idxs.push_back(parse_typed_value());
+        instr = GetElementPtrInst::create_gep(ptr, idxs, bb);
+        break;
+    }
+    case Instruction::zext:
+    case Instruction::fptosi:
+    case Instruction::sitofp:
+    case Instruction::bitcast:
+    {
+        auto val = parse_typed_value();
+        expect_keyword("to");
+        auto ty = parse_type();
+        if (op->second == Instruction::zext)
+            instr = ZextInst::create_zext(val, ty, bb);
+        else if (op->second == Instruction::fptosi)
+            instr = FpToSiInst::create_fptosi(val, ty, bb);
+        else if (op->second == Instruction::sitofp)
+            instr = SiToFpInst::create_sitofp(val, ty, bb);
+        else
+            instr = BitCastInst::create_bitcast(val, ty, bb);
+        break;
+    }
+    case Instruction::insertelement:
+    {
+        auto vec = parse_typed_value();
+        expect(',');
+        auto val = parse_typed_value();
+        expect(',');
+        auto idx = parse_typed_value();
+        if (vec->get_type()->get_vector_element_type() != val->get_type())
+            error("mismatched operands of insertelement");
+        instr = InsertElementInst::create_insert_element(vec, val, idx, bb);
+        break;
+    }
+    case Instruction::extractelement:
+    {
+        auto vec = parse_typed_value();
+        expect(',');
+        auto idx = parse_typed_value();
+        if (!vec->get_type()->is_vector_type())
+            error("the operand of extractelement is not a vector");
+        instr = ExtractElementInst::create_extract_element(vec, idx, bb);
+        break;
+    }
+    default:
+    {
+        // the binary operators
+        auto ty = parse_type();
+        auto lhs = parse_value(ty);
+        expect(',');
+        auto rhs = parse_typed_value(ty);
+        if (!lhs || lhs->get_type() != rhs->get_type())
+            error("mismatched operands of " + std::string(op_name));
+        instr = BinaryInst::create(op->second, lhs, rhs, bb);
+        break;
+    }
+    }
+    if (!result.empty())
+    {
+        if (instr->is_void())
+            error("%" + std::string(result) + " is assigned a void instruction");
+        define_value(result, instr);
+    }
+}
+
+void Parser::parse_body(const Body &body)
+{
+    // step 1: the arguments are the first values
+    pos_ = body.pos;
+    func_ = body.func;
+    locals_.clear();
+    blocks_.clear();
+    placeholders_.clear();
+    block_order_.clear();
+    defined_blocks_.clear();
+    preds_.clear();
+    auto arg = func_->arg_begin();
+    for (auto name : body.arg_names)
+    {
+        if (!name.empty())
+            define_value(name, *arg);
+        arg++;
+    }
+
+    // step 2: the blocks, a label is a name followed by ':', and the entry block may have none
+    while (!consume('}'))
+    {
+        if (pos_ == end_)
+            error("expected '}'");
+        auto pos = pos_;
+        if (*pos_ != '%')
+        {
+            auto name = parse_name();
+            if (pos_ < end_ && *pos_ == ':')
+            {
+                pos_++;
+                parse_preds(define_block(name));
+                continue;
+            }
+            pos_ = pos;
+        }
+        if (block_order_.empty())
+        {
+            block_order_.push_back(BasicBlock::create(m_, "", func_));
+            defined_blocks_.insert(block_order_.back());
+        }
+        parse_instruction(block_order_.back());
+    }
+
+    // step 3: check the forward references, then put the blocks in the order of their labels
+    if (!placeholders_.empty())
+        error("use of undefined value %" + std::string(placeholders_.begin()->first));
+    for (auto &entry : blocks_)
+    {
+        if (!defined_blocks_.count(entry.second))
+            error("use of undefined label %" + std::string(entry.first));
+    }
+    func_->get_basic_blocks().assign(block_order_.begin(), block_order_.end());
+
+    // step 4: the order of the predecessors printed in the comments, if they are the same blocks
+    for (auto &entry : preds_)
+    {
+        auto &pre_bbs = entry.first->get_pre_basic_blocks();
+        std::vector<BasicBlock *> order;
+        for (auto name : entry.second)
+        {
+            auto it = blocks_.find(name);
+            if (it == blocks_.end())
+                break;
+            order.push_back(it->second);
+        }
+        if (order.size() == pre_bbs.size() && std::is_permutation(order.begin(), order.end(), pre_bbs.begin()))
+            pre_bbs.assign(order.begin(), order.end());
+    }
+}
+
+void Parser::parse_global()
+{
+    expect('@');
+    auto name = parse_name();
+    expect('=');
+    bool is_const = consume_keyword("constant");
+    if (!is_const)
+        expect_keyword("global");
+    auto ty = parse_type();
+    auto init = parse_constant(ty);
+    skip_align();
+    if (globals_.count(name))
+        error("redefinition of @" + std::string(name));
+    globals_[name] = GlobalVariable::create(std::string(name), m_, ty, is_const, init);
+}
+
+Function *Parser::parse_function_header(std::vector<std::string_view> &arg_names, Function *func)
+{
+    auto ret_ty = parse_type();
+    expect('@');
+    auto name = parse_name();
+    expect('(');
+    std::vector<Type *> params;
+    if (!consume(')'))
+    {
+        do
+        {
+            params.push_back(parse_type());
+            if (!FunctionType::is_valid_argument_type(params.back()))
+                error("bad argument type " + params.back()->print());
+            arg_names.emplace_back();
+            if (consume('%'))
+                arg_names.back() = parse_name();
+        } while (consume(','));
+        expect(')');
+    }
+    if (!FunctionType::is_valid_return_type(ret_ty))
+        error("bad return type " + ret_ty->print());
+    if (func)
+    {
+        // the function types are not unique, so they are compared by their parts
+        bool same = name == func->get_name() && ret_ty == func->get_return_type() &&
+                    params.size() == func->get_num_of_args();
+        for (unsigned i = 0; same && i < params.size(); i++)
+            same = params[i] == func->get_function_type()->get_param_type(i);
+        if (!same)
+            error("the header is not that of @" + func->get_name());
+        return func;
+    }
+    if (globals_.count(name))
+        error("redefinition of @" + std::string(name));
+    globals_[name] = Function::create(FunctionType::get(ret_ty, params), std::string(name), m_);
+    return static_cast<Function *>(globals_[name]);
+}
+
+std::unique_ptr<Module> Parser::parse()
+{
+    // step 1: the module is named by the comment printed by cminusfc, if any
+    const char MODULE_ID[] = "; ModuleID = '";
+    std::string module_name;
+    if (static_cast<size_t>(end_ - pos_) > sizeof(MODULE_ID) && !std::memcmp(pos_, MODULE_ID, sizeof(MODULE_ID) - 1))
+    {
+        auto start = pos_ + sizeof(MODULE_ID) - 1;
+        auto quote = static_cast<const char *>(std::memchr(start, '\'', end_ - start));
+        if (quote)
+            module_name.assign(start, quote);
+    }
+    std::unique_ptr<Module> module(new Module(module_name));
+    m_ = module.get();
+
+    // step 2: the globals and the headers of the functions, skipping the bodies
+    std::vector<Body> bodies;
+    while (true)
+    {
+        skip_space();
+        if (pos_ == end_)
+            break;
+        if (*pos_ == '@')
+            parse_global();
+        else if (consume_keyword("declare"))
+        {
+            std::vector<std::string_view> arg_names;
+            parse_function_header(arg_names);
+        }
+        else if (consume_keyword("define"))
+        {
+            Body body;
+            body.func = parse_function_header(body.arg_names);
+            expect('{');
+            body.pos = pos_;
+            bodies.push_back(body);
+            // the body ends at the first line starting with '}'
+            while (pos_ < end_ && *pos_ != '}')
+            {
+                auto newline = static_cast<const char *>(std::memchr(pos_, '\n', end_ - pos_));
+                pos_ = newline ? newline + 1 : end_;
+            }
+            expect('}');
+        }
+        else if (consume_keyword("source_filename") || consume_keyword("target"))
+        {
+            auto newline = static_cast<const char *>(std::memchr(pos_, '\n', end_ - pos_));
+            pos_ = newline ? newline : end_;
+        }
+        else
+            error("expected a global or a function");
+    }
+
+    // step 3: the bodies, which may call any function
+    for (auto &body : bodies)
+        parse_body(body);
+    return module;
+}
+
+void Parser::use_module(Module *m)
+{
+    m_ = m;
+    for (auto global : m_->get_global_variable())
+    {
+        global_names_.push_back(global->get_name());
+        globals_[global_names_.back()] = global;
+    }
+    for (auto f : m_->get_functions())
+    {
+        global_names_.push_back(f->get_name());
+        globals_[global_names_.back()] = f;
+    }
+}
+
+void Parser::parse_function(Function *func, const char *data, size_t size)
+{
+    begin_ = pos_ = data;
+    end_ = data + size;
+    skip_space();
+    expect_keyword("define");
+    Body body;
+    body.func = parse_function_header(body.arg_names, func);
+    expect('{');
+    body.pos = pos_;
+    parse_body(body);
+    skip_space();
+    if (pos_ != end_)
+        error("expected the end of the function");
+}
+
+} // namespace
+
+std::unique_ptr<Module> parse_ir(const char *data, size_t size)
+{
+    return Parser(data, size).parse();
+}
+
+std::vector<Function *> parse_function_bodies(Module *m, const std::vector<std::pair<Function *, std::string>> &texts)
+{
+    Parser parser(nullptr, 0);
+    parser.use_module(m);
+    std::vector<Function *> malformed;
+    // the blocks of the old bodies, and the values they use which outlive them
+    std::unordered_set<BasicBlock *> old_set;
+    std::unordered_set<Value *> old_operands;
+    for (auto &text : texts)
+    {
+        // step 1: parse the new blocks after the old ones, which are put back if the text is malformed
+        auto func = text.first;
+        std::list<BasicBlock *> old_blocks = func->get_basic_blocks();
+        try
+        {
+            parser.parse_function(func, text.second.data(), text.second.size());
+        }
+        catch (...)
+        {
+            std::unordered_set<BasicBlock *> old_set(old_blocks.begin(), old_blocks.end());
+            for (auto bb : func->get_basic_blocks())
+            {
+                if (old_set.count(bb))
+                    continue;
+                for (auto instr : bb->get_instructions())
+                    instr->remove_use_of_ops();
+            }
+            func->get_basic_blocks() = old_blocks;
+            malformed.push_back(func);
+            continue;
+        }
+
+        for (auto bb : old_blocks)
+        {
+            old_set.insert(bb);
+            for (auto instr : bb->get_instructions())
+            {
+                for (auto op : instr->get_operands())
+                {
+                    // the constants are not shared, they go away with the instructions
+                    if (dynamic_cast<GlobalVariable *>(op) || dynamic_cast<Function *>(op) || dynamic_cast<Argument *>(op))
+                        old_operands.insert(op);
+                }
+            }
+        }
+    }
+
+    // step 2: the old instructions no longer use their operands, each use list is walked once,
+    // since a global may be used by every function
+    for (auto op : old_operands)
+    {
+        op->get_use_list().remove_if([&old_set](const Use &use) {
+            auto instr = dynamic_cast<Instruction *>(use.val_);
+            return instr && old_set.count(instr->get_parent());
+        });
+    }
+    return malformed;
+}
+
+std::unique_ptr<Module> parse_ir_file(const std::string &path)
+{
+    auto fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        if (fd >= 0)
+            close(fd);
+        throw "cannot open " + path;
+    }
+    if (st.st_size == 0)
+    {
+        close(fd);
+        return parse_ir(nullptr, 0);
+    }
+    auto data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        throw "cannot map " + path;
+    std::unique_ptr<Module> module;
+    try
+    {
+        module = parse_ir(static_cast<const char *>(data), st.st_size);
+    }
+    catch (const std::string &e)
+    {
+        // e.g. "a.ll: line 2: unknown instruction foo"
+        munmap(data, st.st_size);
+        throw path + ": " + e;
+    }
+    catch (...)
+    {
+        munmap(data, st.st_size);
+        throw;
+    }
+    munmap(data, st.st_size);
+    return module;
+}
@@ -68,6 +68,36 @@ BinaryInst *BinaryInst::create_sdiv(Value *v1, Value *v2, BasicBlock *bb, Module
     return new BinaryInst(Type::get_int32_type(m), Instruction::sdiv, v1, v2, bb);
 }
 
+BinaryInst *BinaryInst::create_srem(Value *v1, Value *v2, BasicBlock *bb, Module *m)
+{
+    return new BinaryInst(Type::get_int32_type(m), Instruction::srem, v1, v2, bb);
+}
+
+BinaryInst *BinaryInst::create_shl(Value *v1, Value *v2, BasicBlock *bb, Module *m)
+{
+    return new BinaryInst(Type::get_int32_type(m), Instruction::shl, v1, v2, bb);
+}
+
+BinaryInst *BinaryInst::create_ashr(Value *v1, Value *v2, BasicBlock *bb, Module *m)
+{
+    return new BinaryInst(Type::get_int32_type(m), Instruction::ashr, v1, v2, bb);
+}
+
+BinaryInst *BinaryInst::create_and(Value *v1, Value *v2, BasicBlock *bb, Module *m)
+{
+    return new BinaryInst(Type::get_int32_type(m), Instruction::and_, v1, v2, bb);
+}
+
+BinaryInst *BinaryInst::create_or(Value *v1, Value *v2, BasicBlock *bb, Module *m)
+{
+    return new BinaryInst(Type::get_int32_type(m), Instruction::or_, v1, v2, bb);
+}
+
+BinaryInst *BinaryInst::create_xor(Value *v1, Value *v2, BasicBlock *bb, Module *m)
+{
+    return new BinaryInst(Type::get_int32_type(m), Instruction::xor_, v1, v2, bb);
+}
+
 BinaryInst *BinaryInst::create_fadd(Value *v1, Value *v2, BasicBlock *bb, Module *m)
 {
     return new BinaryInst(Type::get_float_type(m), Instruction::fadd, v1, v2, bb);
@@ -88,6 +118,16 @@ BinaryInst *BinaryInst::create_fdiv(Value *v1, Value *v2, BasicBlock *bb, Module
     return new BinaryInst(Type::get_float_type(m), Instruction::fdiv, v1, v2, bb);
 }
 
+BinaryInst *BinaryInst::create(OpID id, Value *v1, Value *v2, BasicBlock *bb)
+{
+    return new BinaryInst(v1->get_type(), id, v1, v2, bb);
+}
+
+Instruction *BinaryInst::copy_inst(BasicBlock *bb)
+{
+    return new BinaryInst(get_type(), get_instr_type(), get_operand(0), get_operand(1), bb);
+}
+
 std::string BinaryInst::print()
 {
     std::string instr_ir;
@@ -134,6 +174,11 @@ CmpInst *CmpInst::create_cmp(CmpOp op, Value *lhs, Value *rhs,
     return new CmpInst(m->get_int1_type(), op, lhs, rhs, bb);
 }
 
+Instruction *CmpInst::copy_inst(BasicBlock *bb)
+{
+    return new CmpInst(get_type(), cmp_op_, get_operand(0), get_operand(1), bb);
+}
+
 std::string CmpInst::print()
 {
     std::string instr_ir;
@@ -180,6 +225,11 @@ FCmpInst *FCmpInst::create_fcmp(CmpOp op, Value *lhs, Value *rhs,
     return new FCmpInst(m->get_int1_type(), op, lhs, rhs, bb);
 }
 
+Instruction *FCmpInst::copy_inst(BasicBlock *bb)
+{
+    return new FCmpInst(get_type(), cmp_op_, get_operand(0), get_operand(1), bb);
+}
+
 std::string FCmpInst::print()
 {
     std::string instr_ir;
@@ -226,6 +276,12 @@ FunctionType *CallInst::get_function_type() const
     return static_cast<FunctionType *>(get_operand(0)->get_type());
 }
 
+Instruction *CallInst::copy_inst(BasicBlock *bb)
+{
+    std::vector<Value *> args(get_operands().begin() + 1, get_operands().end());
+    return new CallInst(static_cast<Function *>(get_operand(0)), args, bb);
+}
+
 std::string CallInst::print()
 {
     std::string instr_ir;
@@ -294,6 +350,14 @@ bool BranchInst::is_cond_br() const
     return get_num_operand() == 3;
 }
 
+Instruction *BranchInst::copy_inst(BasicBlock *bb)
+{
+    if (is_cond_br())
+        return new BranchInst(get_operand(0), static_cast<BasicBlock *>(get_operand(1)),
+                              static_cast<BasicBlock *>(get_operand(2)), bb);
+    return new BranchInst(static_cast<BasicBlock *>(get_operand(0)), bb);
+}
+
 std::string BranchInst::print()
 {
     std::string instr_ir;
@@ -338,6 +402,13 @@ bool ReturnInst::is_void_ret() const
     return get_num_operand() == 0;
 }
 
+Instruction *ReturnInst::copy_inst(BasicBlock *bb)
+{
+    if (is_void_ret())
+        return new ReturnInst(bb);
+    return new ReturnInst(get_operand(0), bb);
+}
+
 std::string ReturnInst::print()
 {
     std::string instr_ir;
@@ -399,6 +470,12 @@ GetElementPtrInst *GetElementPtrInst::create_gep(Value *ptr, std::vector<Value *
     return new GetElementPtrInst(ptr, idxs, bb);
 }
 
+Instruction *GetElementPtrInst::copy_inst(BasicBlock *bb)
+{
+    std::vector<Value *> idxs(get_operands().begin() + 1, get_operands().end());
+    return new GetElementPtrInst(get_operand(0), idxs, bb);
+}
+
 std::string GetElementPtrInst::print()
 {
     std::string instr_ir;
@@ -433,6 +510,11 @@ StoreInst *StoreInst::create_store(Value *val, Value *ptr, BasicBlock *bb)
     return new StoreInst(val, ptr, bb);
 }
 
+Instruction *StoreInst::copy_inst(BasicBlock *bb)
+{
+    return new StoreInst(get_rval(), get_lval(), bb);
+}
+
 std::string StoreInst::print()
 {
     std::string instr_ir;
@@ -443,6 +525,12 @@ std::string StoreInst::print()
     instr_ir += print_as_op(this->get_operand(0), false);
     instr_ir += ", ";
     instr_ir += print_as_op(this->get_operand(1), true);
+    // a vector is only aligned as its elements, e.g. the elements a[i] to a[i+3]
+    if (this->get_operand(0)->get_type()->is_vector_type())
+    {
+        instr_ir += ", align ";
+        instr_ir += std::to_string(this->get_operand(0)->get_type()->get_vector_element_type()->get_size());
+    }
     return instr_ir;
 }
 
@@ -464,6 +552,11 @@ Type *LoadInst::get_load_type() const
     return static_cast<PointerType *>(get_operand(0)->get_type())->get_element_type();
 }
 
+Instruction *LoadInst::copy_inst(BasicBlock *bb)
+{
+    return new LoadInst(get_type(), get_lval(), bb);
+}
+
 std::string LoadInst::print()
 {
     std::string instr_ir;
@@ -477,6 +570,11 @@ std::string LoadInst::print()
     instr_ir += ",";
     instr_ir += " ";
     instr_ir += print_as_op(this->get_operand(0), true);
+    if (this->get_type()->is_vector_type())
+    {
+        instr_ir += ", align ";
+        instr_ir += std::to_string(this->get_type()->get_vector_element_type()->get_size());
+    }
     return instr_ir;
 }
 
@@ -496,6 +594,11 @@ Type *AllocaInst::get_alloca_type() const
     return alloca_ty_;
 }
 
+Instruction *AllocaInst::copy_inst(BasicBlock *bb)
+{
+    return new AllocaInst(alloca_ty_, bb);
+}
+
 std::string AllocaInst::print()
 {
     std::string instr_ir;
@@ -524,6 +627,11 @@ Type *ZextInst::get_dest_type() const
     return dest_ty_;
 }
 
+Instruction *ZextInst::copy_inst(BasicBlock *bb)
+{
+    return new ZextInst(get_instr_type(), get_operand(0), dest_ty_, bb);
+}
+
 std::string ZextInst::print()
 {
     std::string instr_ir;
@@ -556,6 +664,11 @@ Type *FpToSiInst::get_dest_type() const
     return dest_ty_;
 }
 
+Instruction *FpToSiInst::copy_inst(BasicBlock *bb)
+{
+    return new FpToSiInst(get_instr_type(), get_operand(0), dest_ty_, bb);
+}
+
 std::string FpToSiInst::print()
 {
     std::string instr_ir;
@@ -588,6 +701,11 @@ Type *SiToFpInst::get_dest_type() const
     return dest_ty_;
 }
 
+Instruction *SiToFpInst::copy_inst(BasicBlock *bb)
+{
+    return new SiToFpInst(get_instr_type(), get_operand(0), dest_ty_, bb);
+}
+
 std::string SiToFpInst::print()
 {
     std::string instr_ir;
@@ -604,8 +722,111 @@ std::string SiToFpInst::print()
     return instr_ir; 
 }
 
+BitCastInst::BitCastInst(OpID op, Value *val, Type *ty, BasicBlock *bb)
+    : Instruction(ty, op, 1, bb), dest_ty_(ty)
+{
+    set_operand(0, val);
+}
+
+BitCastInst *BitCastInst::create_bitcast(Value *val, Type *ty, BasicBlock *bb)
+{
+    return new BitCastInst(Instruction::bitcast, val, ty, bb);
+}
+
+Type *BitCastInst::get_dest_type() const
+{
+    return dest_ty_;
+}
+
+Instruction *BitCastInst::copy_inst(BasicBlock *bb)
+{
+    return new BitCastInst(get_instr_type(), get_operand(0), dest_ty_, bb);
+}
+
+std::string BitCastInst::print()
+{
+    std::string instr_ir;
+    instr_ir += "%";
+    instr_ir += this->get_name();
+    instr_ir += " = ";
+    instr_ir += this->get_module()->get_instr_op_name( this->get_instr_type() );
+    instr_ir += " ";
+    instr_ir += this->get_operand(0)->get_type()->print();
+    instr_ir += " ";
+    instr_ir += print_as_op(this->get_operand(0), false);
+    instr_ir += " to ";
+    instr_ir += this->get_dest_type()->print();
+    return instr_ir; 
+}
+
+InsertElementInst::InsertElementInst(Value *vec, Value *val, Value *idx, BasicBlock *bb)
+    : Instruction(vec->get_type(), Instruction::insertelement, 3, bb)
+{
+    assert(vec->get_type()->get_vector_element_type() == val->get_type());
+    set_operand(0, vec);
+    set_operand(1, val);
+    set_operand(2, idx);
+}
+
+InsertElementInst *InsertElementInst::create_insert_element(Value *vec, Value *val, Value *idx, BasicBlock *bb)
+{
+    return new InsertElementInst(vec, val, idx, bb);
+}
+
+Instruction *InsertElementInst::copy_inst(BasicBlock *bb)
+{
+    return new InsertElementInst(get_operand(0), get_operand(1), get_operand(2), bb);
+}
+
+std::string InsertElementInst::print()
+{
+    std::string instr_ir;
+    instr_ir += "%";
+    instr_ir += this->get_name();
+    instr_ir += " = ";
+    instr_ir += this->get_module()->get_instr_op_name( this->get_instr_type() );
+    instr_ir += " ";
+    instr_ir += print_as_op(this->get_operand(0), true);
+    instr_ir += ", ";
+    instr_ir += print_as_op(this->get_operand(1), true);
+    instr_ir += ", ";
+    instr_ir += print_as_op(this->get_operand(2), true);
+    return instr_ir;
+}
+
+ExtractElementInst::ExtractElementInst(Value *vec, Value *idx, BasicBlock *bb)
+    : Instruction(vec->get_type()->get_vector_element_type(), Instruction::extractelement, 2, bb)
+{
+    set_operand(0, vec);
+    set_operand(1, idx);
+}
+
+ExtractElementInst *ExtractElementInst::create_extract_element(Value *vec, Value *idx, BasicBlock *bb)
+{
+    return new ExtractElementInst(vec, idx, bb);
+}
+
+Instruction *ExtractElementInst::copy_inst(BasicBlock *bb)
+{
+    return new ExtractElementInst(get_operand(0), get_operand(1), bb);
+}
+
+std::string ExtractElementInst::print()
+{
+    std::string instr_ir;
+    instr_ir += "%";
+    instr_ir += this->get_name();
+    instr_ir += " = ";
+    instr_ir += this->get_module()->get_instr_op_name( this->get_instr_type() );
+    instr_ir += " ";
+    instr_ir += print_as_op(this->get_operand(0), true);
+    instr_ir += ", ";
+    instr_ir += print_as_op(this->get_operand(1), true);
+    return instr_ir;
+}
+
 PhiInst::PhiInst(OpID op, std::vector<Value *> vals, std::vector<BasicBlock *> val_bbs, Type *ty, BasicBlock *bb)
-    : Instruction(ty, op, 2*vals.size() )
+    : Instruction(ty, op, 2*vals.size() ), l_val_(nullptr)
 {
     for ( int i = 0; i < vals.size(); i++)
     {
@@ -622,6 +843,21 @@ PhiInst *PhiInst::create_phi( Type *ty, BasicBlock *bb)
     return new PhiInst(Instruction::phi, vals, val_bbs, ty, bb);
 }
 
+Instruction *PhiInst::copy_inst(BasicBlock *bb)
+{
+    std::vector<Value *> vals;
+    std::vector<BasicBlock *> val_bbs;
+    for (int i = 0; i < get_num_operand(); i += 2)
+    {
+        vals.push_back(get_operand(i));
+        val_bbs.push_back(static_cast<BasicBlock *>(get_operand(i + 1)));
+    }
+    auto phi = new PhiInst(get_instr_type(), vals, val_bbs, get_type(), bb);
+    phi->set_lval(l_val_);
+    bb->add_instruction(phi);
+    return phi;
+}
+
 std::string PhiInst::print()
 {
     std::string instr_ir;
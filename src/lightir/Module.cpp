@@ -16,6 +16,13 @@ Module::Module(std::string name)
     instr_id2string_.insert({ Instruction::sub, "sub" });
     instr_id2string_.insert({ Instruction::mul, "mul" });
     instr_id2string_.insert({ Instruction::sdiv, "sdiv" });
+    instr_id2string_.insert({ Instruction::srem, "srem" });
+
+    instr_id2string_.insert({ Instruction::shl, "shl" });
+    instr_id2string_.insert({ Instruction::ashr, "ashr" });
+    instr_id2string_.insert({ Instruction::and_, "and" });
+    instr_id2string_.insert({ Instruction::or_, "or" });
+    instr_id2string_.insert({ Instruction::xor_, "xor" });
     
     instr_id2string_.insert({ Instruction::fadd, "fadd" });
     instr_id2string_.insert({ Instruction::fsub, "fsub" });
@@ -33,6 +40,9 @@ Module::Module(std::string name)
     instr_id2string_.insert({ Instruction::zext, "zext" });
     instr_id2string_.insert({ Instruction::sitofp, "sitofp" });
     instr_id2string_.insert({ Instruction::fptosi, "fptosi" });
+    instr_id2string_.insert({ Instruction::bitcast, "bitcast" });
+    instr_id2string_.insert({ Instruction::insertelement, "insertelement" });
+    instr_id2string_.insert({ Instruction::extractelement, "extractelement" });
 }
 
 Module::~Module()
@@ -66,6 +76,7 @@ IntegerType *Module::get_int32_type()
 
 PointerType *Module::get_pointer_type(Type *contained)
 {
+    std::lock_guard<std::mutex> lock(type_map_mutex_);
     if( pointer_map_.find(contained) == pointer_map_.end() )
     {
         pointer_map_[contained] = new PointerType(contained);
@@ -75,6 +86,7 @@ PointerType *Module::get_pointer_type(Type *contained)
 
 ArrayType *Module::get_array_type(Type *contained, unsigned num_elements)
 {
+    std::lock_guard<std::mutex> lock(type_map_mutex_);
     if( array_map_.find({contained, num_elements}) == array_map_.end() )
     {
         array_map_[{contained, num_elements}] = new ArrayType(contained, num_elements);
@@ -82,6 +94,16 @@ ArrayType *Module::get_array_type(Type *contained, unsigned num_elements)
     return array_map_[{contained, num_elements}];
 }
 
+VectorType *Module::get_vector_type(Type *contained, unsigned num_elements)
+{
+    std::lock_guard<std::mutex> lock(type_map_mutex_);
+    if( vector_map_.find({contained, num_elements}) == vector_map_.end() )
+    {
+        vector_map_[{contained, num_elements}] = new VectorType(contained, num_elements);
+    }
+    return vector_map_[{contained, num_elements}];
+}
+
 PointerType *Module::get_int32_ptr_type()
 {
     return get_pointer_type(int32_ty_);
@@ -49,6 +49,11 @@ ArrayType *Type::get_array_type(Type *contained, unsigned num_elements)
     return ArrayType::get(contained, num_elements);
 }
 
+VectorType *Type::get_vector_type(Type *contained, unsigned num_elements)
+{
+    return VectorType::get(contained, num_elements);
+}
+
 PointerType *Type::get_int32_ptr_type(Module *m)
 {
     return m->get_int32_ptr_type();
@@ -78,6 +83,13 @@ Type *Type::get_array_element_type(){
         return nullptr;
 }
 
+Type *Type::get_vector_element_type(){
+    if( this->is_vector_type() )
+        return static_cast<VectorType *>(this)->get_element_type();
+    else
+        return nullptr;
+}
+
 int Type::get_size() 
 {
     if (this->is_integer_type()) 
@@ -106,6 +118,12 @@ int Type::get_size()
     {
         return 4;
     }
+    if (this->is_vector_type())
+    {
+        auto element_size = static_cast<VectorType *>(this)->get_element_type()->get_size();
+        auto num_elements = static_cast<VectorType *>(this)->get_num_of_elements();
+        return element_size * num_elements;
+    }
     return 0;
 }
 
@@ -148,6 +166,13 @@ std::string Type::print(){
     case FloatTyID:
         type_ir += "float";
         break;
+    case VectorTyID:
+        type_ir += "<";
+        type_ir += std::to_string( static_cast<VectorType *>(this)->get_num_of_elements());
+        type_ir += " x ";
+        type_ir += static_cast<VectorType *>(this)->get_element_type()->print();
+        type_ir += ">";
+        break;
     default:
         break;
     }
@@ -246,3 +271,20 @@ FloatType::FloatType (Module *m)
 {
 
 }
+
+VectorType::VectorType(Type *contained, unsigned num_elements)
+    : Type(Type::VectorTyID, contained->get_module()), num_elements_(num_elements)
+{
+    assert(is_valid_element_type(contained) && "Not a valid type for vector element!");
+    contained_ = contained;
+}
+
+bool VectorType::is_valid_element_type(Type *ty)
+{
+    return ty->is_integer_type() || ty->is_float_type();
+}
+
+VectorType *VectorType::get(Type *contained, unsigned num_elements)
+{
+    return contained->get_module()->get_vector_type(contained, num_elements);
+}
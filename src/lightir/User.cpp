@@ -23,6 +23,8 @@ void User::set_operand(unsigned i, Value *v)
 {
     assert(i < num_ops_ && "set_operand out of index");
     // assert(operands_[i] == nullptr && "ith operand is not null");
+    if (operands_[i])
+        operands_[i]->remove_use(this, i);
     operands_[i] = v;  
     v->add_use(this, i);
 }
@@ -42,15 +44,20 @@ unsigned User::get_num_operand() const
 void User::remove_use_of_ops()
 {
     for (auto op : operands_) {
-        op->remove_use(this);
+        if (op)
+            op->remove_use(this);
     }
 }
 
 void User::remove_operands(int index1,int index2){
-    for(int i=index1;i<=index2;i++){
-        operands_[i]->remove_use(this);
+    // operands after index2 shift down, so their uses are re-registered with the new index
+    for(int i=index1;i<operands_.size();i++){
+        operands_[i]->remove_use(this, i);
     }
     operands_.erase(operands_.begin()+index1,operands_.begin()+index2+1);
     // std::cout<<operands_.size()<<std::endl;
     num_ops_=operands_.size();
+    for(int i=index1;i<operands_.size();i++){
+        operands_[i]->add_use(this, i);
+    }
 }
@@ -2,6 +2,10 @@
 #include "Type.h"
 #include "User.h"
 #include <cassert>
+#include <mutex>
+
+// guards the shared use lists
+static std::mutex shared_use_list_mutex;
 
 Value::Value(Type *ty, const std::string &name )
   : type_(ty), name_(name)
@@ -11,6 +15,9 @@ Value::Value(Type *ty, const std::string &name )
 
 void Value::add_use(Value *val, unsigned arg_no )
 {
+    std::unique_lock<std::mutex> lock(shared_use_list_mutex, std::defer_lock);
+    if (shared_use_list_)
+        lock.lock();
     use_list_.push_back(Use(val, arg_no));
 }
 
@@ -21,7 +28,11 @@ std::string Value::get_name() const
 
 void Value::replace_all_use_with(Value *new_val)
 {
-    for (auto use : use_list_) {
+    if (new_val == this)
+        return;
+    // set_operand() unlinks each use from use_list_, so walk over a copy
+    auto uses = use_list_;
+    for (auto use : uses) {
         auto val = dynamic_cast<User *>(use.val_);
         assert(val && "new_val is not a user");
         val->set_operand(use.arg_no_, new_val);
@@ -30,6 +41,17 @@ void Value::replace_all_use_with(Value *new_val)
 
 void Value::remove_use(Value *val)
 {
+    std::unique_lock<std::mutex> lock(shared_use_list_mutex, std::defer_lock);
+    if (shared_use_list_)
+        lock.lock();
     auto is_val = [val] (const Use &use) { return use.val_ == val; };
     use_list_.remove_if(is_val);
-}
\ No newline at end of file
+}
+void Value::remove_use(Value *val, unsigned arg_no)
+{
+    std::unique_lock<std::mutex> lock(shared_use_list_mutex, std::defer_lock);
+    if (shared_use_list_)
+        lock.lock();
+    auto is_use = [val, arg_no] (const Use &use) { return use.val_ == val && use.arg_no_ == arg_no; };
+    use_list_.remove_if(is_use);
+}
@@ -0,0 +1,62 @@
+#include "AnalysisManager.hpp"
+
+AnalysisManager::~AnalysisManager()
+{
+    invalidate_all(PRESERVE_NONE);
+}
+
+AnalysisManager::Results &AnalysisManager::get_results(Function *f)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return results_[f];
+}
+
+Dominators *AnalysisManager::get_dominators(Function *f)
+{
+    auto &results = get_results(f);
+    if (!results.dominators)
+    {
+        results.dominators = new Dominators(m_);
+        results.dominators->run_on_function(f);
+    }
+    return results.dominators;
+}
+
+LoopSearch *AnalysisManager::get_loop_search(Function *f)
+{
+    auto &results = get_results(f);
+    if (!results.loop_search)
+    {
+        results.loop_search = new LoopSearch(m_);
+        results.loop_search->run_on_function(f);
+    }
+    return results.loop_search;
+}
+
+void AnalysisManager::invalidate(Function *f, unsigned preserved)
+{
+    invalidate(get_results(f), preserved);
+}
+
+void AnalysisManager::invalidate_all(unsigned preserved)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &results : results_)
+    {
+        invalidate(results.second, preserved);
+    }
+}
+
+void AnalysisManager::invalidate(Results &results, unsigned preserved)
+{
+    if (!(preserved & PRESERVE_DOMINATORS))
+    {
+        delete results.dominators;
+        results.dominators = nullptr;
+    }
+    if (!(preserved & PRESERVE_LOOPS))
+    {
+        delete results.loop_search;
+        results.loop_search = nullptr;
+    }
+}
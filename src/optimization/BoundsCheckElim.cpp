@@ -0,0 +1,389 @@
+#include "BoundsCheckElim.hpp"
+#include "AnalysisManager.hpp"
+#include <algorithm>
+#include <vector>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+
+// ranges are not computed through chains longer than this
+const int MAX_RANGE_DEPTH = 8;
+
+static bool is_const_int(Value *val, int c)
+{
+    auto const_val = CONST_INT(val);
+    return const_val && const_val->get_value() == c;
+}
+
+// the range of a result which may wrap around is unknown
+static bool in_int_range(long long lo, long long hi)
+{
+    return lo >= INT_MIN && hi <= INT_MAX;
+}
+
+// !(a op b) == (a inverse_op b)
+static CmpInst::CmpOp inverse_cmp_op(CmpInst::CmpOp op)
+{
+    switch (op)
+    {
+    case CmpInst::EQ: return CmpInst::NE;
+    case CmpInst::NE: return CmpInst::EQ;
+    case CmpInst::GT: return CmpInst::LE;
+    case CmpInst::GE: return CmpInst::LT;
+    case CmpInst::LT: return CmpInst::GE;
+    case CmpInst::LE: return CmpInst::GT;
+    }
+    return op;
+}
+
+// (a op b) == (b swapped_op a)
+static CmpInst::CmpOp swap_cmp_op(CmpInst::CmpOp op)
+{
+    switch (op)
+    {
+    case CmpInst::GT: return CmpInst::LT;
+    case CmpInst::GE: return CmpInst::LE;
+    case CmpInst::LT: return CmpInst::GT;
+    case CmpInst::LE: return CmpInst::GE;
+    default: return op;
+    }
+}
+
+// cminusfc tests a condition c as "icmp ne (zext c), 0",
+// return c and whether the test is inverted, or nullptr if cmp is not such a test
+static CmpInst *unwrap_zext_test(CmpInst *cmp, bool &inverted)
+{
+    auto op = cmp->get_cmp_op();
+    if ((op != CmpInst::NE && op != CmpInst::EQ) || !is_const_int(cmp->get_operand(1), 0))
+        return nullptr;
+    auto zext = dynamic_cast<Instruction *>(cmp->get_operand(0));
+    if (!zext || !zext->is_zext())
+        return nullptr;
+    inverted = op == CmpInst::EQ;
+    return dynamic_cast<CmpInst *>(zext->get_operand(0));
+}
+
+void BoundsCheckElim::run_on_function(Function *func)
+{
+    dominators_ = am_->get_dominators(func);
+
+    // step 1: find the bounds checks
+    std::vector<BranchInst *> checks;
+    for (auto bb : func->get_basic_blocks())
+    {
+        if (bb->empty() || !bb->get_instructions().back()->is_br())
+            continue;
+        auto br = static_cast<BranchInst *>(bb->get_instructions().back());
+        if (br->is_cond_br() && is_except_block(static_cast<BasicBlock *>(br->get_operand(1))))
+        {
+            checks.push_back(br);
+        }
+    }
+
+    // step 2: remove the checks which never fail
+    add_stat("checks found", checks.size());
+    for (auto br : checks)
+    {
+        if (is_always_false(br->get_operand(0), br->get_parent()))
+        {
+            remove_check(br);
+            add_stat("checks removed");
+        }
+    }
+}
+
+bool BoundsCheckElim::is_except_block(BasicBlock *bb)
+{
+    if (bb->empty() || !bb->get_instructions().front()->is_call())
+        return false;
+    auto callee = bb->get_instructions().front()->get_operand(0);
+    return callee->get_name() == "neg_idx_except" || callee->get_name() == "idx_out_of_range_except";
+}
+
+bool BoundsCheckElim::is_always_false(Value *cond, BasicBlock *bb)
+{
+    if (CONST_INT(cond))
+        return CONST_INT(cond)->get_value() == 0;
+    auto cmp = dynamic_cast<CmpInst *>(cond);
+    if (!cmp)
+        return false;
+
+    bool inverted = false;
+    auto inner_cmp = unwrap_zext_test(cmp, inverted);
+    if (inner_cmp && !inverted)
+        return is_always_false(inner_cmp, bb);
+
+    auto lhs = get_range(cmp->get_operand(0), bb, 0);
+    auto rhs = get_range(cmp->get_operand(1), bb, 0);
+    switch (cmp->get_cmp_op())
+    {
+    case CmpInst::LT: return lhs.lo >= rhs.hi;
+    case CmpInst::LE: return lhs.lo > rhs.hi;
+    case CmpInst::GT: return lhs.hi <= rhs.lo;
+    case CmpInst::GE: return lhs.hi < rhs.lo;
+    case CmpInst::EQ: return lhs.hi < rhs.lo || rhs.hi < lhs.lo;
+    case CmpInst::NE: return lhs.lo == lhs.hi && rhs.lo == rhs.hi && lhs.lo == rhs.lo;
+    }
+    return false;
+}
+
+void BoundsCheckElim::remove_check(BranchInst *br)
+{
+    auto bb = br->get_parent();
+    auto cond = br->get_operand(0);
+    auto except_bb = static_cast<BasicBlock *>(br->get_operand(1));
+    auto cont_bb = static_cast<BasicBlock *>(br->get_operand(2));
+
+    // step 1: branch to the block where the access continues
+    bb->delete_instr(br);
+    bb->remove_succ_basic_block(except_bb);
+    except_bb->remove_pre_basic_block(bb);
+    bb->remove_succ_basic_block(cont_bb);
+    cont_bb->remove_pre_basic_block(bb);
+    BranchInst::create_br(cont_bb, bb);
+
+    // step 2: delete the condition if it is dead
+    auto instr = dynamic_cast<Instruction *>(cond);
+    while (instr && (instr->is_cmp() || instr->is_zext()) && instr->get_use_list().empty())
+    {
+        auto op = instr->get_operand(0);
+        instr->get_parent()->delete_instr(instr);
+        instr = dynamic_cast<Instruction *>(op);
+    }
+
+    // step 3: delete the exception block if it is unreachable
+    if (!except_bb->get_pre_basic_blocks().empty())
+        return;
+    for (auto succ_bb : except_bb->get_succ_basic_blocks())
+    {
+        for (auto succ_instr : succ_bb->get_instructions())
+        {
+            if (!succ_instr->is_phi())
+                break;
+            for (int i = succ_instr->get_num_operand() - 2; i >= 0; i -= 2)
+            {
+                if (succ_instr->get_operand(i + 1) == except_bb)
+                    succ_instr->remove_operands(i, i + 1);
+            }
+        }
+    }
+    auto except_instrs = except_bb->get_instructions();
+    for (auto except_instr : except_instrs)
+    {
+        except_bb->delete_instr(except_instr);
+    }
+    except_bb->erase_from_parent();
+}
+
+BoundsCheckElim::Range BoundsCheckElim::get_range(Value *val, BasicBlock *bb, int depth)
+{
+    if (CONST_INT(val))
+        return Range(CONST_INT(val)->get_value(), CONST_INT(val)->get_value());
+    if (depth > MAX_RANGE_DEPTH)
+        return Range();
+    auto range = get_def_range(val, bb, depth);
+    return refine_by_conditions(val, range, bb, depth);
+}
+
+BoundsCheckElim::Range BoundsCheckElim::get_def_range(Value *val, BasicBlock *bb, int depth)
+{
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (!instr)
+        return Range();
+
+    if (instr->is_phi())
+    {
+        auto phi = static_cast<PhiInst *>(instr);
+        if (assumed_.find(phi) != assumed_.end())
+            return assumed_[phi];
+        return get_phi_range(phi, depth);
+    }
+    if (instr->is_zext())
+        return Range(0, 1);
+    if (!instr->is_int_instr())
+        return Range();
+
+    // the operands dominate instr, so the conditions dominating bb hold for them
+    auto lhs = get_range(instr->get_operand(0), bb, depth + 1);
+    auto rhs_const = CONST_INT(instr->get_operand(1));
+    long long lo, hi;
+    if (instr->is_add())
+    {
+        auto rhs = get_range(instr->get_operand(1), bb, depth + 1);
+        lo = lhs.lo + rhs.lo;
+        hi = lhs.hi + rhs.hi;
+    }
+    else if (instr->is_sub())
+    {
+        auto rhs = get_range(instr->get_operand(1), bb, depth + 1);
+        lo = lhs.lo - rhs.hi;
+        hi = lhs.hi - rhs.lo;
+    }
+    else if (instr->is_mul())
+    {
+        auto rhs = get_range(instr->get_operand(1), bb, depth + 1);
+        long long corners[] = {lhs.lo * rhs.lo, lhs.lo * rhs.hi, lhs.hi * rhs.lo, lhs.hi * rhs.hi};
+        lo = *std::min_element(corners, corners + 4);
+        hi = *std::max_element(corners, corners + 4);
+    }
+    else if (instr->is_div() && rhs_const && rhs_const->get_value() != 0)
+    {
+        long long c = rhs_const->get_value();
+        if (c == -1 && lhs.lo <= INT_MIN)
+            return Range();
+        lo = std::min(lhs.lo / c, lhs.hi / c);
+        hi = std::max(lhs.lo / c, lhs.hi / c);
+    }
+    else if (instr->is_rem() && rhs_const && rhs_const->get_value() != 0)
+    {
+        // the result has the sign of lhs, and |result| < |c|
+        long long m = std::abs((long long)rhs_const->get_value()) - 1;
+        lo = lhs.lo >= 0 ? 0 : std::max(-m, lhs.lo);
+        hi = lhs.hi <= 0 ? 0 : std::min(m, lhs.hi);
+    }
+    else if (instr->is_and())
+    {
+        auto rhs = get_range(instr->get_operand(1), bb, depth + 1);
+        if (lhs.lo < 0 && rhs.lo < 0)
+            return Range();
+        lo = 0;
+        hi = std::min(lhs.lo >= 0 ? lhs.hi : (long long)INT_MAX, rhs.lo >= 0 ? rhs.hi : (long long)INT_MAX);
+    }
+    else if (instr->is_shl() && rhs_const && rhs_const->get_value() >= 0 && rhs_const->get_value() < 32)
+    {
+        lo = lhs.lo * (1LL << rhs_const->get_value());
+        hi = lhs.hi * (1LL << rhs_const->get_value());
+    }
+    else if (instr->is_ashr() && rhs_const && rhs_const->get_value() >= 0 && rhs_const->get_value() < 32)
+    {
+        lo = lhs.lo >> rhs_const->get_value();
+        hi = lhs.hi >> rhs_const->get_value();
+    }
+    else
+    {
+        return Range();
+    }
+    if (!in_int_range(lo, hi))
+        return Range();
+    return Range(lo, hi);
+}
+
+BoundsCheckElim::Range BoundsCheckElim::get_phi_range(PhiInst *phi, int depth)
+{
+    // step 1: an induction variable, phi [init, pre_bb], [phi + step, latch_bb]
+    if (phi->get_num_operand() == 4)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            auto next = dynamic_cast<Instruction *>(phi->get_operand(2 * i));
+            auto next_bb = static_cast<BasicBlock *>(phi->get_operand(2 * i + 1));
+            auto init = phi->get_operand(2 - 2 * i);
+            auto init_bb = static_cast<BasicBlock *>(phi->get_operand(3 - 2 * i));
+            if (!next || !(next->is_add() || next->is_sub()) || init == phi)
+                continue;
+            long long step;
+            if (next->get_operand(0) == phi && CONST_INT(next->get_operand(1)))
+                step = CONST_INT(next->get_operand(1))->get_value();
+            else if (next->is_add() && next->get_operand(1) == phi && CONST_INT(next->get_operand(0)))
+                step = CONST_INT(next->get_operand(0))->get_value();
+            else
+                continue;
+            if (next->is_sub())
+                step = -step;
+            if (step == 0)
+                continue;
+
+            // assume the phi never goes back beyond its initial value,
+            // it holds if the next value doesn't either, i.e. phi + step doesn't wrap
+            auto init_range = get_range(init, init_bb, depth + 1);
+            assumed_[phi] = step > 0 ? Range(init_range.lo, INT_MAX) : Range(INT_MIN, init_range.hi);
+            auto next_range = get_range(next, next_bb, depth + 1);
+            assumed_.erase(phi);
+            if (step > 0 && next_range.lo >= init_range.lo)
+                return Range(init_range.lo, std::max(init_range.hi, next_range.hi));
+            if (step < 0 && next_range.hi <= init_range.hi)
+                return Range(std::min(init_range.lo, next_range.lo), init_range.hi);
+            return Range();
+        }
+    }
+
+    // step 2: otherwise, the union of the incoming values
+    assumed_[phi] = Range();
+    Range range(INT_MAX, INT_MIN);
+    for (int i = 0; i < phi->get_num_operand(); i += 2)
+    {
+        auto incoming = get_range(phi->get_operand(i), static_cast<BasicBlock *>(phi->get_operand(i + 1)), depth + 1);
+        range.lo = std::min(range.lo, incoming.lo);
+        range.hi = std::max(range.hi, incoming.hi);
+    }
+    assumed_.erase(phi);
+    return range;
+}
+
+BoundsCheckElim::Range BoundsCheckElim::refine_by_conditions(Value *val, Range range, BasicBlock *bb, int depth)
+{
+    // if a block on the dominator tree path has a single predecessor,
+    // the condition of the edge from the predecessor holds in bb
+    auto entry = bb->get_parent()->get_entry_block();
+    auto cur_bb = bb;
+    while (cur_bb != entry)
+    {
+        if (cur_bb->get_pre_basic_blocks().size() == 1)
+        {
+            auto pre_bb = cur_bb->get_pre_basic_blocks().front();
+            auto terminator = pre_bb->empty() ? nullptr : pre_bb->get_instructions().back();
+            if (terminator && terminator->is_br() && static_cast<BranchInst *>(terminator)->is_cond_br() &&
+                terminator->get_operand(1) != terminator->get_operand(2))
+            {
+                auto cmp = dynamic_cast<CmpInst *>(terminator->get_operand(0));
+                bool taken = terminator->get_operand(1) == cur_bb;
+                if (cmp)
+                    range = refine_by_cmp(val, range, cmp, taken, pre_bb, depth);
+            }
+        }
+        auto idom = dominators_->get_idom(cur_bb);
+        if (!idom || idom == cur_bb)
+            break;
+        cur_bb = idom;
+    }
+    return range;
+}
+
+BoundsCheckElim::Range BoundsCheckElim::refine_by_cmp(Value *val, Range range, CmpInst *cmp, bool taken,
+                                                      BasicBlock *bb, int depth)
+{
+    bool inverted = false;
+    auto inner_cmp = unwrap_zext_test(cmp, inverted);
+    if (inner_cmp)
+        return refine_by_cmp(val, range, inner_cmp, taken != inverted, bb, depth);
+
+    auto op = taken ? cmp->get_cmp_op() : inverse_cmp_op(cmp->get_cmp_op());
+    Value *other;
+    if (cmp->get_operand(0) == val && cmp->get_operand(1) != val)
+    {
+        other = cmp->get_operand(1);
+    }
+    else if (cmp->get_operand(1) == val && cmp->get_operand(0) != val)
+    {
+        other = cmp->get_operand(0);
+        op = swap_cmp_op(op);
+    }
+    else
+    {
+        return range;
+    }
+
+    auto other_range = get_range(other, bb, depth + 1);
+    switch (op)
+    {
+    case CmpInst::LT: range.hi = std::min(range.hi, other_range.hi - 1); break;
+    case CmpInst::LE: range.hi = std::min(range.hi, other_range.hi); break;
+    case CmpInst::GT: range.lo = std::max(range.lo, other_range.lo + 1); break;
+    case CmpInst::GE: range.lo = std::max(range.lo, other_range.lo); break;
+    case CmpInst::EQ:
+        range.lo = std::max(range.lo, other_range.lo);
+        range.hi = std::min(range.hi, other_range.hi);
+        break;
+    case CmpInst::NE: break;
+    }
+    return range;
+}
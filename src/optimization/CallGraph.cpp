@@ -0,0 +1,87 @@
+#include "CallGraph.hpp"
+#include <algorithm>
+
+void CallGraph::run()
+{
+    callees_.clear();
+    callers_.clear();
+    call_sites_.clear();
+    recursive_.clear();
+    bottom_up_order_.clear();
+
+    // step 1: collect the call sites of every function
+    for (auto f : m_->get_functions())
+    {
+        for (auto bb : f->get_basic_blocks())
+        {
+            for (auto instr : bb->get_instructions())
+            {
+                if (instr->is_call())
+                {
+                    auto callee = static_cast<Function *>(instr->get_operand(0));
+                    call_sites_[f].push_back(static_cast<CallInst *>(instr));
+                    callees_[f].insert(callee);
+                    callers_[callee].insert(f);
+                }
+            }
+        }
+    }
+
+    // step 2: find the strongly connected components, which are popped in bottom-up order
+    index_count_ = 0;
+    index_.clear();
+    low_link_.clear();
+    stack_.clear();
+    on_stack_.clear();
+    for (auto f : m_->get_functions())
+    {
+        if (!f->is_declaration() && index_.find(f) == index_.end())
+        {
+            strong_connect(f);
+        }
+    }
+}
+
+void CallGraph::strong_connect(Function *f)
+{
+    index_[f] = low_link_[f] = index_count_++;
+    stack_.push_back(f);
+    on_stack_.insert(f);
+
+    for (auto callee : callees_[f])
+    {
+        if (callee->is_declaration())
+            continue;
+        if (index_.find(callee) == index_.end())
+        {
+            strong_connect(callee);
+            low_link_[f] = std::min(low_link_[f], low_link_[callee]);
+        }
+        else if (on_stack_.find(callee) != on_stack_.end())
+        {
+            low_link_[f] = std::min(low_link_[f], index_[callee]);
+        }
+    }
+
+    if (low_link_[f] == index_[f])
+    {
+        // f is the root of a component
+        std::vector<Function *> component;
+        Function *member;
+        do
+        {
+            member = stack_.back();
+            stack_.pop_back();
+            on_stack_.erase(member);
+            component.push_back(member);
+        } while (member != f);
+
+        bool is_self_call = callees_[f].find(f) != callees_[f].end();
+        for (auto func : component)
+        {
+            if (component.size() > 1 || is_self_call)
+                recursive_.insert(func);
+            bottom_up_order_.push_back(func);
+        }
+    }
+}
@@ -18,7 +18,7 @@
  * @return: whether the state has changed
  */
 bool process_bin_instr(BinaryInst *instr,
-                       std::map<Instruction, std::map<Value*, ConstState>>& program_state) {
+                       std::map<Instruction *, std::map<Value*, ConstState>>& program_state) {
     //auto r_val_1 = instr->get_operand(0);
     //auto r_val_2 = instr->get_operand(1);
     if (instr->is_int_instr()) {
@@ -26,6 +26,7 @@ bool process_bin_instr(BinaryInst *instr,
     } else if (instr->is_fp_instr()) {
 
     }
+    return false;
 }
 
 /*
@@ -35,7 +36,7 @@ bool process_bin_instr(BinaryInst *instr,
  * @return: whether the state has changed
  */
 bool process_cmp_instr(CmpInst *instr,
-                       std::map<Instruction, std::map<Value*, ConstState>>& program_state) {
+                       std::map<Instruction *, std::map<Value*, ConstState>>& program_state) {
     return false;
 }
 
@@ -46,7 +47,7 @@ bool process_cmp_instr(CmpInst *instr,
  * @return: whether the state has changed
  */
 bool process_fcmp_instr(FCmpInst *instr,
-                       std::map<Instruction, std::map<Value*, ConstState>>& program_state) {
+                       std::map<Instruction *, std::map<Value*, ConstState>>& program_state) {
     return false;
 }
 
@@ -57,7 +58,7 @@ bool process_fcmp_instr(FCmpInst *instr,
  * @return: whether the state has changed
  */
 bool process_instr(Instruction *instr,
-                   std::map<Instruction, std::map<Value*, ConstState>>& program_state) {
+                   std::map<Instruction *, std::map<Value*, ConstState>>& program_state) {
     // we only analyze binary and comparison instruction
     if (IS_BINARY_INSTR(instr)) {
         auto bin_instr = dynamic_cast<BinaryInst *>(instr);
@@ -73,14 +74,14 @@ bool process_instr(Instruction *instr,
     }
 }
 
-void ConstPropagation::process_func(Function *func) {
+void ConstPropagation::run_on_function(Function *func) {
     // we don't deal with an empty function
     if (func->get_num_basic_blocks() == 0) {
         return;
     }
 
     // maps the constant state of each value at each program point
-    std::map<Instruction, std::map<Value*, ConstState>> program_state;
+    std::map<Instruction *, std::map<Value*, ConstState>> program_state;
     // the worklist to store basic blocks
     std::list<BasicBlock*> bb_list;
 
@@ -97,10 +98,3 @@ void ConstPropagation::process_func(Function *func) {
         }
     }
 }
-
-void ConstPropagation::run() {
-    // do each intraprocedural analysis separately
-    for (auto func : m_->get_functions()) {
-        process_func(func);
-    }
-}
\ No newline at end of file
@@ -1,28 +1,28 @@
 #include "Dominators.h"
 #include <algorithm>
 #include <string>
+#include <vector>
 
-void Dominators::run()
+void Dominators::run_on_function(Function *f)
 {
-    for (auto f : m_->get_functions()) {
-        if (f->get_basic_blocks().size() == 0)
-            continue;
-        for (auto bb : f->get_basic_blocks() )
-        {
-            doms_.insert({bb ,{}});
-            idom_.insert({bb ,{}});
-            dom_frontier_.insert({bb ,{}});
-            dom_tree_succ_blocks_.insert({bb ,{}});
-        }
-        
-        create_reverse_post_order(f);
-        create_idom(f);
-        create_dominance_frontier(f);
-        create_dom_tree_succ(f);
-        // for debug
-        // print_idom(f);
-        // print_dominance_frontier(f);
+    if (f->get_basic_blocks().size() == 0)
+        return;
+    // the function may have been analyzed before it changed
+    for (auto bb : f->get_basic_blocks() )
+    {
+        doms_[bb] = {};
+        idom_[bb] = {};
+        dom_frontier_[bb] = {};
+        dom_tree_succ_blocks_[bb] = {};
     }
+
+    create_reverse_post_order(f);
+    create_idom(f);
+    create_dominance_frontier(f);
+    create_dom_tree_succ(f);
+    // for debug
+    // print_idom(f);
+    // print_dominance_frontier(f);
 }
 
 void Dominators::create_doms(Function *f)
@@ -71,15 +71,26 @@ void Dominators::create_reverse_post_order(Function *f)
     reverse_post_order_.reverse();
 }
 
+// depth first search with an explicit stack, a deep cfg would overflow the call stack
 void Dominators::post_order_visit(BasicBlock *bb, std::set<BasicBlock *> &visited)
 {
+    // (block, its next successor to visit)
+    std::vector<std::pair<BasicBlock *, std::list<BasicBlock *>::iterator>> stack;
     visited.insert(bb);
-    for (auto b : bb->get_succ_basic_blocks()) {
-        if (visited.find(b) == visited.end())
-            post_order_visit(b, visited);
+    stack.push_back({bb, bb->get_succ_basic_blocks().begin()});
+    while (!stack.empty()) {
+        auto cur = stack.back().first;
+        auto &iter = stack.back().second;
+        if (iter != cur->get_succ_basic_blocks().end()) {
+            auto b = *iter++;
+            if (visited.insert(b).second)
+                stack.push_back({b, b->get_succ_basic_blocks().begin()});
+            continue;
+        }
+        stack.pop_back();
+        post_order_id_[cur] = reverse_post_order_.size();
+        reverse_post_order_.push_back(cur);
     }
-    post_order_id_[bb] = reverse_post_order_.size();
-    reverse_post_order_.push_back(bb);
 }
 
 void Dominators::create_idom(Function *f)
@@ -147,6 +158,9 @@ void Dominators::create_dominance_frontier(Function *f)
     for (auto bb : f->get_basic_blocks()) {
         if (bb->get_pre_basic_blocks().size() >= 2) {
             for (auto p : bb->get_pre_basic_blocks()) {
+                // unreachable preds have no idom
+                if (get_idom(p) == nullptr)
+                    continue;
                 auto runner = p;
                 while (runner != get_idom(bb)) {
                     add_dominance_frontier(runner, bb);
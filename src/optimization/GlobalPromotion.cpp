@@ -0,0 +1,182 @@
+#include "GlobalPromotion.hpp"
+#include <algorithm>
+#include <vector>
+
+#define IS_GLOBAL_VARIABLE(l_val) dynamic_cast<GlobalVariable *>(l_val)
+
+// only int and float globals are promoted, arrays are accessed by gep
+static GlobalVariable *get_global_scalar(Value *ptr)
+{
+    auto global = IS_GLOBAL_VARIABLE(ptr);
+    if (!global)
+        return nullptr;
+    auto type = global->get_type()->get_pointer_element_type();
+    if (!type->is_integer_type() && !type->is_float_type())
+        return nullptr;
+    return global;
+}
+
+void GlobalPromotion::run()
+{
+    call_graph_.reset(new CallGraph(m_));
+    call_graph_->run();
+    compute_mod_ref();
+
+    for (auto func : call_graph_->get_bottom_up_order())
+    {
+        // the accessed globals are loaded at the entry, which can't be a loop header
+        if (!func->get_entry_block()->get_pre_basic_blocks().empty())
+            continue;
+        std::set<GlobalVariable *> accessed;
+        for (auto bb : func->get_basic_blocks())
+        {
+            for (auto instr : bb->get_instructions())
+            {
+                GlobalVariable *global = nullptr;
+                if (instr->is_load())
+                    global = get_global_scalar(static_cast<LoadInst *>(instr)->get_lval());
+                else if (instr->is_store())
+                    global = get_global_scalar(static_cast<StoreInst *>(instr)->get_lval());
+                if (global)
+                    accessed.insert(global);
+            }
+        }
+        for (auto global : accessed)
+        {
+            promote(func, global);
+        }
+    }
+}
+
+void GlobalPromotion::compute_mod_ref()
+{
+    mod_.clear();
+    ref_.clear();
+
+    // step 1: the globals accessed directly
+    for (auto func : call_graph_->get_bottom_up_order())
+    {
+        for (auto bb : func->get_basic_blocks())
+        {
+            for (auto instr : bb->get_instructions())
+            {
+                if (instr->is_load() && IS_GLOBAL_VARIABLE(static_cast<LoadInst *>(instr)->get_lval()))
+                    ref_[func].insert(IS_GLOBAL_VARIABLE(static_cast<LoadInst *>(instr)->get_lval()));
+                else if (instr->is_store() && IS_GLOBAL_VARIABLE(static_cast<StoreInst *>(instr)->get_lval()))
+                    mod_[func].insert(IS_GLOBAL_VARIABLE(static_cast<StoreInst *>(instr)->get_lval()));
+            }
+        }
+    }
+
+    // step 2: add the summaries of callees, callees come first in bottom-up order,
+    // but the functions in a recursion need more iterations
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto func : call_graph_->get_bottom_up_order())
+        {
+            auto mod_size = mod_[func].size();
+            auto ref_size = ref_[func].size();
+            for (auto callee : call_graph_->get_callees(func))
+            {
+                mod_[func].insert(mod_[callee].begin(), mod_[callee].end());
+                ref_[func].insert(ref_[callee].begin(), ref_[callee].end());
+            }
+            if (mod_[func].size() != mod_size || ref_[func].size() != ref_size)
+                changed = true;
+        }
+    }
+}
+
+void GlobalPromotion::promote(Function *func, GlobalVariable *global)
+{
+    // step 1: find the accesses of global, and the calls which may access it
+    std::vector<Instruction *> accesses;
+    bool is_stored = false;
+    std::vector<Instruction *> rets;
+    for (auto bb : func->get_basic_blocks())
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (instr->is_load() && static_cast<LoadInst *>(instr)->get_lval() == global)
+            {
+                accesses.push_back(instr);
+            }
+            else if (instr->is_store() && static_cast<StoreInst *>(instr)->get_lval() == global)
+            {
+                accesses.push_back(instr);
+                is_stored = true;
+            }
+            else if (instr->is_ret())
+            {
+                rets.push_back(instr);
+            }
+        }
+    }
+    std::vector<CallInst *> ref_calls, mod_calls;
+    for (auto call : call_graph_->get_call_sites(func))
+    {
+        auto callee = static_cast<Function *>(call->get_operand(0));
+        bool is_mod = mod_[callee].find(global) != mod_[callee].end();
+        bool is_ref = ref_[callee].find(global) != ref_[callee].end();
+        if (is_stored && (is_mod || is_ref))
+            ref_calls.push_back(call);
+        if (is_mod)
+            mod_calls.push_back(call);
+    }
+
+    // it's not worth it if the copies outnumber the accesses
+    if (ref_calls.size() + mod_calls.size() > accesses.size())
+        return;
+    add_stat("globals promoted");
+
+    // step 2: copy global into a new local variable at the entry
+    auto entry = func->get_entry_block();
+    auto type = global->get_type()->get_pointer_element_type();
+    auto local = AllocaInst::create_alloca(type, entry);
+    entry->get_instructions().pop_back();
+    entry->add_instr_begin(local);
+    auto pos = *std::find_if(entry->get_instructions().begin(), entry->get_instructions().end(),
+                             [](Instruction *instr) { return !instr->is_alloca(); });
+    insert_copy(global, local, pos);
+
+    // step 3: access the local variable instead
+    for (auto instr : accesses)
+    {
+        if (instr->is_load())
+            instr->set_operand(0, local);
+        else
+            instr->set_operand(1, local);
+    }
+
+    // step 4: synchronize global with the local variable around calls and at returns
+    for (auto call : ref_calls)
+    {
+        insert_copy(local, global, call);
+    }
+    for (auto call : mod_calls)
+    {
+        auto &instrs = call->get_parent()->get_instructions();
+        insert_copy(global, local, *std::next(std::find(instrs.begin(), instrs.end(), call)));
+    }
+    if (is_stored)
+    {
+        for (auto ret : rets)
+        {
+            insert_copy(local, global, ret);
+        }
+    }
+}
+
+void GlobalPromotion::insert_copy(Value *src, Value *dest, Instruction *pos)
+{
+    auto bb = pos->get_parent();
+    auto type = src->get_type()->get_pointer_element_type();
+    auto load = LoadInst::create_load(type, src, bb);
+    bb->get_instructions().pop_back();
+    bb->add_instr_before(load, pos);
+    auto store = StoreInst::create_store(load, dest, bb);
+    bb->get_instructions().pop_back();
+    bb->add_instr_before(store, pos);
+}
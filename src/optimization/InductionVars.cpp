@@ -0,0 +1,272 @@
+#include "InductionVars.hpp"
+#include "GlobalVariable.h"
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+
+// expressions deeper than this are not analyzed
+const int MAX_IV_DEPTH = 8;
+
+// i32 addition, which wraps around on overflow
+static int wrap(int a, unsigned b) { return (unsigned)a + b; }
+
+// the compare which holds when op doesn't
+static CmpInst::CmpOp negate(CmpInst::CmpOp op)
+{
+    switch (op)
+    {
+    case CmpInst::EQ:
+        return CmpInst::NE;
+    case CmpInst::NE:
+        return CmpInst::EQ;
+    case CmpInst::GT:
+        return CmpInst::LE;
+    case CmpInst::GE:
+        return CmpInst::LT;
+    case CmpInst::LT:
+        return CmpInst::GE;
+    default:
+        return CmpInst::GT;
+    }
+}
+
+// the compare of "b op a" written as "a swapped_op b"
+static CmpInst::CmpOp swap_operands(CmpInst::CmpOp op)
+{
+    switch (op)
+    {
+    case CmpInst::GT:
+        return CmpInst::LT;
+    case CmpInst::GE:
+        return CmpInst::LE;
+    case CmpInst::LT:
+        return CmpInst::GT;
+    case CmpInst::LE:
+        return CmpInst::GE;
+    default:
+        return op;
+    }
+}
+
+InductionVars::InductionVars(Loop *loop) : loop_(loop)
+{
+    // step 1: find the entry of the loop
+    auto header = loop->get_header();
+    for (auto pred : header->get_pre_basic_blocks())
+    {
+        if (loop->contains(pred) || pred == entry_)
+            continue;
+        if (entry_)
+        {
+            entry_ = nullptr;
+            return;
+        }
+        entry_ = pred;
+    }
+    auto latch = loop->get_latch();
+    if (!entry_ || !latch)
+    {
+        entry_ = nullptr;
+        return;
+    }
+
+    // step 2: find the phis stepped by a constant
+    for (auto instr : header->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        if (instr->get_num_operand() != 4)
+            continue;
+        auto phi = static_cast<PhiInst *>(instr);
+        Value *init = nullptr, *next = nullptr;
+        for (int i = 0; i < 4; i += 2)
+        {
+            if (phi->get_operand(i + 1) == entry_)
+                init = phi->get_operand(i);
+            else if (phi->get_operand(i + 1) == latch)
+                next = phi->get_operand(i);
+        }
+        auto next_instr = dynamic_cast<Instruction *>(next);
+        if (!init || !next_instr || next_instr->get_num_operand() != 2)
+            continue;
+        auto lhs = next_instr->get_operand(0);
+        auto rhs = next_instr->get_operand(1);
+        if (next_instr->is_add() && lhs == phi && CONST_INT(rhs))
+            basic_ivs_[phi] = {phi, init, CONST_INT(rhs)->get_value()};
+        else if (next_instr->is_add() && rhs == phi && CONST_INT(lhs))
+            basic_ivs_[phi] = {phi, init, CONST_INT(lhs)->get_value()};
+        else if (next_instr->is_sub() && lhs == phi && CONST_INT(rhs))
+            basic_ivs_[phi] = {phi, init, -CONST_INT(rhs)->get_value()};
+    }
+}
+
+InductionVars::BasicIV *InductionVars::get_basic_iv(PhiInst *phi)
+{
+    auto iter = basic_ivs_.find(phi);
+    return iter == basic_ivs_.end() ? nullptr : &iter->second;
+}
+
+bool InductionVars::get_affine_iv(Value *val, AffineIV &iv)
+{
+    return get_affine_iv(val, iv, 0);
+}
+
+bool InductionVars::get_affine_iv(Value *val, AffineIV &iv, int depth)
+{
+    auto phi = dynamic_cast<PhiInst *>(val);
+    if (phi && get_basic_iv(phi))
+    {
+        iv = {phi, 1, nullptr, 0};
+        return true;
+    }
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (depth >= MAX_IV_DEPTH || !instr || !loop_->contains(instr->get_parent()) || instr->get_num_operand() != 2)
+        return false;
+
+    auto lhs = instr->get_operand(0);
+    auto rhs = instr->get_operand(1);
+    if (instr->is_add())
+    {
+        if (get_affine_iv(lhs, iv, depth + 1))
+            return add_offset(iv, rhs);
+        if (get_affine_iv(rhs, iv, depth + 1))
+            return add_offset(iv, lhs);
+    }
+    else if (instr->is_sub())
+    {
+        if (CONST_INT(rhs) && get_affine_iv(lhs, iv, depth + 1))
+        {
+            iv.offset = wrap(iv.offset, -(unsigned)CONST_INT(rhs)->get_value());
+            return true;
+        }
+    }
+    else if (instr->is_mul() || instr->is_shl())
+    {
+        if (instr->is_mul() && CONST_INT(lhs))
+            std::swap(lhs, rhs);
+        auto factor = CONST_INT(rhs);
+        if (!factor || (instr->is_shl() && (factor->get_value() < 0 || factor->get_value() > 30)))
+            return false;
+        int scale = instr->is_mul() ? factor->get_value() : 1 << factor->get_value();
+        if (get_affine_iv(lhs, iv, depth + 1) && !iv.offset_val)
+        {
+            iv.scale = (unsigned)iv.scale * (unsigned)scale;
+            iv.offset = (unsigned)iv.offset * (unsigned)scale;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool InductionVars::add_offset(AffineIV &iv, Value *val)
+{
+    if (CONST_INT(val))
+    {
+        iv.offset = wrap(iv.offset, CONST_INT(val)->get_value());
+        return true;
+    }
+    if (iv.offset_val || !is_invariant(val))
+        return false;
+    iv.offset_val = val;
+    return true;
+}
+
+bool InductionVars::is_invariant(Value *val)
+{
+    return is_invariant(val, 0);
+}
+
+bool InductionVars::is_invariant(Value *val, int depth)
+{
+    if (dynamic_cast<Constant *>(val) || dynamic_cast<Argument *>(val) || dynamic_cast<GlobalVariable *>(val))
+        return true;
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (!instr)
+        return false;
+    if (!loop_->contains(instr->get_parent()))
+        return true;
+
+    // an operation in the loop can be hoisted if it has no side effect and can't trap
+    if (!entry_ || depth >= MAX_IV_DEPTH)
+        return false;
+    bool is_pure = (instr->is_int_instr() && !instr->is_div() && !instr->is_rem()) || instr->is_cmp() || instr->is_zext();
+    if (!is_pure)
+        return false;
+    for (auto op : instr->get_operands())
+    {
+        if (!is_invariant(op, depth + 1))
+            return false;
+    }
+    return true;
+}
+
+void InductionVars::hoist(Value *val)
+{
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (!instr || !loop_->contains(instr->get_parent()))
+        return;
+    for (auto op : instr->get_operands())
+    {
+        hoist(op);
+    }
+    instr->get_parent()->get_instructions().remove(instr);
+    entry_->add_instr_before(instr, entry_->get_terminator());
+}
+
+bool InductionVars::get_loop_bound(LoopBound &bound)
+{
+    // step 1: the header branches into and out of the loop on a compare
+    auto header = loop_->get_header();
+    auto br = header->get_terminator();
+    if (!entry_ || !br || !br->is_br() || br->get_num_operand() != 3)
+        return false;
+    bound.cond = dynamic_cast<CmpInst *>(br->get_operand(0));
+    if (!bound.cond)
+        return false;
+    auto if_true = static_cast<BasicBlock *>(br->get_operand(1));
+    auto if_false = static_cast<BasicBlock *>(br->get_operand(2));
+    bound.op = bound.cond->get_cmp_op();
+    if (loop_->contains(if_true) && !loop_->contains(if_false))
+    {
+        bound.body = if_true;
+        bound.exit = if_false;
+    }
+    else if (loop_->contains(if_false) && !loop_->contains(if_true))
+    {
+        bound.body = if_false;
+        bound.exit = if_true;
+        bound.op = negate(bound.op);
+    }
+    else
+    {
+        return false;
+    }
+
+    // step 2: the compare is "iv op bound" or "bound op iv"
+    auto lhs = dynamic_cast<PhiInst *>(bound.cond->get_operand(0));
+    auto rhs = dynamic_cast<PhiInst *>(bound.cond->get_operand(1));
+    bound.iv = nullptr;
+    if (lhs && get_basic_iv(lhs))
+    {
+        bound.iv = get_basic_iv(lhs);
+        bound.bound = bound.cond->get_operand(1);
+    }
+    else if (rhs && get_basic_iv(rhs))
+    {
+        bound.iv = get_basic_iv(rhs);
+        bound.bound = bound.cond->get_operand(0);
+        bound.op = swap_operands(bound.op);
+    }
+    if (!bound.iv || bound.iv->step == 0 || !is_invariant(bound.bound))
+        return false;
+    hoist(bound.bound);
+    return true;
+}
+
+Value *InductionVars::get_gep_index(Instruction *gep)
+{
+    bool is_array = gep->get_num_operand() == 3 && CONST_INT(gep->get_operand(1)) &&
+                    CONST_INT(gep->get_operand(1))->get_value() == 0;
+    if (!is_array && gep->get_num_operand() != 2)
+        return nullptr;
+    return gep->get_operand(gep->get_num_operand() - 1);
+}
@@ -0,0 +1,257 @@
+#include "Inliner.hpp"
+#include "AnalysisManager.hpp"
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+// callees with more instructions than this are not inlined
+const int INLINE_THRESHOLD = 40;
+// calls in loops are worth more, since the call overhead is paid every iteration
+const int LOOP_INLINE_THRESHOLD = 120;
+// every constant argument will likely fold some instructions of the callee
+const int CONST_ARG_BONUS = 5;
+// stop inlining into a caller which grows too big
+const int MAX_CALLER_SIZE = 3000;
+
+void Inliner::run()
+{
+    call_graph_.reset(new CallGraph(m_));
+    call_graph_->run();
+
+    // step 1: find the calls in loops
+    for (auto f : call_graph_->get_bottom_up_order())
+    {
+        for (auto call : call_graph_->get_call_sites(f))
+        {
+            if (am_->get_loop_search(f)->get_inner_loop(call->get_parent()) != nullptr)
+            {
+                calls_in_loop_.insert(call);
+            }
+        }
+    }
+
+    // step 2: inline callees into callers, from the bottom of the call graph
+    for (auto f : call_graph_->get_bottom_up_order())
+    {
+        auto call_sites = call_graph_->get_call_sites(f);
+        for (auto call : call_sites)
+        {
+            auto callee = static_cast<Function *>(call->get_operand(0));
+            if (should_inline(call, callee))
+            {
+                inline_call(call, callee);
+                add_stat("calls inlined");
+            }
+        }
+    }
+}
+
+bool Inliner::should_inline(CallInst *call, Function *callee)
+{
+    auto caller = call->get_function();
+    // recursion guard: a recursive callee would be inlined into itself endlessly
+    if (callee->is_declaration() || callee == caller || call_graph_->is_recursive(callee))
+        return false;
+    if (get_func_size(caller) + get_func_size(callee) > MAX_CALLER_SIZE)
+        return false;
+
+    int cost = get_func_size(callee);
+    for (int i = 1; i < call->get_num_operand(); i++)
+    {
+        if (dynamic_cast<Constant *>(call->get_operand(i)))
+            cost -= CONST_ARG_BONUS;
+    }
+    bool in_loop = calls_in_loop_.find(call) != calls_in_loop_.end();
+    return cost <= (in_loop ? LOOP_INLINE_THRESHOLD : INLINE_THRESHOLD);
+}
+
+void Inliner::inline_call(CallInst *call, Function *callee)
+{
+    auto bb = call->get_parent();
+    auto caller = bb->get_parent();
+
+    // step 1: split bb after the call
+    auto next_bb = split_block_after(call);
+
+    // step 2: clone the blocks and instructions of callee, with arguments mapped to call operands
+    std::map<Value *, Value *> val_map;
+    int arg_no = 1;
+    for (auto arg : callee->get_args())
+    {
+        val_map[arg] = call->get_operand(arg_no++);
+    }
+    // only the reachable blocks are cloned, the unreachable ones would jump into the caller
+    std::vector<BasicBlock *> callee_bbs;
+    std::set<BasicBlock *> reachable;
+    callee_bbs.push_back(callee->get_entry_block());
+    reachable.insert(callee->get_entry_block());
+    for (int i = 0; i < callee_bbs.size(); i++)
+    {
+        for (auto succ_bb : callee_bbs[i]->get_succ_basic_blocks())
+        {
+            if (reachable.insert(succ_bb).second)
+                callee_bbs.push_back(succ_bb);
+        }
+    }
+    std::vector<BasicBlock *> new_bbs;
+    for (auto callee_bb : callee_bbs)
+    {
+        auto new_bb = BasicBlock::create(m_, "", caller);
+        val_map[callee_bb] = new_bb;
+        new_bbs.push_back(new_bb);
+    }
+    std::vector<Instruction *> new_instrs;
+    bool in_loop = calls_in_loop_.find(call) != calls_in_loop_.end();
+    for (auto callee_bb : callee_bbs)
+    {
+        auto new_bb = static_cast<BasicBlock *>(val_map[callee_bb]);
+        for (auto instr : callee_bb->get_instructions())
+        {
+            auto new_instr = instr->copy_inst(new_bb);
+            val_map[instr] = new_instr;
+            new_instrs.push_back(new_instr);
+            if (in_loop && new_instr->is_call())
+                calls_in_loop_.insert(static_cast<CallInst *>(new_instr));
+        }
+        for (auto pre_bb : callee_bb->get_pre_basic_blocks())
+        {
+            if (reachable.find(pre_bb) != reachable.end())
+                new_bb->add_pre_basic_block(static_cast<BasicBlock *>(val_map[pre_bb]));
+        }
+        for (auto succ_bb : callee_bb->get_succ_basic_blocks())
+            new_bb->add_succ_basic_block(static_cast<BasicBlock *>(val_map[succ_bb]));
+    }
+    for (auto new_instr : new_instrs)
+    {
+        if (new_instr->is_phi())
+        {
+            // drop the incoming values from unreachable blocks
+            for (int i = new_instr->get_num_operand() - 2; i >= 0; i -= 2)
+            {
+                auto pre_bb = static_cast<BasicBlock *>(new_instr->get_operand(i + 1));
+                if (reachable.find(pre_bb) == reachable.end())
+                    new_instr->remove_operands(i, i + 1);
+            }
+        }
+        for (int i = 0; i < new_instr->get_num_operand(); i++)
+        {
+            auto iter = val_map.find(new_instr->get_operand(i));
+            if (iter != val_map.end())
+                new_instr->set_operand(i, iter->second);
+        }
+    }
+
+    // step 3: turn returns into branches to next_bb, the returned values meet in a phi
+    std::vector<std::pair<Value *, BasicBlock *>> ret_vals;
+    for (auto new_bb : new_bbs)
+    {
+        auto terminator = new_bb->get_terminator();
+        if (terminator && terminator->is_ret())
+        {
+            if (!static_cast<ReturnInst *>(terminator)->is_void_ret())
+                ret_vals.push_back({terminator->get_operand(0), new_bb});
+            new_bb->delete_instr(terminator);
+            BranchInst::create_br(next_bb, new_bb);
+        }
+    }
+    Value *ret_val = nullptr;
+    if (!call->is_void())
+    {
+        if (ret_vals.size() == 1)
+        {
+            ret_val = ret_vals[0].first;
+        }
+        else if (ret_vals.empty())
+        {
+            // callee never returns, so next_bb is unreachable
+            ret_val = ConstantZero::get(call->get_type(), m_);
+        }
+        else
+        {
+            auto phi = PhiInst::create_phi(call->get_type(), next_bb);
+            for (auto &pair : ret_vals)
+                phi->add_phi_pair_operand(pair.first, pair.second);
+            next_bb->add_instr_begin(phi);
+            ret_val = phi;
+        }
+    }
+
+    // step 4: move allocas to the entry of caller, so that a call in a loop doesn't allocate every iteration
+    auto entry_bb = caller->get_entry_block();
+    for (auto new_bb : new_bbs)
+    {
+        auto instrs = new_bb->get_instructions();
+        for (auto instr : instrs)
+        {
+            if (instr->is_alloca())
+            {
+                new_bb->get_instructions().remove(instr);
+                entry_bb->add_instr_begin(instr);
+                instr->set_parent(entry_bb);
+            }
+        }
+    }
+
+    // step 5: replace the call with a branch to the cloned entry
+    if (ret_val)
+        call->replace_all_use_with(ret_val);
+    bb->delete_instr(call);
+    BranchInst::create_br(new_bbs.front(), bb);
+
+    // keep the cloned blocks right after bb in the layout
+    auto &bbs = caller->get_basic_blocks();
+    new_bbs.push_back(next_bb);
+    for (auto new_bb : new_bbs)
+        bbs.remove(new_bb);
+    bbs.insert(std::next(std::find(bbs.begin(), bbs.end(), bb)), new_bbs.begin(), new_bbs.end());
+
+    func_size_[caller] += get_func_size(callee);
+}
+
+BasicBlock *Inliner::split_block_after(Instruction *instr)
+{
+    auto bb = instr->get_parent();
+    auto next_bb = BasicBlock::create(m_, "", bb->get_parent());
+    auto &instrs = bb->get_instructions();
+    auto iter = std::next(std::find(instrs.begin(), instrs.end(), instr));
+    while (iter != instrs.end())
+    {
+        auto moved_instr = *iter;
+        iter = instrs.erase(iter);
+        next_bb->add_instruction(moved_instr);
+        moved_instr->set_parent(next_bb);
+    }
+
+    // the successors of bb are reached from next_bb now
+    for (auto succ_bb : bb->get_succ_basic_blocks())
+    {
+        auto &pre_bbs = succ_bb->get_pre_basic_blocks();
+        std::replace(pre_bbs.begin(), pre_bbs.end(), bb, next_bb);
+        for (auto succ_instr : succ_bb->get_instructions())
+        {
+            if (!succ_instr->is_phi())
+                break;
+            for (int i = 1; i < succ_instr->get_num_operand(); i += 2)
+            {
+                if (succ_instr->get_operand(i) == bb)
+                    succ_instr->set_operand(i, next_bb);
+            }
+        }
+    }
+    next_bb->get_succ_basic_blocks() = bb->get_succ_basic_blocks();
+    bb->get_succ_basic_blocks().clear();
+    return next_bb;
+}
+
+int Inliner::get_func_size(Function *f)
+{
+    if (func_size_.find(f) == func_size_.end())
+    {
+        int size = 0;
+        for (auto bb : f->get_basic_blocks())
+            size += bb->get_num_of_instr();
+        func_size_[f] = size;
+    }
+    return func_size_[f];
+}
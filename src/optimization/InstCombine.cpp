@@ -0,0 +1,640 @@
+#include "InstCombine.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <climits>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+#define CONST_FP(val) dynamic_cast<ConstantFP *>(val)
+#define IS_INT32(val) ((val)->get_type()->is_integer_type() && \
+                       static_cast<IntegerType *>((val)->get_type())->get_num_bits() == 32)
+
+// a float has a 24-bit significand, so integers with |x| < 2^24 convert exactly
+const int FLOAT_EXACT_BITS = 24;
+
+// whether val is a constant integer equal to c
+static bool is_const_int(Value *val, int c)
+{
+    auto const_val = CONST_INT(val);
+    return const_val && const_val->get_value() == c;
+}
+
+// constants are not uniqued, so compare them by value
+static bool is_same_value(Value *lhs, Value *rhs)
+{
+    if (CONST_INT(lhs) && CONST_INT(rhs))
+        return CONST_INT(lhs)->get_value() == CONST_INT(rhs)->get_value();
+    return lhs == rhs;
+}
+
+// return k if c == 2^k (k >= 0), otherwise -1
+static int log2_of(int c)
+{
+    if (c <= 0 || (c & (c - 1)) != 0)
+        return -1;
+    int k = 0;
+    while ((1 << k) != c)
+        k++;
+    return k;
+}
+
+// the number of bits needed by |c|
+static int bits_of(long long c)
+{
+    c = c < 0 ? -c : c;
+    int bits = 0;
+    while (bits < 32 && (c >> bits) != 0)
+        bits++;
+    return bits;
+}
+
+// an upper bound of the bits needed by |val|, i.e. -2^bits < val < 2^bits
+static int magnitude_bits(Value *val, int depth = 0)
+{
+    if (auto const_val = CONST_INT(val))
+        return bits_of(const_val->get_value());
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (instr == nullptr || depth > 4)
+        return 32;
+    if (instr->is_zext())
+        return static_cast<IntegerType *>(instr->get_operand(0)->get_type())->get_num_bits();
+    if (instr->is_and())
+    {
+        // and with a non-negative constant is in [0, c]
+        for (auto op : instr->get_operands())
+            if (CONST_INT(op) && CONST_INT(op)->get_value() >= 0)
+                return bits_of(CONST_INT(op)->get_value());
+    }
+    if (instr->is_rem() && CONST_INT(instr->get_operand(1)))
+        return bits_of(CONST_INT(instr->get_operand(1))->get_value());
+    if (instr->is_ashr() && CONST_INT(instr->get_operand(1)))
+    {
+        int k = CONST_INT(instr->get_operand(1))->get_value();
+        if (k >= 0 && k < 32)
+            return 31 - k;
+    }
+    if (instr->is_add() || instr->is_sub())
+    {
+        int bits = std::max(magnitude_bits(instr->get_operand(0), depth + 1),
+                            magnitude_bits(instr->get_operand(1), depth + 1)) + 1;
+        return std::min(bits, 32);
+    }
+    return 32;
+}
+
+// the integer x if val is (sitofp x) or an integral float constant, and the bits needed by |x|
+// (-0.0 is not the float of an integer)
+static Value *int_source(Value *val, int &bits, Module *m)
+{
+    if (auto si2fp = dynamic_cast<SiToFpInst *>(val))
+    {
+        bits = magnitude_bits(si2fp->get_operand(0));
+        return si2fp->get_operand(0);
+    }
+    if (auto const_val = CONST_FP(val))
+    {
+        float c = const_val->get_value();
+        // the range is checked first, the cast of nan, inf or a float out of the int range is undefined
+        if (std::fabs(c) < (float)(1 << FLOAT_EXACT_BITS) && c == (float)(int)c && !(c == 0.0f && std::signbit(c)))
+        {
+            bits = bits_of((int)c);
+            return ConstantInt::get((int)c, m);
+        }
+    }
+    return nullptr;
+}
+
+static CmpInst::CmpOp swap_cmp_op(CmpInst::CmpOp op)
+{
+    switch (op)
+    {
+        case CmpInst::LT: return CmpInst::GT;
+        case CmpInst::LE: return CmpInst::GE;
+        case CmpInst::GT: return CmpInst::LT;
+        case CmpInst::GE: return CmpInst::LE;
+        default: return op;
+    }
+}
+
+static CmpInst::CmpOp inverse_cmp_op(CmpInst::CmpOp op)
+{
+    switch (op)
+    {
+        case CmpInst::EQ: return CmpInst::NE;
+        case CmpInst::NE: return CmpInst::EQ;
+        case CmpInst::LT: return CmpInst::GE;
+        case CmpInst::LE: return CmpInst::GT;
+        case CmpInst::GT: return CmpInst::LE;
+        default: return CmpInst::LT;
+    }
+}
+
+static bool eval_cmp(CmpInst::CmpOp op, int l, int r)
+{
+    switch (op)
+    {
+        case CmpInst::EQ: return l == r;
+        case CmpInst::NE: return l != r;
+        case CmpInst::LT: return l < r;
+        case CmpInst::LE: return l <= r;
+        case CmpInst::GT: return l > r;
+        default: return l >= r;
+    }
+}
+
+// all fcmp predicates are unordered, i.e. true if either operand is NaN
+static bool eval_fcmp(FCmpInst::CmpOp op, float l, float r)
+{
+    switch (op)
+    {
+        case FCmpInst::EQ: return !(l < r || l > r);
+        case FCmpInst::NE: return !(l == r);
+        case FCmpInst::LT: return !(l >= r);
+        case FCmpInst::LE: return !(l > r);
+        case FCmpInst::GT: return !(l <= r);
+        default: return !(l < r);
+    }
+}
+
+void InstCombine::run_on_function(Function *func)
+{
+    worklist_.clear();
+    in_worklist_.clear();
+    erased_.clear();
+
+    // step 1: push all the instructions in reverse order, so that they are popped in order
+    auto &bbs = func->get_basic_blocks();
+    for (auto bb_iter = bbs.rbegin(); bb_iter != bbs.rend(); bb_iter++)
+    {
+        auto &instrs = (*bb_iter)->get_instructions();
+        for (auto instr_iter = instrs.rbegin(); instr_iter != instrs.rend(); instr_iter++)
+        {
+            add_to_worklist(*instr_iter);
+        }
+    }
+
+    // step 2: combine instructions until the worklist is empty, i.e. a fixed point is reached
+    while (!worklist_.empty())
+    {
+        auto instr = worklist_.back();
+        worklist_.pop_back();
+        in_worklist_.erase(instr);
+        if (erased_.find(instr) != erased_.end())
+            continue;
+
+        if (is_trivially_dead(instr))
+        {
+            erase(instr);
+            add_stat("dead instructions deleted");
+            continue;
+        }
+
+        pos_ = instr;
+        auto new_val = combine(instr);
+        if (new_val == nullptr || new_val == instr)
+            continue;
+
+        // step 3: the users of instr may be simplified further after replacement
+        add_users_to_worklist(instr);
+        instr->replace_all_use_with(new_val);
+        add_to_worklist(new_val);
+        erase(instr);
+        add_stat("instructions combined");
+    }
+}
+
+Value *InstCombine::combine(Instruction *instr)
+{
+    if (instr->isBinary() && instr->is_int_instr())
+        return combine_int_binary(static_cast<BinaryInst *>(instr));
+    if (instr->isBinary() && instr->is_fp_instr())
+        return combine_fp_binary(static_cast<BinaryInst *>(instr));
+    if (instr->is_cmp())
+        return combine_cmp(static_cast<CmpInst *>(instr));
+    if (instr->is_fcmp())
+        return combine_fcmp(static_cast<FCmpInst *>(instr));
+    if (instr->is_zext() || instr->is_fp2si() || instr->is_si2fp())
+        return combine_cast(instr);
+    if (instr->is_phi())
+        return combine_phi(static_cast<PhiInst *>(instr));
+    return nullptr;
+}
+
+Value *InstCombine::combine_int_binary(BinaryInst *instr)
+{
+    if (!IS_INT32(instr))
+        return nullptr;
+    auto op = instr->get_instr_type();
+    auto lhs = instr->get_operand(0);
+    auto rhs = instr->get_operand(1);
+    auto const_l = CONST_INT(lhs);
+    auto const_r = CONST_INT(rhs);
+
+    // constant folding, with two's complement wrap around
+    if (const_l && const_r)
+    {
+        int l = const_l->get_value();
+        int r = const_r->get_value();
+        uint32_t ul = l, ur = r;
+        switch (op)
+        {
+            case Instruction::add: return ConstantInt::get((int)(ul + ur), m_);
+            case Instruction::sub: return ConstantInt::get((int)(ul - ur), m_);
+            case Instruction::mul: return ConstantInt::get((int)(ul * ur), m_);
+            case Instruction::and_: return ConstantInt::get(l & r, m_);
+            case Instruction::or_: return ConstantInt::get(l | r, m_);
+            case Instruction::xor_: return ConstantInt::get(l ^ r, m_);
+            case Instruction::sdiv:
+            case Instruction::srem:
+                // leave the undefined cases to run time
+                if (r == 0 || (l == INT_MIN && r == -1))
+                    return nullptr;
+                return ConstantInt::get(op == Instruction::sdiv ? l / r : l % r, m_);
+            case Instruction::shl:
+            case Instruction::ashr:
+                if (r < 0 || r >= 32)
+                    return nullptr;
+                return ConstantInt::get(op == Instruction::shl ? (int)(ul << r) : l >> r, m_);
+            default:
+                return nullptr;
+        }
+    }
+
+    // canonicalize commutative operators so that the constant is on the right
+    bool is_commutative = instr->is_add() || instr->is_mul() ||
+                          instr->is_and() || instr->is_or() || instr->is_xor();
+    if (is_commutative && const_l && !const_r)
+        return insert_binary(op, rhs, lhs);
+
+    switch (op)
+    {
+        case Instruction::add:
+        {
+            // x + 0 => x
+            if (is_const_int(rhs, 0))
+                return lhs;
+            // (x + c1) + c2 => x + (c1 + c2)
+            auto inner = dynamic_cast<BinaryInst *>(lhs);
+            if (const_r && inner && inner->is_add() && CONST_INT(inner->get_operand(1)))
+            {
+                uint32_t c = (uint32_t)CONST_INT(inner->get_operand(1))->get_value() + (uint32_t)const_r->get_value();
+                return insert_binary(Instruction::add, inner->get_operand(0), ConstantInt::get((int)c, m_));
+            }
+            break;
+        }
+        case Instruction::sub:
+        {
+            // x - 0 => x
+            if (is_const_int(rhs, 0))
+                return lhs;
+            // x - x => 0
+            if (lhs == rhs)
+                return ConstantInt::get(0, m_);
+            // x - c => x + (-c), so that it can be reassociated with other adds
+            if (const_r)
+                return insert_binary(Instruction::add, lhs, ConstantInt::get((int)(0u - (uint32_t)const_r->get_value()), m_));
+            // x - (x sdiv y) * y => x srem y
+            auto mul = dynamic_cast<BinaryInst *>(rhs);
+            if (mul && mul->is_mul())
+            {
+                for (int i = 0; i < 2; i++)
+                {
+                    auto div = dynamic_cast<BinaryInst *>(mul->get_operand(i));
+                    auto y = mul->get_operand(1 - i);
+                    if (div && div->is_div() && div->get_operand(0) == lhs && is_same_value(div->get_operand(1), y))
+                        return insert_binary(Instruction::srem, lhs, y);
+                }
+            }
+            break;
+        }
+        case Instruction::mul:
+        {
+            // x * 0 => 0, x * 1 => x, x * -1 => 0 - x
+            if (is_const_int(rhs, 0))
+                return rhs;
+            if (is_const_int(rhs, 1))
+                return lhs;
+            if (is_const_int(rhs, -1))
+                return insert_binary(Instruction::sub, ConstantInt::get(0, m_), lhs);
+            // x * 2^k => x shl k
+            if (const_r && log2_of(const_r->get_value()) > 0)
+                return insert_binary(Instruction::shl, lhs, ConstantInt::get(log2_of(const_r->get_value()), m_));
+            // (x * c1) * c2 => x * (c1 * c2)
+            auto inner = dynamic_cast<BinaryInst *>(lhs);
+            if (const_r && inner && inner->is_mul() && CONST_INT(inner->get_operand(1)))
+            {
+                uint32_t c = (uint32_t)CONST_INT(inner->get_operand(1))->get_value() * (uint32_t)const_r->get_value();
+                return insert_binary(Instruction::mul, inner->get_operand(0), ConstantInt::get((int)c, m_));
+            }
+            break;
+        }
+        case Instruction::sdiv:
+        {
+            // x sdiv 1 => x, x sdiv -1 => 0 - x
+            if (is_const_int(rhs, 1))
+                return lhs;
+            if (is_const_int(rhs, -1))
+                return insert_binary(Instruction::sub, ConstantInt::get(0, m_), lhs);
+            // x sdiv 2^k => (x + bias) ashr k, the bias rounds negative x towards zero
+            int k = const_r ? log2_of(const_r->get_value()) : -1;
+            if (k > 0)
+            {
+                auto sign = insert_binary(Instruction::ashr, lhs, ConstantInt::get(31, m_));
+                auto bias = insert_binary(Instruction::and_, sign, ConstantInt::get((1 << k) - 1, m_));
+                auto sum = insert_binary(Instruction::add, lhs, bias);
+                return insert_binary(Instruction::ashr, sum, ConstantInt::get(k, m_));
+            }
+            break;
+        }
+        case Instruction::srem:
+        {
+            // x srem 1 => 0, x srem -1 => 0
+            if (is_const_int(rhs, 1) || is_const_int(rhs, -1))
+                return ConstantInt::get(0, m_);
+            // x srem 2^k => x - ((x + bias) and -2^k)
+            int k = const_r ? log2_of(const_r->get_value()) : -1;
+            if (k > 0)
+            {
+                auto sign = insert_binary(Instruction::ashr, lhs, ConstantInt::get(31, m_));
+                auto bias = insert_binary(Instruction::and_, sign, ConstantInt::get((1 << k) - 1, m_));
+                auto sum = insert_binary(Instruction::add, lhs, bias);
+                auto rounded = insert_binary(Instruction::and_, sum, ConstantInt::get(-(1 << k), m_));
+                return insert_binary(Instruction::sub, lhs, rounded);
+            }
+            break;
+        }
+        case Instruction::shl:
+        case Instruction::ashr:
+            // x shift 0 => x, 0 shift x => 0
+            if (is_const_int(rhs, 0) || is_const_int(lhs, 0))
+                return lhs;
+            break;
+        case Instruction::and_:
+            // x and 0 => 0, x and -1 => x, x and x => x
+            if (is_const_int(rhs, 0))
+                return rhs;
+            if (is_const_int(rhs, -1) || lhs == rhs)
+                return lhs;
+            break;
+        case Instruction::or_:
+            // x or 0 => x, x or -1 => -1, x or x => x
+            if (is_const_int(rhs, 0) || lhs == rhs)
+                return lhs;
+            if (is_const_int(rhs, -1))
+                return rhs;
+            break;
+        case Instruction::xor_:
+            // x xor 0 => x, x xor x => 0
+            if (is_const_int(rhs, 0))
+                return lhs;
+            if (lhs == rhs)
+                return ConstantInt::get(0, m_);
+            break;
+        default:
+            break;
+    }
+    return nullptr;
+}
+
+Value *InstCombine::combine_fp_binary(BinaryInst *instr)
+{
+    auto lhs = instr->get_operand(0);
+    auto rhs = instr->get_operand(1);
+    auto const_l = CONST_FP(lhs);
+    auto const_r = CONST_FP(rhs);
+
+    // constant folding
+    if (const_l && const_r)
+    {
+        float l = const_l->get_value();
+        float r = const_r->get_value();
+        switch (instr->get_instr_type())
+        {
+            case Instruction::fadd: return ConstantFP::get(l + r, m_);
+            case Instruction::fsub: return ConstantFP::get(l - r, m_);
+            case Instruction::fmul: return ConstantFP::get(l * r, m_);
+            case Instruction::fdiv: return ConstantFP::get(l / r, m_);
+            default: return nullptr;
+        }
+    }
+
+    // canonicalize fadd and fmul so that the constant is on the right
+    if ((instr->is_fadd() || instr->is_fmul()) && const_l && !const_r)
+    {
+        auto bb = pos_->get_parent();
+        auto new_instr = instr->is_fadd() ? BinaryInst::create_fadd(rhs, lhs, bb, m_)
+                                          : BinaryInst::create_fmul(rhs, lhs, bb, m_);
+        return insert_before_pos(new_instr);
+    }
+
+    // x fmul 1.0 => x, x fdiv 1.0 => x, x fsub 0.0 => x, x fadd -0.0 => x
+    // (x fadd 0.0 is not x when x is -0.0)
+    if (const_r)
+    {
+        float r = const_r->get_value();
+        if ((instr->is_fmul() || instr->is_fdiv()) && r == 1.0f)
+            return lhs;
+        if (instr->is_fsub() && r == 0.0f && !std::signbit(r))
+            return lhs;
+        if (instr->is_fadd() && r == 0.0f && std::signbit(r))
+            return lhs;
+    }
+
+    // (sitofp a) op (sitofp b) => sitofp (a op b), if a op b is exact in float
+    // (not for fmul, 0 times a negative is -0.0 in float but 0 in int)
+    int bits_a = 32, bits_b = 32;
+    auto a = int_source(lhs, bits_a, m_);
+    auto b = int_source(rhs, bits_b, m_);
+    if (a && b && (instr->is_fadd() || instr->is_fsub()))
+    {
+        if (std::max(bits_a, bits_b) < FLOAT_EXACT_BITS)
+        {
+            auto op = instr->is_fadd() ? Instruction::add : Instruction::sub;
+            auto int_result = insert_binary(op, a, b);
+            auto new_instr = SiToFpInst::create_sitofp(int_result, instr->get_type(), pos_->get_parent());
+            return insert_before_pos(new_instr);
+        }
+    }
+    return nullptr;
+}
+
+Value *InstCombine::combine_cmp(CmpInst *instr)
+{
+    auto op = instr->get_cmp_op();
+    auto lhs = instr->get_operand(0);
+    auto rhs = instr->get_operand(1);
+    auto const_l = CONST_INT(lhs);
+    auto const_r = CONST_INT(rhs);
+
+    // constant folding
+    if (const_l && const_r)
+        return ConstantInt::get(eval_cmp(op, const_l->get_value(), const_r->get_value()), m_);
+
+    // x op x
+    if (lhs == rhs)
+        return ConstantInt::get(op == CmpInst::EQ || op == CmpInst::LE || op == CmpInst::GE, m_);
+
+    // canonicalize so that the constant is on the right
+    if (const_l && !const_r)
+        return insert_before_pos(CmpInst::create_cmp(swap_cmp_op(op), rhs, lhs, pos_->get_parent(), m_));
+
+    // icmp ne (zext i1 c to i32), 0 => c, which is generated by every if and while
+    auto zext = dynamic_cast<ZextInst *>(lhs);
+    if (zext && const_r && (op == CmpInst::EQ || op == CmpInst::NE))
+    {
+        auto cond = zext->get_operand(0);
+        int c = const_r->get_value();
+        if (c != 0 && c != 1)
+            return ConstantInt::get(op == CmpInst::NE, m_);
+        // (zext c) != 0 and (zext c) == 1 are c itself
+        if ((op == CmpInst::NE) == (c == 0))
+            return cond;
+        // otherwise it is the inverse of c
+        auto cond_cmp = dynamic_cast<CmpInst *>(cond);
+        if (cond_cmp)
+        {
+            auto new_instr = CmpInst::create_cmp(inverse_cmp_op(cond_cmp->get_cmp_op()), cond_cmp->get_operand(0),
+                                                 cond_cmp->get_operand(1), pos_->get_parent(), m_);
+            return insert_before_pos(new_instr);
+        }
+    }
+    return nullptr;
+}
+
+Value *InstCombine::combine_fcmp(FCmpInst *instr)
+{
+    auto op = instr->get_cmp_op();
+    auto lhs = instr->get_operand(0);
+    auto rhs = instr->get_operand(1);
+    auto const_l = CONST_FP(lhs);
+    auto const_r = CONST_FP(rhs);
+
+    // constant folding
+    if (const_l && const_r)
+        return ConstantInt::get(eval_fcmp(op, const_l->get_value(), const_r->get_value()), m_);
+
+    // fcmp (sitofp a), (sitofp b) => icmp a, b, if both conversions are exact
+    // a converted integer is never NaN, so the unordered predicates are the plain ones
+    int bits_a = 32, bits_b = 32;
+    auto a = int_source(lhs, bits_a, m_);
+    auto b = int_source(rhs, bits_b, m_);
+    if (a && b && bits_a <= FLOAT_EXACT_BITS && bits_b <= FLOAT_EXACT_BITS)
+    {
+        auto int_op = static_cast<CmpInst::CmpOp>(op);
+        return insert_before_pos(CmpInst::create_cmp(int_op, a, b, pos_->get_parent(), m_));
+    }
+    return nullptr;
+}
+
+Value *InstCombine::combine_cast(Instruction *instr)
+{
+    auto val = instr->get_operand(0);
+    if (instr->is_zext())
+    {
+        if (CONST_INT(val))
+            return ConstantInt::get(CONST_INT(val)->get_value() != 0 ? 1 : 0, m_);
+    }
+    else if (instr->is_si2fp())
+    {
+        if (CONST_INT(val))
+            return ConstantFP::get((float)CONST_INT(val)->get_value(), m_);
+    }
+    else if (instr->is_fp2si())
+    {
+        // out of range conversions are undefined, leave them to run time
+        auto const_val = CONST_FP(val);
+        if (const_val && const_val->get_value() > (float)INT_MIN && const_val->get_value() < -(float)INT_MIN)
+            return ConstantInt::get((int)const_val->get_value(), m_);
+        // fptosi (sitofp x) => x, which CminusfBuilder emits for mixed int/float expressions
+        auto si2fp = dynamic_cast<SiToFpInst *>(val);
+        if (si2fp && IS_INT32(instr) && magnitude_bits(si2fp->get_operand(0)) <= FLOAT_EXACT_BITS)
+            return si2fp->get_operand(0);
+    }
+    return nullptr;
+}
+
+Value *InstCombine::combine_phi(PhiInst *instr)
+{
+    // phi [x, bb1], [x, bb2], ..., [phi, bbn] => x,
+    // only if every predecessor has an entry, otherwise x may not dominate the phi
+    Value *same_val = nullptr;
+    for (int i = 0; i < instr->get_num_operand(); i += 2)
+    {
+        auto val = instr->get_operand(i);
+        if (val == instr || val == same_val)
+            continue;
+        if (same_val != nullptr)
+            return nullptr;
+        same_val = val;
+    }
+    auto &pre_bbs = instr->get_parent()->get_pre_basic_blocks();
+    for (auto pre_bb : pre_bbs)
+    {
+        auto &ops = instr->get_operands();
+        if (std::find(ops.begin(), ops.end(), static_cast<Value *>(pre_bb)) == ops.end())
+            return nullptr;
+    }
+    return same_val;
+}
+
+BinaryInst *InstCombine::insert_binary(Instruction::OpID op, Value *lhs, Value *rhs)
+{
+    auto bb = pos_->get_parent();
+    BinaryInst *instr = nullptr;
+    switch (op)
+    {
+        case Instruction::add: instr = BinaryInst::create_add(lhs, rhs, bb, m_); break;
+        case Instruction::sub: instr = BinaryInst::create_sub(lhs, rhs, bb, m_); break;
+        case Instruction::mul: instr = BinaryInst::create_mul(lhs, rhs, bb, m_); break;
+        case Instruction::sdiv: instr = BinaryInst::create_sdiv(lhs, rhs, bb, m_); break;
+        case Instruction::srem: instr = BinaryInst::create_srem(lhs, rhs, bb, m_); break;
+        case Instruction::shl: instr = BinaryInst::create_shl(lhs, rhs, bb, m_); break;
+        case Instruction::ashr: instr = BinaryInst::create_ashr(lhs, rhs, bb, m_); break;
+        case Instruction::and_: instr = BinaryInst::create_and(lhs, rhs, bb, m_); break;
+        case Instruction::or_: instr = BinaryInst::create_or(lhs, rhs, bb, m_); break;
+        case Instruction::xor_: instr = BinaryInst::create_xor(lhs, rhs, bb, m_); break;
+        default: assert(false && "not an integer binary operator"); break;
+    }
+    insert_before_pos(instr);
+    return instr;
+}
+
+// instructions are created at the end of bb, move the new one before pos_
+Instruction *InstCombine::insert_before_pos(Instruction *instr)
+{
+    auto bb = pos_->get_parent();
+    assert(bb->get_instructions().back() == instr);
+    bb->get_instructions().pop_back();
+    bb->add_instr_before(instr, pos_);
+    return instr;
+}
+
+void InstCombine::add_to_worklist(Value *val)
+{
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (instr && in_worklist_.insert(instr).second)
+        worklist_.push_back(instr);
+}
+
+void InstCombine::add_users_to_worklist(Value *val)
+{
+    for (auto use : val->get_use_list())
+        add_to_worklist(use.val_);
+}
+
+void InstCombine::erase(Instruction *instr)
+{
+    // the operands may become dead after instr is deleted
+    for (auto op : instr->get_operands())
+        add_to_worklist(op);
+    instr->get_parent()->delete_instr(instr);
+    erased_.insert(instr);
+}
+
+bool InstCombine::is_trivially_dead(Instruction *instr)
+{
+    if (!instr->get_use_list().empty())
+        return false;
+    return !(instr->is_store() || instr->is_call() || instr->isTerminator());
+}
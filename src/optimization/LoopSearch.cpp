@@ -1,321 +1,284 @@
 #include "LoopSearch.hpp"
+#include <algorithm>
 #include <iostream>
 #include <unordered_set>
 #include <fstream>
 #include "logging.hpp"
 
-struct CFGNode
+BasicBlock *Loop::get_preheader()
 {
-    std::unordered_set<CFGNodePtr> succs;
-    std::unordered_set<CFGNodePtr> prevs;
-    BasicBlock *bb;
-    int index;   // the index of the node in CFG
-    int lowlink; // the min index of the node in the strongly connected componets
-    bool onStack;
-};
-
-// build control flow graph used in loop search pass
-void LoopSearch::build_cfg(Function *func, std::unordered_set<CFGNode *> &result)
-{
-    std::unordered_map<BasicBlock *, CFGNode *> bb2cfg_node;
-    for (auto bb : func->get_basic_blocks())
-    {
-        auto node = new CFGNode;
-        node->bb = bb;
-        node->index = node->lowlink = -1;
-        node->onStack = false;
-        bb2cfg_node.insert({bb, node});
-
-        result.insert(node);
-    }
-    for (auto bb : func->get_basic_blocks())
+    BasicBlock *preheader = nullptr;
+    for (auto pred : header_->get_pre_basic_blocks())
     {
-        auto node = bb2cfg_node[bb];
-        std::string succ_string = "success node: ";
-        for (auto succ : bb->get_succ_basic_blocks())
-        {
-            succ_string = succ_string + succ->get_name() + " ";
-            node->succs.insert(bb2cfg_node[succ]);
-        }
-        std::string prev_string = "previous node: ";
-        for (auto prev : bb->get_pre_basic_blocks())
-        {
-            prev_string = prev_string + prev->get_name() + " ";
-            node->prevs.insert(bb2cfg_node[prev]);
-        }
+        if (contains(pred))
+            continue;
+        if (preheader && preheader != pred)
+            return nullptr;
+        preheader = pred;
     }
+    if (preheader && preheader->get_succ_basic_blocks().size() != 1)
+        return nullptr;
+    return preheader;
 }
 
-// Tarjan algorithm
-// reference: https://baike.baidu.com/item/tarjan%E7%AE%97%E6%B3%95/10687825?fr=aladdin
-bool LoopSearch::strongly_connected_components(
-    CFGNodePtrSet &nodes,
-    std::unordered_set<CFGNodePtrSet *> &result)
+std::vector<BasicBlock *> Loop::get_latches()
 {
-    index_count = 0;
-    stack.clear();
-    for (auto n : nodes)
+    std::vector<BasicBlock *> latches;
+    for (auto pred : header_->get_pre_basic_blocks())
     {
-        if (n->index == -1)
-            traverse(n, result);
+        if (contains(pred) && std::find(latches.begin(), latches.end(), pred) == latches.end())
+            latches.push_back(pred);
     }
-    return result.size() != 0;
+    return latches;
 }
-void LoopSearch::traverse(
-    CFGNodePtr n,
-    std::unordered_set<CFGNodePtrSet *> &result)
+
+BasicBlock *Loop::get_latch()
 {
-    n->index = index_count++;
-    n->lowlink = n->index;
-    stack.push_back(n);
-    n->onStack = true;
+    auto latches = get_latches();
+    return latches.size() == 1 ? latches.front() : nullptr;
+}
 
-    for (auto su : n->succs)
+std::vector<BasicBlock *> Loop::get_exit_blocks()
+{
+    std::vector<BasicBlock *> exits;
+    BBset_t visited;
+    for (auto bb : blocks_)
     {
-        // has not visited su
-        if (su->index == -1)
-        {
-            traverse(su, result);
-            n->lowlink = std::min(su->lowlink, n->lowlink);
-        }
-        // has visited su
-        else if (su->onStack)
+        for (auto succ : bb->get_succ_basic_blocks())
         {
-            n->lowlink = std::min(su->index, n->lowlink);
+            if (!contains(succ) && visited.insert(succ).second)
+                exits.push_back(succ);
         }
     }
+    return exits;
+}
 
-    // nodes that in the same strongly connected component will be popped out of stack
-    if (n->index == n->lowlink)
+std::vector<BasicBlock *> Loop::get_exiting_blocks()
+{
+    std::vector<BasicBlock *> exitings;
+    for (auto bb : blocks_)
     {
-        auto set = new CFGNodePtrSet;
-        CFGNodePtr tmp;
-        do
+        for (auto succ : bb->get_succ_basic_blocks())
         {
-            tmp = stack.back();
-            tmp->onStack = false;
-            set->insert(tmp);
-            stack.pop_back();
-        } while (tmp != n);
-        if (set->size() == 1)
-            delete set;
-        else
-            result.insert(set);
+            if (!contains(succ))
+            {
+                exitings.push_back(bb);
+                break;
+            }
+        }
     }
+    return exitings;
 }
-CFGNodePtr LoopSearch::find_loop_base(
-    CFGNodePtrSet *set,
-    CFGNodePtrSet &reserved)
+
+void LoopSearch::run_on_function(Function *func)
 {
+    if (func->get_basic_blocks().size() == 0)
+        return;
 
-    CFGNodePtr base = nullptr;
-    bool hadBeen = false;
-    for (auto n : *set)
+    // step 1: build cfg over the indices of the blocks
+    std::unordered_map<BasicBlock *, int> bb_index;
+    bbs_.clear();
+    for (auto bb : func->get_basic_blocks())
     {
-        for (auto prev : n->prevs)
-        {
-            if (set->find(prev) == set->end())
-            {
-                base = n;
-            }
-        }
+        bb_index[bb] = bbs_.size();
+        bbs_.push_back(bb);
     }
-    if (base != nullptr)
-        return base;
-    for (auto res : reserved)
+    int n = bbs_.size();
+    succs_.assign(n, {});
+    preds_.assign(n, {});
+    for (int i = 0; i < n; i++)
     {
-        for (auto succ : res->succs)
-        {
-            if (set->find(succ) != set->end())
-            {
-                base = succ;
-            }
-        }
+        for (auto succ : bbs_[i]->get_succ_basic_blocks())
+            succs_[i].push_back(bb_index[succ]);
+        for (auto pred : bbs_[i]->get_pre_basic_blocks())
+            preds_[i].push_back(bb_index[pred]);
     }
+    region_mark_.assign(n, 0);
+    index_.assign(n, -1);
+    lowlink_.assign(n, 0);
+    on_stack_.assign(n, false);
 
-    return base;
-}
-void LoopSearch::run()
-{
-    
-
-    auto func_list = m_->get_functions();
-    for (auto func : func_list)
+    // step 2: find strongly connected components from external to internal,
+    // a region is the set of nodes searched for the loops directly inside parent
+    struct Region
+    {
+        std::vector<int> nodes;
+        Loop *parent;
+    };
+    std::vector<Region> work_list;
+    work_list.push_back({std::vector<int>(n), nullptr});
+    for (int i = 0; i < n; i++)
+        work_list.back().nodes[i] = i;
+    int mark_count = 0;
+    while (!work_list.empty())
     {
+        auto region = std::move(work_list.back());
+        work_list.pop_back();
+        int mark = ++mark_count;
+        for (auto v : region.nodes)
+            region_mark_[v] = mark;
+        std::vector<std::vector<int>> sccs;
+        find_sccs(region.nodes, mark, sccs);
 
-        if (func->get_basic_blocks().size() == 0)
+        for (auto &scc : sccs)
         {
-            continue;
-        }
-        else
-        {
-            CFGNodePtrSet nodes;
-            CFGNodePtrSet reserved;
-            std::unordered_set<CFGNodePtrSet *> sccs;
-            
-            // step 1: build cfg
-            build_cfg(func, nodes);
-            // dump graph
-            dump_graph(nodes, func->get_name());
-            // step 2: find strongly connected graph from external to internal
-            int scc_index = 0;
-            while (strongly_connected_components(nodes, sccs))
-            {
+            // a single block is a loop only if it branches to itself
+            if (scc.size() == 1 && std::find(succs_[scc[0]].begin(), succs_[scc[0]].end(), scc[0]) == succs_[scc[0]].end())
+                continue;
 
-                if (sccs.size() == 0)
-                {
-                    
-                    break;
-                }
-                else
+            // step 3: find loop base node, which is entered from outside the component
+            std::sort(scc.begin(), scc.end());
+            int scc_mark = ++mark_count;
+            for (auto v : scc)
+                region_mark_[v] = scc_mark;
+            int base = -1;
+            for (auto v : scc)
+            {
+                for (auto pred : preds_[v])
                 {
-                    // step 3: find loop base node for each strongly connected graph
-
-                    for (auto scc : sccs)
+                    if (region_mark_[pred] != scc_mark)
                     {
-                        scc_index += 1;
-
-                        auto base = find_loop_base(scc, reserved);
-
-                        // step 4: store result
-                        auto bb_set = new BBset_t;
-                        std::string node_set_string = "";
-
-                        for (auto n : *scc)
-                        {
-                            bb_set->insert(n->bb);
-                            node_set_string = node_set_string + n->bb->get_name() + ',';
-                        }
-                        loop_set.insert(bb_set);
-                        func2loop[func].insert(bb_set);
-                        base2loop.insert({base->bb, bb_set});
-                        loop2base.insert({bb_set, base->bb});
-                        for (auto bb : *bb_set)
-                        {
-                            if (bb2base.find(bb) == bb2base.end())
-                            {
-                                bb2base.insert({bb, base->bb});
-                            }
-                            else
-                            {
-                                bb2base[bb] = base->bb;
-                            }
-                        }
-                        // step 5: map each node to loop base
-                        for (auto bb : *bb_set)
-                        {
-                            if (bb2base.find(bb) == bb2base.end())
-                                bb2base.insert({bb, base->bb});
-                            else
-                                bb2base[bb] = base->bb;
-                        }
+                        base = v;
+                        break;
+                    }
+                }
+                if (base != -1)
+                    break;
+            }
+            // an unreachable cycle has no entry
+            if (base == -1)
+                base = scc.front();
 
-                        // step 6: remove loop base node for researching inner loop
-                        reserved.insert(base);
-                        dump_graph(*scc, func->get_name() + '_' + std::to_string(scc_index));
-                        nodes.erase(base);
-                        for (auto su : base->succs)
-                        {
-                            su->prevs.erase(base);
-                        }
-                        for (auto prev : base->prevs)
-                        {
-                            prev->succs.erase(base);
-                        }
+            // step 4: store result
+            auto loop = new Loop;
+            loop->header_ = bbs_[base];
+            loop->parent_ = region.parent;
+            loop->depth_ = region.parent ? region.parent->depth_ + 1 : 1;
+            loop->blocks_.push_back(bbs_[base]);
+            for (auto v : scc)
+            {
+                if (v != base)
+                    loop->blocks_.push_back(bbs_[v]);
+            }
+            loop->block_set_.insert(loop->blocks_.begin(), loop->blocks_.end());
+            if (region.parent)
+                region.parent->sub_loops_.push_back(loop);
+            loops_.push_back(loop);
+            func2loop_[func].push_back(loop);
+            // step 5: map each node to loop, the inner loops are found later and override it
+            for (auto bb : loop->blocks_)
+                bb2loop_[bb] = loop;
 
-                    } // for (auto scc : sccs)
-                    for (auto scc : sccs)
-                        delete scc;
-                    sccs.clear();
-                    for (auto n : nodes)
-                    {
-                        n->index = n->lowlink = -1;
-                        n->onStack = false;
-                    }
-                } // else
-            }     // while (strongly_connected_components(nodes, sccs))
-            // clear
-            reserved.clear();
-            for (auto node : nodes)
+            // step 6: remove loop base node for researching inner loop
+            Region inner{{}, loop};
+            for (auto v : scc)
             {
-                delete node;
+                if (v != base)
+                    inner.nodes.push_back(v);
             }
-            nodes.clear();
-        } // else
+            if (!inner.nodes.empty())
+                work_list.push_back(std::move(inner));
+        }
+    }
 
-    } // for (auto func : func_list)
+    dump_graph(func);
 }
 
-void LoopSearch::dump_graph(CFGNodePtrSet &nodes, std::string title)
+// Tarjan algorithm, with an explicit stack instead of recursion
+// reference: https://baike.baidu.com/item/tarjan%E7%AE%97%E6%B3%95/10687825?fr=aladdin
+void LoopSearch::find_sccs(const std::vector<int> &nodes, int mark, std::vector<std::vector<int>> &sccs)
 {
-    if (dump)
+    for (auto v : nodes)
     {
-        std::vector<std::string> edge_set;
-        for (auto node : nodes)
+        index_[v] = -1;
+        on_stack_[v] = false;
+    }
+    int index_count = 0;
+    std::vector<int> stack;
+    // (node, the position of its next successor to visit)
+    std::vector<std::pair<int, int>> visit_stack;
+    for (auto root : nodes)
+    {
+        if (index_[root] != -1)
+            continue;
+        index_[root] = lowlink_[root] = index_count++;
+        stack.push_back(root);
+        on_stack_[root] = true;
+        visit_stack.push_back({root, 0});
+        while (!visit_stack.empty())
         {
-            if (node->bb->get_name() == "")
+            int v = visit_stack.back().first;
+            if (visit_stack.back().second < succs_[v].size())
             {
-                
-                return;
-            }
-            if (base2loop.find(node->bb) != base2loop.end())
-            {
-
-                for (auto succ : node->succs)
+                int su = succs_[v][visit_stack.back().second++];
+                if (region_mark_[su] != mark)
+                    continue;
+                // has not visited su
+                if (index_[su] == -1)
                 {
-                    if (nodes.find(succ) != nodes.end())
-                    {
-                        edge_set.insert(edge_set.begin(), '\t' + node->bb->get_name() + "->" + succ->bb->get_name() + ';' + '\n');
-                    }
+                    index_[su] = lowlink_[su] = index_count++;
+                    stack.push_back(su);
+                    on_stack_[su] = true;
+                    visit_stack.push_back({su, 0});
+                }
+                // has visited su
+                else if (on_stack_[su])
+                {
+                    lowlink_[v] = std::min(lowlink_[v], index_[su]);
                 }
-                edge_set.insert(edge_set.begin(), '\t' + node->bb->get_name() + " [color=red]" + ';' + '\n');
+                continue;
+            }
+
+            // all the successors of v are visited
+            visit_stack.pop_back();
+            if (!visit_stack.empty())
+            {
+                int parent = visit_stack.back().first;
+                lowlink_[parent] = std::min(lowlink_[parent], lowlink_[v]);
             }
-            else
+            // nodes that in the same strongly connected component will be popped out of stack
+            if (lowlink_[v] == index_[v])
             {
-                for (auto succ : node->succs)
+                std::vector<int> scc;
+                int tmp;
+                do
                 {
-                    if (nodes.find(succ) != nodes.end())
-                    {
-                        edge_set.push_back('\t' + node->bb->get_name() + "->" + succ->bb->get_name() + ';' + '\n');
-                    }
-                }
+                    tmp = stack.back();
+                    stack.pop_back();
+                    on_stack_[tmp] = false;
+                    scc.push_back(tmp);
+                } while (tmp != v);
+                sccs.push_back(std::move(scc));
             }
         }
+    }
+}
+
+void LoopSearch::dump_graph(Function *func)
+{
+    if (dump)
+    {
         std::string digragh = "digraph G {\n";
-        for (auto edge : edge_set)
+        for (auto bb : func->get_basic_blocks())
         {
-            digragh += edge;
+            if (bb->get_name() == "")
+                return;
+            auto loop = get_inner_loop(bb);
+            if (loop && loop->get_header() == bb)
+                digragh += '\t' + bb->get_name() + " [color=red]" + ';' + '\n';
+            for (auto succ : bb->get_succ_basic_blocks())
+            {
+                digragh += '\t' + bb->get_name() + "->" + succ->get_name() + ';' + '\n';
+            }
         }
         digragh += '}';
+        std::string title = func->get_name();
         std::ofstream file_output;
         file_output.open(title + ".dot", std::ios::out);
-        
+
         file_output << digragh;
         file_output.close();
         std::string dot_cmd = "dot -Tpng " + title + ".dot" + " -o " + title + ".png";
         std::system(dot_cmd.c_str());
     }
 }
-
-BBset_t *LoopSearch::get_parent_loop(BBset_t *loop)
-{
-    auto base = loop2base[loop];
-    for (auto prev : base->get_pre_basic_blocks())
-    {
-        if (loop->find(prev) != loop->end())
-            continue;
-        auto loop = get_inner_loop(prev);
-        if (loop == nullptr || loop->find(base) == loop->end())
-            return nullptr;
-        else
-        {
-            return loop;
-        }
-    }
-    return nullptr;
-}
-
-std::unordered_set<BBset_t *> LoopSearch::get_loops_in_func(Function *f)
-{
-    return func2loop.count(f) ? func2loop[f] : std::unordered_set<BBset_t *>();
-}
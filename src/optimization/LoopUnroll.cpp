@@ -0,0 +1,348 @@
+#include "LoopUnroll.hpp"
+#include "AnalysisManager.hpp"
+#include <climits>
+#include <vector>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+
+// loops running at most this many times may be fully unrolled
+const int MAX_FULL_UNROLL_TRIPS = 16;
+// the instructions a fully unrolled loop may grow to
+const int MAX_FULL_UNROLL_SIZE = 256;
+// the instructions the body of a partially unrolled loop may grow to,
+// the factor is halved until the loop fits
+const int MAX_PARTIAL_UNROLL_SIZE = 128;
+
+int LoopUnroll::unroll_factor_ = 4;
+
+static bool in_int_range(long long val) { return val >= INT_MIN && val <= INT_MAX; }
+
+static bool compare(CmpInst::CmpOp op, long long lhs, long long rhs)
+{
+    switch (op)
+    {
+    case CmpInst::EQ:
+        return lhs == rhs;
+    case CmpInst::NE:
+        return lhs != rhs;
+    case CmpInst::GT:
+        return lhs > rhs;
+    case CmpInst::GE:
+        return lhs >= rhs;
+    case CmpInst::LT:
+        return lhs < rhs;
+    default:
+        return lhs <= rhs;
+    }
+}
+
+void LoopUnroll::run_on_function(Function *func)
+{
+    // step 1: find the innermost loops which can be unrolled, before any of them is changed
+    auto loop_search = am_->get_loop_search(func);
+    std::vector<LoopShape> shapes;
+    for (auto loop : loop_search->get_loops_in_func(func))
+    {
+        if (!loop->get_sub_loops().empty())
+            continue;
+        InductionVars ivs(loop);
+        LoopShape shape;
+        if (analyze_loop(loop, ivs, shape))
+            shapes.push_back(shape);
+    }
+
+    // step 2: unroll them, fully if the trip count is small enough
+    for (auto &shape : shapes)
+    {
+        int trip_count = get_trip_count(shape);
+        if (trip_count > 0 && trip_count * shape.size <= MAX_FULL_UNROLL_SIZE)
+        {
+            fully_unroll(shape, trip_count);
+            continue;
+        }
+        int factor = unroll_factor_;
+        while (factor > 1 && factor * shape.size > MAX_PARTIAL_UNROLL_SIZE)
+            factor /= 2;
+        if (factor > 1)
+            partially_unroll(shape, factor);
+    }
+}
+
+bool LoopUnroll::analyze_loop(Loop *loop, InductionVars &ivs, LoopShape &shape)
+{
+    // step 1: the header is the only block leaving the loop, and the latch just branches back
+    auto header = loop->get_header();
+    auto latch = loop->get_latch();
+    auto exitings = loop->get_exiting_blocks();
+    if (!ivs.get_entry() || latch == header || exitings.size() != 1 || exitings.front() != header)
+        return false;
+    if (latch->get_terminator()->get_num_operand() != 1)
+        return false;
+    for (auto instr : header->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        if (instr->get_num_operand() != 4)
+            return false;
+    }
+
+    // step 2: the loop goes on while "iv op bound" holds
+    InductionVars::LoopBound bound;
+    if (!ivs.get_loop_bound(bound))
+        return false;
+
+    shape.loop = loop;
+    shape.entry = ivs.get_entry();
+    shape.latch = latch;
+    shape.body = bound.body;
+    shape.exit = bound.exit;
+    shape.cond = bound.cond;
+    shape.iv = *bound.iv;
+    shape.op = bound.op;
+    shape.bound = bound.bound;
+    shape.size = 0;
+    for (auto bb : loop->get_blocks())
+    {
+        shape.size += bb->get_instructions().size();
+    }
+    return true;
+}
+
+int LoopUnroll::get_trip_count(LoopShape &shape)
+{
+    auto init = CONST_INT(shape.iv.init);
+    auto bound = CONST_INT(shape.bound);
+    if (!init || !bound)
+        return -1;
+    long long val = init->get_value();
+    int trip_count = 0;
+    while (compare(shape.op, val, bound->get_value()))
+    {
+        trip_count++;
+        val += shape.iv.step;
+        // the loop running long or wrapping around is left alone
+        if (trip_count > MAX_FULL_UNROLL_TRIPS || !in_int_range(val))
+            return -1;
+    }
+    return trip_count;
+}
+
+void LoopUnroll::fully_unroll(LoopShape &shape, int trip_count)
+{
+    auto header = shape.loop->get_header();
+    auto func = header->get_parent();
+
+    // step 1: chain the clones of the iterations from the entry, the first one starts with the initial values
+    std::map<Value *, Value *> val_map;
+    std::vector<PhiInst *> phis;
+    for (auto instr : header->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(instr);
+        phis.push_back(phi);
+        val_map[phi] = phi->get_operand(0);
+        if (phi->get_operand(1) != shape.entry)
+            val_map[phi] = phi->get_operand(2);
+    }
+    BasicBlock *latch = nullptr;
+    for (int i = 0; i < trip_count; i++)
+    {
+        BasicBlock *new_latch;
+        auto new_header = clone_iteration(shape, val_map, new_latch);
+        if (latch)
+            BranchInst::create_br(new_header, latch);
+        else
+            shape.entry->redirect_succ_basic_block(header, new_header);
+        latch = new_latch;
+    }
+    BranchInst::create_br(header, latch);
+
+    // step 2: the header is only reached from the last clone, and leaves the loop;
+    // the exit is taken from the branch again, since a loop unrolled before may have been put in between
+    for (auto phi : phis)
+    {
+        phi->remove_operands(0, 3);
+        phi->add_phi_pair_operand(val_map[phi], latch);
+    }
+    auto br = header->get_terminator();
+    shape.exit = static_cast<BasicBlock *>(br->get_operand(br->get_operand(1) == shape.body ? 2 : 1));
+    header->delete_instr(br);
+    header->remove_succ_basic_block(shape.body);
+    header->remove_succ_basic_block(shape.exit);
+    shape.body->remove_pre_basic_block(header);
+    shape.exit->remove_pre_basic_block(header);
+    BranchInst::create_br(shape.exit, header);
+    if (shape.cond->get_use_list().empty())
+        header->delete_instr(shape.cond);
+
+    // step 3: remove the blocks of the old loop body, which are only used by each other
+    for (auto bb : shape.loop->get_blocks())
+    {
+        if (bb == header)
+            continue;
+        for (auto instr : bb->get_instructions())
+        {
+            instr->remove_use_of_ops();
+        }
+    }
+    for (auto bb : shape.loop->get_blocks())
+    {
+        if (bb != header)
+            func->remove(bb);
+    }
+    add_stat("loops fully unrolled");
+}
+
+void LoopUnroll::partially_unroll(LoopShape &shape, int factor)
+{
+    auto header = shape.loop->get_header();
+    auto func = header->get_parent();
+
+    // step 1: the unrolled loop runs while the last of its iterations is in range,
+    // i.e. "iv op bound - offset", which is only monotonic for a step in the direction of the bound
+    bool up = shape.op == CmpInst::LT || shape.op == CmpInst::LE;
+    bool down = shape.op == CmpInst::GT || shape.op == CmpInst::GE;
+    long long offset = (long long)(factor - 1) * shape.iv.step;
+    if ((!up || shape.iv.step < 0) && (!down || shape.iv.step > 0))
+        return;
+    if (!in_int_range(offset))
+        return;
+    BasicBlock *pre = shape.entry;
+    Value *bound;
+    Value *wrapped = nullptr;
+    if (CONST_INT(shape.bound))
+    {
+        long long val = CONST_INT(shape.bound)->get_value() - offset;
+        if (!in_int_range(val))
+            return;
+        bound = ConstantInt::get((int)val, m_);
+    }
+    else
+    {
+        // the bound is computed in a new block, which goes straight to the remainder loop if it wraps around
+        pre = BasicBlock::create(m_, "", func);
+        shape.entry->redirect_succ_basic_block(header, pre);
+        bound = BinaryInst::create_sub(shape.bound, ConstantInt::get((int)offset, m_), pre, m_);
+        wrapped = CmpInst::create_cmp(offset > 0 ? CmpInst::GT : CmpInst::LT, bound, shape.bound, pre, m_);
+    }
+
+    // step 2: the header of the unrolled loop, with the phis of the header
+    auto new_header = BasicBlock::create(m_, "", func);
+    std::map<Value *, Value *> val_map;
+    std::vector<std::pair<PhiInst *, PhiInst *>> phis;
+    for (auto instr : header->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(instr);
+        auto new_phi = PhiInst::create_phi(phi->get_type(), new_header);
+        new_header->add_instruction(new_phi);
+        new_phi->add_phi_pair_operand(phi->get_operand(phi->get_operand(1) == shape.entry ? 0 : 2), pre);
+        phis.push_back({phi, new_phi});
+        val_map[phi] = new_phi;
+    }
+    auto new_cond = CmpInst::create_cmp(shape.op, val_map[shape.iv.phi], bound, new_header, m_);
+    if (wrapped)
+        BranchInst::create_cond_br(wrapped, header, new_header, pre);
+    else
+        shape.entry->redirect_succ_basic_block(header, new_header);
+
+    // step 3: chain the clones of factor iterations, the last one branches back to the new header
+    BasicBlock *first = nullptr;
+    BasicBlock *latch = nullptr;
+    for (int i = 0; i < factor; i++)
+    {
+        BasicBlock *new_latch;
+        auto iter_header = clone_iteration(shape, val_map, new_latch);
+        if (latch)
+            BranchInst::create_br(iter_header, latch);
+        else
+            first = iter_header;
+        latch = new_latch;
+    }
+    BranchInst::create_br(new_header, latch);
+    BranchInst::create_cond_br(new_cond, first, header, new_header);
+
+    // step 4: the original loop is left as the remainder loop, entered from the new header
+    for (auto &phi_pair : phis)
+    {
+        auto phi = phi_pair.first;
+        phi_pair.second->add_phi_pair_operand(val_map[phi], latch);
+        int i = phi->get_operand(1) == shape.entry ? 0 : 2;
+        if (wrapped)
+            phi->set_operand(i + 1, pre);
+        else
+            phi->remove_operands(i, i + 1);
+        phi->add_phi_pair_operand(phi_pair.second, new_header);
+    }
+    add_stat("loops partially unrolled");
+}
+
+BasicBlock *LoopUnroll::clone_iteration(LoopShape &shape, std::map<Value *, Value *> &val_map, BasicBlock *&latch)
+{
+    auto header = shape.loop->get_header();
+    auto func = header->get_parent();
+
+    // step 1: clone the blocks, the phis and the branch of the header are left out,
+    // since a clone only runs when the iteration does
+    for (auto bb : shape.loop->get_blocks())
+    {
+        val_map[bb] = BasicBlock::create(m_, "", func);
+    }
+    std::vector<Instruction *> new_instrs;
+    for (auto bb : shape.loop->get_blocks())
+    {
+        auto new_bb = static_cast<BasicBlock *>(val_map[bb]);
+        for (auto instr : bb->get_instructions())
+        {
+            if (instr->is_phi() && bb == header)
+                continue;
+            if (instr == bb->get_terminator() && (bb == header || bb == shape.latch))
+                continue;
+            auto new_instr = instr->copy_inst(new_bb);
+            val_map[instr] = new_instr;
+            new_instrs.push_back(new_instr);
+        }
+    }
+
+    // step 2: map the operands to the clones, and connect the cloned blocks
+    for (auto new_instr : new_instrs)
+    {
+        for (int i = 0; i < new_instr->get_num_operand(); i++)
+        {
+            auto iter = val_map.find(new_instr->get_operand(i));
+            if (iter != val_map.end())
+                new_instr->set_operand(i, iter->second);
+        }
+        if (!new_instr->is_br())
+            continue;
+        auto new_bb = new_instr->get_parent();
+        for (auto op : new_instr->get_operands())
+        {
+            auto succ_bb = dynamic_cast<BasicBlock *>(op);
+            if (succ_bb)
+            {
+                new_bb->add_succ_basic_block(succ_bb);
+                succ_bb->add_pre_basic_block(new_bb);
+            }
+        }
+    }
+    auto new_header = static_cast<BasicBlock *>(val_map[header]);
+    BranchInst::create_br(static_cast<BasicBlock *>(val_map[shape.body]), new_header);
+    latch = static_cast<BasicBlock *>(val_map[shape.latch]);
+
+    // step 3: the values of the phis at the next iteration come from the latch
+    std::map<Value *, Value *> next_map;
+    for (auto instr : header->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        auto next = instr->get_operand(instr->get_operand(1) == shape.latch ? 0 : 2);
+        auto iter = val_map.find(next);
+        next_map[instr] = iter == val_map.end() ? next : iter->second;
+    }
+    val_map = next_map;
+    return new_header;
+}
+
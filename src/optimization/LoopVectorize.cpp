@@ -0,0 +1,417 @@
+#include "LoopVectorize.hpp"
+#include "AnalysisManager.hpp"
+#include "GlobalVariable.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+
+// the lanes of a vector: i32 lanes fill a 128-bit register, since 256-bit integer operations need AVX2,
+// float lanes fill a 256-bit AVX register
+const int INT_LANES = 4;
+const int FLOAT_LANES = 8;
+// a loop needing more checks at run time is left scalar
+const int MAX_RUNTIME_CHECKS = 8;
+
+// a global or local array, which can't alias another one
+static bool is_object(Value *val)
+{
+    return dynamic_cast<GlobalVariable *>(val) || dynamic_cast<AllocaInst *>(val);
+}
+
+void LoopVectorize::run_on_function(Function *func)
+{
+    // the innermost loops are disjoint, so each one is analyzed right before it is vectorized
+    auto loop_search = am_->get_loop_search(func);
+    for (auto loop : loop_search->get_loops_in_func(func))
+    {
+        if (!loop->get_sub_loops().empty())
+            continue;
+        InductionVars ivs(loop);
+        VectorLoop vl;
+        if (analyze_loop(loop, ivs, vl) && check_dependences(vl))
+            vectorize(vl);
+    }
+}
+
+bool LoopVectorize::analyze_loop(Loop *loop, InductionVars &ivs, VectorLoop &vl)
+{
+    // step 1: the loop is a header computing "iv < bound" and a body branching back
+    auto header = loop->get_header();
+    auto body = loop->get_latch();
+    if (!ivs.get_entry() || loop->get_blocks().size() != 2 || body == header)
+        return false;
+    if (!ivs.get_loop_bound(vl.bound) || vl.bound.body != body || body->get_terminator()->get_num_operand() != 1)
+        return false;
+    auto iv = vl.bound.iv;
+    if (iv->step != 1 || (vl.bound.op != CmpInst::LT && vl.bound.op != CmpInst::LE))
+        return false;
+    if (vl.bound.cond->get_use_list().size() != 1)
+        return false;
+    for (auto instr : header->get_instructions())
+    {
+        if (!instr->is_phi() && instr != vl.bound.cond && instr != header->get_terminator())
+            return false;
+    }
+    vl.loop = loop;
+    vl.entry = ivs.get_entry();
+    vl.body = body;
+
+    // step 2: the other phis are sums, which are only used by their adds in the loop
+    for (auto instr : header->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(instr);
+        if (phi == iv->phi)
+            continue;
+        if (phi->get_num_operand() != 4)
+            return false;
+        auto next = dynamic_cast<Instruction *>(phi->get_operand(phi->get_operand(1) == body ? 0 : 2));
+        if (!next || next->get_parent() != body || !next->is_add() || next->get_use_list().size() != 1)
+            return false;
+        if (next->get_operand(0) != phi && next->get_operand(1) != phi)
+            return false;
+        for (auto &use : phi->get_use_list())
+        {
+            auto user = static_cast<Instruction *>(use.val_);
+            if (loop->contains(user->get_parent()) && user != next)
+                return false;
+        }
+        vl.sums.push_back(phi);
+    }
+
+    // step 3: the elements are accessed at iv + offset, whose computation is kept scalar
+    for (auto instr : body->get_instructions())
+    {
+        if (!instr->is_gep())
+            continue;
+        auto idx = InductionVars::get_gep_index(instr);
+        InductionVars::AffineIV index;
+        if (!idx || !ivs.is_invariant(instr->get_operand(0)) || !ivs.get_affine_iv(idx, index) ||
+            index.phi != iv->phi || index.scale != 1)
+            return false;
+        ivs.hoist(instr->get_operand(0));
+        if (index.offset_val)
+            ivs.hoist(index.offset_val);
+        mark_scalar(idx, vl);
+    }
+    mark_scalar(iv->phi->get_operand(iv->phi->get_operand(1) == body ? 0 : 2), vl);
+
+    // step 4: the other instructions are loads, stores and operations on elements of the same type
+    vl.element_ty = nullptr;
+    bool has_store = false;
+    for (auto instr : body->get_instructions())
+    {
+        if (instr == body->get_terminator())
+            continue;
+        Type *ty;
+        if (vl.scalars.count(instr))
+        {
+            for (auto &use : instr->get_use_list())
+            {
+                auto user = static_cast<Instruction *>(use.val_);
+                if (user != iv->phi && !user->is_gep() && !vl.scalars.count(user))
+                    return false;
+            }
+            continue;
+        }
+        else if (instr->is_gep())
+        {
+            for (auto &use : instr->get_use_list())
+            {
+                auto user = static_cast<Instruction *>(use.val_);
+                bool is_address = (user->is_load() && use.arg_no_ == 0) || (user->is_store() && use.arg_no_ == 1);
+                if (!is_address || user->get_parent() != body)
+                    return false;
+            }
+            continue;
+        }
+        else if (instr->is_load() || instr->is_store())
+        {
+            auto gep = dynamic_cast<GetElementPtrInst *>(instr->get_operand(instr->is_load() ? 0 : 1));
+            if (!gep || gep->get_parent() != body)
+                return false;
+            if (instr->is_store() && !is_vector_operand(instr->get_operand(0), vl))
+                return false;
+            ty = instr->is_load() ? instr->get_type() : instr->get_operand(0)->get_type();
+            Access access;
+            access.instr = instr;
+            access.gep = gep;
+            ivs.get_affine_iv(gep->get_operand(gep->get_num_operand() - 1), access.index);
+            vl.accesses.push_back(access);
+            has_store |= instr->is_store();
+        }
+        else if (instr->isBinary() && !instr->is_div() && !instr->is_rem())
+        {
+            // there are no vector integer divisions, they would be split into scalar ones
+            for (auto op : instr->get_operands())
+            {
+                if (!is_vector_operand(op, vl))
+                    return false;
+            }
+            ty = instr->get_type();
+        }
+        else
+        {
+            return false;
+        }
+        if (ty != m_->get_int32_type() && !ty->is_float_type())
+            return false;
+        if (vl.element_ty && ty != vl.element_ty)
+            return false;
+        vl.element_ty = ty;
+    }
+    if (!vl.element_ty || (!has_store && vl.sums.empty()))
+        return false;
+    vl.lanes = vl.element_ty->is_float_type() ? FLOAT_LANES : INT_LANES;
+
+    // the bound of the vector loop is bound - (lanes - 1), which must not wrap around
+    auto bound = CONST_INT(vl.bound.bound);
+    return !bound || (long long)bound->get_value() - (vl.lanes - 1) >= INT_MIN;
+}
+
+void LoopVectorize::mark_scalar(Value *val, VectorLoop &vl)
+{
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (!instr || instr->get_parent() != vl.body || !vl.scalars.insert(instr).second)
+        return;
+    for (auto op : instr->get_operands())
+    {
+        mark_scalar(op, vl);
+    }
+}
+
+bool LoopVectorize::is_vector_operand(Value *val, VectorLoop &vl)
+{
+    auto instr = dynamic_cast<Instruction *>(val);
+    if (!instr || !vl.loop->contains(instr->get_parent()))
+        return true;
+    // a sum is only used by its add
+    if (instr->is_phi())
+        return std::find(vl.sums.begin(), vl.sums.end(), instr) != vl.sums.end();
+    return !instr->is_gep() && !vl.scalars.count(instr);
+}
+
+bool LoopVectorize::check_dependences(VectorLoop &vl)
+{
+    for (int i = 0; i < vl.accesses.size(); i++)
+    {
+        auto &store = vl.accesses[i];
+        if (!store.instr->is_store())
+            continue;
+        for (int j = 0; j < vl.accesses.size(); j++)
+        {
+            auto &other = vl.accesses[j];
+            if (j == i || (other.instr->is_store() && j < i))
+                continue;
+            auto base = store.gep->get_operand(0);
+            auto other_base = other.gep->get_operand(0);
+            // step 1: the elements of an array at a constant distance must be the same or at least lanes apart,
+            // so that each one is read and written in the same order as the scalar loop does
+            if (base == other_base && store.index.offset_val == other.index.offset_val)
+            {
+                long long distance = (long long)other.index.offset - store.index.offset;
+                if (distance != 0 && std::llabs(distance) < vl.lanes)
+                    return false;
+                continue;
+            }
+            // step 2: different arrays never alias, the others are checked at run time
+            if (is_object(base) && is_object(other_base) && base != other_base)
+                continue;
+            vl.runtime_checks.push_back({i, j});
+        }
+    }
+    return vl.runtime_checks.size() <= MAX_RUNTIME_CHECKS;
+}
+
+void LoopVectorize::vectorize(VectorLoop &vl)
+{
+    auto header = vl.loop->get_header();
+    auto func = header->get_parent();
+    auto iv = vl.bound.iv;
+    auto vector_ty = VectorType::get(vl.element_ty, vl.lanes);
+    vector_map_.clear();
+
+    // step 1: the checks in pre, the vector loop goes on while the last lane is in range,
+    // i.e. "iv op bound - (lanes - 1)", unless the bound wraps around
+    auto pre = BasicBlock::create(m_, "", func);
+    vl.entry->redirect_succ_basic_block(header, pre);
+    Value *skip = nullptr;
+    Value *bound;
+    if (CONST_INT(vl.bound.bound))
+    {
+        bound = ConstantInt::get(CONST_INT(vl.bound.bound)->get_value() - (vl.lanes - 1), m_);
+    }
+    else
+    {
+        bound = BinaryInst::create_sub(vl.bound.bound, ConstantInt::get(vl.lanes - 1, m_), pre, m_);
+        skip = CmpInst::create_cmp(CmpInst::GT, bound, vl.bound.bound, pre, m_);
+    }
+    // the first elements accessed by a pair are at least lanes apart, i.e. the lanes of the first
+    // iteration [first, first + lanes) don't overlap
+    std::vector<Value *> firsts(vl.accesses.size(), nullptr);
+    for (auto &check : vl.runtime_checks)
+    {
+        for (int i : {check.first, check.second})
+        {
+            if (!firsts[i])
+                firsts[i] = get_first_element(vl, vl.accesses[i], pre);
+        }
+        auto first = firsts[check.first];
+        auto other_first = firsts[check.second];
+        auto end = GetElementPtrInst::create_gep(first, {ConstantInt::get(vl.lanes, m_)}, pre);
+        auto other_end = GetElementPtrInst::create_gep(other_first, {ConstantInt::get(vl.lanes, m_)}, pre);
+        auto before = CmpInst::create_cmp(CmpInst::LT, other_first, end, pre, m_);
+        auto after = CmpInst::create_cmp(CmpInst::LT, first, other_end, pre, m_);
+        auto overlap = BinaryInst::create(Instruction::and_, before, after, pre);
+        skip = skip ? BinaryInst::create(Instruction::or_, skip, overlap, pre) : overlap;
+        add_stat("runtime alias checks");
+    }
+
+    // step 2: the header of the vector loop, the sums start from <init, 0, ...>
+    auto vector_header = BasicBlock::create(m_, "", func);
+    auto vector_body = BasicBlock::create(m_, "", func);
+    auto vector_exit = BasicBlock::create(m_, "", func);
+    if (skip)
+        BranchInst::create_cond_br(skip, header, vector_header, pre);
+    else
+        BranchInst::create_br(vector_header, pre);
+    auto vector_iv = PhiInst::create_phi(iv->phi->get_type(), vector_header);
+    vector_header->add_instruction(vector_iv);
+    vector_iv->add_phi_pair_operand(iv->init, pre);
+    std::vector<PhiInst *> vector_sums;
+    for (auto sum : vl.sums)
+    {
+        auto init = sum->get_operand(sum->get_operand(1) == vl.entry ? 0 : 2);
+        auto vector_init = pre->insert_before_terminator(
+            InsertElementInst::create_insert_element(ConstantZero::get(vector_ty, m_), init, ConstantInt::get(0, m_), pre));
+        auto vector_sum = PhiInst::create_phi(vector_ty, vector_header);
+        vector_header->add_instruction(vector_sum);
+        vector_sum->add_phi_pair_operand(vector_init, pre);
+        vector_map_[sum] = vector_sum;
+        vector_sums.push_back(vector_sum);
+    }
+    auto vector_cond = CmpInst::create_cmp(vl.bound.op, vector_iv, bound, vector_header, m_);
+    BranchInst::create_cond_br(vector_cond, vector_body, vector_exit, vector_header);
+
+    // step 3: the body, the indices and addresses are computed for the first lane,
+    // the loads, stores and operations work on all the lanes
+    std::map<Value *, Value *> val_map;
+    val_map[iv->phi] = vector_iv;
+    for (auto instr : vl.body->get_instructions())
+    {
+        if (instr == vl.body->get_terminator())
+            continue;
+        if (vl.scalars.count(instr) || instr->is_gep())
+        {
+            auto new_instr = instr->copy_inst(vector_body);
+            for (int i = 0; i < new_instr->get_num_operand(); i++)
+            {
+                auto iter = val_map.find(new_instr->get_operand(i));
+                if (iter != val_map.end())
+                    new_instr->set_operand(i, iter->second);
+            }
+            val_map[instr] = new_instr;
+        }
+        else if (instr->is_load())
+        {
+            auto ptr = BitCastInst::create_bitcast(val_map[instr->get_operand(0)], PointerType::get(vector_ty), vector_body);
+            vector_map_[instr] = LoadInst::create_load(vector_ty, ptr, vector_body);
+        }
+        else if (instr->is_store())
+        {
+            auto val = get_vector(instr->get_operand(0), vl, pre);
+            auto ptr = BitCastInst::create_bitcast(val_map[instr->get_operand(1)], PointerType::get(vector_ty), vector_body);
+            StoreInst::create_store(val, ptr, vector_body);
+        }
+        else
+        {
+            auto lhs = get_vector(instr->get_operand(0), vl, pre);
+            auto rhs = get_vector(instr->get_operand(1), vl, pre);
+            vector_map_[instr] = BinaryInst::create(instr->get_instr_type(), lhs, rhs, vector_body);
+        }
+    }
+    auto vector_next = BinaryInst::create_add(vector_iv, ConstantInt::get(vl.lanes, m_), vector_body, m_);
+    BranchInst::create_br(vector_header, vector_body);
+    vector_iv->add_phi_pair_operand(vector_next, vector_body);
+    for (int i = 0; i < vl.sums.size(); i++)
+    {
+        auto sum = vl.sums[i];
+        auto next = sum->get_operand(sum->get_operand(1) == vl.body ? 0 : 2);
+        vector_sums[i]->add_phi_pair_operand(vector_map_[next], vector_body);
+    }
+
+    // step 4: the lanes of the sums are added up when the vector loop exits
+    std::map<PhiInst *, Value *> totals;
+    for (int i = 0; i < vl.sums.size(); i++)
+    {
+        Value *total = ExtractElementInst::create_extract_element(vector_sums[i], ConstantInt::get(0, m_), vector_exit);
+        for (int lane = 1; lane < vl.lanes; lane++)
+        {
+            auto element = ExtractElementInst::create_extract_element(vector_sums[i], ConstantInt::get(lane, m_), vector_exit);
+            total = BinaryInst::create_add(total, element, vector_exit, m_);
+        }
+        totals[vl.sums[i]] = total;
+    }
+    BranchInst::create_br(header, vector_exit);
+
+    // step 5: the scalar loop runs the remaining iterations, entered from the exit of the vector loop,
+    // or from pre if the checks fail
+    for (auto instr : header->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        auto phi = static_cast<PhiInst *>(instr);
+        int i = phi->get_operand(1) == vl.entry ? 0 : 2;
+        if (skip)
+            phi->set_operand(i + 1, pre);
+        else
+            phi->remove_operands(i, i + 1);
+        phi->add_phi_pair_operand(phi == iv->phi ? vector_iv : totals[phi], vector_exit);
+    }
+    add_stat("loops vectorized");
+}
+
+Value *LoopVectorize::get_first_element(VectorLoop &vl, Access &access, BasicBlock *pre)
+{
+    auto &index = access.index;
+    auto init = vl.bound.iv->init;
+    Value *idx;
+    if (CONST_INT(init))
+    {
+        int first = (unsigned)CONST_INT(init)->get_value() + (unsigned)index.offset;
+        idx = ConstantInt::get(first, m_);
+        if (index.offset_val)
+            idx = first == 0 ? index.offset_val : BinaryInst::create_add(index.offset_val, idx, pre, m_);
+    }
+    else
+    {
+        idx = init;
+        if (index.offset != 0)
+            idx = BinaryInst::create_add(idx, ConstantInt::get(index.offset, m_), pre, m_);
+        if (index.offset_val)
+            idx = BinaryInst::create_add(idx, index.offset_val, pre, m_);
+    }
+    std::vector<Value *> idxs(access.gep->get_operands().begin() + 1, access.gep->get_operands().end());
+    idxs.back() = idx;
+    return GetElementPtrInst::create_gep(access.gep->get_operand(0), idxs, pre);
+}
+
+Value *LoopVectorize::get_vector(Value *val, VectorLoop &vl, BasicBlock *pre)
+{
+    auto iter = vector_map_.find(val);
+    if (iter != vector_map_.end())
+        return iter->second;
+    // a loop invariant is broadcast to all the lanes
+    Value *vec = ConstantZero::get(VectorType::get(val->get_type(), vl.lanes), m_);
+    for (int lane = 0; lane < vl.lanes; lane++)
+    {
+        vec = pre->insert_before_terminator(InsertElementInst::create_insert_element(vec, val, ConstantInt::get(lane, m_), pre));
+    }
+    vector_map_[val] = vec;
+    return vec;
+}
+
@@ -1,96 +1,217 @@
 #include "Mem2Reg.hpp"
+#include "AnalysisManager.hpp"
 #include "IRBuilder.h"
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <vector>
 
-#define IS_GLOBAL_VARIABLE(l_val) dynamic_cast<GlobalVariable *>(l_val)
-#define IS_GEP_INSTR(l_val) dynamic_cast<GetElementPtrInst *>(l_val)
+// phi instructions generated by this pass, other phis have no lval
+#define IS_VAR_PHI(instr) ((instr)->is_phi() && static_cast<PhiInst *>(instr)->get_lval() != nullptr)
 
-std::map<Value *, std::vector<Value *>> var_val_stack;//全局变量初值提前存入栈中
-
-void Mem2Reg::run()
+// Promote the variables of a function, the renaming states are local to this call
+void Mem2Reg::run_on_function(Function *func)
 {
     // get info from Dominators
-    dominators_ = new Dominators(m_);
-    dominators_->run();
-    for (auto f : m_->get_functions())
+    dominators_ = am_->get_dominators(func);
+
+    generate_phi(func);
+    re_name(func);
+    clear_phi_lval(func);
+    remove_alloca(func);
+}
+
+// Only the allocas of int, float and pointer variables are promoted, not the arrays, the globals,
+// or the other pointers, e.g. the gep or the pointer phi of a reduced loop
+static bool is_var(Value *l_val)
+{
+    auto alloca = dynamic_cast<AllocaInst *>(l_val);
+    if (alloca == nullptr)
+        return false;
+    auto type = alloca->get_type()->get_pointer_element_type();
+    return type->is_integer_type() || type->is_float_type() || type->is_pointer_type();
+}
+
+// dense bitsets for liveness, one bit per variable
+typedef std::vector<uint64_t> BitSet;
+static void set_bit(BitSet &set, int i) { set[i >> 6] |= 1ULL << (i & 63); }
+static bool test_bit(const BitSet &set, int i) { return (set[i >> 6] >> (i & 63)) & 1; }
+
+// Generate phi instruction in the given function.
+// A phi for var is only placed in a block where var is live-in (pruned SSA),
+// other phis would be dead.
+void Mem2Reg::generate_phi(Function *func)
+{
+    // step 1: number the variables and the blocks, find the blocks where each variable is stored
+    std::map<Value *, int> var_id;
+    std::vector<Value *> vars;
+    std::map<BasicBlock *, int> bb_id;
+    std::vector<BasicBlock *> bbs;
+    std::vector<std::vector<BasicBlock *>> var_def_blocks;
+    for (auto bb : func->get_basic_blocks())
     {
-        func_ = f;
-        if ( func_->get_basic_blocks().size() >= 1 )
+        bb_id[bb] = bbs.size();
+        bbs.push_back(bb);
+        for (auto instr : bb->get_instructions())
         {
-            generate_phi();
-            re_name(func_->get_entry_block());
+            Value *l_val = nullptr;
+            if (instr->is_load())
+                l_val = static_cast<LoadInst *>(instr)->get_lval();
+            else if (instr->is_store())
+                l_val = static_cast<StoreInst *>(instr)->get_lval();
+            if (l_val && is_var(l_val) && var_id.find(l_val) == var_id.end())
+            {
+                var_id[l_val] = vars.size();
+                vars.push_back(l_val);
+                var_def_blocks.push_back({});
+            }
+            if (instr->is_store() && var_id.find(l_val) != var_id.end())
+            {
+                auto &def_blocks = var_def_blocks[var_id[l_val]];
+                if (def_blocks.empty() || def_blocks.back() != bb)
+                    def_blocks.push_back(bb);
+            }
         }
-        remove_alloca();
     }
-}
+    if (vars.empty())
+        return;
 
-// Generate phi instruction in the current function
-void Mem2Reg::generate_phi()
-{
-    // step 1: find all global_live_var_name x and get their blocks
-    std::set<Value *> global_live_var_name;
-    std::map<Value *, std::set<BasicBlock *>> live_var_2blocks;
-    for (auto bb : func_->get_basic_blocks())
+    // step 2: compute the variables which are used before defined (use) and defined (def) in each block
+    int words = (vars.size() + 63) / 64;
+    std::vector<BitSet> use(bbs.size(), BitSet(words)), def(bbs.size(), BitSet(words));
+    for (int i = 0; i < bbs.size(); i++)
     {
-        std::set<Value *> var_is_killed;
-        for (auto instr : bb->get_instructions())
+        for (auto instr : bbs[i]->get_instructions())
+        {
+            if (instr->is_load())
+            {
+                auto iter = var_id.find(static_cast<LoadInst *>(instr)->get_lval());
+                if (iter != var_id.end() && !test_bit(def[i], iter->second))
+                    set_bit(use[i], iter->second);
+            }
+            else if (instr->is_store())
+            {
+                auto iter = var_id.find(static_cast<StoreInst *>(instr)->get_lval());
+                if (iter != var_id.end())
+                    set_bit(def[i], iter->second);
+            }
+        }
+    }
+
+    // step 3: live_in = use | (live_out & ~def), iterate backward until a fixed point
+    std::vector<BitSet> live_in(use);
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = bbs.size() - 1; i >= 0; i--)
         {
-            if (instr->is_store())
+            BitSet live_out(words);
+            for (auto succ_bb : bbs[i]->get_succ_basic_blocks())
+            {
+                auto &succ_live_in = live_in[bb_id[succ_bb]];
+                for (int w = 0; w < words; w++)
+                    live_out[w] |= succ_live_in[w];
+            }
+            for (int w = 0; w < words; w++)
             {
-                // store i32 a, i32 *b
-                // a is r_val, b is l_val
-                auto r_val = static_cast<StoreInst *>(instr)->get_rval();
-                auto l_val = static_cast<StoreInst *>(instr)->get_lval();
-                // for instruction a = b,
-                // before, if b is not killed, then a is live
-                // after, a is killed
-                if (!IS_GLOBAL_VARIABLE(l_val) && !IS_GEP_INSTR(l_val))
+                auto new_live_in = use[i][w] | (live_out[w] & ~def[i][w]);
+                if (new_live_in != live_in[i][w])
                 {
-                    if (var_is_killed.find(r_val) == var_is_killed.end())
-                    {
-                        global_live_var_name.insert(l_val);
-                    }
-                    var_is_killed.insert(l_val);
-                    live_var_2blocks[l_val].insert(bb);
+                    live_in[i][w] = new_live_in;
+                    changed = true;
                 }
             }
         }
     }
 
-    // step 2: insert phi instr into each bb in the dominating frontier of the bb that each live var is in
-    std::map<std::pair<BasicBlock *,Value *>, bool> bb_has_var_phi; // bb has phi for var
-    for (auto var : global_live_var_name)
+    // step 4: insert phi instr into each bb in the iterated dominating frontier of the blocks where var is stored,
+    // if var is live-in there
+    std::vector<bool> bb_has_phi(bbs.size());
+    std::vector<bool> bb_in_work_list(bbs.size());
+    for (int v = 0; v < vars.size(); v++)
     {
-        std::vector<BasicBlock *> work_list;
-        work_list.assign(live_var_2blocks[var].begin(), live_var_2blocks[var].end());
+        auto var = vars[v];
+        std::fill(bb_has_phi.begin(), bb_has_phi.end(), false);
+        std::fill(bb_in_work_list.begin(), bb_in_work_list.end(), false);
+        std::vector<BasicBlock *> work_list(var_def_blocks[v]);
+        for (auto bb : work_list)
+        {
+            bb_in_work_list[bb_id[bb]] = true;
+        }
         for (int i = 0; i < work_list.size(); i++)
         {
             auto bb = work_list[i];
             for (auto bb_dominance_frontier_bb : dominators_->get_dominance_frontier(bb))
             {
-                if (bb_has_var_phi.find({bb_dominance_frontier_bb, var}) == bb_has_var_phi.end())
+                int id = bb_id[bb_dominance_frontier_bb];
+                if (bb_has_phi[id] || !test_bit(live_in[id], v))
+                    continue;
+                // generate phi for bb_dominance_frontier_bb & add bb_dominance_frontier_bb to work list
+                auto phi = PhiInst::create_phi(var->get_type()->get_pointer_element_type(), bb_dominance_frontier_bb);
+                phi->set_lval(var);
+                bb_dominance_frontier_bb->add_instr_begin(phi);
+                add_stat("phis inserted");
+                bb_has_phi[id] = true;
+                if (!bb_in_work_list[id])
                 {
-                    // generate phi for bb_dominance_frontier_bb & add bb_dominance_frontier_bb to work list
-                    auto phi = PhiInst::create_phi(var->get_type()->get_pointer_element_type(), bb_dominance_frontier_bb);
-                    phi->set_lval(var);
-                    bb_dominance_frontier_bb->add_instr_begin(phi);
                     work_list.push_back(bb_dominance_frontier_bb);
-                    bb_has_var_phi[{bb_dominance_frontier_bb, var}] = true;
+                    bb_in_work_list[id] = true;
                 }
             }
         }
     }
 }
 
-// Rename the value of phi instruction in the given bb
-void Mem2Reg::re_name(BasicBlock *bb)
+// Rename the variables in the given function.
+// The dominator tree is walked in preorder with an explicit stack instead of recursion,
+// so that deep dominator trees can't overflow the C++ stack.
+void Mem2Reg::re_name(Function *func)
 {
-    // the instructions that are waiting to be deleted
-    std::vector<Instruction *> wait_delete;
+    // the definitions of each variable on the path from the entry block to current block
+    std::map<Value *, std::vector<Value *>> var_val_stack;
+    std::set<BasicBlock *> visited;
+    // a block is pushed twice, to enter it and to exit it after its dominator tree successors
+    std::vector<std::pair<BasicBlock *, bool>> work_stack;
+    work_stack.push_back({func->get_entry_block(), false});
+    while (!work_stack.empty())
+    {
+        auto bb = work_stack.back().first;
+        auto is_exit = work_stack.back().second;
+        work_stack.pop_back();
+        if (is_exit)
+        {
+            exit_block(bb, var_val_stack);
+            continue;
+        }
+        visited.insert(bb);
+        enter_block(bb, var_val_stack);
+        work_stack.push_back({bb, true});
+        for (auto dom_succ_bb : dominators_->get_dom_tree_succ_blocks(bb))
+        {
+            work_stack.push_back({dom_succ_bb, false});
+        }
+    }
 
+    // the blocks unreachable from the entry block (e.g. after a return) are not in the dominator tree,
+    // their loads and stores are removed as well, a variable not stored before in the block is 0 there
+    for (auto bb : func->get_basic_blocks())
+    {
+        if (visited.count(bb))
+            continue;
+        std::map<Value *, std::vector<Value *>> unreachable_val_stack;
+        enter_block(bb, unreachable_val_stack);
+        exit_block(bb, unreachable_val_stack);
+    }
+}
+
+// Rename the value of phi instruction in the given bb
+void Mem2Reg::enter_block(BasicBlock *bb, std::map<Value *, std::vector<Value *>> &var_val_stack)
+{
     // get the new value of each left value in phi instruction
     for (auto instr : bb->get_instructions())
     {
-        if (instr->is_phi())
+        if (IS_VAR_PHI(instr))
         {
             // step 3: push phi instr as lval's lastest value define
             auto l_val = static_cast<PhiInst *>(instr)->get_lval();
@@ -98,7 +219,6 @@ void Mem2Reg::re_name(BasicBlock *bb)
         }
     }
 
-    // ready to remove redundant load and store instructions
     for (auto instr : bb->get_instructions())
     {
         if (instr->is_load())
@@ -106,15 +226,10 @@ void Mem2Reg::re_name(BasicBlock *bb)
             // step 4: replace load with the top of stack[l_val]
             auto l_val = static_cast<LoadInst *>(instr)->get_lval();
 
-            // we don't deal with gep and global variables
-            if (!IS_GLOBAL_VARIABLE(l_val) && !IS_GEP_INSTR(l_val))
+            if (is_var(l_val))
             {
                 // this load instruction is redundant
-                if (var_val_stack.find(l_val) != var_val_stack.end())
-                {
-                    instr->replace_all_use_with(var_val_stack[l_val].back());
-                    wait_delete.push_back(instr);
-                }
+                instr->replace_all_use_with(get_latest_val(l_val, var_val_stack));
             }
         }
         if (instr->is_store())
@@ -123,12 +238,9 @@ void Mem2Reg::re_name(BasicBlock *bb)
             auto l_val = static_cast<StoreInst *>(instr)->get_lval();
             auto r_val = static_cast<StoreInst *>(instr)->get_rval();
 
-            // we also don't deal with gep and global variables
-            // this store instruction is redundant
-            if (!IS_GLOBAL_VARIABLE(l_val) && !IS_GEP_INSTR(l_val))
+            if (is_var(l_val))
             {
                 var_val_stack[l_val].push_back(r_val);
-                wait_delete.push_back(instr);
             }
         }
     }
@@ -138,73 +250,107 @@ void Mem2Reg::re_name(BasicBlock *bb)
     {
         for (auto instr : succ_bb->get_instructions())
         {
-            if (instr->is_phi())
+            if (IS_VAR_PHI(instr))
             {
+                // step 6: fill phi pair parameters
                 auto l_val = static_cast<PhiInst *>(instr)->get_lval();
-                if (var_val_stack.find(l_val) != var_val_stack.end())
-                {
-                    assert(var_val_stack[l_val].size() != 0);
-                    // step 6: fill phi pair parameters
-                    static_cast<PhiInst *>(instr)->add_phi_pair_operand(var_val_stack[l_val].back(), bb);
-                }
-                // else phi parameter is [ undef, bb ]
+                static_cast<PhiInst *>(instr)->add_phi_pair_operand(get_latest_val(l_val, var_val_stack), bb);
             }
         }
     }
+}
 
-    // call this method recursively for its immediate dominators
-    for (auto dom_succ_bb : dominators_->get_dom_tree_succ_blocks(bb))
-    {
-        re_name(dom_succ_bb);
-    }
-
+// Pop the definitions in the given bb after its dominator tree successors are renamed,
+// and delete the redundant load and store instructions
+void Mem2Reg::exit_block(BasicBlock *bb, std::map<Value *, std::vector<Value *>> &var_val_stack)
+{
+    // the instructions that are waiting to be deleted
+    std::vector<Instruction *> wait_delete;
     for (auto instr : bb->get_instructions())
     {
         // step 7: pop lval's lastest definition
-        if(instr->is_store())
+        if (instr->is_store())
         {
             auto l_val = static_cast<StoreInst *>(instr)->get_lval();
-            if (!IS_GLOBAL_VARIABLE(l_val) && !IS_GEP_INSTR(l_val))
+            if (is_var(l_val))
             {
                 var_val_stack[l_val].pop_back();
+                wait_delete.push_back(instr);
             }
         }
-        else if (instr->is_phi())
+        else if (instr->is_load())
         {
-            auto l_val = static_cast<PhiInst *>(instr)->get_lval();
-            if ( var_val_stack.find(l_val)!=var_val_stack.end())
+            auto l_val = static_cast<LoadInst *>(instr)->get_lval();
+            if (is_var(l_val))
             {
-                var_val_stack[l_val].pop_back();
+                wait_delete.push_back(instr);
             }
         }
+        else if (IS_VAR_PHI(instr))
+        {
+            auto l_val = static_cast<PhiInst *>(instr)->get_lval();
+            var_val_stack[l_val].pop_back();
+        }
     }
 
-    // delete the redundant load and store instructions
+    add_stat("loads and stores removed", wait_delete.size());
     for (auto instr : wait_delete)
     {
         bb->delete_instr(instr);
     }
 }
 
-// remove the alloca instruction for int and float variables in the current function
-void Mem2Reg::remove_alloca()
+// Get the latest definition of l_val, l_val may be used before any store on this path,
+// e.g. a local variable of an inlined function, then its value is undefined and 0 is used
+Value *Mem2Reg::get_latest_val(Value *l_val, std::map<Value *, std::vector<Value *>> &var_val_stack)
 {
-    for (auto bb : func_->get_basic_blocks())
+    auto &val_stack = var_val_stack[l_val];
+    if (!val_stack.empty())
+    {
+        return val_stack.back();
+    }
+    auto type = l_val->get_type()->get_pointer_element_type();
+    if (type->is_float_type())
+    {
+        return ConstantFP::get(0.0f, m_);
+    }
+    if (type->is_integer_type())
+    {
+        return ConstantInt::get(0, m_);
+    }
+    return ConstantZero::get(type, m_);
+}
+
+// The phis of the given function are complete now, forget their variables,
+// so that they are not taken as unfilled phis if Mem2Reg runs again (e.g. after SROA)
+void Mem2Reg::clear_phi_lval(Function *func)
+{
+    for (auto bb : func->get_basic_blocks())
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (IS_VAR_PHI(instr))
+            {
+                static_cast<PhiInst *>(instr)->set_lval(nullptr);
+            }
+        }
+    }
+}
+
+// remove the alloca instruction for the promoted variables in the given function
+void Mem2Reg::remove_alloca(Function *func)
+{
+    for (auto bb : func->get_basic_blocks())
     {
         std::vector<Instruction *> wait_delete;
         for (auto instr : bb->get_instructions())
         {
-            auto is_alloca = dynamic_cast<AllocaInst *>(instr);
-            if (is_alloca)
+            if (is_var(instr))
             {
-                bool is_int = is_alloca->get_type()->get_pointer_element_type()->is_integer_type();
-                bool is_float = is_alloca->get_type()->get_pointer_element_type()->is_float_type();
-                if (is_int || is_float)
-                {
-                    wait_delete.push_back(instr);
-                }
+                wait_delete.push_back(instr);
             }
         }
+        add_stat("allocas promoted", wait_delete.size());
         for (auto instr : wait_delete)
         {
             bb->delete_instr(instr);
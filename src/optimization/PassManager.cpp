@@ -0,0 +1,219 @@
+#include "PassManager.hpp"
+#include "AnalysisManager.hpp"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+static double get_wall_time()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(now).count();
+}
+
+// the cpu time of the calling thread, so that the passes running in parallel are timed separately
+static double get_cpu_time()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+PassManager::PassManager(Module *m, int num_threads)
+    : m_(m), num_threads_(std::max(num_threads, 1)), analysis_manager_(new AnalysisManager(m))
+{
+}
+
+PassManager::~PassManager()
+{
+    for (auto &info : passes_)
+    {
+        for (auto pass : info.instances)
+            delete pass;
+    }
+}
+
+void PassManager::run()
+{
+    int i = 0;
+    while (i < passes_.size())
+    {
+        // a module pass runs alone
+        if (!dynamic_cast<FunctionPass *>(passes_[i].instances[0]))
+        {
+            run_pass(i, 0, nullptr);
+            if (passes_[i].print_ir)
+                std::cout << m_->print();
+            i++;
+            continue;
+        }
+
+        // consecutive function passes run as a group, the ir can only be printed at the end of a group
+        int last = i;
+        while (last < passes_.size() && dynamic_cast<FunctionPass *>(passes_[last].instances[0]))
+        {
+            last++;
+            if (passes_[last - 1].print_ir)
+                break;
+        }
+        run_function_passes(i, last);
+        if (passes_[last - 1].print_ir)
+            std::cout << m_->print();
+        i = last;
+    }
+}
+
+void PassManager::run_function_passes(int first, int last)
+{
+    // step 1: sort the functions by size, the larger ones are scheduled first
+    std::vector<std::pair<int, Function *>> funcs;
+    for (auto f : m_->get_functions())
+    {
+        if (f->is_declaration() || (function_filter_ && !function_filter_(f)))
+            continue;
+        int size = 0;
+        for (auto bb : f->get_basic_blocks())
+        {
+            size += bb->get_instructions().size();
+        }
+        funcs.push_back({size, f});
+    }
+    std::stable_sort(funcs.begin(), funcs.end(),
+                     [](const std::pair<int, Function *> &a, const std::pair<int, Function *> &b) { return a.first > b.first; });
+
+    // step 2: run the group sequentially if there is nothing to parallelize
+    if (num_threads_ == 1 || funcs.size() <= 1)
+    {
+        for (auto &func : funcs)
+        {
+            for (int i = first; i < last; i++)
+            {
+                run_pass(i, 0, func.second);
+            }
+        }
+        return;
+    }
+
+    // step 3: create the instances of the passes for the workers, and run the functions on the thread pool
+    if (!thread_pool_ || thread_pool_->get_num_workers() != num_threads_)
+        thread_pool_.reset(new ThreadPool(num_threads_));
+    for (int i = first; i < last; i++)
+    {
+        while (passes_[i].instances.size() < num_threads_)
+            passes_[i].instances.push_back(passes_[i].create());
+    }
+    std::vector<std::function<void(int)>> tasks;
+    for (auto &func : funcs)
+    {
+        auto f = func.second;
+        tasks.push_back([this, first, last, f](int worker_id) {
+            for (int i = first; i < last; i++)
+            {
+                run_pass(i, worker_id, f);
+            }
+        });
+    }
+    thread_pool_->run_tasks(tasks);
+}
+
+void PassManager::run_pass(int i, int worker_id, Function *f)
+{
+    auto pass = passes_[i].instances[worker_id];
+    double wall = 0, cpu = 0;
+    if (time_passes_)
+    {
+        wall = get_wall_time();
+        cpu = get_cpu_time();
+    }
+
+    if (f)
+    {
+        static_cast<FunctionPass *>(pass)->run_on_function(f);
+        analysis_manager_->invalidate(f, pass->get_preserved_analyses());
+    }
+    else
+    {
+        pass->run();
+        analysis_manager_->invalidate_all(pass->get_preserved_analyses());
+    }
+
+    if (time_passes_)
+    {
+        wall = get_wall_time() - wall;
+        cpu = get_cpu_time() - cpu;
+        std::lock_guard<std::mutex> lock(timing_mutex_);
+        auto &timing = passes_[i].timings[f];
+        timing.wall += wall;
+        timing.cpu += cpu;
+    }
+}
+
+void PassManager::print_timing(std::ostream &out)
+{
+    PassTiming total;
+    for (auto &info : passes_)
+    {
+        for (auto &timing : info.timings)
+        {
+            total.wall += timing.second.wall;
+            total.cpu += timing.second.cpu;
+        }
+    }
+
+    out << "===-------------------------------------------------------------------------===\n";
+    out << "                          Pass execution timing report\n";
+    out << "===-------------------------------------------------------------------------===\n";
+    out << std::fixed << std::setprecision(6);
+    out << "  Total: " << total.wall << "s wall, " << total.cpu << "s cpu\n\n";
+    out << "     Wall(s)      CPU(s)  Pass / Function\n";
+    for (auto &info : passes_)
+    {
+        PassTiming pass_total;
+        for (auto &timing : info.timings)
+        {
+            pass_total.wall += timing.second.wall;
+            pass_total.cpu += timing.second.cpu;
+        }
+        out << std::setw(12) << pass_total.wall << std::setw(12) << pass_total.cpu << "  " << info.name << "\n";
+        // the functions are listed in the order of the module
+        for (auto f : m_->get_functions())
+        {
+            auto iter = info.timings.find(f);
+            if (iter == info.timings.end())
+                continue;
+            out << std::setw(12) << iter->second.wall << std::setw(12) << iter->second.cpu << "    "
+                << f->get_name() << "\n";
+        }
+    }
+    out << std::defaultfloat;
+}
+
+void PassManager::print_stats(std::ostream &out)
+{
+    // { pass name : { counter name : value } }
+    std::map<std::string, std::map<std::string, long long>> stats;
+    for (auto &info : passes_)
+    {
+        for (auto pass : info.instances)
+        {
+            for (auto &stat : pass->get_stats())
+            {
+                stats[info.name][stat.first] += stat.second;
+            }
+        }
+    }
+
+    out << "===-------------------------------------------------------------------------===\n";
+    out << "                          ... Statistics Collected ...\n";
+    out << "===-------------------------------------------------------------------------===\n";
+    for (auto &pass : stats)
+    {
+        for (auto &stat : pass.second)
+        {
+            if (stat.second == 0)
+                continue;
+            out << std::setw(10) << stat.second << " " << pass.first << " - " << stat.first << "\n";
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#include "PassRegistry.hpp"
+#include "BoundsCheckElim.hpp"
+#include "GlobalPromotion.hpp"
+#include "Inliner.hpp"
+#include "InstCombine.hpp"
+#include "LoopUnroll.hpp"
+#include "LoopVectorize.hpp"
+#include "Mem2Reg.hpp"
+#include "SROA.hpp"
+#include "StrengthReduction.hpp"
+#include "TailRecursionElim.hpp"
+#include <functional>
+#include <map>
+#include <sstream>
+#include <type_traits>
+
+template <typename PassType>
+static void add(PassManager &pm, const std::string &name, bool print_ir)
+{
+    pm.add_pass<PassType>(print_ir, name);
+}
+
+typedef std::function<void(PassManager &, const std::string &, bool)> PassAdder;
+
+struct PassEntry
+{
+    PassAdder add;
+    bool is_function_pass;
+};
+
+template <typename PassType>
+static PassEntry entry()
+{
+    return {add<PassType>, std::is_base_of<FunctionPass, PassType>::value};
+}
+
+// { name : the function adding the pass }
+static const std::map<std::string, PassEntry> &get_registry()
+{
+    static const std::map<std::string, PassEntry> registry = {
+        {"bce", entry<BoundsCheckElim>()},
+        {"globalopt", entry<GlobalPromotion>()},
+        {"inline", entry<Inliner>()},
+        {"instcombine", entry<InstCombine>()},
+        {"loop-reduce", entry<StrengthReduction>()},
+        {"loop-unroll", entry<LoopUnroll>()},
+        {"loop-vectorize", entry<LoopVectorize>()},
+        {"mem2reg", entry<Mem2Reg>()},
+        {"sroa", entry<SROA>()},
+        {"tre", entry<TailRecursionElim>()},
+    };
+    return registry;
+}
+
+bool PassRegistry::add_pass(PassManager &pm, const std::string &name, bool print_ir)
+{
+    auto &registry = get_registry();
+    auto iter = registry.find(name);
+    if (iter == registry.end())
+        return false;
+    iter->second.add(pm, name, print_ir);
+    return true;
+}
+
+bool PassRegistry::add_pipeline(PassManager &pm, const std::string &pipeline)
+{
+    std::stringstream ss(pipeline);
+    std::string name;
+    while (std::getline(ss, name, ','))
+    {
+        if (name.empty())
+            continue;
+        if (!add_pass(pm, name))
+            return false;
+    }
+    return true;
+}
+
+std::vector<std::string> PassRegistry::get_pass_names()
+{
+    std::vector<std::string> names;
+    for (auto &entry : get_registry())
+    {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+bool PassRegistry::is_function_pass(const std::string &name)
+{
+    auto &registry = get_registry();
+    auto iter = registry.find(name);
+    return iter != registry.end() && iter->second.is_function_pass;
+}
+
+std::string PassRegistry::get_default_pipeline(int opt_level)
+{
+    switch (opt_level)
+    {
+    case 0:
+        return "";
+    case 1:
+        return "mem2reg,instcombine";
+    case 2:
+        // inlining and global promotion expose more variables to Mem2Reg,
+        // SROA splits the arrays whose indices InstCombine has folded to constants,
+        // the loop passes come after TRE, since the loops of tail recursion are only formed by TRE;
+        // the vectorizer needs the element pointers which strength reduction turns into pointer phis,
+        // the unrolled loops share those phis, and InstCombine folds the offsets of their clones
+        return "inline,globalopt,mem2reg,instcombine,sroa,mem2reg,instcombine,bce,tre,"
+               "loop-vectorize,loop-reduce,loop-unroll,instcombine";
+    default:
+        return "";
+    }
+}
@@ -0,0 +1,94 @@
+#include "SROA.hpp"
+#include <vector>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+
+// larger arrays are usually accessed in loops, so they are left in memory
+const int SROA_MAX_ELEMENTS = 64;
+
+void SROA::run_on_function(Function *func)
+{
+    std::vector<AllocaInst *> allocas;
+    for (auto bb : func->get_basic_blocks())
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (instr->is_alloca() && is_splittable(static_cast<AllocaInst *>(instr)))
+            {
+                allocas.push_back(static_cast<AllocaInst *>(instr));
+            }
+        }
+    }
+    for (auto alloca : allocas)
+    {
+        split(alloca);
+    }
+    add_stat("arrays split", allocas.size());
+}
+
+bool SROA::is_splittable(AllocaInst *alloca)
+{
+    auto type = alloca->get_alloca_type();
+    if (!type->is_array_type())
+        return false;
+    auto array_type = static_cast<ArrayType *>(type);
+    if (array_type->get_num_of_elements() > SROA_MAX_ELEMENTS)
+        return false;
+
+    for (auto &use : alloca->get_use_list())
+    {
+        // getelementptr [N x T], [N x T]* %a, i32 0, i32 c
+        auto gep = dynamic_cast<GetElementPtrInst *>(use.val_);
+        if (!gep || use.arg_no_ != 0 || gep->get_num_operand() != 3)
+            return false;
+        auto first = CONST_INT(gep->get_operand(1));
+        auto idx = CONST_INT(gep->get_operand(2));
+        if (!first || first->get_value() != 0 || !idx || idx->get_value() < 0 ||
+            idx->get_value() >= (int)array_type->get_num_of_elements())
+            return false;
+
+        // the element pointer doesn't escape
+        for (auto &gep_use : gep->get_use_list())
+        {
+            auto user = dynamic_cast<Instruction *>(gep_use.val_);
+            if (!user)
+                return false;
+            if (!(user->is_load() || (user->is_store() && gep_use.arg_no_ == 1)))
+                return false;
+        }
+    }
+    return true;
+}
+
+void SROA::split(AllocaInst *alloca)
+{
+    auto bb = alloca->get_parent();
+    auto element_type = static_cast<ArrayType *>(alloca->get_alloca_type())->get_element_type();
+
+    // step 1: create an alloca for each accessed element, next to the array
+    std::map<int, AllocaInst *> elements;
+    std::vector<GetElementPtrInst *> geps;
+    for (auto &use : alloca->get_use_list())
+    {
+        auto gep = static_cast<GetElementPtrInst *>(use.val_);
+        auto idx = CONST_INT(gep->get_operand(2))->get_value();
+        if (elements.find(idx) == elements.end())
+        {
+            auto element = AllocaInst::create_alloca(element_type, bb);
+            bb->get_instructions().pop_back();
+            bb->add_instr_before(element, alloca);
+            elements[idx] = element;
+            add_stat("elements created");
+        }
+        geps.push_back(gep);
+    }
+
+    // step 2: access the elements directly
+    for (auto gep : geps)
+    {
+        auto idx = CONST_INT(gep->get_operand(2))->get_value();
+        gep->replace_all_use_with(elements[idx]);
+        gep->get_parent()->delete_instr(gep);
+    }
+    bb->delete_instr(alloca);
+}
@@ -0,0 +1,196 @@
+#include "StrengthReduction.hpp"
+#include "AnalysisManager.hpp"
+#include <vector>
+
+#define CONST_INT(val) dynamic_cast<ConstantInt *>(val)
+
+// each new phi takes a register through the loop, so only so many are created in a loop
+const int MAX_REDUCED_PER_LOOP = 8;
+
+void StrengthReduction::run_on_function(Function *func)
+{
+    auto loop_search = am_->get_loop_search(func);
+    // the outer loops come first, so the inner loops are reduced first in reverse order
+    auto &loops = loop_search->get_loops_in_func(func);
+    for (auto iter = loops.rbegin(); iter != loops.rend(); ++iter)
+    {
+        reduce_loop(*iter, loop_search);
+    }
+}
+
+void StrengthReduction::reduce_loop(Loop *loop, LoopSearch *loop_search)
+{
+    InductionVars ivs(loop);
+    if (!ivs.get_entry())
+        return;
+
+    // step 1: find the element pointers and multiplications which are affine induction variables,
+    // the instructions of inner loops have been reduced there
+    std::vector<std::pair<GetElementPtrInst *, InductionVars::AffineIV>> geps;
+    std::vector<std::pair<Instruction *, InductionVars::AffineIV>> muls;
+    for (auto bb : loop->get_blocks())
+    {
+        if (loop_search->get_inner_loop(bb) != loop)
+            continue;
+        for (auto instr : bb->get_instructions())
+        {
+            InductionVars::AffineIV iv;
+            if (instr->is_gep())
+            {
+                auto idx = InductionVars::get_gep_index(instr);
+                if (idx && ivs.is_invariant(instr->get_operand(0)) && ivs.get_affine_iv(idx, iv) && iv.scale != 0)
+                    geps.push_back({static_cast<GetElementPtrInst *>(instr), iv});
+            }
+            else if ((instr->is_mul() || instr->is_shl()) && ivs.get_affine_iv(instr, iv) && iv.scale != 0)
+            {
+                muls.push_back({instr, iv});
+            }
+        }
+    }
+
+    // step 2: replace the element pointers with pointer phis,
+    // the pointers with the same base and index share a phi
+    int reduced = 0;
+    // the phis created here, which may be left only used by their increments, e.g. the phi of i * 4 in (i * 4) * 2
+    std::vector<PhiInst *> new_phis;
+    std::map<std::tuple<Value *, PhiInst *, int, Value *, int>, PhiInst *> pointer_phis;
+    for (auto &gep_iv : geps)
+    {
+        auto gep = gep_iv.first;
+        auto &iv = gep_iv.second;
+        auto base = gep->get_operand(0);
+        auto key = std::make_tuple(base, iv.phi, iv.scale, iv.offset_val, iv.offset);
+        if (pointer_phis.find(key) == pointer_phis.end())
+        {
+            if (reduced == MAX_REDUCED_PER_LOOP)
+                continue;
+            reduced++;
+            ivs.hoist(base);
+            std::vector<Value *> idxs(gep->get_operands().begin() + 1, gep->get_operands().end());
+            idxs.back() = get_init_value(ivs, iv);
+            auto init = ivs.get_entry()->insert_before_terminator(GetElementPtrInst::create_gep(base, idxs, ivs.get_entry()));
+            int stride = (unsigned)iv.scale * (unsigned)ivs.get_basic_iv(iv.phi)->step;
+            pointer_phis[key] = create_phi(loop, ivs.get_entry(), init, stride);
+            new_phis.push_back(pointer_phis[key]);
+            add_stat("pointer phis created");
+        }
+        gep->replace_all_use_with(pointer_phis[key]);
+        gep->get_parent()->delete_instr(gep);
+        add_stat("geps reduced");
+    }
+
+    // step 3: replace the multiplications still used with phis advanced by adds
+    std::map<std::tuple<PhiInst *, int, Value *, int>, PhiInst *> scalar_phis;
+    for (auto &mul_iv : muls)
+    {
+        auto mul = mul_iv.first;
+        auto &iv = mul_iv.second;
+        if (mul->get_use_list().empty())
+            continue;
+        auto key = std::make_tuple(iv.phi, iv.scale, iv.offset_val, iv.offset);
+        if (scalar_phis.find(key) == scalar_phis.end())
+        {
+            if (reduced == MAX_REDUCED_PER_LOOP)
+                continue;
+            reduced++;
+            int stride = (unsigned)iv.scale * (unsigned)ivs.get_basic_iv(iv.phi)->step;
+            scalar_phis[key] = create_phi(loop, ivs.get_entry(), get_init_value(ivs, iv), stride);
+            new_phis.push_back(scalar_phis[key]);
+        }
+        mul->replace_all_use_with(scalar_phis[key]);
+        mul->get_parent()->delete_instr(mul);
+        add_stat("multiplications reduced");
+    }
+
+    if (reduced > 0)
+        remove_dead_instrs(loop, ivs, new_phis);
+}
+
+Value *StrengthReduction::get_init_value(InductionVars &ivs, InductionVars::AffineIV &iv)
+{
+    auto entry = ivs.get_entry();
+    auto init = ivs.get_basic_iv(iv.phi)->init;
+    if (iv.offset_val)
+        ivs.hoist(iv.offset_val);
+    if (CONST_INT(init))
+    {
+        int first = (unsigned)iv.scale * (unsigned)CONST_INT(init)->get_value() + (unsigned)iv.offset;
+        if (!iv.offset_val)
+            return ConstantInt::get(first, m_);
+        if (first == 0)
+            return iv.offset_val;
+        return entry->insert_before_terminator(BinaryInst::create_add(iv.offset_val, ConstantInt::get(first, m_), entry, m_));
+    }
+
+    Value *val = init;
+    if (iv.scale != 1)
+        val = entry->insert_before_terminator(BinaryInst::create_mul(val, ConstantInt::get(iv.scale, m_), entry, m_));
+    if (iv.offset != 0)
+        val = entry->insert_before_terminator(BinaryInst::create_add(val, ConstantInt::get(iv.offset, m_), entry, m_));
+    if (iv.offset_val)
+        val = entry->insert_before_terminator(BinaryInst::create_add(val, iv.offset_val, entry, m_));
+    return val;
+}
+
+PhiInst *StrengthReduction::create_phi(Loop *loop, BasicBlock *entry, Value *init, int stride)
+{
+    auto header = loop->get_header();
+    auto latch = loop->get_latch();
+    auto phi = PhiInst::create_phi(init->get_type(), header);
+    header->add_instr_begin(phi);
+    Instruction *next;
+    if (init->get_type()->is_pointer_type())
+        next = GetElementPtrInst::create_gep(phi, {ConstantInt::get(stride, m_)}, latch);
+    else
+        next = BinaryInst::create_add(phi, ConstantInt::get(stride, m_), latch, m_);
+    latch->insert_before_terminator(next);
+    phi->add_phi_pair_operand(init, entry);
+    phi->add_phi_pair_operand(next, latch);
+    return phi;
+}
+
+void StrengthReduction::remove_dead_instrs(Loop *loop, InductionVars &ivs, std::vector<PhiInst *> &new_phis)
+{
+    // step 1: remove the arithmetic and the element pointers nobody uses
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (auto bb : loop->get_blocks())
+        {
+            std::vector<Instruction *> dead;
+            for (auto instr : bb->get_instructions())
+            {
+                if (instr->get_use_list().empty() &&
+                    (instr->is_int_instr() || instr->is_gep() || instr->is_cmp() || instr->is_zext()))
+                    dead.push_back(instr);
+            }
+            for (auto instr : dead)
+            {
+                bb->delete_instr(instr);
+                changed = true;
+            }
+        }
+    }
+
+    // step 2: remove the basic induction variables and the new phis only used by their own increments
+    std::vector<PhiInst *> phis(new_phis);
+    for (auto instr : loop->get_header()->get_instructions())
+    {
+        if (!instr->is_phi())
+            break;
+        if (ivs.get_basic_iv(static_cast<PhiInst *>(instr)))
+            phis.push_back(static_cast<PhiInst *>(instr));
+    }
+    for (auto phi : phis)
+    {
+        if (phi->get_use_list().size() != 1)
+            continue;
+        auto next = dynamic_cast<Instruction *>(phi->get_use_list().front().val_);
+        if (!next || next->is_phi() || next->get_use_list().size() != 1 || next->get_use_list().front().val_ != phi)
+            continue;
+        next->get_parent()->delete_instr(next);
+        phi->get_parent()->delete_instr(phi);
+        add_stat("induction variables removed");
+    }
+}
@@ -0,0 +1,131 @@
+#include "TailRecursionElim.hpp"
+#include <algorithm>
+
+void TailRecursionElim::run_on_function(Function *func)
+{
+    // step 1: find the self tail calls
+    std::vector<CallInst *> tail_calls;
+    for (auto bb : func->get_basic_blocks())
+    {
+        for (auto instr : bb->get_instructions())
+        {
+            if (instr->is_call() && instr->get_operand(0) == func &&
+                is_tail_call(static_cast<CallInst *>(instr)) &&
+                !passes_local_memory(static_cast<CallInst *>(instr)))
+            {
+                tail_calls.push_back(static_cast<CallInst *>(instr));
+            }
+        }
+    }
+    if (tail_calls.empty())
+        return;
+
+    // step 2: create a new entry block, the old one becomes the loop header
+    auto header = func->get_entry_block();
+    auto new_entry = BasicBlock::create(m_, "", func);
+    auto &bbs = func->get_basic_blocks();
+    bbs.remove(new_entry);
+    bbs.push_front(new_entry);
+    auto header_instrs = header->get_instructions();
+    for (auto instr : header_instrs)
+    {
+        if (instr->is_alloca())
+        {
+            header->get_instructions().remove(instr);
+            new_entry->add_instruction(instr);
+            instr->set_parent(new_entry);
+        }
+    }
+    BranchInst::create_br(header, new_entry);
+
+    // step 3: the arguments are phis in the header now
+    std::vector<PhiInst *> arg_phis;
+    for (auto arg : func->get_args())
+    {
+        auto phi = PhiInst::create_phi(arg->get_type(), header);
+        arg->replace_all_use_with(phi);
+        phi->add_phi_pair_operand(arg, new_entry);
+        arg_phis.push_back(phi);
+    }
+    for (auto iter = arg_phis.rbegin(); iter != arg_phis.rend(); iter++)
+    {
+        header->add_instr_begin(*iter);
+    }
+
+    // step 4: replace each tail call and its return with a branch to the header
+    for (auto call : tail_calls)
+    {
+        auto bb = call->get_parent();
+        for (int i = 0; i < arg_phis.size(); i++)
+        {
+            arg_phis[i]->add_phi_pair_operand(call->get_operand(i + 1), bb);
+        }
+        auto terminator = bb->get_terminator();
+        if (terminator->is_br())
+        {
+            auto ret_bb = static_cast<BasicBlock *>(terminator->get_operand(0));
+            bb->remove_succ_basic_block(ret_bb);
+            ret_bb->remove_pre_basic_block(bb);
+            for (auto instr : ret_bb->get_instructions())
+            {
+                if (!instr->is_phi())
+                    break;
+                for (int i = instr->get_num_operand() - 2; i >= 0; i -= 2)
+                {
+                    if (instr->get_operand(i + 1) == bb)
+                        instr->remove_operands(i, i + 1);
+                }
+            }
+        }
+        bb->delete_instr(terminator);
+        bb->delete_instr(call);
+        BranchInst::create_br(header, bb);
+        add_stat("tail calls eliminated");
+    }
+}
+
+bool TailRecursionElim::is_tail_call(CallInst *call)
+{
+    auto &instrs = call->get_parent()->get_instructions();
+    auto next = std::next(std::find(instrs.begin(), instrs.end(), call));
+    if (next == instrs.end())
+        return false;
+    auto next_instr = *next;
+
+    // call f; ret call
+    if (next_instr->is_ret())
+    {
+        auto ret = static_cast<ReturnInst *>(next_instr);
+        if (ret->is_void_ret())
+            return call->is_void();
+        return ret->get_operand(0) == call;
+    }
+
+    // call void f; br label %bb, where bb only has phis and ret void
+    if (next_instr->is_br() && !static_cast<BranchInst *>(next_instr)->is_cond_br() && call->is_void())
+    {
+        auto ret_bb = static_cast<BasicBlock *>(next_instr->get_operand(0));
+        for (auto instr : ret_bb->get_instructions())
+        {
+            if (instr->is_ret())
+                return true;
+            if (!instr->is_phi())
+                return false;
+        }
+    }
+    return false;
+}
+
+bool TailRecursionElim::passes_local_memory(CallInst *call)
+{
+    for (int i = 1; i < call->get_num_operand(); i++)
+    {
+        // the allocas are reused by the next iteration, so a callee can't point to them
+        auto val = call->get_operand(i);
+        while (dynamic_cast<GetElementPtrInst *>(val))
+            val = static_cast<GetElementPtrInst *>(val)->get_operand(0);
+        if (dynamic_cast<AllocaInst *>(val))
+            return true;
+    }
+    return false;
+}
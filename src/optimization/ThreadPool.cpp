@@ -0,0 +1,112 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int num_workers) : num_workers_(std::max(num_workers, 1))
+{
+    for (int i = 0; i < num_workers_; i++)
+    {
+        queues_.emplace_back(new TaskQueue());
+    }
+    for (int i = 1; i < num_workers_; i++)
+    {
+        threads_.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        stopping_ = true;
+    }
+    batch_start_.notify_all();
+    for (auto &thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::run_tasks(const std::vector<std::function<void(int)>> &tasks)
+{
+    if (tasks.empty())
+        return;
+
+    // step 1: deal the tasks to the workers, a worker takes tasks from the back of its queue,
+    // so they are pushed in reverse order to run the first (e.g. the largest) tasks first
+    for (int i = tasks.size() - 1; i >= 0; i--)
+    {
+        auto &queue = *queues_[i % num_workers_];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(&tasks[i]);
+    }
+
+    // step 2: wake up the workers, and work as worker 0
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex_);
+        batch_id_++;
+        busy_workers_ = num_workers_ - 1;
+    }
+    batch_start_.notify_all();
+    work(0);
+
+    // step 3: wait for the tasks still running on other workers
+    std::unique_lock<std::mutex> lock(batch_mutex_);
+    batch_done_.wait(lock, [this] { return busy_workers_ == 0; });
+}
+
+void ThreadPool::worker_loop(int worker_id)
+{
+    unsigned last_batch_id = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(batch_mutex_);
+            batch_start_.wait(lock, [&] { return stopping_ || batch_id_ != last_batch_id; });
+            if (stopping_)
+                return;
+            last_batch_id = batch_id_;
+        }
+        work(worker_id);
+        {
+            std::lock_guard<std::mutex> lock(batch_mutex_);
+            busy_workers_--;
+        }
+        batch_done_.notify_all();
+    }
+}
+
+void ThreadPool::work(int worker_id)
+{
+    // no task is added during a batch, so the batch is over for this worker
+    // once all the queues are empty
+    while (auto task = pop_task(worker_id))
+    {
+        (*task)(worker_id);
+    }
+}
+
+const std::function<void(int)> *ThreadPool::pop_task(int worker_id)
+{
+    {
+        auto &queue = *queues_[worker_id];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
+        {
+            auto task = queue.tasks.back();
+            queue.tasks.pop_back();
+            return task;
+        }
+    }
+    for (int i = 1; i < num_workers_; i++)
+    {
+        auto &victim = *queues_[(worker_id + i) % num_workers_];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            auto task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return task;
+        }
+    }
+    return nullptr;
+}
@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 import subprocess
+import sys
 # { name: need_input }
 testcases = {
     "01": True,
@@ -36,9 +37,25 @@ testcases = {
     "30": False,
     "31": False,
     "33": False,
+    "fmul_neg_zero": True,
+    "deep_recursion": False,
+    "opt_passes": False,
+    "loop_unroll": False,
+    "loop_vectorize": False,
+    "loop_reduce_mem2reg": False,
+    "array_io": True,
+    "array_io_bounds": True,
+}
+# { name: the options of cminusfc }
+options = {
+    "opt_passes": ["-check-bounds"],
+    # mem2reg again after loop-reduce must leave its pointer phis alone
+    "loop_reduce_mem2reg": ["-passes=mem2reg,loop-reduce,mem2reg"],
+    # outputArray(a, n) with n larger than a
+    "array_io_bounds": ["-check-bounds"],
 }
 
-def eval():
+def eval(riscv, run_option, opt_level):
     EXE_PATH = "../../build/cminusfc"
     TEST_BASE_PATH = "./testcases/"
     print('===========TEST START===========')
@@ -48,10 +65,27 @@ def eval():
         INPUT_PATH = TEST_BASE_PATH + case + '.in'
         OUTPUT_PATH = TEST_BASE_PATH + case + '.out'
         need_input = testcases[case]
+        # an explicit -passes of the case replaces the pipeline of opt_level
+        flags = ([opt_level] if opt_level else []) + options.get(case, [])
 
         COMMAND = [TEST_PATH]
+        timeout = 1
 
-        result = subprocess.run([EXE_PATH, TEST_PATH + ".cminus"], stderr=subprocess.PIPE)
+        if run_option:
+            # the compiler runs the program itself, nothing is built
+            COMMAND = [EXE_PATH, run_option] + flags + [TEST_PATH + ".cminus"]
+            result = subprocess.CompletedProcess(COMMAND, 0)
+        elif riscv:
+            # the RISC-V assembly is linked statically with the io library and run under qemu
+            COMMAND = ["qemu-riscv64", TEST_PATH]
+            timeout = 10
+            result = subprocess.run([EXE_PATH, "-S", "-target=riscv64"] + flags + [TEST_PATH + ".cminus"], stderr=subprocess.PIPE)
+            if result.returncode == 0:
+                result = subprocess.run(["riscv64-linux-gnu-gcc", "-static", "-w", TEST_PATH + ".s", "../../src/io/io.c",
+                                         "-o", TEST_PATH], stderr=subprocess.PIPE)
+                subprocess.call(["rm", "-f", TEST_PATH + ".s"])
+        else:
+            result = subprocess.run([EXE_PATH] + flags + [TEST_PATH + ".cminus"], stderr=subprocess.PIPE)
         if result.returncode == 0:
             input_option = None
             if need_input:
@@ -59,7 +93,7 @@ def eval():
                     input_option = fin.read()
 
             try:
-                result = subprocess.run(COMMAND, input=input_option, stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=1)
+                result = subprocess.run(COMMAND, input=input_option, stdout=subprocess.PIPE, stderr=subprocess.PIPE, timeout=timeout)
                 with open(OUTPUT_PATH, "rb") as fout:
                     if result.stdout == fout.read():
                         print('\t\033[32mSuccess\033[0m')
@@ -77,4 +111,9 @@ def eval():
 
 
 if __name__ == "__main__":
-    eval()
+    # --riscv tests the RISC-V backend instead, with a cross toolchain and qemu-riscv64,
+    # --jit runs the tests in the compiler with --run, and --interpret with --interpret,
+    # -O1 or -O2 compiles them with the passes of that level
+    run_option = "--run" if "--jit" in sys.argv[1:] else "--interpret" if "--interpret" in sys.argv[1:] else None
+    opt_level = "-O2" if "-O2" in sys.argv[1:] else "-O1" if "-O1" in sys.argv[1:] else None
+    eval("--riscv" in sys.argv[1:], run_option, opt_level)